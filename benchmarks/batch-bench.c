@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/batch.h>
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define LINES 100000
+
+struct counts {
+    size_t lines;
+    size_t failures;
+};
+
+static int level;
+static const char *name;
+
+static void
+report(const size_t line, const int exit_code, void * const ctx)
+{
+    struct counts *c = ctx;
+
+    (void)line;
+
+    c->lines++;
+    if (exit_code)
+        c->failures++;
+}
+
+static void
+noop(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)exit_code;
+    (void)ctx;
+}
+
+static const struct cli_option options[] = {
+    {
+        .shrt = 'l',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &level,
+    },
+    {
+        .shrt = 'n',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = &name,
+    },
+};
+
+static char *
+generate(size_t * const len)
+{
+    char *buf;
+    size_t off = 0;
+    const size_t size = (size_t)LINES * 64;
+
+    buf = malloc(size);
+    assert(buf);
+
+    for (size_t i = 0; i < LINES; i++)
+        off += (size_t)snprintf(buf + off, size - off, "cmd%zu -l %zu -n job-%zu\n", i % 16, i, i);
+
+    *len = off;
+
+    return buf;
+}
+
+static void
+run(const struct cli * const cli, const char * const variant, char * const input, const size_t len)
+{
+    merr_t err;
+    FILE *stream;
+    uint64_t start;
+    struct counts c = { 0 };
+    struct cli_parser parser = { .program_name = "bench" };
+    const struct cli_batch batch = { .delim = '\n', .report = report, .ctx = &c };
+
+    stream = fmemopen(input, len, "r");
+    assert(stream);
+
+    start = bench_now();
+    err = cli_parse_batch(cli, stream, &batch, &parser);
+    bench_report(variant, LINES, bench_now() - start, LINES);
+    assert(!err && c.lines == LINES && c.failures == 0);
+    (void)err;
+
+    fclose(stream);
+}
+
+int
+main(void)
+{
+    merr_t err;
+    char *input;
+    size_t len;
+    struct cli root = { .name = "bench" };
+    struct cli subcommands[16];
+    char names[16][8];
+    struct cli_option copies[16][NELEM(options)];
+
+    memset(subcommands, 0, sizeof(subcommands));
+    for (size_t i = 0; i < NELEM(subcommands); i++) {
+        snprintf(names[i], sizeof(names[i]), "cmd%zu", i);
+        subcommands[i].name = names[i];
+        subcommands[i].callback = noop;
+    }
+
+    /* Every subcommand shares the same storage, which is what the reset
+     * between lines has to cope with.
+     */
+    for (size_t i = 0; i < NELEM(subcommands); i++) {
+        memcpy(copies[i], options, sizeof(options));
+        err = cli_add_options(&subcommands[i], NELEM(options), copies[i]);
+        assert(!err);
+    }
+
+    err = cli_add_subcommands(&root, NELEM(subcommands), subcommands);
+    assert(!err);
+    (void)err;
+
+    input = generate(&len);
+
+    run(&root, "batch/uncompiled", input, len);
+
+    /* Lines are split in place, so start over from a fresh copy. */
+    free(input);
+    input = generate(&len);
+
+    err = cli_compile(&root);
+    assert(!err);
+
+    run(&root, "batch/compiled", input, len);
+
+    free(input);
+    cli_fini(&root);
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_BENCH_H
+#define LIBCLI_BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static inline uint64_t
+bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* With LIBCLI_BENCH_FORMAT=json, results are printed as one JSON object per
+ * line so that they can be collected and compared across releases. Names
+ * never need escaping.
+ */
+static inline bool
+bench_json(void)
+{
+    const char * const format = getenv("LIBCLI_BENCH_FORMAT");
+
+    return format && strcmp(format, "json") == 0;
+}
+
+static inline void
+bench_metric(
+    const char * const name,
+    const size_t n,
+    const char * const metric,
+    const double value,
+    const char * const unit)
+{
+    if (bench_json()) {
+        printf(
+            "{\"name\":\"%s\",\"n\":%zu,\"metric\":\"%s\",\"value\":%.2f,\"unit\":\"%s\"}\n",
+            name,
+            n,
+            metric,
+            value,
+            unit);
+    } else {
+        printf("%-40s %10zu %14.2f %s %s\n", name, n, value, unit, metric);
+    }
+}
+
+static inline void
+bench_report(const char * const name, const size_t n, const uint64_t ns, const size_t ops)
+{
+    const double value = (double)ns / (double)(ops ? ops : 1);
+
+    if (bench_json()) {
+        bench_metric(name, n, "time", value, "ns/op");
+    } else {
+        printf("%-40s %10zu %14.2f ns/op\n", name, n, value);
+    }
+}
+
+#endif
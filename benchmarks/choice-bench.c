@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define PARSES 200000
+
+static uint64_t
+run(const struct cli * const cli, char (* const names)[32], const size_t choicec, int * const choice)
+{
+    uint64_t start;
+    char *args[] = { "bench", "-c", NULL };
+
+    start = bench_now();
+    for (size_t i = 0; i < PARSES; i++) {
+        merr_t err;
+        int exit_code;
+        const size_t j = (i * 7919) % choicec;
+
+        args[2] = names[j];
+        err = cli_parse(cli, NELEM(args), args, &exit_code);
+        assert(!err && exit_code == 0 && (size_t)*choice == j);
+        (void)err;
+    }
+    (void)choice;
+
+    return bench_now() - start;
+}
+
+int
+main(void)
+{
+    static const size_t choicec[] = { 3, 30, 300, 3000, 30000 };
+
+    for (size_t i = 0; i < NELEM(choicec); i++) {
+        merr_t err;
+        int choice = -1;
+        const size_t n = choicec[i];
+        char (*names)[32];
+        const char **choices;
+        struct cli cli = { .name = "bench" };
+        struct cli_option option = {
+            .shrt = 'c',
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_CHOICE,
+            .action = CLI_ACTION_STORE,
+            .data = &choice,
+        };
+
+        names = calloc(n, sizeof(*names));
+        choices = calloc(n + 1, sizeof(*choices));
+        assert(names && choices);
+
+        for (size_t j = 0; j < n; j++) {
+            snprintf(names[j], sizeof(names[j]), "us-region-%zu", j);
+            choices[j] = names[j];
+        }
+        option.choices = choices;
+
+        err = cli_add_option(&cli, &option);
+        assert(!err);
+
+        bench_report("choice/parse/uncompiled", n, run(&cli, names, n, &choice), PARSES);
+
+        err = cli_compile(&cli);
+        assert(!err);
+        (void)err;
+
+        bench_report("choice/parse/compiled", n, run(&cli, names, n, &choice), PARSES);
+
+        cli_fini(&cli);
+        free(choices);
+        free(names);
+    }
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define FANOUT     100
+#define OPTIONS    8
+#define ITERATIONS 20000
+
+struct node {
+    struct cli cli;
+    char name[32];
+    struct cli_option options[OPTIONS];
+    char option_names[OPTIONS][32];
+};
+
+static struct node *nodes;
+
+static void
+node_init(struct node * const n, const char * const name)
+{
+    merr_t err;
+
+    snprintf(n->name, sizeof(n->name), "%s", name);
+    n->cli.name = n->name;
+    n->cli.flags = CLI_FLAG_COMPLETION;
+
+    for (size_t i = 0; i < OPTIONS; i++) {
+        struct cli_option *o = n->options + i;
+
+        o->shrt = (char)('a' + i);
+#ifndef CLI_NO_GETOPT_LONG
+        snprintf(n->option_names[i], sizeof(n->option_names[i]), "option-%zu", i);
+        o->lng = n->option_names[i];
+#endif
+        o->argument = CLI_HAS_ARG_REQUIRED;
+        o->action = CLI_ACTION_HELP;
+    }
+
+    err = cli_add_options(&n->cli, OPTIONS, n->options);
+    assert(!err);
+    (void)err;
+}
+
+/* A root with FANOUT subcommands, each of which has FANOUT subcommands. */
+static struct cli *
+tree_init(void)
+{
+    merr_t err;
+    size_t next = 1;
+    const size_t count = 1 + FANOUT + FANOUT * FANOUT;
+
+    nodes = calloc(count, sizeof(*nodes));
+    assert(nodes);
+
+    node_init(nodes, "complete-bench");
+    for (size_t i = 0; i < FANOUT; i++) {
+        struct node * const mid = nodes + next++;
+        char name[32];
+
+        snprintf(name, sizeof(name), "command-%zu", i);
+        node_init(mid, name);
+        for (size_t j = 0; j < FANOUT; j++) {
+            struct node * const leaf = nodes + next++;
+
+            snprintf(name, sizeof(name), "action-%zu", j);
+            node_init(leaf, name);
+            err = cli_add_subcommand(&mid->cli, &leaf->cli);
+            assert(!err);
+        }
+
+        err = cli_add_subcommand(&nodes->cli, &mid->cli);
+        assert(!err);
+    }
+    (void)err;
+
+    printf("%zu nodes\n", count);
+
+    return &nodes->cli;
+}
+
+static void
+bench(const char * const name, const struct cli * const cli, char ** const argv, const int argc)
+{
+    uint64_t start;
+    struct cli_parser parser = { 0 };
+
+    parser.out = fopen("/dev/null", "w");
+    assert(parser.out);
+
+    start = bench_now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        merr_t err;
+        int exit_code;
+
+        err = cli_parse_r(cli, argc, argv, &exit_code, &parser);
+        assert(!err && exit_code == 0);
+        (void)err;
+    }
+    bench_report(name, ITERATIONS, bench_now() - start, ITERATIONS);
+
+    fclose(parser.out);
+}
+
+int
+main(void)
+{
+    merr_t err;
+    struct cli *cli;
+    char *subcommand[] = { "complete-bench", "__complete", "-a", "x", "command-42", "action-1" };
+    char *option[] = { "complete-bench", "__complete", "command-42", "action-7", "--option-" };
+
+    cli = tree_init();
+
+    bench("uncompiled subcommand", cli, subcommand, NELEM(subcommand));
+    bench("uncompiled option", cli, option, NELEM(option));
+
+    err = cli_compile(cli);
+    assert(!err);
+    (void)err;
+
+    bench("compiled subcommand", cli, subcommand, NELEM(subcommand));
+    bench("compiled option", cli, option, NELEM(option));
+
+    cli_fini(cli);
+    free(nodes);
+
+    return 0;
+}
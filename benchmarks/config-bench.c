@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include <libcli/config.h>
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define ROUNDS 5
+
+#ifndef CLI_NO_GETOPT_LONG
+static int jobs;
+static const char *target;
+
+static struct cli_option options[] = {
+    {
+        .lng = "jobs",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &jobs,
+    },
+    {
+        .lng = "target",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = &target,
+    },
+};
+#endif
+
+static void
+noop(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    *exit_code = 0;
+}
+
+/* A config shared by many tools, of which this one only reads one section. */
+static void
+generate(const char * const file, const size_t size)
+{
+    FILE *f;
+    size_t n = 0;
+
+    f = fopen(file, "w");
+    assert(f);
+
+    n += (size_t)fprintf(f, "[build]\njobs = 8\ntarget = \"x86_64-linux\"\n");
+    for (size_t i = 0; n < size; i++) {
+        if (i % 16 == 0)
+            n += (size_t)fprintf(f, "\n[tool-%zu sub-%zu]\n", i / 16 % 997, i % 7);
+        n += (size_t)fprintf(f, "option-%zu = value for option %zu\n", i % 64, i);
+    }
+
+    fclose(f);
+}
+
+static void
+run(struct cli * const cli, const size_t size)
+{
+    int fd;
+    merr_t err;
+    char name[64];
+    uint64_t open_ns = 0;
+    uint64_t parse_ns = 0;
+    char file[] = "/tmp/libcli-config-bench-XXXXXX";
+
+    fd = mkstemp(file);
+    assert(fd != -1);
+    close(fd);
+
+    generate(file, size);
+
+    for (int r = 0; r < ROUNDS; r++) {
+        uint64_t start;
+        int exit_code;
+        struct cli_config *config;
+        struct cli_parser parser = { .program_name = "bench" };
+        char *argv[] = { "bench", "build", NULL };
+
+        start = bench_now();
+        err = cli_config_open(file, &config, NULL);
+        open_ns += bench_now() - start;
+        assert(!err);
+
+        parser.config = config;
+
+        start = bench_now();
+        err = cli_parse_r(cli, 2, argv, &exit_code, &parser);
+        parse_ns += bench_now() - start;
+        assert(!err && exit_code == 0);
+#ifndef CLI_NO_GETOPT_LONG
+        assert(jobs == 8 && strcmp(target, "x86_64-linux") == 0);
+#endif
+
+        cli_config_close(config);
+    }
+
+    (void)err;
+
+    snprintf(name, sizeof(name), "config/open/%zuK", size / 1024);
+    bench_report(name, size, open_ns, ROUNDS);
+    snprintf(name, sizeof(name), "config/parse/%zuK", size / 1024);
+    bench_report(name, size, parse_ns, ROUNDS);
+
+    unlink(file);
+}
+
+int
+main(void)
+{
+    merr_t err;
+    struct cli cli = { .name = "bench" };
+    struct cli build = { .name = "build", .callback = noop };
+    static const size_t sizes[] = { 64 << 10, 1 << 20, 16 << 20, 64 << 20 };
+
+#ifndef CLI_NO_GETOPT_LONG
+    err = cli_add_options(&build, NELEM(options), options);
+    assert(!err);
+#endif
+    err = cli_add_subcommand(&cli, &build);
+    assert(!err);
+    err = cli_compile(&cli);
+    assert(!err);
+    (void)err;
+
+    for (size_t i = 0; i < NELEM(sizes); i++)
+        run(&cli, sizes[i]);
+
+    cli_fini(&cli);
+
+    return 0;
+}
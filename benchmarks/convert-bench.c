@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include "bench.h"
+#include "convert.h"
+
+#define N     (1 << 20)
+#define WIDTH 32
+
+static char strs[N][WIDTH];
+
+static uint64_t
+xorshift(uint64_t * const state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static void
+fill_integers(void)
+{
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+
+    for (size_t i = 0; i < N; i++) {
+        const uint64_t r = xorshift(&state);
+
+        /* Mostly the small values command lines carry, with some wide ones. */
+        snprintf(strs[i], WIDTH, "%llu", (unsigned long long)(i % 8 ? r % 10000 : r));
+    }
+}
+
+static void
+fill_doubles(void)
+{
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+
+    for (size_t i = 0; i < N; i++) {
+        const uint64_t r = xorshift(&state);
+
+        if (i % 4)
+            snprintf(strs[i], WIDTH, "%.*f", (int)(r % 4), (double)(r % 100000) / 100);
+        else
+            snprintf(strs[i], WIDTH, "%.17g", (double)(r >> 11) / 9007199254740992.0 * 1e10);
+    }
+}
+
+int
+main(void)
+{
+    uint64_t start;
+    uint64_t sum = 0;
+    double total = 0;
+
+    fill_integers();
+
+    start = bench_now();
+    for (size_t i = 0; i < N; i++) {
+        unsigned long long v;
+        merr_t err = cli_convert_uint(strs[i], ULLONG_MAX, &v);
+
+        assert(!err);
+        (void)err;
+        sum += v;
+    }
+    bench_report("cli_convert_uint", N, bench_now() - start, N);
+
+    start = bench_now();
+    for (size_t i = 0; i < N; i++) {
+        char *end;
+
+        sum -= strtoull(strs[i], &end, 10);
+        assert(*end == '\0');
+    }
+    bench_report("strtoull", N, bench_now() - start, N);
+    assert(sum == 0);
+
+    fill_doubles();
+
+    start = bench_now();
+    for (size_t i = 0; i < N; i++) {
+        double v;
+        merr_t err = cli_convert_double(strs[i], &v);
+
+        assert(!err);
+        (void)err;
+        total += v;
+    }
+    bench_report("cli_convert_double", N, bench_now() - start, N);
+
+    start = bench_now();
+    for (size_t i = 0; i < N; i++) {
+        char *end;
+
+        total -= strtod(strs[i], &end);
+        assert(*end == '\0');
+    }
+    bench_report("strtod", N, bench_now() - start, N);
+
+    printf("%g\n", total);
+
+    return 0;
+}
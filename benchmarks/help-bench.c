@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define OPTIONS     200
+#define SUBCOMMANDS 50
+#define ITERATIONS  20000
+
+static const char shorts[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+static char option_names[OPTIONS][32];
+static char subcommand_names[SUBCOMMANDS][32];
+static struct cli_option options[OPTIONS];
+static struct cli subcommands[SUBCOMMANDS];
+
+/* Help as it used to be printed, a stream call per field with the widths
+ * recomputed each time, to compare against.
+ */
+static void
+print_help(FILE * const output, const char * const program, const struct cli * const cli)
+{
+    size_t max_width = 0;
+    const struct cli *c;
+    const struct cli_option *o;
+
+    flockfile(output);
+
+    fprintf(output, "Usage: %s", program);
+    if (!SLIST_EMPTY(&cli->options))
+        fputs(" [OPTIONS]...", output);
+    fputc('\n', output);
+
+    if (cli->description)
+        fprintf(output, "\n%s\n", cli->description);
+
+    fputs("\nOptions:\n", output);
+    SLIST_FOREACH(o, &cli->options, entry) {
+        size_t width = 0;
+
+#ifndef CLI_NO_GETOPT_LONG
+        if (o->lng)
+            width += strlen(o->lng);
+#endif
+        if (o->argument == CLI_HAS_ARG_REQUIRED)
+            width += 4;
+        if (width > max_width)
+            max_width = width;
+    }
+    SLIST_FOREACH(o, &cli->options, entry) {
+        if (o->shrt) {
+            fprintf(output, "   -%c", o->shrt);
+        } else {
+            fputs("     ", output);
+        }
+#ifndef CLI_NO_GETOPT_LONG
+        if (o->lng) {
+            fprintf(
+                output, "%s--%s%*s", o->shrt ? ", " : "  ", o->lng,
+                (int)(max_width - strlen(o->lng)),
+                o->argument == CLI_HAS_ARG_REQUIRED ? " arg" : "");
+        }
+#endif
+        if (o->description)
+            fprintf(output, "  %s", o->description);
+        fputc('\n', output);
+    }
+
+    max_width = 0;
+    fputs("\nSubcommands:\n", output);
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        const size_t width = strlen(c->name);
+
+        if (width > max_width)
+            max_width = width;
+    }
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        fprintf(output, "  %-*s", (int)max_width, c->name);
+        if (c->description)
+            fprintf(output, "  %s", c->description);
+        fputc('\n', output);
+    }
+
+    funlockfile(output);
+}
+
+static void
+tree_init(struct cli * const cli)
+{
+    merr_t err;
+
+    memset(cli, 0, sizeof(*cli));
+    cli->name = "help-bench";
+    cli->description = "Prints its help over and over.";
+
+    for (size_t i = 0; i < OPTIONS; i++) {
+        struct cli_option *o = options + i;
+
+        snprintf(option_names[i], sizeof(option_names[i]), "option-%zu", i);
+        o->shrt = i < sizeof(shorts) - 1 ? shorts[i] : '\0';
+#ifndef CLI_NO_GETOPT_LONG
+        o->lng = option_names[i];
+#endif
+        o->description = "Does something worth describing";
+        o->argument = i % 2 ? CLI_HAS_ARG_REQUIRED : CLI_HAS_ARG_NONE;
+        o->action = CLI_ACTION_HELP;
+    }
+
+    for (size_t i = 0; i < SUBCOMMANDS; i++) {
+        snprintf(subcommand_names[i], sizeof(subcommand_names[i]), "subcommand-%zu", i);
+        subcommands[i].name = subcommand_names[i];
+        subcommands[i].description = "A subcommand";
+    }
+
+    err = cli_add_options(cli, OPTIONS, options);
+    assert(!err);
+    err = cli_add_subcommands(cli, SUBCOMMANDS, subcommands);
+    assert(!err);
+    (void)err;
+}
+
+static void
+bench_parse(const char * const name, const struct cli * const cli, FILE * const out)
+{
+    uint64_t start;
+    char *args[] = { "help-bench", "-a" };
+    struct cli_parser parser = { .out = out };
+
+    start = bench_now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        merr_t err;
+        int exit_code;
+
+        err = cli_parse_r(cli, NELEM(args), args, &exit_code, &parser);
+        assert(!err);
+        (void)err;
+    }
+    bench_report(name, ITERATIONS, bench_now() - start, ITERATIONS);
+}
+
+int
+main(void)
+{
+    merr_t err;
+    FILE *out;
+    uint64_t start;
+    struct cli cli;
+
+    out = fopen("/dev/null", "w");
+    assert(out);
+
+    tree_init(&cli);
+
+    start = bench_now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        print_help(out, "help-bench", &cli);
+        fflush(out);
+    }
+    bench_report("stdio per field", ITERATIONS, bench_now() - start, ITERATIONS);
+
+    bench_parse("rendered per invocation", &cli, out);
+
+    err = cli_compile(&cli);
+    assert(!err);
+    (void)err;
+    bench_parse("compiled, cached", &cli, out);
+
+    cli_fini(&cli);
+    fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/incremental.h>
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define KEYSTROKES 100000
+
+static int verbose;
+static int jobs;
+static int level;
+static struct cli_slice files;
+
+static struct cli_option root_options[] = {
+    {
+        .shrt = 'v',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = &verbose,
+    },
+    {
+        .shrt = 'j',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &jobs,
+    },
+};
+
+static struct cli_option build_option = {
+    .shrt = 'O',
+    .argument = CLI_HAS_ARG_REQUIRED,
+    .type = CLI_TYPE_INT,
+    .action = CLI_ACTION_STORE,
+    .data = &level,
+};
+
+static struct cli_argument build_argument = {
+    .name = "files",
+    .type = CLI_TYPE_STRING,
+    .variadic = true,
+    .data = &files,
+};
+
+/* Alternately type and erase a character at pos. */
+static uint64_t
+run_edit(struct cli_incremental * const inc, const size_t pos)
+{
+    uint64_t start;
+
+    start = bench_now();
+    for (size_t i = 0; i < KEYSTROKES; i++) {
+        merr_t err;
+
+        err = cli_incremental_edit(inc, pos, i % 2, "1", i % 2 ? 0 : 1);
+        assert(!err && inc->errors == 0);
+        (void)err;
+    }
+
+    return bench_now() - start;
+}
+
+/* The same, handing over the whole line every time. */
+static uint64_t
+run_update(
+    struct cli_incremental * const inc,
+    const char * const line,
+    const size_t len,
+    const size_t pos)
+{
+    uint64_t start;
+    char * const edited = malloc(len + 2);
+
+    assert(edited);
+    memcpy(edited, line, pos);
+    edited[pos] = '1';
+    memcpy(edited + pos + 1, line + pos, len - pos + 1);
+
+    start = bench_now();
+    for (size_t i = 0; i < KEYSTROKES; i++) {
+        merr_t err;
+
+        err = cli_incremental_update(inc, i % 2 ? line : edited, i % 2 ? len : len + 1);
+        assert(!err && inc->errors == 0);
+        (void)err;
+    }
+
+    free(edited);
+
+    return bench_now() - start;
+}
+
+int
+main(void)
+{
+    merr_t err;
+    struct cli root = { .name = "bench" };
+    struct cli build = { .name = "build" };
+    static const size_t tokenc[] = { 8, 64, 512, 4096 };
+
+    err = cli_add_options(&root, NELEM(root_options), root_options);
+    assert(!err);
+    err = cli_add_option(&build, &build_option);
+    assert(!err);
+    err = cli_add_argument(&build, &build_argument);
+    assert(!err);
+    err = cli_add_subcommand(&root, &build);
+    assert(!err);
+    err = cli_compile(&root);
+    assert(!err);
+
+    for (size_t i = 0; i < NELEM(tokenc); i++) {
+        const size_t n = tokenc[i];
+        char *line;
+        size_t len = 0;
+        size_t middle = 0;
+        struct cli_incremental inc;
+
+        line = malloc(n * 16 + 32);
+        assert(line);
+
+        len += (size_t)sprintf(line, "-v -j 4 build -O2");
+        for (size_t j = 5; j < n; j++) {
+            if (!middle && j >= n / 2)
+                middle = len + 1;
+            len += (size_t)sprintf(line + len, " src/file-%zu.c", j);
+        }
+
+        err = cli_incremental_init(&inc, &root);
+        assert(!err);
+        err = cli_incremental_update(&inc, line, len);
+        assert(!err);
+
+        bench_report("incremental/edit/end", n, run_edit(&inc, len), KEYSTROKES);
+        bench_report("incremental/edit/middle", n, run_edit(&inc, middle), KEYSTROKES);
+        bench_report(
+            "incremental/update/end", n, run_update(&inc, line, len, len), KEYSTROKES);
+        bench_report(
+            "incremental/update/middle", n, run_update(&inc, line, len, middle), KEYSTROKES);
+
+        /* What every keystroke used to cost. */
+        {
+            uint64_t start;
+            const size_t lines = KEYSTROKES / n + 1;
+
+            start = bench_now();
+            for (size_t j = 0; j < lines; j++) {
+                struct cli_incremental fresh;
+
+                err = cli_incremental_init(&fresh, &root);
+                assert(!err);
+                err = cli_incremental_update(&fresh, line, len);
+                assert(!err);
+                cli_incremental_fini(&fresh);
+            }
+            bench_report("incremental/line", n, bench_now() - start, lines);
+        }
+        (void)err;
+
+        cli_incremental_fini(&inc);
+        free(line);
+    }
+
+    cli_fini(&root);
+
+    return 0;
+}
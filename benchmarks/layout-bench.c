@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/stats.h>
+
+#include "bench.h"
+
+#define OPTIONS 100
+#define PARSES  200000
+
+static const char shorts[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+/* Shaped like a generated API client: many commands with many options. */
+struct tree {
+    struct cli root;
+    struct cli *commands;
+    struct cli_option *options;
+    char (*command_names)[32];
+    char (*option_names)[48];
+    int value;
+};
+
+static void
+tree_init(struct tree * const t, const size_t commandc)
+{
+    merr_t err;
+
+    memset(t, 0, sizeof(*t));
+    t->root.name = "bench";
+    t->commands = calloc(commandc, sizeof(*t->commands));
+    t->options = calloc(commandc * OPTIONS, sizeof(*t->options));
+    t->command_names = calloc(commandc, sizeof(*t->command_names));
+    t->option_names = calloc(OPTIONS, sizeof(*t->option_names));
+    assert(t->commands && t->options && t->command_names && t->option_names);
+
+    for (size_t i = 0; i < OPTIONS; i++)
+        snprintf(t->option_names[i], sizeof(t->option_names[i]), "resource-field-%zu", i);
+
+    for (size_t i = 0; i < commandc; i++) {
+        snprintf(t->command_names[i], sizeof(t->command_names[i]), "operation-%zu", i);
+        t->commands[i].name = t->command_names[i];
+
+        for (size_t j = 0; j < OPTIONS; j++) {
+            struct cli_option * const o = t->options + i * OPTIONS + j;
+
+            o->shrt = j < sizeof(shorts) - 1 ? shorts[j] : '\0';
+#ifndef CLI_NO_GETOPT_LONG
+            o->lng = t->option_names[j];
+#endif
+            o->argument = CLI_HAS_ARG_REQUIRED;
+            o->type = CLI_TYPE_INT;
+            o->action = CLI_ACTION_STORE;
+            o->data = &t->value;
+        }
+
+        err = cli_add_options(&t->commands[i], OPTIONS, t->options + i * OPTIONS);
+        assert(!err);
+    }
+
+    err = cli_add_subcommands(&t->root, commandc, t->commands);
+    assert(!err);
+    (void)err;
+}
+
+static void
+tree_fini(struct tree * const t)
+{
+    cli_fini(&t->root);
+    free(t->option_names);
+    free(t->command_names);
+    free(t->options);
+    free(t->commands);
+}
+
+int
+main(void)
+{
+    static const size_t commandc[] = { 10, 100, 1000 };
+
+    bench_metric("layout/cli_option", 1, "size", sizeof(struct cli_option), "B");
+    bench_metric("layout/cli_argument", 1, "size", sizeof(struct cli_argument), "B");
+
+    for (size_t i = 0; i < NELEM(commandc); i++) {
+        merr_t err;
+        uint64_t start;
+        struct tree t;
+        struct cli_stats stats;
+        const size_t n = commandc[i];
+        char *args[] = { "bench", NULL, "-b", "1", NULL, "2" };
+        char lng[64];
+
+        tree_init(&t, n);
+
+        /* Only what compiling allocates, which is where the layout lives. */
+        cli_stats_enable(true);
+        cli_stats_reset();
+        err = cli_compile(&t.root);
+        assert(!err);
+        cli_stats_get(&stats);
+        cli_stats_enable(false);
+
+        bench_metric(
+            "layout/compile", n * OPTIONS, "memory",
+            (double)stats.alloc_bytes / (double)(n * OPTIONS), "B/option");
+
+        /* Jump between commands so that lookups cannot stay in cache. */
+        start = bench_now();
+        for (size_t j = 0; j < PARSES; j++) {
+            int exit_code;
+            const size_t option = (j * 31) % OPTIONS;
+
+            args[1] = t.command_names[(j * 7919) % n];
+#ifndef CLI_NO_GETOPT_LONG
+            snprintf(lng, sizeof(lng), "--%s", t.option_names[option]);
+#else
+            snprintf(lng, sizeof(lng), "-%c", shorts[option % (sizeof(shorts) - 1)]);
+#endif
+            args[4] = lng;
+
+            err = cli_parse(&t.root, NELEM(args), args, &exit_code);
+            assert(!err && exit_code == 0 && t.value == 2);
+        }
+        (void)err;
+
+        bench_report("layout/parse", n * OPTIONS, bench_now() - start, PARSES);
+
+        tree_fini(&t);
+    }
+
+    return 0;
+}
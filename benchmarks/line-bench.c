@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/line.h>
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define LINE_SZ (1024 * 1024)
+#define ROUNDS  64
+#define PARSES  200000
+
+static int level;
+static const char *name;
+
+static struct cli_option options[] = {
+    {
+        .shrt = 'l',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &level,
+    },
+    {
+        .shrt = 'n',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = &name,
+    },
+};
+
+/* Repeat word, which ends in its separator, up to LINE_SZ bytes. */
+static char *
+generate(const char * const word, size_t * const len)
+{
+    char *buf;
+    size_t off = 0;
+    const size_t n = strlen(word);
+
+    buf = malloc(LINE_SZ + 1);
+    assert(buf);
+
+    while (off + n <= LINE_SZ) {
+        memcpy(buf + off, word, n);
+        off += n;
+    }
+    buf[off] = '\0';
+
+    *len = off;
+
+    return buf;
+}
+
+static void
+bench_split(const char * const bench, const char * const word)
+{
+    size_t len;
+    uint64_t ns = 0;
+    char *line;
+    char *orig;
+    struct cli_line split = { 0 };
+
+    orig = generate(word, &len);
+    line = malloc(len + 1);
+    assert(line);
+
+    for (int i = 0; i < ROUNDS; i++) {
+        merr_t err;
+        uint64_t start;
+
+        /* Splitting clobbers the line. */
+        memcpy(line, orig, len + 1);
+
+        start = bench_now();
+        err = cli_line_split(&split, line);
+        ns += bench_now() - start;
+
+        assert(!err && split.argc > 0);
+        (void)err;
+    }
+
+    bench_report(bench, len, ns, ROUNDS);
+    bench_metric(bench, len, "throughput", (double)len * ROUNDS / (double)ns, "GB/s");
+
+    cli_line_fini(&split);
+    free(line);
+    free(orig);
+}
+
+static void
+bench_parse(void)
+{
+    merr_t err;
+    uint64_t start, elapsed;
+    char line[64];
+    struct cli cli = { .name = "bench" };
+    struct cli_parser parser = { 0 };
+    static const char orig[] = "-l 3 -n 'a job name'";
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    assert(!err);
+    err = cli_compile(&cli);
+    assert(!err);
+
+    start = bench_now();
+    for (int i = 0; i < PARSES; i++) {
+        int exit_code;
+
+        memcpy(line, orig, sizeof(orig));
+        err = cli_parse_line(&cli, line, &exit_code, &parser);
+        assert(!err && exit_code == 0 && level == 3);
+    }
+    elapsed = bench_now() - start;
+    (void)err;
+
+    bench_report("parse_line", sizeof(orig) - 1, elapsed, PARSES);
+
+    cli_fini(&cli);
+}
+
+int
+main(void)
+{
+    bench_split("split/plain", "--include-dir=/usr/lib/x86_64-linux-gnu/pkgconfig ");
+    bench_split("split/words", "a bb ccc dddd ");
+    bench_split("split/quoted", "--message=\"a value with blanks\" ");
+    bench_split("split/single", "'a value with blanks in single quotes' ");
+    bench_split("split/escaped", "a\\ path\\ with\\ escaped\\ blanks ");
+    bench_parse();
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+#include "list.h"
+
+#define IDS    50000
+#define ROUNDS 200
+
+static struct cli_list ids;
+
+static struct cli_option options[] = {
+    {
+        .shrt = 'i',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_U32,
+        .action = CLI_ACTION_APPEND,
+        .delimiter = ',',
+        .data = &ids,
+    },
+};
+
+/* The usual byte loop over memchr(3), for comparison with cli_split(). */
+static size_t
+split_memchr(char * const s, const size_t len, const char delim)
+{
+    size_t fields = 1;
+    char *p = s;
+    char * const end = s + len;
+
+    while ((p = memchr(p, delim, (size_t)(end - p)))) {
+        *p++ = '\0';
+        fields++;
+    }
+
+    return fields;
+}
+
+int
+main(void)
+{
+    merr_t err;
+    uint64_t start;
+    size_t len = 0;
+    size_t fields = 0;
+    char *list, *copy;
+    struct cli cli = { .name = "list-bench" };
+
+    list = malloc(IDS * 11);
+    copy = malloc(IDS * 11);
+    assert(list && copy);
+
+    for (uint32_t i = 0; i < IDS; i++)
+        len += (size_t)sprintf(list + len, "%s%u", i ? "," : "", i * 2654435761U % 1000000);
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    assert(!err);
+
+    start = bench_now();
+    for (int r = 0; r < ROUNDS; r++) {
+        memcpy(copy, list, len + 1);
+        fields += cli_split(copy, len, ',');
+    }
+    bench_report("cli_split", ROUNDS, bench_now() - start, ROUNDS * IDS);
+
+    start = bench_now();
+    for (int r = 0; r < ROUNDS; r++) {
+        memcpy(copy, list, len + 1);
+        fields -= split_memchr(copy, len, ',');
+    }
+    bench_report("memchr split", ROUNDS, bench_now() - start, ROUNDS * IDS);
+    assert(fields == 0);
+
+    start = bench_now();
+    for (int r = 0; r < ROUNDS; r++) {
+        int exit_code;
+        char *args[] = { "list-bench", "-i", list };
+
+        ids.count = 0;
+        err = cli_parse(&cli, NELEM(args), args, &exit_code);
+        assert(!err && exit_code == 0);
+        assert(ids.count == IDS);
+    }
+    bench_report("parse -i id,...", ROUNDS, bench_now() - start, ROUNDS * IDS);
+
+    (void)err;
+    cli_list_fini(&ids);
+    free(copy);
+    free(list);
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define OPTIONS 16
+#define ROUNDS  20
+
+struct tool {
+    struct cli root;
+    struct cli *commands;
+    struct cli_option (*options)[OPTIONS];
+    char (*names)[32];
+    int values[OPTIONS];
+};
+
+static merr_t
+load(struct cli * const cli, void * const ctx)
+{
+    return cli_add_options(cli, OPTIONS, ctx);
+}
+
+static void
+tool_init(struct tool * const t, const size_t commandc)
+{
+    memset(t, 0, sizeof(*t));
+    t->root.name = "tool";
+    t->commands = calloc(commandc, sizeof(*t->commands));
+    t->options = calloc(commandc, sizeof(*t->options));
+    t->names = calloc(commandc, sizeof(*t->names));
+    assert(t->commands && t->options && t->names);
+
+    for (size_t i = 0; i < commandc; i++) {
+        snprintf(t->names[i], sizeof(t->names[i]), "command-%zu", i);
+        t->commands[i].name = t->names[i];
+
+        for (size_t j = 0; j < OPTIONS; j++) {
+            t->options[i][j] = (struct cli_option){
+                .shrt = (char)('a' + j),
+                .argument = CLI_HAS_ARG_REQUIRED,
+                .type = CLI_TYPE_INT,
+                .action = CLI_ACTION_STORE,
+                .data = &t->values[j],
+            };
+        }
+    }
+}
+
+static void
+tool_fini(struct tool * const t)
+{
+    cli_fini(&t->root);
+    free(t->names);
+    free(t->options);
+    free(t->commands);
+}
+
+/* Everything a process does to run one command, from an empty tree. */
+static uint64_t
+startup(const size_t commandc, const bool lazy, const bool compile)
+{
+    merr_t err;
+    int exit_code;
+    uint64_t start;
+    struct tool t;
+    char *args[] = { "tool", NULL, "-c", "3" };
+
+    tool_init(&t, commandc);
+    args[1] = t.names[commandc / 2];
+
+    start = bench_now();
+    for (size_t i = 0; i < commandc; i++) {
+        if (lazy) {
+            t.commands[i].loader = load;
+            t.commands[i].loader_ctx = t.options[i];
+        } else {
+            err = cli_add_options(&t.commands[i], OPTIONS, t.options[i]);
+            assert(!err);
+        }
+    }
+
+    err = cli_add_subcommands(&t.root, commandc, t.commands);
+    assert(!err);
+    if (compile) {
+        err = cli_compile(&t.root);
+        assert(!err);
+    }
+
+    err = cli_parse(&t.root, NELEM(args), args, &exit_code);
+    assert(!err && exit_code == 0 && t.values[2] == 3);
+    (void)err;
+
+    start = bench_now() - start;
+    tool_fini(&t);
+
+    return start;
+}
+
+int
+main(void)
+{
+    static const size_t commandc[] = { 100, 1000, 3000 };
+
+    for (size_t i = 0; i < NELEM(commandc); i++) {
+        const size_t n = commandc[i];
+        uint64_t eager = 0, eager_compiled = 0, lazy = 0, lazy_compiled = 0;
+
+        for (int r = 0; r < ROUNDS; r++) {
+            eager += startup(n, false, false);
+            eager_compiled += startup(n, false, true);
+            lazy += startup(n, true, false);
+            lazy_compiled += startup(n, true, true);
+        }
+
+        bench_report("loader/startup/eager", n, eager, ROUNDS);
+        bench_report("loader/startup/eager-compiled", n, eager_compiled, ROUNDS);
+        bench_report("loader/startup/stub", n, lazy, ROUNDS);
+        bench_report("loader/startup/stub-compiled", n, lazy_compiled, ROUNDS);
+    }
+
+    return 0;
+}
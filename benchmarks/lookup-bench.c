@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define ARGC       1024
+#define ITERATIONS 200
+#define ARG_SZ     48
+
+static const char shorts[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+struct tree {
+    struct cli cli;
+    struct cli_option *options;
+    char (*names)[32];
+    int *values;
+    char **argv;
+    /* The same arguments with the long options abbreviated. */
+    char **abbreviated;
+};
+
+static void
+tree_init(struct tree * const t, const size_t optionc)
+{
+    merr_t err;
+
+    memset(t, 0, sizeof(*t));
+    t->cli.name = "bench";
+    t->options = calloc(optionc, sizeof(*t->options));
+    t->names = calloc(optionc, sizeof(*t->names));
+    t->values = calloc(optionc, sizeof(*t->values));
+    t->argv = calloc(ARGC + 1, sizeof(*t->argv));
+    t->abbreviated = calloc(ARGC + 1, sizeof(*t->abbreviated));
+    assert(t->options && t->names && t->values && t->argv && t->abbreviated);
+
+    for (size_t i = 0; i < optionc; i++) {
+        struct cli_option *o = t->options + i;
+
+        snprintf(t->names[i], sizeof(t->names[i]), "opt-%zu-value", i);
+
+        o->shrt = i < sizeof(shorts) - 1 ? shorts[i] : '\0';
+        o->lng = t->names[i];
+        o->argument = CLI_HAS_ARG_REQUIRED;
+        o->type = CLI_TYPE_INT;
+        o->action = CLI_ACTION_STORE;
+        o->data = t->values + i;
+    }
+
+    err = cli_add_options(&t->cli, optionc, t->options);
+    assert(!err);
+    (void)err;
+
+    /* Alternate between long options and short options spread over the
+     * whole node so that the position of an option in the node does not
+     * matter.
+     */
+    t->argv[0] = "bench";
+    t->abbreviated[0] = "bench";
+    for (size_t i = 1; i < ARGC; i++) {
+        const size_t o = (i * 7919) % optionc;
+
+        t->argv[i] = malloc(ARG_SZ);
+        t->abbreviated[i] = malloc(ARG_SZ);
+        assert(t->argv[i] && t->abbreviated[i]);
+        if (i % 2 == 0 && t->options[o].shrt) {
+            snprintf(t->argv[i], ARG_SZ, "-%c1", t->options[o].shrt);
+            snprintf(t->abbreviated[i], ARG_SZ, "-%c1", t->options[o].shrt);
+        } else {
+            snprintf(t->argv[i], ARG_SZ, "--%s=1", t->names[o]);
+            snprintf(t->abbreviated[i], ARG_SZ, "--opt-%zu-v=1", o);
+        }
+    }
+}
+
+static void
+tree_fini(struct tree * const t)
+{
+    cli_fini(&t->cli);
+
+    for (size_t i = 1; i < ARGC; i++) {
+        free(t->argv[i]);
+        free(t->abbreviated[i]);
+    }
+    free(t->argv);
+    free(t->abbreviated);
+    free(t->values);
+    free(t->names);
+    free(t->options);
+}
+
+static uint64_t
+run(const struct tree * const t, char ** const argv)
+{
+    uint64_t start;
+
+    start = bench_now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        merr_t err;
+        int exit_code;
+
+        err = cli_parse(&t->cli, ARGC, argv, &exit_code);
+        assert(!err && exit_code == 0);
+        (void)err;
+    }
+
+    return bench_now() - start;
+}
+
+int
+main(void)
+{
+    static const size_t optionc[] = { 8, 64, 256, 1024, 4096, 16384 };
+
+    for (size_t i = 0; i < NELEM(optionc); i++) {
+        merr_t err;
+        struct tree t;
+
+        tree_init(&t, optionc[i]);
+
+        bench_report(
+            "lookup/uncompiled", optionc[i], run(&t, t.argv), (size_t)ITERATIONS * (ARGC - 1));
+        bench_report(
+            "lookup/uncompiled-prefix", optionc[i], run(&t, t.abbreviated),
+            (size_t)ITERATIONS * (ARGC - 1));
+
+        err = cli_compile(&t.cli);
+        assert(!err);
+        (void)err;
+
+        bench_report(
+            "lookup/compiled", optionc[i], run(&t, t.argv), (size_t)ITERATIONS * (ARGC - 1));
+        bench_report(
+            "lookup/compiled-prefix", optionc[i], run(&t, t.abbreviated),
+            (size_t)ITERATIONS * (ARGC - 1));
+
+        tree_fini(&t);
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define DISPATCHES 100000
+
+struct box {
+    struct cli root;
+    struct cli *applets;
+    char (*names)[48];
+};
+
+static void
+box_init(struct box * const b, const size_t appletc)
+{
+    memset(b, 0, sizeof(*b));
+    b->root.name = "box";
+    b->root.flags = CLI_FLAG_MULTI_CALL;
+    b->applets = calloc(appletc, sizeof(*b->applets));
+    b->names = calloc(appletc, sizeof(*b->names));
+    assert(b->applets && b->names);
+
+    for (size_t i = 0; i < appletc; i++) {
+        snprintf(b->names[i], sizeof(b->names[i]), "/usr/bin/applet-%zu", (i * 7919) % appletc);
+        b->applets[i].name = b->names[i] + sizeof("/usr/bin/") - 1;
+    }
+}
+
+static void
+box_fini(struct box * const b)
+{
+    cli_fini(&b->root);
+    free(b->names);
+    free(b->applets);
+}
+
+static uint64_t
+dispatch(const struct box * const b, const size_t appletc)
+{
+    uint64_t start;
+    char *args[] = { NULL };
+
+    start = bench_now();
+    for (size_t i = 0; i < DISPATCHES; i++) {
+        merr_t err;
+        int exit_code;
+
+        args[0] = b->names[(i * 104729) % appletc];
+        err = cli_parse(&b->root, NELEM(args), args, &exit_code);
+        assert(!err && exit_code == 0);
+        (void)err;
+    }
+
+    return bench_now() - start;
+}
+
+int
+main(void)
+{
+    static const size_t appletc[] = { 10, 100, 1000, 3000, 10000 };
+
+    for (size_t i = 0; i < NELEM(appletc); i++) {
+        merr_t err;
+        struct box b;
+        const size_t n = appletc[i];
+
+        box_init(&b, n);
+        err = cli_add_subcommands(&b.root, n, b.applets);
+        assert(!err);
+
+        bench_report("multicall/dispatch/uncompiled", n, dispatch(&b, n), DISPATCHES);
+
+        err = cli_compile(&b.root);
+        assert(!err);
+        (void)err;
+
+        bench_report("multicall/dispatch/compiled", n, dispatch(&b, n), DISPATCHES);
+
+        box_fini(&b);
+    }
+
+    return 0;
+}
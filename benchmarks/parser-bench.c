@@ -0,0 +1,425 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/stats.h>
+
+#include "bench.h"
+
+#define ROUNDS 15
+
+static const char shorts[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+/* A synthetic tree. Node 0 is the root, and the children of a node are
+ * contiguous so that they can be registered with one cli_add_subcommands().
+ */
+struct fixture {
+    const char *name;
+    size_t nodec;
+    struct cli *nodes;
+    char (*node_names)[24];
+    size_t *option_first;
+    size_t *option_count;
+    size_t *child_first;
+    size_t *child_count;
+    size_t optionc;
+    struct cli_option *options;
+    char (*option_names)[24];
+    int *values;
+    int argc;
+    char **argv;
+    char *args;
+    size_t args_sz;
+    size_t args_len;
+    int iterations;
+};
+
+static void
+noop(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    *exit_code = 0;
+}
+
+static void
+fixture_alloc(struct fixture * const f, const size_t nodec, const size_t optionc, const int argc)
+{
+    f->nodec = nodec;
+    f->nodes = calloc(nodec, sizeof(*f->nodes));
+    f->node_names = calloc(nodec, sizeof(*f->node_names));
+    f->option_first = calloc(nodec, sizeof(*f->option_first));
+    f->option_count = calloc(nodec, sizeof(*f->option_count));
+    f->child_first = calloc(nodec, sizeof(*f->child_first));
+    f->child_count = calloc(nodec, sizeof(*f->child_count));
+    f->optionc = optionc;
+    f->options = calloc(optionc, sizeof(*f->options));
+    f->option_names = calloc(optionc, sizeof(*f->option_names));
+    f->values = calloc(optionc, sizeof(*f->values));
+    f->argc = 1;
+    f->argv = calloc((size_t)argc + 1, sizeof(*f->argv));
+    f->args_sz = 64 * (size_t)argc;
+    f->args = malloc(f->args_sz);
+    assert(f->nodes && f->node_names && f->option_first && f->option_count && f->child_first);
+    assert(f->child_count && f->options && f->option_names && f->values && f->argv && f->args);
+
+    f->argv[0] = "bench";
+}
+
+static void
+fixture_free(struct fixture * const f)
+{
+    cli_fini(&f->nodes[0]);
+    free(f->nodes);
+    free(f->node_names);
+    free(f->option_first);
+    free(f->option_count);
+    free(f->child_first);
+    free(f->child_count);
+    free(f->options);
+    free(f->option_names);
+    free(f->values);
+    free(f->argv);
+    free(f->args);
+}
+
+/* Options get a short name while there are any left in the node, and a long
+ * name whenever long options are available.
+ */
+static void
+fixture_options(struct fixture * const f, const size_t node, const size_t first, const size_t count)
+{
+    f->option_first[node] = first;
+    f->option_count[node] = count;
+
+    for (size_t i = 0; i < count; i++) {
+        struct cli_option * const o = &f->options[first + i];
+
+        snprintf(f->option_names[first + i], sizeof(f->option_names[0]), "option-%zu", i);
+
+        o->shrt = i < sizeof(shorts) - 1 ? shorts[i] : '\0';
+#ifndef CLI_NO_GETOPT_LONG
+        o->lng = f->option_names[first + i];
+#endif
+        o->argument = CLI_HAS_ARG_REQUIRED;
+        o->type = CLI_TYPE_INT;
+        o->action = CLI_ACTION_STORE;
+        o->data = &f->values[first + i];
+    }
+}
+
+static void
+fixture_arg(struct fixture * const f, const char * const fmt, ...)
+{
+    int len;
+    va_list ap;
+
+    va_start(ap, fmt);
+    len = vsnprintf(f->args + f->args_len, f->args_sz - f->args_len, fmt, ap);
+    va_end(ap);
+    assert(len > 0 && (size_t)len < f->args_sz - f->args_len);
+
+    /* Offsets for now, since the buffer is written in full first. */
+    f->argv[f->argc++] = (char *)(uintptr_t)f->args_len;
+    f->args_len += (size_t)len + 1;
+}
+
+static void
+fixture_argv(struct fixture * const f)
+{
+    for (int i = 1; i < f->argc; i++)
+        f->argv[i] = f->args + (uintptr_t)f->argv[i];
+}
+
+/* Option argument for option i of a node, alternating between forms. */
+static void
+fixture_option_arg(struct fixture * const f, const size_t i, const size_t n)
+{
+#ifndef CLI_NO_GETOPT_LONG
+    if (i >= sizeof(shorts) - 1 || n % 2 == 1) {
+        fixture_arg(f, "--option-%zu=%zu", i, n);
+        return;
+    }
+#endif
+    fixture_arg(f, "-%c%zu", shorts[i], n);
+}
+
+/* One node with many options, most of them only reachable by long name. */
+static void
+shape_wide(struct fixture * const f)
+{
+#ifndef CLI_NO_GETOPT_LONG
+    const size_t optionc = 1024;
+#else
+    const size_t optionc = sizeof(shorts) - 1;
+#endif
+
+    fixture_alloc(f, 1, optionc, 256);
+    f->name = "wide";
+    fixture_options(f, 0, 0, optionc);
+    for (size_t i = 1; i < 256; i++)
+        fixture_option_arg(f, (i * 7919) % optionc, i);
+    f->iterations = 2000;
+}
+
+/* A chain of subcommands, with options set at every level. */
+static void
+shape_deep(struct fixture * const f)
+{
+    const size_t depth = 32;
+    const size_t optionc = 8;
+
+    fixture_alloc(f, depth, depth * optionc, (int)(depth * 3));
+    f->name = "deep";
+    for (size_t i = 0; i < depth; i++) {
+        fixture_options(f, i, i * optionc, optionc);
+        if (i + 1 < depth) {
+            f->child_first[i] = i + 1;
+            f->child_count[i] = 1;
+        }
+        if (i > 0)
+            fixture_arg(f, "level-%zu", i);
+        fixture_option_arg(f, i % optionc, i);
+        fixture_option_arg(f, (i + 3) % optionc, i + 1);
+    }
+    f->iterations = 5000;
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+/* Long options only, which exercises the long name lookup. */
+static void
+shape_long(struct fixture * const f)
+{
+    const size_t optionc = 16384;
+
+    fixture_alloc(f, 1, optionc, 256);
+    f->name = "long";
+    fixture_options(f, 0, 0, optionc);
+    for (size_t i = 0; i < optionc; i++)
+        f->options[i].shrt = '\0';
+    for (size_t i = 1; i < 256; i++)
+        fixture_arg(f, "--option-%zu=%zu", (i * 7919) % optionc, i);
+    f->iterations = 500;
+}
+#endif
+
+/* A flat command with many subcommands, of which a parse picks one. */
+static void
+shape_subcommands(struct fixture * const f)
+{
+    const size_t subcommandc = 10000;
+    const size_t optionc = 4;
+
+    fixture_alloc(f, subcommandc + 1, (subcommandc + 1) * optionc, 4);
+    f->name = "subcommands";
+    f->child_first[0] = 1;
+    f->child_count[0] = subcommandc;
+    for (size_t i = 0; i <= subcommandc; i++)
+        fixture_options(f, i, i * optionc, optionc);
+    fixture_option_arg(f, 0, 1);
+    fixture_arg(f, "command-%zu", subcommandc / 3);
+    fixture_option_arg(f, 1, 2);
+    f->iterations = 5000;
+}
+
+/* A handful of options repeated across a very long command line. */
+static void
+shape_argv(struct fixture * const f)
+{
+    const int argc = 1 << 20;
+
+    fixture_alloc(f, 1, 4, argc);
+    f->name = "argv";
+    fixture_options(f, 0, 0, 4);
+    for (int i = 1; i < argc; i++)
+        fixture_option_arg(f, (size_t)i % 4, (size_t)i);
+    f->iterations = 3;
+}
+
+static void
+fixture_register(struct fixture * const f)
+{
+    merr_t err;
+
+    for (size_t i = 0; i < f->nodec; i++) {
+        struct cli * const c = &f->nodes[i];
+
+        memset(c, 0, sizeof(*c));
+        if (i == 0) {
+            c->name = "bench";
+        } else {
+            snprintf(
+                f->node_names[i],
+                sizeof(f->node_names[i]),
+                f->nodec > 64 ? "command-%zu" : "level-%zu",
+                f->nodec > 64 ? i - 1 : i);
+            c->name = f->node_names[i];
+        }
+        c->callback = noop;
+    }
+
+    for (size_t i = 0; i < f->nodec; i++) {
+        err = cli_add_options(&f->nodes[i], f->option_count[i], f->options + f->option_first[i]);
+        assert(!err);
+        if (f->child_count[i] > 0) {
+            err = cli_add_subcommands(
+                &f->nodes[i], f->child_count[i], f->nodes + f->child_first[i]);
+            assert(!err);
+        }
+    }
+
+    (void)err;
+}
+
+static int
+u64_cmp(const void * const a, const void * const b)
+{
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t
+median(uint64_t * const samples, const size_t n)
+{
+    qsort(samples, n, sizeof(*samples), u64_cmp);
+
+    return samples[n / 2];
+}
+
+static uint64_t
+parse_median(const struct fixture * const f)
+{
+    uint64_t *samples;
+    uint64_t result;
+
+    samples = calloc((size_t)f->iterations, sizeof(*samples));
+    assert(samples);
+
+    for (int i = 0; i < f->iterations; i++) {
+        merr_t err;
+        int exit_code;
+        const uint64_t start = bench_now();
+
+        err = cli_parse(&f->nodes[0], f->argc, f->argv, &exit_code);
+        samples[i] = bench_now() - start;
+        assert(!err && exit_code == 0);
+        (void)err;
+    }
+
+    result = median(samples, (size_t)f->iterations);
+    free(samples);
+
+    return result;
+}
+
+static void
+report_allocs(const char * const name, const size_t n, const char * const phase)
+{
+    struct cli_stats stats;
+    char metric[64];
+
+    cli_stats_get(&stats);
+
+    snprintf(metric, sizeof(metric), "%s/allocs", phase);
+    bench_metric(name, n, metric, (double)stats.allocs, "count");
+    snprintf(metric, sizeof(metric), "%s/bytes", phase);
+    bench_metric(name, n, metric, (double)stats.alloc_bytes, "bytes");
+}
+
+static void
+run(void (*shape)(struct fixture *))
+{
+    merr_t err;
+    struct fixture f;
+    char name[64];
+    uint64_t samples[ROUNDS];
+    const char *states[] = { "uncompiled", "compiled" };
+
+    memset(&f, 0, sizeof(f));
+    shape(&f);
+    fixture_argv(&f);
+    snprintf(name, sizeof(name), "parser/%s", f.name);
+
+    for (int r = 0; r < ROUNDS; r++) {
+        const uint64_t start = bench_now();
+
+        fixture_register(&f);
+        samples[r] = bench_now() - start;
+    }
+    bench_metric(name, f.optionc, "register", (double)median(samples, ROUNDS), "ns");
+
+    cli_stats_enable(true);
+    cli_stats_reset();
+    fixture_register(&f);
+    cli_stats_enable(false);
+    report_allocs(name, f.optionc, "register");
+
+    for (size_t s = 0; s < NELEM(states); s++) {
+        char metric[64];
+        uint64_t latency;
+
+        if (s == 1) {
+            const uint64_t start = bench_now();
+
+            err = cli_compile(&f.nodes[0]);
+            bench_metric(name, f.optionc, "compile", (double)(bench_now() - start), "ns");
+            assert(!err);
+        }
+
+        latency = parse_median(&f);
+        snprintf(metric, sizeof(metric), "parse/%s", states[s]);
+        bench_metric(name, (size_t)f.argc, metric, (double)latency, "ns");
+        snprintf(metric, sizeof(metric), "parse/%s/arg", states[s]);
+        bench_metric(name, (size_t)f.argc, metric, (double)latency / (double)(f.argc - 1), "ns");
+
+        cli_stats_enable(true);
+        cli_stats_reset();
+        {
+            int exit_code;
+
+            err = cli_parse(&f.nodes[0], f.argc, f.argv, &exit_code);
+            assert(!err && exit_code == 0);
+        }
+        cli_stats_enable(false);
+        snprintf(metric, sizeof(metric), "parse/%s", states[s]);
+        report_allocs(name, (size_t)f.argc, metric);
+    }
+
+    (void)err;
+    fixture_free(&f);
+}
+
+int
+main(void)
+{
+    static void (* const shapes[])(struct fixture *) = {
+        shape_wide,
+        shape_deep,
+#ifndef CLI_NO_GETOPT_LONG
+        shape_long,
+#endif
+        shape_subcommands,
+        shape_argv,
+    };
+
+    for (size_t i = 0; i < NELEM(shapes); i++)
+        run(shapes[i]);
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+/* Registering one at a time is quadratic, so cap it to keep the run short. */
+#define MAX_SINGLE 10000
+
+struct table {
+    struct cli cli;
+    struct cli_option *options;
+    struct cli_argument *arguments;
+    char (*names)[32];
+};
+
+static void
+table_init(struct table * const t, const size_t n)
+{
+    memset(t, 0, sizeof(*t));
+    t->cli.name = "bench";
+    t->options = calloc(n, sizeof(*t->options));
+    t->arguments = calloc(n, sizeof(*t->arguments));
+    t->names = calloc(n, sizeof(*t->names));
+    assert(t->options && t->arguments && t->names);
+
+    /* Scramble the names so that registration order is not sorted order. */
+    for (size_t i = 0; i < n; i++) {
+        snprintf(t->names[i], sizeof(t->names[i]), "name-%zu", (i * 7919) % n);
+#ifndef CLI_NO_GETOPT_LONG
+        t->options[i].lng = t->names[i];
+#else
+        t->options[i].shrt = (char)(i + 1);
+#endif
+        t->options[i].action = CLI_ACTION_HELP;
+        t->arguments[i].name = t->names[i];
+    }
+}
+
+static void
+table_fini(struct table * const t)
+{
+    free(t->names);
+    free(t->arguments);
+    free(t->options);
+}
+
+int
+main(void)
+{
+    static const size_t sizes[] = { 10, 1000, 10000, 100000 };
+
+    for (size_t i = 0; i < NELEM(sizes); i++) {
+        merr_t err;
+        uint64_t start;
+        struct table t;
+        size_t n = sizes[i];
+
+#ifdef CLI_NO_GETOPT_LONG
+        if (n > 255)
+            n = 255;
+#endif
+
+        if (n <= MAX_SINGLE) {
+            table_init(&t, n);
+            start = bench_now();
+            for (size_t j = 0; j < n; j++) {
+                err = cli_add_option(&t.cli, t.options + j);
+                assert(!err);
+            }
+            bench_report("registration/options/single", n, bench_now() - start, n);
+
+            start = bench_now();
+            for (size_t j = 0; j < n; j++) {
+                err = cli_add_argument(&t.cli, t.arguments + j);
+                assert(!err);
+            }
+            bench_report("registration/arguments/single", n, bench_now() - start, n);
+            table_fini(&t);
+        }
+
+        table_init(&t, n);
+        start = bench_now();
+        err = cli_add_options(&t.cli, n, t.options);
+        assert(!err);
+        bench_report("registration/options/bulk", n, bench_now() - start, n);
+
+        start = bench_now();
+        err = cli_add_arguments(&t.cli, n, t.arguments);
+        assert(!err);
+        (void)err;
+        bench_report("registration/arguments/bulk", n, bench_now() - start, n);
+        table_fini(&t);
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+static const char *path;
+static struct cli_slice files;
+
+static struct cli_option options[] = {
+    {
+        .shrt = 'f',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = &path,
+    },
+};
+
+static struct cli_argument arguments[] = {
+    {
+        .name = "files",
+        .type = CLI_TYPE_STRING,
+        .data = &files,
+        .variadic = true,
+    },
+};
+
+static void
+noop(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    *exit_code = 0;
+}
+
+/* Either pairs of option and value entries, or a plain list of sources the
+ * way a build system would pass them.
+ */
+static void
+generate(const char * const file, const size_t entries, const char sep, const bool pairs)
+{
+    FILE *f;
+
+    f = fopen(file, "w");
+    assert(f);
+
+    for (size_t i = 0; i < entries; i++) {
+        if (pairs && i % 2 == 0) {
+            fprintf(f, "-f%c", sep);
+        } else {
+            fprintf(f, "src/module-%zu/file-%zu.c%c", i % 1024, i, sep);
+        }
+    }
+
+    fclose(f);
+}
+
+static void
+run(
+    const struct cli * const cli,
+    const char * const name,
+    const size_t entries,
+    const char sep,
+    const bool pairs)
+{
+    int fd;
+    merr_t err;
+    int exit_code;
+    uint64_t start;
+    char file[] = "/tmp/libcli-response-bench-XXXXXX";
+    char arg[sizeof(file) + 1];
+    struct cli_parser parser = { .program_name = "bench" };
+
+    fd = mkstemp(file);
+    assert(fd != -1);
+    close(fd);
+
+    generate(file, entries, sep, pairs);
+    snprintf(arg, sizeof(arg), "@%s", file);
+
+    {
+        char *argv[] = { "bench", arg, NULL };
+
+        start = bench_now();
+        err = cli_parse_r(cli, 2, argv, &exit_code, &parser);
+        bench_report(name, entries, bench_now() - start, entries);
+        assert(!err && exit_code == 0);
+        assert(pairs || files.argc == entries);
+        (void)err;
+    }
+
+    cli_parser_fini(&parser);
+    unlink(file);
+}
+
+int
+main(void)
+{
+    merr_t err;
+    struct cli cli = { .name = "bench", .flags = CLI_FLAG_RESPONSE_FILES, .callback = noop };
+    struct cli list = { .name = "bench", .flags = CLI_FLAG_RESPONSE_FILES, .callback = noop };
+    static const size_t entries[] = { 1000, 10000, 100000, 1000000 };
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    assert(!err);
+    err = cli_compile(&cli);
+    assert(!err);
+    err = cli_add_arguments(&list, NELEM(arguments), arguments);
+    assert(!err);
+    (void)err;
+
+    for (size_t i = 0; i < NELEM(entries); i++) {
+        run(&cli, "response/options/newline", entries[i], '\n', true);
+        run(&cli, "response/options/nul", entries[i], '\0', true);
+        run(&list, "response/arguments/newline", entries[i], '\n', false);
+        run(&list, "response/arguments/nul", entries[i], '\0', false);
+    }
+
+    cli_fini(&cli);
+
+    return 0;
+}
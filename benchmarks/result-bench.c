@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/result.h>
+
+#include "bench.h"
+
+#define PARSES 200000
+#define ARGS   8
+
+static uint64_t
+run(const struct cli * const cli, char ** const argv, struct cli_result * const result)
+{
+    uint64_t start;
+    struct cli_parser parser = { .result = result };
+
+    start = bench_now();
+    for (size_t i = 0; i < PARSES; i++) {
+        merr_t err;
+        int exit_code;
+
+        err = cli_parse_r(cli, ARGS + 1, argv, &exit_code, &parser);
+        assert(!err && exit_code == 0);
+        (void)err;
+    }
+
+    return bench_now() - start;
+}
+
+int
+main(void)
+{
+#ifndef CLI_NO_GETOPT_LONG
+    static const size_t optionc[] = { 8, 64, 512 };
+#else
+    /* There are only so many letters. */
+    static const size_t optionc[] = { 8, 48 };
+    static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+#endif
+
+    for (size_t i = 0; i < NELEM(optionc); i++) {
+        merr_t err;
+        uint64_t ns;
+        const size_t n = optionc[i];
+        char (*names)[32];
+        char *argv[ARGS + 1] = { "bench" };
+        int *values;
+        struct cli_option *options;
+        const struct cli_option **members;
+        struct cli cli = { .name = "bench" };
+        struct cli_result result = { 0 };
+        struct cli_constraint constraints[3];
+
+        names = calloc(n, sizeof(*names));
+        values = calloc(n, sizeof(*values));
+        options = calloc(n, sizeof(*options));
+        members = calloc(3 * (n / 4 + 1), sizeof(*members));
+        assert(names && values && options && members);
+
+        for (size_t j = 0; j < n; j++) {
+#ifndef CLI_NO_GETOPT_LONG
+            snprintf(names[j], sizeof(names[j]), "--opt-%zu", j);
+            options[j].lng = names[j] + 2;
+#else
+            snprintf(names[j], sizeof(names[j]), "-%c", letters[j]);
+            options[j].shrt = names[j][1];
+#endif
+            options[j].argument = CLI_HAS_ARG_NONE;
+            options[j].type = CLI_TYPE_INT;
+            options[j].action = CLI_ACTION_ACCUMULATE;
+            options[j].data = &values[j];
+        }
+
+        err = cli_add_options(&cli, n, options);
+        assert(!err);
+
+        /* Every option given is in the last quarter, so no constraint fails
+         * while each still looks at every word.
+         */
+        for (size_t j = 0; j < ARGS; j++)
+            argv[j + 1] = names[n - 1 - j % (n / 4)];
+
+        err = cli_compile(&cli);
+        assert(!err);
+
+        ns = run(&cli, argv, NULL);
+        bench_report("result/parse/none", n, ns, PARSES);
+
+        ns = run(&cli, argv, &result);
+        bench_report("result/parse/tracked", n, ns, PARSES);
+
+        cli_fini(&cli);
+
+        /* Exclusive over the first quarter, requires from the second into the
+         * third, and one-of over the last.
+         */
+        for (size_t c = 0; c < 3; c++) {
+            const struct cli_option **m = members + c * (n / 4 + 1);
+
+            for (size_t j = 0; j < n / 4; j++)
+                m[j] = &options[c * (n / 4) + j + (c == 2 ? n / 4 : 0)];
+            m[n / 4] = NULL;
+
+            constraints[c].type = (enum cli_constraint_type)c;
+            constraints[c].options = m;
+            err = cli_add_constraint(&cli, &constraints[c]);
+            assert(!err);
+        }
+
+        err = cli_compile(&cli);
+        assert(!err);
+        (void)err;
+
+        ns = run(&cli, argv, NULL);
+        bench_report("result/parse/constrained", n, ns, PARSES);
+
+        ns = run(&cli, argv, &result);
+        bench_report("result/parse/constrained-tracked", n, ns, PARSES);
+
+        cli_result_fini(&result);
+        cli_fini(&cli);
+        free(members);
+        free(options);
+        free(values);
+        free(names);
+    }
+
+    return 0;
+}
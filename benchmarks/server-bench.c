@@ -0,0 +1,274 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/server.h>
+
+#include "bench.h"
+
+#define CALLS 2000
+#define SPAWNS 200
+#define CLIENTS 4
+
+struct bench_options {
+    int level;
+    unsigned int verbose;
+    const char *output;
+};
+
+static struct cli root = { .name = "bench" };
+static struct cli run = { .name = "run" };
+
+static struct cli_option root_options[] = {
+    {
+        .shrt = 'v',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "verbose",
+#endif
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_UINT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = (void *)offsetof(struct bench_options, verbose),
+    },
+};
+
+static struct cli_option run_options[] = {
+    {
+        .shrt = 'l',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "level",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct bench_options, level),
+    },
+    {
+        .shrt = 'o',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "output",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct bench_options, output),
+    },
+};
+
+static char *args[] = { "bench", "-vv", "run", "-l", "3", "-o", "out" };
+
+struct client {
+    const char *path;
+    bool reconnect;
+    int null_fd;
+    uint64_t *latencies;
+    size_t count;
+};
+
+static void
+setup(void)
+{
+    merr_t err;
+
+    err = cli_add_options(&root, NELEM(root_options), root_options);
+    assert(!err);
+    err = cli_add_options(&run, NELEM(run_options), run_options);
+    assert(!err);
+    err = cli_add_subcommand(&root, &run);
+    assert(!err);
+    err = cli_compile(&root);
+    assert(!err);
+    (void)err;
+}
+
+static int
+compare(const void * const a, const void * const b)
+{
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void
+report(const char * const name, const size_t n, uint64_t * const latencies, const size_t count)
+{
+    char metric[64];
+
+    qsort(latencies, count, sizeof(*latencies), compare);
+
+    snprintf(metric, sizeof(metric), "%s/p50", name);
+    bench_metric(metric, n, "latency", (double)latencies[count / 2] / 1000, "us");
+    snprintf(metric, sizeof(metric), "%s/p99", name);
+    bench_metric(metric, n, "latency", (double)latencies[count * 99 / 100] / 1000, "us");
+}
+
+static void *
+client(void * const arg)
+{
+    merr_t err;
+    struct cli_client conn;
+    struct client * const c = arg;
+
+    err = cli_client_connect(&conn, c->path);
+    assert(!err);
+
+    for (size_t i = 0; i < c->count; i++) {
+        int exit_code;
+        const uint64_t start = bench_now();
+
+        if (c->reconnect && i > 0) {
+            cli_client_close(&conn);
+            err = cli_client_connect(&conn, c->path);
+            assert(!err);
+        }
+
+        err = cli_client_call(&conn, NELEM(args), args, c->null_fd, c->null_fd, &exit_code);
+        assert(!err && exit_code == 0);
+        (void)err;
+
+        c->latencies[i] = bench_now() - start;
+    }
+
+    cli_client_close(&conn);
+
+    return NULL;
+}
+
+static void
+load(
+    const char * const name,
+    const char * const path,
+    const bool reconnect,
+    const size_t clients,
+    const int null_fd)
+{
+    pthread_t threads[CLIENTS];
+    struct client c[CLIENTS];
+    uint64_t * const latencies = malloc(clients * CALLS * sizeof(*latencies));
+
+    assert(latencies);
+
+    for (size_t i = 0; i < clients; i++) {
+        c[i].path = path;
+        c[i].reconnect = reconnect;
+        c[i].null_fd = null_fd;
+        c[i].latencies = latencies + i * CALLS;
+        c[i].count = CALLS;
+        pthread_create(&threads[i], NULL, client, &c[i]);
+    }
+
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(threads[i], NULL);
+
+    report(name, clients, latencies, clients * CALLS);
+
+    free(latencies);
+}
+
+/* What the server saves: starting a process which parses the same line. */
+static void
+spawn(const char * const self, const int null_fd)
+{
+    uint64_t latencies[SPAWNS];
+
+    for (size_t i = 0; i < SPAWNS; i++) {
+        int status;
+        pid_t pid;
+        const uint64_t start = bench_now();
+
+        pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            char *argv[NELEM(args) + 2] = { (char *)self, "child" };
+
+            memcpy(argv + 2, args + 1, (NELEM(args) - 1) * sizeof(*argv));
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            execv(self, argv);
+            _exit(127);
+        }
+
+        waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        latencies[i] = bench_now() - start;
+    }
+
+    report("fork+exec", 1, latencies, SPAWNS);
+}
+
+int
+main(int argc, char *argv[])
+{
+    merr_t err;
+    int null_fd;
+    char dir[] = "/tmp/libcli-bench-XXXXXX";
+    char path[64];
+    struct bench_options defaults = { 0 };
+    struct cli_server server = {
+        .workers = CLIENTS,
+        .parser = { .data = &defaults },
+        .data_sz = sizeof(defaults),
+    };
+
+    setup();
+
+    if (argc > 1 && strcmp(argv[1], "child") == 0) {
+        int exit_code;
+        struct bench_options options = { 0 };
+        struct cli_parser parser = { .data = &options };
+
+        argv[1] = argv[0];
+        err = cli_parse_r(&root, argc - 1, argv + 1, &exit_code, &parser);
+        cli_fini(&root);
+
+        return err || options.level != 3 ? 1 : exit_code;
+    }
+
+    null_fd = open("/dev/null", O_WRONLY);
+    assert(null_fd >= 0);
+
+    if (!mkdtemp(dir))
+        return 1;
+    snprintf(path, sizeof(path), "%s/sock", dir);
+    server.path = path;
+
+    err = cli_server_start(&server, &root);
+    assert(!err);
+    (void)err;
+
+    load("server/persistent", path, false, 1, null_fd);
+    load("server/persistent", path, false, CLIENTS, null_fd);
+    load("server/connect", path, true, 1, null_fd);
+    load("server/connect", path, true, CLIENTS, null_fd);
+
+    cli_server_stop(&server);
+    rmdir(dir);
+
+    spawn(argv[0], null_fd);
+
+    close(null_fd);
+    cli_fini(&root);
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/stats.h>
+
+#include "bench.h"
+
+#define ARGC       256
+#define ITERATIONS 20000
+
+static int values[3];
+static double ratio;
+
+static struct cli_option options[] = {
+    {
+        .shrt = 'a',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &values[0],
+    },
+    {
+        .shrt = 'b',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &values[1],
+    },
+    {
+        .shrt = 'c',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = &values[2],
+    },
+    {
+        .shrt = 'd',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_DOUBLE,
+        .action = CLI_ACTION_STORE,
+        .data = &ratio,
+    },
+};
+
+static void
+noop(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    *exit_code = 0;
+}
+
+static uint64_t
+run(const struct cli * const cli, char * const * const argv)
+{
+    uint64_t start;
+
+    start = bench_now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        merr_t err;
+        int exit_code;
+
+        err = cli_parse(cli, ARGC, argv, &exit_code);
+        assert(!err && exit_code == 0);
+        (void)err;
+    }
+
+    return bench_now() - start;
+}
+
+int
+main(void)
+{
+    merr_t err;
+    struct cli_stats stats;
+    char *argv[ARGC + 1] = { "bench" };
+    static char * const args[] = { "-a1", "-b", "22", "-c", "-d0.5" };
+    struct cli cli = { .name = "bench", .callback = noop };
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    assert(!err);
+    err = cli_compile(&cli);
+    assert(!err);
+    (void)err;
+
+    for (size_t i = 1; i < ARGC; i++)
+        argv[i] = args[i % NELEM(args)];
+
+    /* Per argument, so the cost of every instrumented call is visible. */
+    cli_stats_enable(false);
+    bench_report("stats/disabled", ARGC, run(&cli, argv), (size_t)ITERATIONS * (ARGC - 1));
+
+    cli_stats_enable(true);
+    cli_stats_reset();
+    bench_report("stats/enabled", ARGC, run(&cli, argv), (size_t)ITERATIONS * (ARGC - 1));
+
+    cli_stats_get(&stats);
+    cli_stats_print(&stats, stdout);
+
+    cli_fini(&cli);
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define LOOKUPS 100000
+
+struct tree {
+    struct cli root;
+    struct cli *subcommands;
+    char (*names)[32];
+};
+
+static void
+tree_init(struct tree * const t, const size_t subcommandc)
+{
+    memset(t, 0, sizeof(*t));
+    t->root.name = "bench";
+    t->subcommands = calloc(subcommandc, sizeof(*t->subcommands));
+    t->names = calloc(subcommandc, sizeof(*t->names));
+    assert(t->subcommands && t->names);
+
+    /* Scramble the names so that registration order is not sorted order. */
+    for (size_t i = 0; i < subcommandc; i++) {
+        snprintf(t->names[i], sizeof(t->names[i]), "command-%zu", (i * 7919) % subcommandc);
+        t->subcommands[i].name = t->names[i];
+    }
+}
+
+static void
+tree_fini(struct tree * const t)
+{
+    cli_fini(&t->root);
+    free(t->names);
+    free(t->subcommands);
+}
+
+static uint64_t
+lookup(const struct tree * const t, const size_t subcommandc)
+{
+    uint64_t start;
+    char *args[] = { "bench", NULL };
+
+    start = bench_now();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        merr_t err;
+        int exit_code;
+
+        args[1] = t->names[(i * 104729) % subcommandc];
+        err = cli_parse(&t->root, NELEM(args), args, &exit_code);
+        assert(!err && exit_code == 0);
+        (void)err;
+    }
+
+    return bench_now() - start;
+}
+
+int
+main(void)
+{
+    static const size_t subcommandc[] = { 10, 100, 1000, 3000, 10000 };
+
+    for (size_t i = 0; i < NELEM(subcommandc); i++) {
+        merr_t err;
+        uint64_t start;
+        struct tree t;
+        const size_t n = subcommandc[i];
+
+        tree_init(&t, n);
+        start = bench_now();
+        for (size_t j = 0; j < n; j++) {
+            err = cli_add_subcommand(&t.root, t.subcommands + j);
+            assert(!err);
+        }
+        bench_report("subcommand/register/single", n, bench_now() - start, n);
+        tree_fini(&t);
+
+        tree_init(&t, n);
+        start = bench_now();
+        err = cli_add_subcommands(&t.root, n, t.subcommands);
+        assert(!err);
+        bench_report("subcommand/register/bulk", n, bench_now() - start, n);
+
+        bench_report("subcommand/dispatch/uncompiled", n, lookup(&t, n), LOOKUPS);
+
+        err = cli_compile(&t.root);
+        assert(!err);
+        (void)err;
+
+        bench_report("subcommand/dispatch/compiled", n, lookup(&t, n), LOOKUPS);
+
+        tree_fini(&t);
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "suggest.h"
+
+#define CANDIDATES 10000
+#define ROUNDS     200
+
+static char names[CANDIDATES][24];
+
+/* Full-matrix Levenshtein distance, the naive way to rank candidates. */
+static unsigned int
+levenshtein(const char * const a, const size_t m, const char * const b, const size_t n)
+{
+    unsigned int row[32];
+
+    for (size_t j = 0; j <= n; j++)
+        row[j] = (unsigned int)j;
+
+    for (size_t i = 1; i <= m; i++) {
+        unsigned int diag = row[0];
+
+        row[0] = (unsigned int)i;
+        for (size_t j = 1; j <= n; j++) {
+            const unsigned int up = row[j];
+            unsigned int best = diag + (a[i - 1] != b[j - 1]);
+
+            if (up + 1 < best)
+                best = up + 1;
+            if (row[j - 1] + 1 < best)
+                best = row[j - 1] + 1;
+
+            diag = up;
+            row[j] = best;
+        }
+    }
+
+    return row[n];
+}
+
+int
+main(void)
+{
+    uint64_t start;
+    size_t found = 0;
+    unsigned int best = 0;
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    static const char word[] = "deploy-servcie";
+
+    /* Names in the style of real subcommands, with a couple of near misses
+     * hidden among them.
+     */
+    for (size_t i = 0; i < CANDIDATES; i++) {
+        static const char *parts[] = {
+            "deploy", "service", "config", "list", "get", "set", "sync",
+        };
+
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        snprintf(
+            names[i], sizeof(names[i]), "%s-%s-%zu", parts[state % NELEM(parts)],
+            parts[(state >> 8) % NELEM(parts)], i);
+    }
+    snprintf(names[CANDIDATES / 2], sizeof(names[0]), "deploy-service");
+    snprintf(names[CANDIDATES / 3], sizeof(names[0]), "deploy-services");
+
+    start = bench_now();
+    for (int r = 0; r < ROUNDS; r++) {
+        struct cli_suggestions sg;
+
+        cli_suggestions_init(&sg, word, sizeof(word) - 1);
+        for (size_t i = 0; i < CANDIDATES; i++)
+            cli_suggestions_add(&sg, names[i]);
+        found += sg.count;
+    }
+    bench_report("bounded bit-parallel, 10k names", ROUNDS, bench_now() - start, ROUNDS);
+    assert(found >= ROUNDS);
+
+    start = bench_now();
+    for (int r = 0; r < ROUNDS; r++) {
+        struct cli_suggestions sg;
+
+        cli_suggestions_init(&sg, word, sizeof(word) - 1);
+        for (size_t i = 0; i < CANDIDATES; i++)
+            best += cli_suggestions_distance(&sg, names[i], strlen(names[i]), 64) == 0;
+    }
+    bench_report("unbounded bit-parallel, 10k names", ROUNDS, bench_now() - start, ROUNDS);
+
+    start = bench_now();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < CANDIDATES; i++)
+            best += levenshtein(word, sizeof(word) - 1, names[i], strlen(names[i])) == 0;
+    }
+    bench_report("dynamic programming, 10k names", ROUNDS, bench_now() - start, ROUNDS);
+
+    printf("%u\n", best);
+
+    return 0;
+}
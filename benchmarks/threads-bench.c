@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "bench.h"
+
+#define PARSES_PER_THREAD 200000
+
+struct bench_options {
+    int level;
+    unsigned int verbose;
+    const char *output;
+};
+
+static struct cli root = { .name = "bench" };
+static struct cli run = { .name = "run" };
+
+static struct cli_option root_options[] = {
+    {
+        .shrt = 'v',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "verbose",
+#endif
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_UINT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = (void *)offsetof(struct bench_options, verbose),
+    },
+};
+
+static struct cli_option run_options[] = {
+    {
+        .shrt = 'l',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "level",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct bench_options, level),
+    },
+    {
+        .shrt = 'o',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "output",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct bench_options, output),
+    },
+};
+
+static char *args[] = { "bench", "-vv", "run", "-l", "3", "-o", "out" };
+
+static void *
+worker(void * const arg)
+{
+    (void)arg;
+
+    for (int i = 0; i < PARSES_PER_THREAD; i++) {
+        merr_t err;
+        int exit_code;
+        struct bench_options options = { 0 };
+        struct cli_parser parser = { .data = &options };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        assert(!err && options.level == 3 && options.verbose == 2);
+        (void)err;
+    }
+
+    return NULL;
+}
+
+int
+main(void)
+{
+    merr_t err;
+    long ncpus;
+    double base = 0;
+    pthread_t *threads;
+
+    err = cli_add_options(&root, NELEM(root_options), root_options);
+    assert(!err);
+    err = cli_add_options(&run, NELEM(run_options), run_options);
+    assert(!err);
+    err = cli_add_subcommand(&root, &run);
+    assert(!err);
+    err = cli_compile(&root);
+    assert(!err);
+    (void)err;
+
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1)
+        ncpus = 1;
+
+    threads = calloc((size_t)ncpus, sizeof(*threads));
+    assert(threads);
+
+    for (long n = 1;; n = n * 2 < ncpus ? n * 2 : ncpus) {
+        uint64_t start, elapsed;
+        double rate;
+
+        start = bench_now();
+        for (long t = 0; t < n; t++)
+            pthread_create(threads + t, NULL, worker, NULL);
+        for (long t = 0; t < n; t++)
+            pthread_join(threads[t], NULL);
+        elapsed = bench_now() - start;
+
+        rate = (double)n * PARSES_PER_THREAD / ((double)elapsed / 1e9);
+        if (n == 1)
+            base = rate;
+
+        bench_report("parse_r/threads", (size_t)n, elapsed, (size_t)n * PARSES_PER_THREAD);
+        printf("%-40s %10ld %14.0f parses/s (%.2fx)\n", "parse_r/threads", n, rate, rate / base);
+
+        if (n == ncpus)
+            break;
+    }
+
+    free(threads);
+    cli_fini(&root);
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include <libcli/output.h>
+#include <libcli/program.h>
+#include <libcli/server.h>
+
+/* Stands in for a program whose tree is served at $LIBCLI_SERVER. Installed
+ * under the name of the program, it runs each invocation on the server with
+ * this process's stdout and stderr, and exits the way the program would have.
+ */
+int
+main(const int argc, char * const argv[])
+{
+    merr_t err;
+    int exit_code;
+    char buf[256];
+    struct cli_client client;
+    const char * const path = getenv("LIBCLI_SERVER");
+
+    cli_set_program_name(argv[0]);
+
+    if (!path) {
+        cli_error("LIBCLI_SERVER is not set");
+        return EX_USAGE;
+    }
+
+    err = cli_client_connect(&client, path);
+    if (err) {
+        merr_strerror(err, buf, sizeof(buf));
+        cli_error("Failed to connect to %s: %s", path, buf);
+        return EX_UNAVAILABLE;
+    }
+
+    err = cli_client_call(&client, argc, argv, STDOUT_FILENO, STDERR_FILENO, &exit_code);
+    cli_client_close(&client);
+    if (err) {
+        merr_strerror(err, buf, sizeof(buf));
+        cli_error("Failed to call %s: %s", path, buf);
+        return EX_UNAVAILABLE;
+    }
+
+    return exit_code;
+}
@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_ALLOC_H
+#define LIBCLI_ALLOC_H
+
+#include <stddef.h>
+
+struct cli_allocator {
+    /* Must behave like realloc(3), including ptr == NULL. */
+    void *(*reallocate)(void *ptr, size_t size, void *ctx);
+    void (*deallocate)(void *ptr, void *ctx);
+    void *ctx;
+};
+
+/* Route every heap allocation made by the library through allocator, or back
+ * to the C library if allocator is NULL. This is not thread-safe, so call it
+ * before using anything else in the library.
+ */
+void
+cli_set_allocator(const struct cli_allocator *allocator);
+
+#endif
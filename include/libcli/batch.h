@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_BATCH_H
+#define LIBCLI_BATCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+typedef void
+cli_batch_report(size_t line, int exit_code, void *ctx);
+
+struct cli_batch {
+    /* Separates command lines: '\n' or '\0'. */
+    int delim;
+    /* Called with the exit code of every non-empty line, numbered from 1. */
+    cli_batch_report *report;
+    void *ctx;
+};
+
+/* Run every command line read from input through the tree as if each had
+ * been passed to cli_parse_r(). Lines are split in place like
+ * cli_line_split() does, quotes and all, and given the parser's program name
+ * as argv[0]. A line which does not split, such as one with an unterminated
+ * quote, is reported with EX_USAGE. Option storage is restored to the values
+ * it held before the first line ahead of each line, including that of stubs
+ * which a line loads. String values only live as long as the callbacks of
+ * their line.
+ */
+merr_t
+cli_parse_batch(
+    const struct cli *cli,
+    FILE *input,
+    const struct cli_batch *batch,
+    struct cli_parser *parser);
+
+merr_t
+cli_parse_batch_fd(
+    const struct cli *cli,
+    int fd,
+    const struct cli_batch *batch,
+    struct cli_parser *parser);
+
+#endif
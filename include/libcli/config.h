@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_CONFIG_H
+#define LIBCLI_CONFIG_H
+
+#include <stddef.h>
+
+#include <merr.h>
+
+/* Option defaults read from an INI file. Keys are long option names. Keys
+ * before the first section, or under [], belong to the root command, and
+ * [sub nested] holds the defaults of subcommand "sub nested". Lines starting
+ * with '#' or ';' are comments. Values run to the end of the line, and one
+ * pair of surrounding double quotes is removed.
+ *
+ * The file stays mapped while the config is open and values point into it,
+ * so string options set from it are only valid until cli_config_close().
+ */
+struct cli_config;
+
+/* On EINVAL, line, if not NULL, is set to the first malformed line. */
+merr_t
+cli_config_open(const char *path, struct cli_config **config, size_t *line);
+
+void
+cli_config_close(struct cli_config *config);
+
+#endif
@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_INCREMENTAL_H
+#define LIBCLI_INCREMENTAL_H
+
+#include <stddef.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+enum cli_token_kind {
+    /* An option, or a cluster of short options. */
+    CLI_TOKEN_OPTION,
+    /* The value of the option in the token before it. */
+    CLI_TOKEN_VALUE,
+    /* A lone --. */
+    CLI_TOKEN_TERMINATOR,
+    CLI_TOKEN_ARGUMENT,
+    CLI_TOKEN_SUBCOMMAND,
+};
+
+enum cli_token_status {
+    CLI_TOKEN_OK,
+    /* Not an option or subcommand of its command. */
+    CLI_TOKEN_UNKNOWN,
+    /* Abbreviates more than one long option. */
+    CLI_TOKEN_AMBIGUOUS,
+    /* A value which does not convert, or one given to an option without
+     * an argument.
+     */
+    CLI_TOKEN_INVALID,
+    /* More arguments than the command takes. */
+    CLI_TOKEN_UNEXPECTED,
+};
+
+struct cli_token {
+    /* Bytes of the line the token spans. */
+    size_t start;
+    size_t len;
+    enum cli_token_kind kind;
+    enum cli_token_status status;
+    /* Command the token was parsed for. */
+    const struct cli *cli;
+    /* Option of an option or value token, the last one of a cluster. */
+    const struct cli_option *option;
+    const struct cli_argument *argument;
+    /* Value of the token, or of the option it ends with, converted like a
+     * parse would store it. Strings stay in the line, and delimited lists
+     * are only checked.
+     */
+    union {
+        long double align;
+        unsigned char bytes[sizeof(long double)];
+    } value;
+};
+
+struct cli_incremental_state;
+
+/* Validates a command line as it is edited, for interactive consoles. Each
+ * token keeps the state the parse reached after it, so an edit only parses
+ * again from the last token which ends before the first changed byte, and
+ * only until a token past the edit is reached in the state it had before.
+ * Typing at the end of a line costs the same however long the line is, and
+ * an edit elsewhere only adds moving the tokens after it.
+ *
+ * Lines hold the arguments after the program name, split on blanks alone
+ * rather than with the quoting of cli_line_split(), so that every token is a
+ * range of bytes of the line. Nothing is stored and no callbacks run.
+ * Response files, config files and constraints are not considered.
+ */
+struct cli_incremental {
+    const struct cli *cli;
+    size_t tokenc;
+    struct cli_token *tokens;
+    /* Tokens which the last update parsed again, up to but not including
+     * last. Others are as they were, apart from where later ones start.
+     */
+    size_t first;
+    size_t last;
+    /* Tokens whose status is not CLI_TOKEN_OK. */
+    size_t errors;
+    /* Command which the end of the line is in. */
+    const struct cli *command;
+    /* Option still waiting for its value. */
+    const struct cli_option *pending;
+    /* Next positional argument which is still required. */
+    const struct cli_argument *missing;
+    size_t capacity;
+    struct cli_incremental_state *states;
+    /* The line as given, and split into words in place. */
+    char *text;
+    char *words;
+    size_t len;
+    size_t size;
+};
+
+/* The tree must be compiled, so that every update works from its lookup
+ * tables.
+ */
+merr_t
+cli_incremental_init(struct cli_incremental *inc, const struct cli *cli);
+
+/* Replace the line with the len bytes of line. Finding what changed means
+ * comparing the lines, so edit instead when the position is known.
+ */
+merr_t
+cli_incremental_update(struct cli_incremental *inc, const char *line, size_t len);
+
+/* Replace removed bytes of the line at pos with the len bytes of text. */
+merr_t
+cli_incremental_edit(
+    struct cli_incremental *inc,
+    size_t pos,
+    size_t removed,
+    const char *text,
+    size_t len);
+
+void
+cli_incremental_fini(struct cli_incremental *inc);
+
+#endif
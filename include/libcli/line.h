@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_LINE_H
+#define LIBCLI_LINE_H
+
+#include <stddef.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+/* Arguments split from a line, pointing into it. */
+struct cli_line {
+    int argc;
+    /* NULL-terminated. */
+    char **argv;
+    size_t capacity;
+};
+
+/* Split s in place into arguments the way a POSIX shell splits words, without
+ * expanding anything:
+ *
+ * - Blanks outside of quotes separate arguments.
+ * - Everything between single quotes is taken literally.
+ * - Between double quotes, a backslash only escapes ", \, $, ` and newline.
+ * - Elsewhere, a backslash takes the next byte literally.
+ * - A backslash before a newline joins the lines.
+ *
+ * Quotes and escapes are removed and every argument is NUL-terminated within
+ * s, so nothing is copied. An unterminated quote or a trailing backslash is
+ * EINVAL, leaving s clobbered. The argv array is reused by later calls.
+ */
+merr_t
+cli_line_split(struct cli_line *line, char *s);
+
+void
+cli_line_fini(struct cli_line *line);
+
+/* Split line like cli_line_split() and parse the arguments as if they had
+ * been passed to cli_parse_r() after the parser's program name. String values
+ * point into line.
+ */
+merr_t
+cli_parse_line(const struct cli *cli, char *line, int *exit_code, struct cli_parser *parser);
+
+#endif
@@ -9,16 +9,26 @@
 #include <getopt.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #include <sys/queue.h>
 
 #include <merr.h>
 
 struct cli;
+struct cli_config;
+struct cli_index;
+struct cli_response;
+struct cli_result;
 
 typedef void
 cli_callback(const struct cli *cli, int *exit_code, void *ctx);
 
+/* Fills in a stub command through the cli_add_*() functions. */
+typedef merr_t
+cli_loader(struct cli *cli, void *ctx);
+
 enum cli_has_arg {
     CLI_HAS_ARG_NONE,
     CLI_HAS_ARG_REQUIRED,
@@ -51,32 +61,127 @@ enum cli_type {
     CLI_TYPE_DOUBLE,
     CLI_TYPE_LONGDOUBLE,
     CLI_TYPE_STRING,
+    /* One of an option's choices, stored as its position in them in an int.
+     * Only valid for options.
+     */
+    CLI_TYPE_CHOICE,
 };
 
 enum cli_action {
     CLI_ACTION_HELP,
     CLI_ACTION_ACCUMULATE,
     CLI_ACTION_STORE,
+    /* Add every value to the struct cli_list which data points to. */
+    CLI_ACTION_APPEND,
+};
+
+/* Behavior of a whole parse, taken from the root of the tree. */
+enum cli_flags {
+    /* Expand @path arguments into the entries of path, one per line or
+     * NUL-terminated. Entries may themselves be response files. Arguments
+     * after -- are left alone.
+     */
+    CLI_FLAG_RESPONSE_FILES = 1 << 0,
+    /* Treat "prog __complete word..." as a request to complete the last word.
+     * Candidate subcommands and options are printed to the parser's output,
+     * one per line, followed by a tab and the description if there is one.
+     * An expected positional argument is printed as <name>. Nothing is
+     * parsed and no callbacks run.
+     */
+    CLI_FLAG_COMPLETION = 1 << 1,
+    /* Treat "prog --cli-stats args..." as a parse of "prog args..." which
+     * prints libcli's statistics for it afterwards. See <libcli/stats.h>.
+     */
+    CLI_FLAG_STATS = 1 << 2,
+    /* Run the subcommand named like the basename of argv[0] as if it were
+     * the root, for binaries which are installed under many names. Any other
+     * name parses the root as usual, so "prog applet args..." still works.
+     */
+    CLI_FLAG_MULTI_CALL = 1 << 3,
 };
 
+/* Members are ordered by size so that the struct has no holes; initialize
+ * it by name.
+ */
 struct cli_option {
-    char shrt;
 #ifndef CLI_NO_GETOPT_LONG
     const char *lng;
 #endif
     const char *description;
+    void *data;
+    /* NULL-terminated values of a CLI_TYPE_CHOICE option. Compiled trees
+     * look them up in constant time.
+     */
+    const char * const *choices;
+    SLIST_ENTRY(cli_option) entry;
     enum cli_has_arg argument;
     enum cli_type type;
     enum cli_action action;
-    void *data;
-    SLIST_ENTRY(cli_option) entry;
+    char shrt;
+    /* When non-zero, each value of a CLI_ACTION_APPEND option is a list of
+     * items separated by this character, like --ids 1,2,3.
+     */
+    char delimiter;
+    /* Position among the options of its command, set by registration. */
+    uint16_t ordinal;
+};
+
+enum cli_constraint_type {
+    /* At most one of the options may be given. */
+    CLI_CONSTRAINT_EXCLUSIVE,
+    /* If the first option is given, all of the others must be too. */
+    CLI_CONSTRAINT_REQUIRES,
+    /* At least one of the options must be given. */
+    CLI_CONSTRAINT_ONE_OF,
+};
+
+/* A rule about which options of a command appear on the command line. Values
+ * from a config file do not count. Violations are usage errors.
+ */
+struct cli_constraint {
+    enum cli_constraint_type type;
+    /* NULL-terminated, and all registered on the same command. */
+    const struct cli_option * const *options;
+    SLIST_ENTRY(cli_constraint) entry;
 };
 
+/* Positional arguments are captured in the order they were added, after any
+ * options and before any subcommand.
+ */
 struct cli_argument {
     const char *name;
     const char *description;
-    enum cli_type type;
+    /* Where the converted value is stored, like cli_option's data. May be
+     * NULL to only check that the argument is present, even when the parser's
+     * data makes the others offsets.
+     */
+    void *data;
     SLIST_ENTRY(cli_argument) entry;
+    enum cli_type type;
+    /* Take every remaining argument, possibly none. data then points to a
+     * struct cli_slice, and type must be CLI_TYPE_STRING. Only the last
+     * argument may be variadic.
+     */
+    bool variadic;
+};
+
+/* Arguments taken by a variadic argument, pointing into the argv which was
+ * parsed rather than copied from it.
+ */
+struct cli_slice {
+    char * const *argv;
+    size_t argc;
+};
+
+/* Values collected by a CLI_ACTION_APPEND option, as an array of the option's
+ * type. Strings point into argv, or into copies owned by the list when they
+ * were split from a delimited value.
+ */
+struct cli_list {
+    void *items;
+    size_t count;
+    size_t capacity;
+    void *strings;
 };
 
 struct cli {
@@ -84,17 +189,66 @@ struct cli {
     const char *description;
     cli_callback *callback;
     void *ctx;
+    unsigned int flags;
     SLIST_HEAD(options, cli_option) options;
     SLIST_HEAD(subcommands, cli) subcommands;
     SLIST_HEAD(arguments, cli_argument) arguments;
+    SLIST_HEAD(constraints, cli_constraint) constraints;
+    struct cli_index *index;
+    /* Makes this command a stub. Everything but its name, description and
+     * flags is registered by the loader, which is called with loader_ctx the
+     * first time a parse or completion descends into the command. The command
+     * is then compiled, and cli_fini() turns it back into a stub.
+     */
+    cli_loader *loader;
+    void *loader_ctx;
     SLIST_ENTRY(cli) entry;
 };
 
+/* Per-call state for cli_parse_r(). Any number of parsers may run
+ * concurrently against the same tree as long as they do not share option
+ * storage, which is what the data member is for.
+ */
+struct cli_parser {
+    /* Used in usage and diagnostics. Defaults to argv[0]. */
+    const char *program_name;
+    /* Destination of help output. Defaults to stdout. */
+    FILE *out;
+    /* Destination of diagnostics and usage errors. Defaults to stderr. */
+    FILE *err;
+    /* When non-NULL, the data of every option and argument is a byte offset
+     * from this base (see offsetof(3)) rather than an absolute address.
+     */
+    void *data;
+    /* When non-NULL, passed to callbacks in place of cli->ctx. */
+    void *ctx;
+    /* Scratch memory, such as a stack buffer, used for anything the parse
+     * needs to allocate. Allocations which do not fit go to the heap.
+     */
+    void *arena;
+    size_t arena_sz;
+    /* Response files mapped by previous parses. String values point into
+     * them, so they stay mapped until cli_parser_fini().
+     */
+    struct cli_response *responses;
+    /* When non-NULL, option defaults for the commands on the parsed path.
+     * Values given on the command line take priority.
+     */
+    const struct cli_config *config;
+    /* When non-NULL, filled with the options which the parse saw. See
+     * <libcli/result.h>.
+     */
+    struct cli_result *result;
+};
+
 merr_t
 cli_add_argument(struct cli *cli, struct cli_argument *argument);
 
 merr_t
-cli_add_arguments(struct cli *cli, size_t optionc, struct cli_argument *argumentv);
+cli_add_arguments(struct cli *cli, size_t argumentc, struct cli_argument *argumentv);
+
+merr_t
+cli_add_constraint(struct cli *cli, struct cli_constraint *constraint);
 
 merr_t
 cli_add_option(struct cli *cli, struct cli_option *option);
@@ -108,10 +262,33 @@ cli_add_subcommand(struct cli *cli, struct cli *subcommand);
 merr_t
 cli_add_subcommands(struct cli *cli, size_t subcommandc, struct cli *subcommandv);
 
+/* Freeze a command tree into flat lookup tables. Once compiled, nothing may be
+ * added to the tree until cli_fini() is called.
+ */
+merr_t
+cli_compile(struct cli *cli);
+
+void
+cli_fini(struct cli *cli);
+
 void
 cli_init(struct cli *cli);
 
 merr_t
 cli_parse(const struct cli *cli, int argc, char * const *argv, int *exit_code);
 
+merr_t
+cli_parse_r(
+    const struct cli *cli,
+    int argc,
+    char * const *argv,
+    int *exit_code,
+    struct cli_parser *parser);
+
+void
+cli_parser_fini(struct cli_parser *parser);
+
+void
+cli_list_fini(struct cli_list *list);
+
 #endif
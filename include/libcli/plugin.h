@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_PLUGIN_H
+#define LIBCLI_PLUGIN_H
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+/* A stub command implemented by a shared object. Use cli_plugin_loader() as
+ * the stub's loader and the plugin as its loader_ctx.
+ */
+struct cli_plugin {
+    /* Passed to dlopen(3). */
+    const char *path;
+    /* A cli_loader exported by the shared object, called with ctx. */
+    const char *symbol;
+    void *ctx;
+    /* Set while the shared object is open. */
+    void *handle;
+};
+
+merr_t
+cli_plugin_loader(struct cli *cli, void *ctx);
+
+/* Close the shared object. Call cli_fini() on the tree first, since the
+ * commands which the plugin registered may live in it.
+ */
+void
+cli_plugin_fini(struct cli_plugin *plugin);
+
+#endif
@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_RESULT_H
+#define LIBCLI_RESULT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libcli/parser.h>
+
+struct cli_result_node;
+
+/* Which options a parse saw on the command line, how many times, and where,
+ * for every command on the parsed path. Values from a config file are not
+ * counted, so a callback can tell them from explicit ones.
+ *
+ * Queries take the command an option was registered on. They are constant in
+ * the number of options, and linear in the depth of the parsed path, which
+ * they walk to find the command. Commands which the parse did not reach have
+ * seen nothing.
+ *
+ * Memory is kept from one parse to the next, so parsing into the same result
+ * again does not allocate. Results are filled while callbacks run, so they
+ * may already be queried from them.
+ */
+struct cli_result {
+    /* Number of commands on the parsed path. */
+    size_t depth;
+    size_t capacity;
+    struct cli_result_node *nodes;
+};
+
+bool
+cli_result_seen(
+    const struct cli_result *result,
+    const struct cli *cli,
+    const struct cli_option *option);
+
+unsigned int
+cli_result_count(
+    const struct cli_result *result,
+    const struct cli *cli,
+    const struct cli_option *option);
+
+/* Index in the parsed arguments of the last occurrence of option, or -1.
+ * Arguments are argv itself, unless response files were expanded.
+ */
+int
+cli_result_position(
+    const struct cli_result *result,
+    const struct cli *cli,
+    const struct cli_option *option);
+
+void
+cli_result_fini(struct cli_result *result);
+
+#endif
@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_SERVER_H
+#define LIBCLI_SERVER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <pthread.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+struct cli_server_pool;
+struct cli_server_worker;
+
+/* Runs command lines sent by clients over a UNIX socket through a tree, so
+ * that the cost of starting a process is paid once. Clients may pass their
+ * stdout and stderr along, which help, diagnostics and callbacks then write
+ * to. Workers block SIGPIPE, so a stream whose reader has gone away only
+ * fails the writes of its own request.
+ *
+ * Requests are parsed concurrently, so callbacks must be thread-safe, and
+ * option data must be relative (see struct cli_parser) unless there is a
+ * single worker.
+ */
+struct cli_server {
+    /* Socket to listen on. A socket left behind at the path is replaced. */
+    const char *path;
+    /* Threads which serve requests. Connected clients hold none between
+     * requests. Defaults to the number of online processors.
+     */
+    unsigned int workers;
+    /* Copied for every request. The streams are replaced by those of the
+     * client when it passes them, and the program name defaults to the
+     * client's argv[0].
+     */
+    struct cli_parser parser;
+    /* When non-zero, every request parses into its own copy of the data_sz
+     * bytes at parser.data, which callbacks get as their context unless
+     * parser.ctx is set.
+     */
+    size_t data_sz;
+    int fd;
+    int wake[2];
+    const struct cli *cli;
+    struct cli_server_pool *pool;
+    unsigned int workerc;
+    struct cli_server_worker *workerv;
+};
+
+merr_t
+cli_server_start(struct cli_server *server, const struct cli *cli);
+
+/* Finish the requests being served, then close the socket. */
+void
+cli_server_stop(struct cli_server *server);
+
+/* Streams of the request which the calling thread is serving, for use in
+ * callbacks. Outside of a request, stdout and stderr.
+ */
+FILE *
+cli_server_out(void);
+
+FILE *
+cli_server_err(void);
+
+/* A connection to a server, which can send any number of requests. */
+struct cli_client {
+    int fd;
+};
+
+merr_t
+cli_client_connect(struct cli_client *client, const char *path);
+
+/* Run argv on the server. Output goes to out_fd and err_fd, or wherever the
+ * server sends it for either one which is -1.
+ */
+merr_t
+cli_client_call(
+    struct cli_client *client,
+    int argc,
+    char * const *argv,
+    int out_fd,
+    int err_fd,
+    int *exit_code);
+
+void
+cli_client_close(struct cli_client *client);
+
+#endif
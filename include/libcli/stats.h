@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_STATS_H
+#define LIBCLI_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Where libcli spends its time. Phases nest: a parse includes the indexing,
+ * conversion, help and callbacks which happen during it.
+ */
+enum cli_stats_phase {
+    /* cli_add_*() */
+    CLI_STATS_REGISTER,
+    /* Lookup tables, whether compiled ahead of time or built for a parse */
+    CLI_STATS_INDEX,
+    /* cli_config_open() */
+    CLI_STATS_CONFIG,
+    /* cli_parse_r() as a whole */
+    CLI_STATS_PARSE,
+    /* Converting and storing option and argument values */
+    CLI_STATS_CONVERT,
+    /* Rendering and writing help */
+    CLI_STATS_HELP,
+    /* Callbacks of the parsed commands */
+    CLI_STATS_CALLBACK,
+    /* Loaders of stub commands, including their registration and indexing */
+    CLI_STATS_LOAD,
+    CLI_STATS_PHASES,
+};
+
+struct cli_stats {
+    struct {
+        uint64_t calls;
+        uint64_t ns;
+    } phases[CLI_STATS_PHASES];
+    /* Heap allocations, including reallocations, and the bytes requested. */
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+};
+
+/* Statistics are only collected while enabled, which costs a load and a
+ * branch per instrumented call otherwise. Setting LIBCLI_STATS in the
+ * environment enables them from the first call into libcli and prints them
+ * to stderr at exit. Trees with CLI_FLAG_STATS also accept a hidden
+ * --cli-stats first argument, which enables them for that parse only and
+ * prints what it counted to the parser's error stream once it is done.
+ * Registration, compilation and config files come before any parse, so their
+ * costs are only captured with LIBCLI_STATS. Other threads parsing at the
+ * same time are counted along with it.
+ */
+void
+cli_stats_enable(bool enable);
+
+/* Totals across all threads since the last reset. */
+void
+cli_stats_get(struct cli_stats *stats);
+
+void
+cli_stats_reset(void);
+
+void
+cli_stats_print(const struct cli_stats *stats, FILE *stream);
+
+#endif
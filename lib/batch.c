@@ -0,0 +1,406 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include <sys/queue.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include <libcli/batch.h>
+#include <libcli/parser.h>
+#include <libcli/program.h>
+
+#include "line.h"
+#include "list.h"
+#include "loader.h"
+#include "mem.h"
+#include "response.h"
+#include "type.h"
+#include "util.h"
+
+#define BUF_SZ (64 * 1024)
+
+struct reader {
+    FILE *stream;
+    int fd;
+    bool eof;
+    char *buf;
+    size_t buf_sz;
+    /* Start of the data which has not been handed out yet. */
+    size_t start;
+    /* Everything in [start, scanned) is known not to contain the delimiter. */
+    size_t scanned;
+    size_t end;
+};
+
+/* Saved option storage, laid out as a list of (pointer, size, bytes). Lists
+ * are saved as their struct cli_list and truncated back on restore.
+ */
+struct snapshot {
+    void *base;
+    /* First failure to save a stub loaded in the middle of a line. */
+    merr_t err;
+    size_t count;
+    size_t bytes;
+    void **ptrs;
+    size_t *sizes;
+    bool *lists;
+    char *values;
+};
+
+static merr_t
+reader_fill(struct reader * const r)
+{
+    size_t n;
+
+    if (r->start > 0) {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->scanned -= r->start;
+        r->end -= r->start;
+        r->start = 0;
+    }
+
+    /* Always keep a byte free to terminate a final undelimited line. */
+    if (r->end + 1 >= r->buf_sz) {
+        char *buf;
+
+        buf = cli_realloc(r->buf, r->buf_sz * 2);
+        if (!buf)
+            return merr(ENOMEM);
+
+        r->buf = buf;
+        r->buf_sz *= 2;
+    }
+
+    if (r->stream) {
+        n = fread(r->buf + r->end, 1, r->buf_sz - r->end - 1, r->stream);
+        if (n == 0) {
+            if (ferror(r->stream))
+                return merr(EIO);
+            r->eof = true;
+        }
+    } else {
+        ssize_t rc;
+
+        do {
+            rc = read(r->fd, r->buf + r->end, r->buf_sz - r->end - 1);
+        } while (rc == -1 && errno == EINTR);
+        if (rc == -1)
+            return merr(errno);
+        if (rc == 0)
+            r->eof = true;
+
+        n = (size_t)rc;
+    }
+
+    r->end += n;
+
+    return 0;
+}
+
+/* Hand out the next line, terminated in place. The line stays valid until
+ * the next call. Sets *line to NULL at the end of the input.
+ */
+static merr_t
+reader_next(struct reader * const r, const int delim, char ** const line)
+{
+    for (;;) {
+        merr_t err;
+        char *p;
+
+        p = memchr(r->buf + r->scanned, delim, r->end - r->scanned);
+        if (p) {
+            *p = '\0';
+            *line = r->buf + r->start;
+            r->start = r->scanned = (size_t)(p - r->buf) + 1;
+
+            return 0;
+        }
+
+        r->scanned = r->end;
+
+        if (r->eof) {
+            if (r->start == r->end) {
+                *line = NULL;
+                return 0;
+            }
+
+            r->buf[r->end] = '\0';
+            *line = r->buf + r->start;
+            r->start = r->scanned = r->end;
+
+            return 0;
+        }
+
+        err = reader_fill(r);
+        if (err)
+            return err;
+    }
+}
+
+static void
+snapshot_add(
+    struct snapshot * const snap,
+    void * const data,
+    const size_t size,
+    const bool list,
+    const bool fill)
+{
+    if (!data)
+        return;
+
+    if (fill) {
+        snap->ptrs[snap->count] = data;
+        snap->sizes[snap->count] = size;
+        snap->lists[snap->count] = list;
+        memcpy(snap->values + snap->bytes, data, size);
+    }
+
+    snap->count++;
+    snap->bytes += size;
+}
+
+static void
+snapshot_walk(
+    const struct cli * const cli,
+    void * const base,
+    struct snapshot * const snap,
+    const bool fill)
+{
+    const struct cli *c;
+    const struct cli_option *o;
+    const struct cli_argument *a;
+
+    SLIST_FOREACH(o, &cli->options, entry) {
+        const bool list = o->action == CLI_ACTION_APPEND;
+
+        if (o->action != CLI_ACTION_HELP) {
+            snapshot_add(
+                snap, cli_resolve_data(o->data, base),
+                list ? sizeof(struct cli_list) : cli_type_size(o->type), list, fill);
+        }
+    }
+
+    SLIST_FOREACH(a, &cli->arguments, entry) {
+        if (!a->data)
+            continue;
+
+        snapshot_add(
+            snap, cli_resolve_data(a->data, base),
+            a->variadic ? sizeof(struct cli_slice) : cli_type_size(a->type), false, fill);
+    }
+
+    SLIST_FOREACH(c, &cli->subcommands, entry)
+        snapshot_walk(c, base, snap, fill);
+}
+
+/* Add the storage of cli and its subcommands to the snapshot. */
+static merr_t
+snapshot_extend(struct snapshot * const snap, const struct cli * const cli)
+{
+    char *mem;
+    size_t count;
+    struct snapshot more = { 0 };
+
+    snapshot_walk(cli, snap->base, &more, false);
+    if (more.count == 0)
+        return 0;
+
+    count = snap->count + more.count;
+    mem = cli_malloc(
+        count * (sizeof(*snap->ptrs) + sizeof(*snap->sizes) + sizeof(*snap->lists)) +
+        snap->bytes + more.bytes);
+    if (!mem)
+        return merr(ENOMEM);
+
+    more.ptrs = (void **)mem;
+    more.sizes = (size_t *)(more.ptrs + count);
+    more.lists = (bool *)(more.sizes + count);
+    more.values = (char *)(more.lists + count);
+
+    if (snap->count > 0) {
+        memcpy(more.ptrs, snap->ptrs, snap->count * sizeof(*snap->ptrs));
+        memcpy(more.sizes, snap->sizes, snap->count * sizeof(*snap->sizes));
+        memcpy(more.lists, snap->lists, snap->count * sizeof(*snap->lists));
+        memcpy(more.values, snap->values, snap->bytes);
+    }
+
+    cli_free(snap->ptrs);
+    snap->ptrs = more.ptrs;
+    snap->sizes = more.sizes;
+    snap->lists = more.lists;
+    snap->values = more.values;
+    snapshot_walk(cli, snap->base, snap, true);
+
+    return 0;
+}
+
+/* A stub registers its options when a line first reaches it, and they would
+ * otherwise keep their values from that line to the next. Loads are seen
+ * before the line parses anything into the stub, which a comparison after
+ * the line could not do.
+ */
+static void
+snapshot_loaded(const struct cli * const cli, void * const ctx)
+{
+    struct snapshot * const snap = ctx;
+
+    if (!snap->err)
+        snap->err = snapshot_extend(snap, cli);
+}
+
+static void
+snapshot_restore(const struct snapshot * const snap)
+{
+    const char *value = snap->values;
+
+    for (size_t i = 0; i < snap->count; i++) {
+        if (snap->lists[i]) {
+            struct cli_list saved;
+
+            /* The items may have moved, but the ones before count did not
+             * change.
+             */
+            memcpy(&saved, value, sizeof(saved));
+            cli_list_truncate(snap->ptrs[i], saved.count, saved.strings);
+        } else {
+            memcpy(snap->ptrs[i], value, snap->sizes[i]);
+        }
+        value += snap->sizes[i];
+    }
+}
+
+static merr_t
+parse_batch(
+    const struct cli * const cli,
+    struct reader * const r,
+    const struct cli_batch * const batch,
+    struct cli_parser * const parser)
+{
+    merr_t err;
+    struct snapshot snap = { 0 };
+    size_t lineno = 0;
+    struct cli_line split = { 0 };
+    struct cli_response *responses;
+    const char *program;
+    const char *program_short;
+    const char *slash;
+
+    if (!cli || !batch || !parser || (batch->delim != '\n' && batch->delim != '\0'))
+        return merr(EINVAL);
+
+    r->buf_sz = BUF_SZ;
+    r->buf = cli_malloc(r->buf_sz);
+    if (!r->buf)
+        return merr(ENOMEM);
+
+    responses = parser->responses;
+    snap.base = parser->data;
+
+    err = snapshot_extend(&snap, cli);
+    if (err)
+        goto out;
+
+    program = parser->program_name ? parser->program_name :
+        cli_program_name           ? cli_program_name :
+                                     cli->name;
+    slash = strrchr(program, PATH_SEP);
+    program_short = slash ? slash + 1 : program;
+
+    for (;;) {
+        int exit_code = 0;
+        char *line;
+
+        err = reader_next(r, batch->delim, &line);
+        if (err || !line)
+            break;
+
+        lineno++;
+
+        /* A line which does not split only fails itself, like a usage
+         * error would.
+         */
+        err = cli_line_split_after(&split, line, 1);
+        if (merr_errno(err) == EINVAL) {
+            fprintf(
+                parser->err ? parser->err : stderr,
+                "%s: line %zu: Unterminated quote or trailing backslash\n",
+                program_short,
+                lineno);
+            if (batch->report)
+                batch->report(lineno, EX_USAGE, batch->ctx);
+            continue;
+        }
+        if (err)
+            break;
+
+        if (split.argc == 1)
+            continue;
+
+        split.argv[0] = (char *)program;
+
+        snapshot_restore(&snap);
+
+        cli_load_watch(snapshot_loaded, &snap);
+        err = cli_parse_r(cli, split.argc, split.argv, &exit_code, parser);
+        cli_load_watch(NULL, NULL);
+
+        /* Nothing from this line outlives it, including response files. */
+        cli_response_release(parser->responses, responses);
+        parser->responses = responses;
+
+        if (!err)
+            err = snap.err;
+        if (err)
+            break;
+
+        if (batch->report)
+            batch->report(lineno, exit_code, batch->ctx);
+    }
+
+out:
+    cli_free(snap.ptrs);
+    cli_line_fini(&split);
+    cli_free(r->buf);
+
+    return err;
+}
+
+merr_t
+cli_parse_batch(
+    const struct cli * const cli,
+    FILE * const input,
+    const struct cli_batch * const batch,
+    struct cli_parser * const parser)
+{
+    struct reader r = { .stream = input, .fd = -1 };
+
+    if (!input)
+        return merr(EINVAL);
+
+    return parse_batch(cli, &r, batch, parser);
+}
+
+merr_t
+cli_parse_batch_fd(
+    const struct cli * const cli,
+    const int fd,
+    const struct cli_batch * const batch,
+    struct cli_parser * const parser)
+{
+    struct reader r = { .fd = fd };
+
+    if (fd < 0)
+        return merr(EINVAL);
+
+    return parse_batch(cli, &r, batch, parser);
+}
@@ -0,0 +1,258 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/queue.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "complete.h"
+#include "index.h"
+#include "loader.h"
+#include "mem.h"
+
+#define TABLES (CLI_INDEX_OPTIONS | CLI_INDEX_SUBCOMMANDS | CLI_INDEX_PREFIX)
+
+/* Where the words before the one being completed left off. */
+struct position {
+    const struct cli *cli;
+    const struct cli_index *idx;
+    /* Index built for this completion, when the tree is not compiled, and
+     * how much of the arena was used before it.
+     */
+    struct cli_index *transient;
+    size_t mark;
+    /* Next positional argument to fill, NULL once they are all filled. */
+    const struct cli_argument *argument;
+    /* The next word belongs to the previous option. */
+    bool value;
+    /* The words so far included --. */
+    bool terminated;
+};
+
+/* Give back the index of the previous level, so that deep paths need no
+ * more scratch memory than their largest level.
+ */
+static void
+position_leave(struct position * const pos, struct cli_arena * const arena)
+{
+    if (!pos->transient)
+        return;
+
+    cli_index_destroy(pos->transient, arena);
+    pos->transient = NULL;
+    if (arena)
+        arena->used = pos->mark;
+}
+
+static merr_t
+position_enter(
+    struct position * const pos,
+    const struct cli * const cli,
+    struct cli_arena * const arena)
+{
+    merr_t err;
+
+    position_leave(pos, arena);
+
+    err = cli_load(cli);
+    if (err)
+        return err;
+
+    pos->cli = cli;
+    pos->argument = SLIST_FIRST(&cli->arguments);
+    if (cli->index && (cli->index->tables & TABLES) == TABLES) {
+        pos->idx = cli->index;
+    } else {
+        pos->mark = arena ? arena->used : 0;
+        err = cli_index_create(cli, TABLES, arena, &pos->transient);
+        if (err)
+            return err;
+        pos->idx = pos->transient;
+    }
+
+    return 0;
+}
+
+static bool
+takes_next(const struct cli_option * const option)
+{
+    return option && option->argument == CLI_HAS_ARG_REQUIRED;
+}
+
+static merr_t
+advance(struct position * const pos, const char * const word, struct cli_arena * const arena)
+{
+    const struct cli *sub;
+
+    if (pos->value) {
+        pos->value = false;
+        return 0;
+    }
+
+    if (!pos->terminated && word[0] == '-' && word[1] != '\0') {
+        if (word[1] == '-') {
+#ifndef CLI_NO_GETOPT_LONG
+            const char *name = word + 2;
+            const char *eq;
+
+            if (*name == '\0') {
+                pos->terminated = true;
+                return 0;
+            }
+
+            eq = strchr(name, '=');
+            if (!eq)
+                pos->value = takes_next(cli_index_find_long(pos->idx, name, strlen(name), NULL));
+#else
+            if (word[2] == '\0')
+                pos->terminated = true;
+#endif
+            return 0;
+        }
+
+        /* In a cluster, an option with an argument takes the rest of it. */
+        for (const char *p = word + 1; *p != '\0'; p++) {
+            const struct cli_option *option = cli_index_find_short(pos->idx, *p);
+
+            if (option && option->argument != CLI_HAS_ARG_NONE) {
+                pos->value = takes_next(option) && p[1] == '\0';
+                break;
+            }
+        }
+
+        return 0;
+    }
+
+    if (pos->argument) {
+        if (!pos->argument->variadic)
+            pos->argument = SLIST_NEXT(pos->argument, entry);
+        return 0;
+    }
+
+    sub = cli_index_find_subcommand(pos->idx, pos->cli, word);
+    if (sub)
+        return position_enter(pos, sub, arena);
+
+    return 0;
+}
+
+static void
+emit(
+    FILE * const out,
+    const char * const candidate,
+    const char * const suffix,
+    const char * const description)
+{
+    fputs(candidate, out);
+    fputs(suffix, out);
+    if (description) {
+        fputc('\t', out);
+        fputs(description, out);
+    }
+    fputc('\n', out);
+}
+
+static void
+emit_options(const struct position * const pos, const char * const word, FILE * const out)
+{
+    const struct cli_option *o;
+
+    /* A lone dash lists every short option before the long ones. */
+    if (word[1] == '\0') {
+        SLIST_FOREACH(o, &pos->cli->options, entry) {
+            if (o->shrt) {
+                const char shrt[] = { '-', o->shrt, '\0' };
+
+                emit(out, shrt, "", o->description);
+            }
+        }
+    } else if (word[1] != '-') {
+        if (word[2] == '\0') {
+            o = cli_index_find_short(pos->idx, word[1]);
+            if (o)
+                emit(out, word, "", o->description);
+        }
+        return;
+    }
+
+#ifndef CLI_NO_GETOPT_LONG
+    {
+        size_t first, count;
+        const char * const prefix = word[1] == '-' ? word + 2 : "";
+
+        if (strchr(prefix, '='))
+            return;
+
+        first = cli_index_prefix_long(pos->idx, prefix, strlen(prefix), &count);
+        for (size_t i = first; i < first + count; i++) {
+            fputs("--", out);
+            emit(out, pos->idx->lngv[i]->lng, "", pos->idx->lngv[i]->description);
+        }
+    }
+#endif
+}
+
+merr_t
+cli_complete(
+    const struct cli * const cli,
+    const int wordc,
+    char * const * const wordv,
+    FILE * const out,
+    struct cli_arena * const arena)
+{
+    merr_t err;
+    const char *word;
+    struct position pos = { 0 };
+
+    assert(cli);
+    assert(out);
+
+    err = position_enter(&pos, cli, arena);
+    if (err)
+        return err;
+
+    for (int i = 0; i < wordc - 1; i++) {
+        err = advance(&pos, wordv[i], arena);
+        if (err)
+            goto out;
+    }
+
+    /* Values of options are up to the shell. */
+    if (pos.value)
+        goto out;
+
+    word = wordc > 0 ? wordv[wordc - 1] : "";
+
+    flockfile(out);
+
+    if (!pos.terminated && word[0] == '-') {
+        emit_options(&pos, word, out);
+    } else if (pos.argument) {
+        /* Named, rather than completed, since any value will do. */
+        fputc('<', out);
+        emit(out, pos.argument->name, ">", pos.argument->description);
+    } else {
+        size_t first, count;
+
+        first = cli_index_prefix_subcommands(pos.idx, word, &count);
+        for (size_t i = first; i < first + count; i++)
+            emit(out, pos.idx->subv[i]->name, "", pos.idx->subv[i]->description);
+    }
+
+    funlockfile(out);
+
+out:
+    position_leave(&pos, arena);
+
+    return err;
+}
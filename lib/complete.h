@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_COMPLETE_H
+#define LIBCLI_COMPLETE_H
+
+#include <stdio.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "mem.h"
+
+/* Name of the hidden argument which turns a parse into a completion. */
+#define CLI_COMPLETE_ARG "__complete"
+
+/* Print the candidates for the last of wordc words, given the words before
+ * it, one per line with a tab and the description when there is one.
+ */
+merr_t
+cli_complete(
+    const struct cli *cli,
+    int wordc,
+    char * const *wordv,
+    FILE *out,
+    struct cli_arena *arena);
+
+#endif
@@ -0,0 +1,415 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include <libcli/config.h>
+
+#include "config.h"
+#include "mem.h"
+#include "stats.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+static uint64_t
+hash_append(uint64_t h, const char * const s, const size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= FNV_PRIME;
+    }
+
+    return h;
+}
+
+static bool
+is_blank(const char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static char *
+trim(char *start, char **end)
+{
+    while (start < *end && is_blank(*start))
+        start++;
+    while (*end > start && is_blank((*end)[-1]))
+        (*end)--;
+
+    return start;
+}
+
+static merr_t
+grow(void ** const v, size_t * const sz, const size_t size)
+{
+    void *nv;
+    const size_t nsz = *sz ? *sz * 2 : 64;
+
+    nv = cli_realloc(*v, nsz * size);
+    if (!nv)
+        return merr(ENOMEM);
+
+    *v = nv;
+    *sz = nsz;
+
+    return 0;
+}
+
+/* Collapse runs of blanks in a section path to single spaces, in place. */
+static size_t
+normalize_path(char * const path, const size_t len)
+{
+    size_t n = 0;
+    bool blank = false;
+
+    for (size_t i = 0; i < len; i++) {
+        if (is_blank(path[i])) {
+            blank = n > 0;
+            continue;
+        }
+
+        if (blank)
+            path[n++] = ' ';
+        blank = false;
+        path[n++] = path[i];
+    }
+
+    path[n] = '\0';
+
+    return n;
+}
+
+static merr_t
+add_section(
+    struct cli_config * const config,
+    size_t * const sz,
+    const char * const path,
+    const size_t path_len)
+{
+    struct cli_config_section *section;
+
+    if (config->sectionc == *sz) {
+        const merr_t err = grow((void **)&config->sectionv, sz, sizeof(*config->sectionv));
+
+        if (err)
+            return err;
+    }
+
+    section = &config->sectionv[config->sectionc++];
+    section->hash = hash_append(FNV_OFFSET, path, path_len);
+    section->path = path;
+    section->path_len = path_len;
+    section->first = config->entryc;
+    section->count = 0;
+
+    return 0;
+}
+
+/* One pass over the file, which terminates keys and values in place and
+ * records where each section's entries start. Nothing is converted here.
+ */
+static merr_t
+read_entries(struct cli_config * const config, size_t * const line)
+{
+    merr_t err;
+    size_t lineno = 0;
+    size_t entry_sz = 0;
+    size_t section_sz = 0;
+    char *p, *end;
+    const size_t page_sz = (size_t)sysconf(_SC_PAGESIZE);
+
+    /* Entries before the first header belong to the root command. */
+    err = add_section(config, &section_sz, "", 0);
+    if (err || !config->map)
+        return err;
+
+    p = config->map;
+    end = p + config->map_sz;
+
+    while (p < end) {
+        char *eol, *start, *stop, *eq, *key_end, *value;
+        struct cli_config_entry *entry;
+        size_t path_len;
+
+        lineno++;
+
+        eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol)
+            eol = end;
+
+        start = p;
+        stop = eol;
+        p = eol + 1;
+
+        if (stop > start && stop[-1] == '\r')
+            stop--;
+
+        start = trim(start, &stop);
+        if (start == stop || *start == '#' || *start == ';')
+            continue;
+
+        if (*start == '[') {
+            if (stop - start < 2 || stop[-1] != ']')
+                goto invalid;
+
+            /* The closing bracket is always within the mapping. */
+            path_len = normalize_path(start + 1, (size_t)(stop - start - 2));
+            err = add_section(config, &section_sz, start + 1, path_len);
+            if (err)
+                return err;
+
+            continue;
+        }
+
+        eq = memchr(start, '=', (size_t)(stop - start));
+        if (!eq || eq == start)
+            goto invalid;
+
+        key_end = eq;
+        while (is_blank(key_end[-1]))
+            key_end--;
+        *key_end = '\0';
+
+        value = trim(eq + 1, &stop);
+        if (stop - value >= 2 && *value == '"' && stop[-1] == '"') {
+            value++;
+            stop--;
+        }
+
+        if (stop < end) {
+            *stop = '\0';
+        } else if (config->map_sz % page_sz == 0) {
+            /* The remainder of the last page is zero-filled unless the file
+             * ends exactly on a page boundary.
+             */
+            config->tail = cli_malloc((size_t)(stop - value) + 1);
+            if (!config->tail)
+                return merr(ENOMEM);
+
+            memcpy(config->tail, value, (size_t)(stop - value));
+            config->tail[stop - value] = '\0';
+            value = config->tail;
+        }
+
+        if (config->entryc == entry_sz) {
+            err = grow((void **)&config->entryv, &entry_sz, sizeof(*config->entryv));
+            if (err)
+                return err;
+        }
+
+        entry = &config->entryv[config->entryc++];
+        entry->key = start;
+        entry->key_len = (size_t)(key_end - start);
+        entry->value = value;
+        config->sectionv[config->sectionc - 1].count++;
+    }
+
+    return 0;
+
+invalid:
+    if (line)
+        *line = lineno;
+
+    return merr(EINVAL);
+}
+
+static int
+section_cmp(const void * const a, const void * const b)
+{
+    const struct cli_config_section * const x = a;
+    const struct cli_config_section * const y = b;
+    int rc;
+
+    if (x->hash != y->hash)
+        return x->hash < y->hash ? -1 : 1;
+
+    rc = strcmp(x->path, y->path);
+    if (rc)
+        return rc;
+
+    /* Repeated sections stay in file order. */
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+merr_t
+cli_config_open(const char * const path, struct cli_config ** const config, size_t * const line)
+{
+    int fd;
+    merr_t err;
+    struct stat st;
+    size_t n = 0;
+    struct cli_config *cfg;
+    const uint64_t start = cli_stats_start();
+
+    if (!path || !config)
+        return merr(EINVAL);
+
+    *config = NULL;
+
+    cfg = cli_calloc(1, sizeof(*cfg));
+    if (!cfg)
+        return merr(ENOMEM);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        err = merr(errno);
+        goto out;
+    }
+
+    if (fstat(fd, &st) == -1) {
+        err = merr(errno);
+        close(fd);
+        goto out;
+    }
+
+    if (st.st_size > 0) {
+        /* Keys and values are terminated in place, so the mapping is private
+         * and writable. Pages are only copied where that happens.
+         */
+        cfg->map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (cfg->map == MAP_FAILED) {
+            err = merr(errno);
+            cfg->map = NULL;
+            close(fd);
+            goto out;
+        }
+
+        cfg->map_sz = (size_t)st.st_size;
+    }
+
+    close(fd);
+
+    err = read_entries(cfg, line);
+    if (err)
+        goto out;
+
+    /* Only sections with entries are worth finding. */
+    for (size_t i = 0; i < cfg->sectionc; i++) {
+        if (cfg->sectionv[i].count > 0)
+            cfg->sectionv[n++] = cfg->sectionv[i];
+    }
+    cfg->sectionc = n;
+
+    qsort(cfg->sectionv, cfg->sectionc, sizeof(*cfg->sectionv), section_cmp);
+
+    *config = cfg;
+    cfg = NULL;
+
+out:
+    cli_config_close(cfg);
+    cli_stats_stop(CLI_STATS_CONFIG, start);
+
+    return err;
+}
+
+void
+cli_config_close(struct cli_config * const config)
+{
+    if (!config)
+        return;
+
+    if (config->map)
+        munmap(config->map, config->map_sz);
+    cli_free(config->tail);
+    cli_free(config->entryv);
+    cli_free(config->sectionv);
+    cli_free(config);
+}
+
+void
+cli_config_path_init(
+    struct cli_config_path * const path,
+    const struct cli_config_path * const parent,
+    const char * const name)
+{
+    assert(path);
+    assert(name);
+
+    path->parent = parent;
+    path->name = name;
+    path->name_len = strlen(name);
+    path->hash = parent ? hash_append(parent->hash, " ", 1) : FNV_OFFSET;
+    path->hash = hash_append(path->hash, name, path->name_len);
+}
+
+static bool
+path_matches(const struct cli_config_section * const section, const struct cli_config_path *path)
+{
+    size_t len = section->path_len;
+
+    /* Compare from the innermost command outwards. */
+    for (; path; path = path->parent) {
+        if (len < path->name_len ||
+            memcmp(section->path + len - path->name_len, path->name, path->name_len) != 0)
+            return false;
+
+        len -= path->name_len;
+
+        if (path->parent) {
+            if (len == 0 || section->path[len - 1] != ' ')
+                return false;
+            len--;
+        }
+    }
+
+    return len == 0;
+}
+
+const struct cli_config_section *
+cli_config_find_section(
+    const struct cli_config * const config,
+    const struct cli_config_path * const path,
+    size_t * const count)
+{
+    size_t lo = 0;
+    size_t hi;
+    uint64_t hash;
+
+    assert(config);
+    assert(count);
+
+    *count = 0;
+    hash = path ? path->hash : FNV_OFFSET;
+    hi = config->sectionc;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (config->sectionv[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo < config->sectionc && config->sectionv[lo].hash == hash; lo++) {
+        const struct cli_config_section * const section = &config->sectionv[lo];
+
+        if (!path_matches(section, path))
+            continue;
+
+        while (lo + *count < config->sectionc &&
+               config->sectionv[lo + *count].hash == hash &&
+               strcmp(config->sectionv[lo + *count].path, section->path) == 0)
+            (*count)++;
+
+        return section;
+    }
+
+    return NULL;
+}
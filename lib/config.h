@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_CONFIG_PRIVATE_H
+#define LIBCLI_CONFIG_PRIVATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libcli/config.h>
+
+struct cli_config_entry {
+    const char *key;
+    size_t key_len;
+    const char *value;
+};
+
+/* Entries under one section header, in file order. */
+struct cli_config_section {
+    uint64_t hash;
+    const char *path;
+    size_t path_len;
+    size_t first;
+    size_t count;
+};
+
+struct cli_config {
+    void *map;
+    size_t map_sz;
+    /* Copy of the final value when it runs up to a page boundary and there is
+     * no room to terminate it in the mapping.
+     */
+    char *tail;
+    /* In file order. */
+    size_t entryc;
+    struct cli_config_entry *entryv;
+    /* Sorted by hash, then path. A section which appears more than once has
+     * one element per header, in file order.
+     */
+    size_t sectionc;
+    struct cli_config_section *sectionv;
+};
+
+/* Subcommand path of the command being parsed, linked from the innermost
+ * command outwards. The root command has no path.
+ */
+struct cli_config_path {
+    const struct cli_config_path *parent;
+    const char *name;
+    size_t name_len;
+    uint64_t hash;
+};
+
+void
+cli_config_path_init(
+    struct cli_config_path *path,
+    const struct cli_config_path *parent,
+    const char *name);
+
+/* Find the headers of the section for path. Sets count to the number of
+ * consecutive elements which belong to it.
+ */
+const struct cli_config_section *
+cli_config_find_section(
+    const struct cli_config *config,
+    const struct cli_config_path *path,
+    size_t *count);
+
+#endif
@@ -0,0 +1,817 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <float.h>
+#include <locale.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include "convert.h"
+#include "mem.h"
+
+#if FLT_RADIX != 2 || FLT_MANT_DIG != 24 || DBL_MANT_DIG != 53
+#error "float and double must be IEEE 754 binary32 and binary64"
+#endif
+
+/* Enough digits to round any double correctly; see the decimal conversion in
+ * Go's strconv, which this follows.
+ */
+#define DECIMAL_DIGITS 800
+
+/* Largest shift which cannot overflow a uint64_t in the shift loops. */
+#define MAX_SHIFT 60
+
+/* Significant digits which always fit in a uint64_t. */
+#define MANT_DIGITS 19
+
+struct decimal {
+    /* Digit values, most significant first, without trailing zeros. */
+    unsigned char d[DECIMAL_DIGITS];
+    int nd;
+    /* Position of the decimal point relative to d. */
+    int dp;
+    /* Nonzero digits were dropped past the end of d. */
+    bool trunc;
+};
+
+enum number_kind {
+    NUMBER_FINITE,
+    NUMBER_INF,
+    NUMBER_NAN,
+};
+
+struct number {
+    enum number_kind kind;
+    bool neg;
+    /* The digits as an integer and the power of ten which scales it, which
+     * are only exact when nsig <= MANT_DIGITS.
+     */
+    uint64_t mant;
+    int exp10;
+    int nsig;
+    struct decimal dec;
+};
+
+struct float_format {
+    unsigned int mant_bits;
+    unsigned int exp_bits;
+    int bias;
+};
+
+static const struct float_format float_format = { 23, 8, -127 };
+static const struct float_format double_format = { 52, 11, -1023 };
+
+/* Binary exponents which bring a decimal with the given number of integer
+ * digits down below one.
+ */
+static const int powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+
+static int
+digit_value(const char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+static bool
+is_digit(const char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* ASCII-only, so the result cannot depend on the locale. */
+static bool
+caseeq(const char *s, const char *lower)
+{
+    for (; *s && *lower; s++, lower++) {
+        const char c = *s >= 'A' && *s <= 'Z' ? (char)(*s - 'A' + 'a') : *s;
+
+        if (c != *lower)
+            return false;
+    }
+
+    return *s == *lower;
+}
+
+static merr_t
+convert_magnitude(const char *s, const unsigned long long limit, unsigned long long * const value)
+{
+    int base = 10;
+    bool digit = false;
+    bool overflow = false;
+    unsigned long long v = 0;
+
+    if (s[0] == '0') {
+        if (s[1] == 'x' || s[1] == 'X') {
+            base = 16;
+        } else if (s[1] == 'o' || s[1] == 'O') {
+            base = 8;
+        } else if (s[1] == 'b' || s[1] == 'B') {
+            base = 2;
+        }
+
+        if (base != 10)
+            s += 2;
+    }
+
+    if (*s == '\0')
+        return merr(EINVAL);
+
+    for (; *s != '\0'; s++) {
+        int d;
+
+        /* Separators go between two digits. */
+        if (*s == '_') {
+            if (!digit)
+                return merr(EINVAL);
+
+            digit = false;
+            continue;
+        }
+
+        d = digit_value(*s);
+        if (d < 0 || d >= base)
+            return merr(EINVAL);
+
+        digit = true;
+
+        /* Keep going after an overflow so that garbage takes precedence. */
+        if (overflow)
+            continue;
+
+        if ((unsigned long long)d > limit ||
+            v > (limit - (unsigned long long)d) / (unsigned int)base)
+        {
+            overflow = true;
+            continue;
+        }
+
+        v = v * (unsigned int)base + (unsigned int)d;
+    }
+
+    if (!digit)
+        return merr(EINVAL);
+
+    if (overflow)
+        return merr(ERANGE);
+
+    *value = v;
+
+    return 0;
+}
+
+merr_t
+cli_convert_uint(const char *str, const unsigned long long max, unsigned long long * const value)
+{
+    if (!str || !value)
+        return merr(EINVAL);
+
+    if (*str == '+')
+        str++;
+
+    return convert_magnitude(str, max, value);
+}
+
+merr_t
+cli_convert_int(
+    const char *str,
+    const long long min,
+    const long long max,
+    long long * const value)
+{
+    merr_t err;
+    bool neg = false;
+    unsigned long long mag;
+
+    if (!str || !value || min > 0 || max < 0)
+        return merr(EINVAL);
+
+    if (*str == '-') {
+        neg = true;
+        str++;
+    } else if (*str == '+') {
+        str++;
+    }
+
+    /* The magnitude of min computed without overflowing on LLONG_MIN. */
+    err = convert_magnitude(
+        str, neg ? (unsigned long long)-(min + 1) + 1 : (unsigned long long)max, &mag);
+    if (err)
+        return err;
+
+    if (neg) {
+        *value = mag == 0 ? 0 : -(long long)(mag - 1) - 1;
+    } else {
+        *value = (long long)mag;
+    }
+
+    return 0;
+}
+
+static void
+decimal_add_digit(struct decimal * const dec, const int d)
+{
+    /* Leading zeros only move the decimal point. */
+    if (d == 0 && dec->nd == 0) {
+        dec->dp--;
+        return;
+    }
+
+    if (dec->nd < DECIMAL_DIGITS) {
+        dec->d[dec->nd++] = (unsigned char)d;
+    } else if (d != 0) {
+        dec->trunc = true;
+    }
+}
+
+static merr_t
+scan(const char *s, struct number * const n)
+{
+    int frac = 0;
+    int exp = 0;
+    bool dot = false;
+    bool digit = false;
+    bool digits = false;
+
+    memset(n, 0, offsetof(struct number, dec));
+    n->dec.nd = 0;
+    n->dec.dp = 0;
+    n->dec.trunc = false;
+
+    if (*s == '-') {
+        n->neg = true;
+        s++;
+    } else if (*s == '+') {
+        s++;
+    }
+
+    if (caseeq(s, "inf") || caseeq(s, "infinity")) {
+        n->kind = NUMBER_INF;
+        return 0;
+    }
+
+    if (caseeq(s, "nan")) {
+        n->kind = NUMBER_NAN;
+        return 0;
+    }
+
+    for (; *s != '\0' && *s != 'e' && *s != 'E'; s++) {
+        if (*s == '_') {
+            if (!digit || !is_digit(s[1]))
+                return merr(EINVAL);
+
+            digit = false;
+            continue;
+        }
+
+        if (*s == '.') {
+            if (dot)
+                return merr(EINVAL);
+
+            dot = true;
+            digit = false;
+            n->dec.dp = n->dec.nd;
+            continue;
+        }
+
+        if (!is_digit(*s))
+            return merr(EINVAL);
+
+        digit = digits = true;
+
+        if (dot)
+            frac++;
+
+        if (n->nsig > 0 || *s != '0') {
+            if (n->nsig < MANT_DIGITS)
+                n->mant = n->mant * 10 + (uint64_t)(*s - '0');
+            n->nsig++;
+        }
+
+        decimal_add_digit(&n->dec, *s - '0');
+    }
+
+    if (!digits)
+        return merr(EINVAL);
+
+    if (!dot)
+        n->dec.dp = n->dec.nd;
+
+    if (*s == 'e' || *s == 'E') {
+        bool eneg = false;
+
+        s++;
+        if (*s == '-') {
+            eneg = true;
+            s++;
+        } else if (*s == '+') {
+            s++;
+        }
+
+        if (!is_digit(*s))
+            return merr(EINVAL);
+
+        for (digit = false; *s != '\0'; s++) {
+            if (*s == '_') {
+                if (!digit || !is_digit(s[1]))
+                    return merr(EINVAL);
+
+                digit = false;
+                continue;
+            }
+
+            if (!is_digit(*s))
+                return merr(EINVAL);
+
+            digit = true;
+
+            /* Anything this large over- or underflows regardless. */
+            if (exp < 100000)
+                exp = exp * 10 + (*s - '0');
+        }
+
+        if (eneg)
+            exp = -exp;
+    }
+
+    n->exp10 = exp - frac;
+    if (n->dec.nd > 0)
+        n->dec.dp += exp;
+
+    return 0;
+}
+
+static void
+trim(struct decimal * const dec)
+{
+    while (dec->nd > 0 && dec->d[dec->nd - 1] == 0)
+        dec->nd--;
+
+    if (dec->nd == 0)
+        dec->dp = 0;
+}
+
+static void
+left_shift(struct decimal * const dec, const unsigned int k)
+{
+    int w;
+    int count;
+    uint64_t n = 0;
+    unsigned char tmp[DECIMAL_DIGITS + 24];
+
+    /* Multiply from the least significant digit into the end of tmp. */
+    w = (int)sizeof(tmp);
+    for (int r = dec->nd - 1; r >= 0; r--) {
+        n += (uint64_t)dec->d[r] << k;
+        tmp[--w] = (unsigned char)(n % 10);
+        n /= 10;
+    }
+
+    while (n > 0) {
+        tmp[--w] = (unsigned char)(n % 10);
+        n /= 10;
+    }
+
+    count = (int)sizeof(tmp) - w;
+    dec->dp += count - dec->nd;
+
+    if (count > DECIMAL_DIGITS) {
+        for (int i = DECIMAL_DIGITS; i < count; i++) {
+            if (tmp[w + i] != 0)
+                dec->trunc = true;
+        }
+
+        count = DECIMAL_DIGITS;
+    }
+
+    memcpy(dec->d, tmp + w, (size_t)count);
+    dec->nd = count;
+    trim(dec);
+}
+
+static void
+right_shift(struct decimal * const dec, const unsigned int k)
+{
+    int r = 0;
+    int w = 0;
+    uint64_t n = 0;
+    const uint64_t mask = ((uint64_t)1 << k) - 1;
+
+    /* Pick up enough leading digits to cover the first shift. */
+    for (; n >> k == 0; r++) {
+        if (r >= dec->nd) {
+            if (n == 0) {
+                dec->nd = 0;
+                return;
+            }
+
+            while (n >> k == 0) {
+                n *= 10;
+                r++;
+            }
+
+            break;
+        }
+
+        n = n * 10 + dec->d[r];
+    }
+
+    dec->dp -= r - 1;
+
+    /* Pick up a digit, put down a digit. */
+    for (; r < dec->nd; r++) {
+        const uint64_t c = dec->d[r];
+
+        dec->d[w++] = (unsigned char)(n >> k);
+        n &= mask;
+        n = n * 10 + c;
+    }
+
+    /* Put down the remaining digits. */
+    while (n > 0) {
+        const uint64_t d = n >> k;
+
+        n &= mask;
+        if (w < DECIMAL_DIGITS) {
+            dec->d[w++] = (unsigned char)d;
+        } else if (d > 0) {
+            dec->trunc = true;
+        }
+
+        n *= 10;
+    }
+
+    dec->nd = w;
+    trim(dec);
+}
+
+static void
+shift(struct decimal * const dec, int k)
+{
+    if (dec->nd == 0)
+        return;
+
+    if (k > 0) {
+        for (; k > MAX_SHIFT; k -= MAX_SHIFT)
+            left_shift(dec, MAX_SHIFT);
+        left_shift(dec, (unsigned int)k);
+    } else if (k < 0) {
+        for (; k < -MAX_SHIFT; k += MAX_SHIFT)
+            right_shift(dec, MAX_SHIFT);
+        right_shift(dec, (unsigned int)-k);
+    }
+}
+
+static bool
+should_round_up(const struct decimal * const dec, const int nd)
+{
+    if (nd < 0 || nd >= dec->nd)
+        return false;
+
+    /* Exactly halfway rounds to even, unless digits were dropped. */
+    if (dec->d[nd] == 5 && nd + 1 == dec->nd)
+        return dec->trunc || (nd > 0 && dec->d[nd - 1] % 2 == 1);
+
+    return dec->d[nd] >= 5;
+}
+
+static uint64_t
+rounded_integer(const struct decimal * const dec)
+{
+    int i;
+    uint64_t n = 0;
+
+    if (dec->dp > 20)
+        return UINT64_MAX;
+
+    for (i = 0; i < dec->dp && i < dec->nd; i++)
+        n = n * 10 + dec->d[i];
+    for (; i < dec->dp; i++)
+        n *= 10;
+
+    if (should_round_up(dec, dec->dp))
+        n++;
+
+    return n;
+}
+
+/* Convert to the bits of an IEEE 754 number without its sign. Returns false
+ * on overflow.
+ */
+static bool
+decimal_to_bits(
+    struct decimal * const dec,
+    const struct float_format * const f,
+    uint64_t * const bits)
+{
+    int exp = 0;
+    uint64_t mant;
+    const int exp_max = (1 << f->exp_bits) - 1;
+
+    if (dec->nd == 0 || dec->dp < -330) {
+        *bits = 0;
+        return true;
+    }
+
+    if (dec->dp > 310)
+        return false;
+
+    /* Scale by powers of two into [0.5, 1). */
+    while (dec->dp > 0) {
+        const int n = dec->dp >= (int)(sizeof(powtab) / sizeof(powtab[0])) ? 27 : powtab[dec->dp];
+
+        shift(dec, -n);
+        exp += n;
+    }
+
+    while (dec->dp < 0 || (dec->dp == 0 && dec->d[0] < 5)) {
+        const int n = -dec->dp >= (int)(sizeof(powtab) / sizeof(powtab[0])) ? 27 : powtab[-dec->dp];
+
+        shift(dec, n);
+        exp -= n;
+    }
+
+    /* The significand is in [1, 2) rather than [0.5, 1). */
+    exp--;
+
+    /* Denormals give up precision to keep the smallest exponent. */
+    if (exp < f->bias + 1) {
+        const int n = f->bias + 1 - exp;
+
+        shift(dec, -n);
+        exp += n;
+    }
+
+    if (exp - f->bias >= exp_max)
+        return false;
+
+    shift(dec, (int)(1 + f->mant_bits));
+    mant = rounded_integer(dec);
+
+    /* Rounding may have carried into a new bit. */
+    if (mant == (uint64_t)2 << f->mant_bits) {
+        mant >>= 1;
+        exp++;
+        if (exp - f->bias >= exp_max)
+            return false;
+    }
+
+    if (!(mant & ((uint64_t)1 << f->mant_bits)))
+        exp = f->bias;
+
+    *bits = (mant & (((uint64_t)1 << f->mant_bits) - 1)) |
+            ((uint64_t)((exp - f->bias) & exp_max) << f->mant_bits);
+
+    return true;
+}
+
+merr_t
+cli_convert_float(const char * const str, float * const value)
+{
+    merr_t err;
+    bool zero;
+    uint32_t u;
+    uint64_t bits;
+    struct number n;
+
+    if (!str || !value)
+        return merr(EINVAL);
+
+    err = scan(str, &n);
+    if (err)
+        return err;
+
+    switch (n.kind) {
+    case NUMBER_INF:
+        *value = n.neg ? -HUGE_VALF : HUGE_VALF;
+        return 0;
+    case NUMBER_NAN:
+        *value = NAN;
+        return 0;
+    case NUMBER_FINITE:
+        break;
+    }
+
+#if FLT_EVAL_METHOD == 0
+    /* Both operands are exact, so a single IEEE operation rounds correctly. */
+    if (n.nsig <= MANT_DIGITS && n.mant <= (1U << 24) && n.exp10 >= -10 && n.exp10 <= 10) {
+        static const float pow10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                       1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+        float f = (float)n.mant;
+
+        f = n.exp10 < 0 ? f / pow10[-n.exp10] : f * pow10[n.exp10];
+        *value = n.neg ? -f : f;
+
+        return 0;
+    }
+#endif
+
+    zero = n.dec.nd == 0;
+    if (!decimal_to_bits(&n.dec, &float_format, &bits))
+        return merr(ERANGE);
+
+    /* Nonzero numbers which round to zero underflow. */
+    if (bits == 0 && !zero)
+        return merr(ERANGE);
+
+    u = (uint32_t)bits | (n.neg ? UINT32_C(1) << 31 : 0);
+    memcpy(value, &u, sizeof(*value));
+
+    return 0;
+}
+
+merr_t
+cli_convert_double(const char * const str, double * const value)
+{
+    merr_t err;
+    bool zero;
+    uint64_t bits;
+    struct number n;
+
+    if (!str || !value)
+        return merr(EINVAL);
+
+    err = scan(str, &n);
+    if (err)
+        return err;
+
+    switch (n.kind) {
+    case NUMBER_INF:
+        *value = n.neg ? -HUGE_VAL : HUGE_VAL;
+        return 0;
+    case NUMBER_NAN:
+        *value = NAN;
+        return 0;
+    case NUMBER_FINITE:
+        break;
+    }
+
+#if FLT_EVAL_METHOD == 0
+    if (n.nsig <= MANT_DIGITS && n.mant <= (UINT64_C(1) << 53) && n.exp10 >= -22 &&
+        n.exp10 <= 22 + 15)
+    {
+        static const double pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        uint64_t mant = n.mant;
+        int exp10 = n.exp10;
+
+        /* Move surplus powers of ten into the mantissa while it stays exact. */
+        for (; exp10 > 22 && mant <= (UINT64_C(1) << 53) / 10; exp10--)
+            mant *= 10;
+
+        if (exp10 <= 22) {
+            double d = (double)mant;
+
+            d = exp10 < 0 ? d / pow10[-exp10] : d * pow10[exp10];
+            *value = n.neg ? -d : d;
+
+            return 0;
+        }
+    }
+#endif
+
+#if LDBL_MANT_DIG == 64
+    /* With a 64-bit significand, up to 19 digits times an exact power of ten
+     * rounds once to within half a unit in the last of 64 bits. Rounding that
+     * again to 53 bits is only wrong when it lands next to a halfway point.
+     */
+    if (n.nsig <= MANT_DIGITS && n.exp10 >= -27 && n.exp10 <= 27 && n.mant != 0) {
+        static const long double pow10l[] = {
+            1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,
+            1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+            1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L,
+        };
+        int e2;
+        uint64_t low;
+        long double ld = (long double)n.mant;
+
+        ld = n.exp10 < 0 ? ld / pow10l[-n.exp10] : ld * pow10l[n.exp10];
+        low = (uint64_t)ldexpl(frexpl(ld, &e2), 64) & 0x7ff;
+        if (low < 0x3ff || low > 0x401) {
+            const double d = (double)ld;
+
+            *value = n.neg ? -d : d;
+
+            return 0;
+        }
+    }
+#endif
+
+    zero = n.dec.nd == 0;
+    if (!decimal_to_bits(&n.dec, &double_format, &bits))
+        return merr(ERANGE);
+
+    /* Nonzero numbers which round to zero underflow. */
+    if (bits == 0 && !zero)
+        return merr(ERANGE);
+
+    bits |= n.neg ? UINT64_C(1) << 63 : 0;
+    memcpy(value, &bits, sizeof(*value));
+
+    return 0;
+}
+
+merr_t
+cli_convert_long_double(const char * const str, long double * const value)
+{
+#if LDBL_MANT_DIG == DBL_MANT_DIG
+    merr_t err;
+    double d;
+
+    err = cli_convert_double(str, &d);
+    if (!err)
+        *value = d;
+
+    return err;
+#else
+    merr_t err;
+    int saved;
+    char *end;
+    char *buf;
+    long double ld;
+    struct number n;
+    locale_t c, old;
+    char stack[64];
+    size_t len, j = 0;
+
+    if (!str || !value)
+        return merr(EINVAL);
+
+    err = scan(str, &n);
+    if (err)
+        return err;
+
+    /* With at least 64 bits of precision, every 19 digit mantissa and power
+     * of ten up to 10^27 is exact.
+     */
+    if (n.kind == NUMBER_FINITE && n.nsig <= MANT_DIGITS && n.exp10 >= -27 && n.exp10 <= 27) {
+        long double p = 1;
+
+        for (int i = 0; i < (n.exp10 < 0 ? -n.exp10 : n.exp10); i++)
+            p *= 10;
+
+        ld = (long double)n.mant;
+        ld = n.exp10 < 0 ? ld / p : ld * p;
+        *value = n.neg ? -ld : ld;
+
+        return 0;
+    }
+
+    /* Otherwise leave it to strtold(3) in the C locale, once the separators
+     * it does not understand are gone.
+     */
+    len = strlen(str);
+    buf = len < sizeof(stack) ? stack : cli_malloc(len + 1);
+    if (!buf)
+        return merr(ENOMEM);
+
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] != '_')
+            buf[j++] = str[i];
+    }
+    buf[j] = '\0';
+
+    c = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+    if (!c) {
+        if (buf != stack)
+            cli_free(buf);
+        return merr(ENOMEM);
+    }
+
+    old = uselocale(c);
+    errno = 0;
+    ld = strtold(buf, &end);
+    saved = errno;
+    uselocale(old);
+    freelocale(c);
+
+    assert(*end == '\0');
+
+    if (buf != stack)
+        cli_free(buf);
+
+    if (saved == ERANGE && (isinf(ld) || ld == 0))
+        return merr(ERANGE);
+
+    *value = ld;
+
+    return 0;
+#endif
+}
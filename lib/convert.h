@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_CONVERT_H
+#define LIBCLI_CONVERT_H
+
+#include <merr.h>
+
+/* Locale-independent conversion of whole strings. Integers take an optional
+ * 0x, 0o or 0b prefix, and any number may separate its digits with single
+ * underscores. Returns EINVAL if str is not entirely a number and ERANGE if
+ * the number does not fit.
+ */
+
+merr_t
+cli_convert_uint(const char *str, unsigned long long max, unsigned long long *value);
+
+merr_t
+cli_convert_int(const char *str, long long min, long long max, long long *value);
+
+/* Correctly rounded, to nearest with ties to even. inf, infinity and nan are
+ * accepted in any case.
+ */
+
+merr_t
+cli_convert_float(const char *str, float *value);
+
+merr_t
+cli_convert_double(const char *str, double *value);
+
+merr_t
+cli_convert_long_double(const char *str, long double *value);
+
+#endif
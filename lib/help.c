@@ -0,0 +1,285 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/queue.h>
+#include <sys/uio.h>
+
+#include <libcli/parser.h>
+
+#include "help.h"
+
+#define TAB "  "
+
+struct sink {
+    char *buf;
+    size_t sz;
+    size_t len;
+};
+
+static void
+put(struct sink * const s, const char * const str, const size_t n)
+{
+    if (s->len < s->sz)
+        memcpy(s->buf + s->len, str, n < s->sz - s->len ? n : s->sz - s->len);
+
+    s->len += n;
+}
+
+static void
+put_str(struct sink * const s, const char * const str)
+{
+    put(s, str, strlen(str));
+}
+
+static void
+pad(struct sink * const s, size_t n)
+{
+    static const char spaces[] = "                                ";
+
+    while (n > 0) {
+        const size_t chunk = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+
+        put(s, spaces, chunk);
+        n -= chunk;
+    }
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+static const char *
+option_arg(const struct cli_option * const o)
+{
+    switch (o->argument) {
+    case CLI_HAS_ARG_NONE:
+        break;
+    case CLI_HAS_ARG_REQUIRED:
+        return " arg";
+#ifndef CLI_NO_OPTIONAL_ARGUMENT
+    case CLI_HAS_ARG_OPTIONAL:
+        return " (arg)";
+#endif
+    }
+
+    return "";
+}
+#endif
+
+static void
+render_arguments(struct sink * const s, const struct cli * const cli)
+{
+    size_t max_width = 0;
+    const struct cli_argument *a;
+
+    put_str(s, "\nArguments:\n");
+
+    SLIST_FOREACH(a, &cli->arguments, entry) {
+        const size_t width = strlen(a->name);
+
+        if (width > max_width)
+            max_width = width;
+    }
+
+    SLIST_FOREACH(a, &cli->arguments, entry) {
+        put_str(s, TAB);
+        put_str(s, a->name);
+        if (a->description) {
+            pad(s, max_width - strlen(a->name));
+            put_str(s, TAB);
+            put_str(s, a->description);
+        }
+        put(s, "\n", 1);
+    }
+}
+
+static void
+render_choices(struct sink * const s, const struct cli_option * const o, const size_t indent)
+{
+    pad(s, indent);
+    put_str(s, "One of: ");
+    for (size_t i = 0; o->choices[i]; i++) {
+        if (i > 0)
+            put_str(s, ", ");
+        put_str(s, o->choices[i]);
+    }
+    put(s, "\n", 1);
+}
+
+static void
+render_options(struct sink * const s, const struct cli * const cli)
+{
+    size_t indent;
+    size_t max_width = 0;
+    const struct cli_option *o;
+
+    put_str(s, "\nOptions:\n");
+
+#ifndef CLI_NO_GETOPT_LONG
+    SLIST_FOREACH(o, &cli->options, entry) {
+        size_t width = 0;
+
+        if (o->lng)
+            width = strlen(o->lng) + strlen(option_arg(o));
+        if (width > max_width)
+            max_width = width;
+    }
+#endif
+
+    /* Choices line up with the descriptions of long options. */
+    indent = 2 * (sizeof(TAB) - 1) + 3 + (max_width > 0 ? 4 + max_width : 0);
+
+    SLIST_FOREACH(o, &cli->options, entry) {
+        size_t width = 0;
+
+        if (o->shrt) {
+            const char shrt[] = { ' ', '-', o->shrt };
+
+            put_str(s, TAB);
+            put(s, shrt, sizeof(shrt));
+        } else {
+            put_str(s, TAB "   ");
+        }
+
+#ifndef CLI_NO_GETOPT_LONG
+        if (o->lng) {
+            put_str(s, o->shrt ? ", --" : "  --");
+            put_str(s, o->lng);
+            put_str(s, option_arg(o));
+            width = strlen(o->lng) + strlen(option_arg(o));
+        }
+#endif
+
+        if (o->description) {
+            pad(s, max_width - width);
+            put_str(s, TAB);
+            put_str(s, o->description);
+        }
+        put(s, "\n", 1);
+
+        if (o->type == CLI_TYPE_CHOICE)
+            render_choices(s, o, indent);
+    }
+}
+
+static void
+render_subcommands(struct sink * const s, const struct cli * const cli)
+{
+    const struct cli *c;
+    size_t max_width = 0;
+
+    put_str(s, "\nSubcommands:\n");
+
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        const size_t width = strlen(c->name);
+
+        if (width > max_width)
+            max_width = width;
+    }
+
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        put_str(s, TAB);
+        put_str(s, c->name);
+        if (c->description) {
+            pad(s, max_width - strlen(c->name));
+            put_str(s, TAB);
+            put_str(s, c->description);
+        }
+        put(s, "\n", 1);
+    }
+}
+
+size_t
+cli_help_render(const struct cli * const cli, char * const buf, const size_t sz)
+{
+    struct sink s = { .buf = buf, .sz = buf ? sz : 0 };
+
+    if (!SLIST_EMPTY(&cli->options))
+        put_str(&s, " [OPTIONS]...");
+    if (!SLIST_EMPTY(&cli->arguments)) {
+        const struct cli_argument *a;
+
+        SLIST_FOREACH(a, &cli->arguments, entry) {
+            if (a->variadic) {
+                put_str(&s, " [");
+                put_str(&s, a->name);
+                put_str(&s, "]...");
+            } else {
+                put(&s, " ", 1);
+                put_str(&s, a->name);
+            }
+        }
+    }
+    put(&s, "\n", 1);
+
+    if (cli->description) {
+        put(&s, "\n", 1);
+        put_str(&s, cli->description);
+        put(&s, "\n", 1);
+    }
+
+    if (!SLIST_EMPTY(&cli->arguments))
+        render_arguments(&s, cli);
+
+    if (!SLIST_EMPTY(&cli->options))
+        render_options(&s, cli);
+
+    if (!SLIST_EMPTY(&cli->subcommands))
+        render_subcommands(&s, cli);
+
+    return s.len;
+}
+
+void
+cli_help_emit(
+    FILE * const stream,
+    const char * const program,
+    const char * const text,
+    const size_t len)
+{
+    int fd;
+    static const char usage[] = "Usage: ";
+
+    flockfile(stream);
+
+    fd = fileno(stream);
+    if (fd >= 0 && fflush(stream) == 0) {
+        int iovcnt = 3;
+        struct iovec iov[3] = {
+            { (void *)usage, sizeof(usage) - 1 },
+            { (void *)program, strlen(program) },
+            { (void *)text, len },
+        };
+        struct iovec *v = iov;
+
+        while (iovcnt > 0) {
+            ssize_t n = writev(fd, v, iovcnt);
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            /* Pick up after a short write. */
+            for (; iovcnt > 0 && (size_t)n >= v->iov_len; v++, iovcnt--)
+                n -= (ssize_t)v->iov_len;
+            if (iovcnt > 0) {
+                v->iov_base = (char *)v->iov_base + n;
+                v->iov_len -= (size_t)n;
+            }
+        }
+    } else {
+        fputs(usage, stream);
+        fputs(program, stream);
+        fwrite(text, 1, len, stream);
+    }
+
+    funlockfile(stream);
+}
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_HELP_H
+#define LIBCLI_HELP_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <libcli/parser.h>
+
+/* Render the help of a node, from just after the program name in the usage
+ * line onwards, into buf like snprintf(3): the return value is the full
+ * length, and nothing past sz is written. The result is not terminated.
+ */
+size_t
+cli_help_render(const struct cli *cli, char *buf, size_t sz);
+
+/* Write "Usage: ", the program name and rendered help. Output already
+ * buffered in stream goes first, and streams backed by a file descriptor get
+ * everything in a single writev(2).
+ */
+void
+cli_help_emit(FILE *stream, const char *program, const char *text, size_t len);
+
+#endif
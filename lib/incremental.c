@@ -0,0 +1,647 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <sys/queue.h>
+
+#include <merr.h>
+
+#include <libcli/incremental.h>
+#include <libcli/parser.h>
+
+#include "index.h"
+#include "loader.h"
+#include "mem.h"
+#include "parser.h"
+
+/* Where the parse stands after a token. */
+struct cli_incremental_state {
+    const struct cli *cli;
+    /* Next positional argument to fill, NULL once they are all filled. */
+    const struct cli_argument *argument;
+    /* The next token is the value of this option. */
+    const struct cli_option *pending;
+    /* Options have ended, either at -- or at the first operand. */
+    bool operands;
+    /* Tokens with errors so far. */
+    size_t errors;
+};
+
+static bool
+is_blank(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static merr_t
+enter(struct cli_incremental_state * const s, const struct cli * const cli)
+{
+    merr_t err;
+
+    err = cli_load(cli);
+    if (err)
+        return err;
+
+    s->cli = cli;
+    s->argument = SLIST_FIRST(&cli->arguments);
+    s->pending = NULL;
+    s->operands = false;
+
+    return 0;
+}
+
+static merr_t
+check_items(
+    const struct cli_index * const idx,
+    const struct cli_option * const option,
+    const char * const arg,
+    bool * const valid)
+{
+    char *items;
+    char stack[256];
+    const size_t len = strlen(arg);
+
+    items = len < sizeof(stack) ? stack : cli_malloc(len + 1);
+    if (!items)
+        return merr(ENOMEM);
+
+    memcpy(items, arg, len + 1);
+
+    *valid = true;
+    for (char *item = items, *end; *valid; item = end + 1) {
+        unsigned char value[sizeof(long double)];
+
+        end = strchr(item, option->delimiter);
+        if (end)
+            *end = '\0';
+
+        *valid = option->type == CLI_TYPE_STRING ||
+            cli_action_store_option(idx, NULL, option, value, item);
+        if (!end)
+            break;
+    }
+
+    if (items != stack)
+        cli_free(items);
+
+    return 0;
+}
+
+static merr_t
+check_value(
+    const struct cli_index * const idx,
+    const struct cli_option * const option,
+    const char * const arg,
+    struct cli_token * const tok)
+{
+    merr_t err;
+    bool valid = true;
+
+    if (option->action == CLI_ACTION_APPEND && option->delimiter) {
+        err = check_items(idx, option, arg, &valid);
+        if (err)
+            return err;
+    } else if (option->type != CLI_TYPE_STRING) {
+        valid = cli_action_store_option(idx, NULL, option, tok->value.bytes, arg);
+    }
+
+    if (!valid)
+        tok->status = CLI_TOKEN_INVALID;
+
+    return 0;
+}
+
+static merr_t
+check_option(
+    struct cli_incremental_state * const s,
+    const char * const word,
+    struct cli_token * const tok)
+{
+    const struct cli_index * const idx = s->cli->index;
+
+    tok->kind = CLI_TOKEN_OPTION;
+
+    if (word[1] == '-') {
+#ifndef CLI_NO_GETOPT_LONG
+        size_t name_len;
+        const char *eq;
+        bool ambiguous = false;
+        const char * const name = word + 2;
+        const struct cli_option *option;
+#endif
+
+        if (word[2] == '\0') {
+            tok->kind = CLI_TOKEN_TERMINATOR;
+            s->operands = true;
+            return 0;
+        }
+
+#ifndef CLI_NO_GETOPT_LONG
+        eq = strchr(name, '=');
+        name_len = eq ? (size_t)(eq - name) : strlen(name);
+
+        option = name_len > 0 ? cli_index_find_long(idx, name, name_len, &ambiguous) : NULL;
+        if (!option) {
+            tok->status = ambiguous ? CLI_TOKEN_AMBIGUOUS : CLI_TOKEN_UNKNOWN;
+            return 0;
+        }
+
+        tok->option = option;
+        if (eq) {
+            if (option->argument == CLI_HAS_ARG_NONE) {
+                tok->status = CLI_TOKEN_INVALID;
+                return 0;
+            }
+
+            return check_value(idx, option, eq + 1, tok);
+        }
+
+        if (option->argument == CLI_HAS_ARG_REQUIRED)
+            s->pending = option;
+#else
+        tok->status = CLI_TOKEN_UNKNOWN;
+#endif
+
+        return 0;
+    }
+
+    for (const char *p = word + 1; *p != '\0'; p++) {
+        const struct cli_option * const option = cli_index_find_short(idx, *p);
+
+        if (!option) {
+            tok->status = CLI_TOKEN_UNKNOWN;
+            return 0;
+        }
+
+        tok->option = option;
+        if (option->argument != CLI_HAS_ARG_NONE) {
+            if (p[1] != '\0')
+                return check_value(idx, option, p + 1, tok);
+
+            if (option->argument == CLI_HAS_ARG_REQUIRED)
+                s->pending = option;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* Parse one token the way parse() would, from the state of the one before. */
+static merr_t
+step(struct cli_incremental_state * const s, const char * const word, struct cli_token * const tok)
+{
+    merr_t err = 0;
+    const struct cli *sub;
+
+    tok->cli = s->cli;
+    tok->option = NULL;
+    tok->argument = NULL;
+    tok->status = CLI_TOKEN_OK;
+    memset(&tok->value, 0, sizeof(tok->value));
+
+    if (s->pending) {
+        tok->kind = CLI_TOKEN_VALUE;
+        tok->option = s->pending;
+        s->pending = NULL;
+        err = check_value(s->cli->index, tok->option, word, tok);
+        goto out;
+    }
+
+    if (!s->operands && word[0] == '-' && word[1] != '\0') {
+        err = check_option(s, word, tok);
+        goto out;
+    }
+
+    s->operands = true;
+
+    if (s->argument) {
+        tok->kind = CLI_TOKEN_ARGUMENT;
+        tok->argument = s->argument;
+        if (!s->argument->variadic) {
+            if (s->argument->type != CLI_TYPE_STRING &&
+                !cli_action_store(NULL, s->argument->type, tok->value.bytes, word))
+                tok->status = CLI_TOKEN_INVALID;
+            s->argument = SLIST_NEXT(s->argument, entry);
+        }
+        goto out;
+    }
+
+    sub = cli_index_find_subcommand(s->cli->index, s->cli, word);
+    if (sub) {
+        tok->kind = CLI_TOKEN_SUBCOMMAND;
+        err = enter(s, sub);
+    } else {
+        tok->kind = CLI_TOKEN_ARGUMENT;
+        tok->status =
+            SLIST_EMPTY(&s->cli->subcommands) ? CLI_TOKEN_UNEXPECTED : CLI_TOKEN_UNKNOWN;
+    }
+
+out:
+    if (tok->status != CLI_TOKEN_OK)
+        s->errors++;
+
+    return err;
+}
+
+static merr_t
+reserve_line(struct cli_incremental * const inc, const size_t len)
+{
+    char *mem;
+    size_t size;
+
+    if (len + 1 <= inc->size)
+        return 0;
+
+    for (size = inc->size ? inc->size : 64; size < len + 1; size *= 2)
+        ;
+
+    /* Updates only copy what changed, so carry the old line over. */
+    mem = cli_malloc(2 * size);
+    if (!mem)
+        return merr(ENOMEM);
+
+    if (inc->text) {
+        memcpy(mem, inc->text, inc->len);
+        memcpy(mem + size, inc->words, inc->len);
+        cli_free(inc->text);
+    }
+
+    inc->text = mem;
+    inc->words = mem + size;
+    inc->size = size;
+
+    return 0;
+}
+
+/* Make room for count tokens, and the states around them. */
+static merr_t
+reserve_tokens(struct cli_incremental * const inc, const size_t count)
+{
+    size_t capacity;
+    struct cli_token *tokens;
+    struct cli_incremental_state *states;
+
+    if (count <= inc->capacity)
+        return 0;
+
+    for (capacity = inc->capacity ? 2 * inc->capacity : 16; capacity < count; capacity *= 2)
+        ;
+
+    tokens = cli_realloc(inc->tokens, capacity * sizeof(*tokens));
+    if (!tokens)
+        return merr(ENOMEM);
+    inc->tokens = tokens;
+
+    /* The state before the first token comes first. */
+    states = cli_realloc(inc->states, (capacity + 1) * sizeof(*states));
+    if (!states)
+        return merr(ENOMEM);
+    inc->states = states;
+
+    inc->capacity = capacity;
+
+    return 0;
+}
+
+static void
+finish(struct cli_incremental * const inc, const struct cli_incremental_state * const s)
+{
+    inc->command = s->cli;
+    inc->pending = s->pending;
+    inc->missing = s->argument && !s->argument->variadic ? s->argument : NULL;
+    inc->errors = s->errors;
+}
+
+merr_t
+cli_incremental_init(struct cli_incremental * const inc, const struct cli * const cli)
+{
+    merr_t err;
+
+    if (!inc || !cli || !cli->index)
+        return merr(EINVAL);
+
+    memset(inc, 0, sizeof(*inc));
+    inc->cli = cli;
+
+    err = reserve_tokens(inc, 1);
+    if (err)
+        return err;
+
+    memset(&inc->states[0], 0, sizeof(inc->states[0]));
+    err = enter(&inc->states[0], cli);
+    if (err) {
+        cli_incremental_fini(inc);
+        return err;
+    }
+
+    finish(inc, &inc->states[0]);
+
+    return 0;
+}
+
+static size_t
+common_prefix(const char * const a, const char * const b, const size_t len)
+{
+    size_t k = 0;
+
+    while (k + 64 <= len && memcmp(a + k, b + k, 64) == 0)
+        k += 64;
+
+    while (k < len && a[k] == b[k])
+        k++;
+
+    return k;
+}
+
+static merr_t
+reset(struct cli_incremental * const inc, const merr_t err)
+{
+    /* Start over from an empty line next time. */
+    inc->tokenc = 0;
+    inc->first = 0;
+    inc->last = 0;
+    inc->len = 0;
+    finish(inc, &inc->states[0]);
+
+    return err;
+}
+
+static size_t
+common_suffix(const char * const a, const size_t a_len, const char * const b, const size_t b_len)
+{
+    size_t k = 0;
+    const size_t len = a_len < b_len ? a_len : b_len;
+
+    while (k < len && a[a_len - 1 - k] == b[b_len - 1 - k])
+        k++;
+
+    return k;
+}
+
+/* Whether the rest of the line parses the same from either state. Errors
+ * only count what came before.
+ */
+static bool
+same_state(
+    const struct cli_incremental_state * const a,
+    const struct cli_incremental_state * const b)
+{
+    return a->cli == b->cli && a->argument == b->argument && a->pending == b->pending &&
+        a->operands == b->operands;
+}
+
+/* Move the old tokens from *tail up by at least as many as the tokens
+ * parsed so far, so that parsing again does not run into them.
+ */
+static merr_t
+open_gap(struct cli_incremental * const inc, size_t * const tail, size_t * const tailc)
+{
+    merr_t err;
+    const size_t parsed = inc->tokenc - inc->first;
+    const size_t gap = parsed < 4 ? 4 : parsed;
+
+    err = reserve_tokens(inc, *tailc + gap);
+    if (err)
+        return err;
+
+    memmove(
+        inc->tokens + *tail + gap, inc->tokens + *tail, (*tailc - *tail) * sizeof(*inc->tokens));
+    memmove(
+        inc->states + *tail + gap,
+        inc->states + *tail,
+        (*tailc - *tail + 1) * sizeof(*inc->states));
+    *tail += gap;
+    *tailc += gap;
+
+    return 0;
+}
+
+/* Take the old tokens from tail on as they were, moved by the edit. */
+static void
+resync(
+    struct cli_incremental * const inc,
+    const size_t tail,
+    const size_t tailc,
+    const size_t removed,
+    const size_t inserted,
+    const struct cli_incremental_state * const s)
+{
+    const size_t errors = s->errors - inc->states[tail].errors;
+
+    if (inc->tokenc != tail) {
+        memmove(
+            inc->tokens + inc->tokenc, inc->tokens + tail, (tailc - tail) * sizeof(*inc->tokens));
+        memmove(
+            inc->states + inc->tokenc,
+            inc->states + tail,
+            (tailc - tail + 1) * sizeof(*inc->states));
+    }
+
+    if (inserted != removed) {
+        for (size_t i = inc->tokenc; i < inc->tokenc + tailc - tail; i++)
+            inc->tokens[i].start += inserted - removed;
+    }
+
+    /* Counts of errors so far, which the edit may have changed. */
+    if (errors != 0) {
+        for (size_t i = inc->tokenc; i <= inc->tokenc + tailc - tail; i++)
+            inc->states[i].errors += errors;
+    }
+
+    inc->last = inc->tokenc;
+    inc->tokenc += tailc - tail;
+}
+
+/* Index of the first token which starts at or after pos, or with end, the
+ * first whose end does. Tokens are in order and do not overlap.
+ */
+static size_t
+first_token(const struct cli_incremental * const inc, const size_t pos, const bool end)
+{
+    size_t lo = 0;
+    size_t hi = inc->tokenc;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const struct cli_token * const tok = &inc->tokens[mid];
+
+        if (tok->start + (end ? tok->len : 0) < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* Parse again after removed bytes at k were replaced by inserted ones, until
+ * the parse is back in step with the old line.
+ */
+static merr_t
+reparse(
+    struct cli_incremental * const inc,
+    const size_t k,
+    const size_t removed,
+    const size_t inserted)
+{
+    merr_t err;
+    size_t pos;
+    struct cli_incremental_state s;
+    size_t tail;
+    size_t tailc = inc->tokenc;
+
+    /* Old tokens past the edit, which are where they were plus the change
+     * in length.
+     */
+    tail = first_token(inc, k + removed, false);
+
+    /* A token is only known to be unchanged if the blank after it is. */
+    inc->tokenc = first_token(inc, k, true);
+
+    pos = inc->tokenc > 0 ? inc->tokens[inc->tokenc - 1].start + inc->tokens[inc->tokenc - 1].len :
+                            0;
+
+    /* Words past the edit moved along with the line. */
+    for (size_t i = pos; i < k + inserted; i++)
+        inc->words[i] = is_blank(inc->text[i]) ? '\0' : inc->text[i];
+    inc->words[inc->len] = '\0';
+
+    inc->first = inc->tokenc;
+    s = inc->states[inc->tokenc];
+
+    for (;;) {
+        size_t len;
+        struct cli_token *tok;
+
+        while (pos < inc->len && inc->words[pos] == '\0')
+            pos++;
+
+        if (pos == inc->len)
+            break;
+
+        /* From a token which starts where an old one did, in the same state,
+         * the rest of the line is the old one.
+         */
+        while (tail < tailc && inc->tokens[tail].start + inserted < pos + removed)
+            tail++;
+        if (tail < tailc && inc->tokens[tail].start + inserted == pos + removed &&
+            same_state(&s, &inc->states[tail])) {
+            resync(inc, tail, tailc, removed, inserted, &s);
+            finish(inc, &inc->states[inc->tokenc]);
+            return 0;
+        }
+
+        /* Nor can the old tokens which this one runs over. */
+        len = strlen(inc->words + pos);
+        while (tail < tailc && inc->tokens[tail].start + inserted < pos + len + removed)
+            tail++;
+
+        if (tail < tailc && inc->tokenc >= tail) {
+            err = open_gap(inc, &tail, &tailc);
+            if (err)
+                return err;
+        }
+
+        err = reserve_tokens(inc, inc->tokenc + 1);
+        if (err)
+            return err;
+
+        inc->states[inc->tokenc] = s;
+        tok = &inc->tokens[inc->tokenc];
+        tok->start = pos;
+        tok->len = len;
+
+        err = step(&s, inc->words + pos, tok);
+        if (err)
+            return err;
+
+        pos += len;
+        inc->tokenc++;
+    }
+
+    inc->states[inc->tokenc] = s;
+    inc->last = inc->tokenc;
+    finish(inc, &s);
+
+    return 0;
+}
+
+/* Replace removed bytes of the line at pos with len bytes of text. */
+static merr_t
+splice(
+    struct cli_incremental * const inc,
+    const size_t pos,
+    const size_t removed,
+    const char * const text,
+    const size_t len)
+{
+    merr_t err;
+    const size_t rest = inc->len - pos - removed;
+
+    err = reserve_line(inc, inc->len - removed + len);
+    if (err)
+        return reset(inc, err);
+
+    memmove(inc->text + pos + len, inc->text + pos + removed, rest);
+    memmove(inc->words + pos + len, inc->words + pos + removed, rest);
+    if (len > 0)
+        memcpy(inc->text + pos, text, len);
+    inc->len = inc->len - removed + len;
+
+    err = reparse(inc, pos, removed, len);
+
+    return err ? reset(inc, err) : 0;
+}
+
+merr_t
+cli_incremental_update(struct cli_incremental * const inc, const char * const line, const size_t len)
+{
+    size_t k, suffix;
+
+    if (!inc || !inc->states || (!line && len > 0))
+        return merr(EINVAL);
+
+    k = inc->len > 0 ? common_prefix(inc->text, line, len < inc->len ? len : inc->len) : 0;
+    if (k == len && k == inc->len && inc->text) {
+        inc->first = inc->last = inc->tokenc;
+        return 0;
+    }
+
+    suffix = inc->len > 0 ? common_suffix(inc->text + k, inc->len - k, line + k, len - k) : 0;
+
+    return splice(inc, k, inc->len - k - suffix, line + k, len - k - suffix);
+}
+
+merr_t
+cli_incremental_edit(
+    struct cli_incremental * const inc,
+    const size_t pos,
+    const size_t removed,
+    const char * const text,
+    const size_t len)
+{
+    if (!inc || !inc->states || (!text && len > 0) || pos > inc->len || removed > inc->len - pos)
+        return merr(EINVAL);
+
+    return splice(inc, pos, removed, text, len);
+}
+
+void
+cli_incremental_fini(struct cli_incremental * const inc)
+{
+    if (!inc)
+        return;
+
+    cli_free(inc->tokens);
+    cli_free(inc->states);
+    cli_free(inc->text);
+    memset(inc, 0, sizeof(*inc));
+}
@@ -0,0 +1,671 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/queue.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "help.h"
+#include "index.h"
+#include "mem.h"
+#include "phash.h"
+#include "result.h"
+#include "stats.h"
+
+static int
+subcommand_cmp(const void * const a, const void * const b)
+{
+    const struct cli * const *x = a;
+    const struct cli * const *y = b;
+
+    return strcmp((*x)->name, (*y)->name);
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+static int
+long_cmp(const void * const a, const void * const b)
+{
+    const struct cli_option * const *x = a;
+    const struct cli_option * const *y = b;
+
+    return strcmp((*x)->lng, (*y)->lng);
+}
+
+/* FNV-1a, a byte at a time, like cli_hash(). */
+#define PREFIX_BASIS UINT64_C(0xcbf29ce484222325)
+#define PREFIX_PRIME UINT64_C(0x100000001b3)
+
+static uint64_t
+prefix_step(const uint64_t h, const char c)
+{
+    return (h ^ (unsigned char)c) * PREFIX_PRIME;
+}
+
+static uint32_t
+prefix_slot(const uint64_t h, const uint32_t mask)
+{
+    return (uint32_t)(h ^ (h >> 32)) & mask;
+}
+
+static size_t
+common_len(const char *a, const char *b)
+{
+    size_t n = 0;
+
+    while (a[n] && a[n] == b[n])
+        n++;
+
+    return n;
+}
+
+static struct cli_index_prefix *
+prefix_insert(struct cli_index * const idx, const uint64_t h, const size_t len, const size_t first)
+{
+    uint32_t s = prefix_slot(h, idx->prefix_mask);
+
+    while (idx->prefixes[s].len)
+        s = (s + 1) & idx->prefix_mask;
+
+    idx->prefixes[s].check = (uint32_t)(h >> 32);
+    idx->prefixes[s].len = (uint32_t)len;
+    idx->prefixes[s].first = (uint32_t)first;
+
+    return &idx->prefixes[s];
+}
+
+/* With the names sorted, those which share a prefix are adjacent, and the
+ * prefixes which a name shares with its neighbours are exactly those no
+ * longer than the common part with either. A shared prefix is inserted at
+ * the first name which has it and counted when a later one no longer does.
+ */
+static merr_t
+index_prefixes(struct cli_index * const idx, struct cli_arena * const arena)
+{
+    size_t n = 0;
+    size_t depth = 0;
+    size_t longest = 0;
+    size_t before = 0;
+    uint32_t slots = 1;
+    struct cli_index_prefix **open;
+
+    for (size_t i = 0; i < idx->lngc; i++) {
+        const char * const lng = idx->lngv[i]->lng;
+        const size_t after = i + 1 < idx->lngc ? common_len(lng, idx->lngv[i + 1]->lng) : 0;
+        const size_t shared = before > after ? before : after;
+
+        if (after > before)
+            n += after - before;
+        if (lng[shared])
+            n++;
+        if (after > longest)
+            longest = after;
+
+        before = after;
+    }
+
+    while (slots < 2 * n)
+        slots <<= 1;
+
+    idx->prefixes = cli_arena_calloc(arena, slots, sizeof(*idx->prefixes));
+    open = cli_malloc((longest + 1) * sizeof(*open));
+    if (!idx->prefixes || !open) {
+        cli_free(open);
+        return merr(ENOMEM);
+    }
+    idx->prefix_mask = slots - 1;
+
+    before = 0;
+    for (size_t i = 0; i < idx->lngc; i++) {
+        uint64_t h = PREFIX_BASIS;
+        const char * const lng = idx->lngv[i]->lng;
+        const size_t after = i + 1 < idx->lngc ? common_len(lng, idx->lngv[i + 1]->lng) : 0;
+        const size_t shared = before > after ? before : after;
+
+        for (; depth > before; depth--)
+            open[depth]->count = (uint32_t)(i - open[depth]->first);
+
+        for (size_t len = 1; len <= shared + 1 && lng[len - 1]; len++) {
+            h = prefix_step(h, lng[len - 1]);
+
+            if (len <= before)
+                continue;
+
+            if (len <= shared) {
+                open[len] = prefix_insert(idx, h, len, i);
+            } else {
+                prefix_insert(idx, h, len, i)->count = 1;
+            }
+        }
+
+        if (after > depth)
+            depth = after;
+        before = after;
+    }
+
+    for (; depth > 0; depth--)
+        open[depth]->count = (uint32_t)(idx->lngc - open[depth]->first);
+
+    cli_free(open);
+
+    return 0;
+}
+
+/* Walk down the prefixes of name, each of which narrows the range of names
+ * the next has to fall in. That a name in the range agrees on the last
+ * character is then enough to tell that a slot holds the prefix.
+ */
+static const struct cli_option *
+find_prefix(
+    const struct cli_index * const idx,
+    const char * const name,
+    const size_t name_len,
+    bool * const ambiguous)
+{
+    uint64_t h = PREFIX_BASIS;
+    size_t first = 0;
+    size_t count = idx->lngc;
+
+    for (size_t len = 1; len <= name_len; len++) {
+        const struct cli_index_prefix *p;
+        uint32_t s;
+
+        h = prefix_step(h, name[len - 1]);
+
+        for (s = prefix_slot(h, idx->prefix_mask);; s = (s + 1) & idx->prefix_mask) {
+            p = &idx->prefixes[s];
+            if (!p->len)
+                return NULL;
+
+            if (p->len == len && p->check == (uint32_t)(h >> 32) && p->first - first < count &&
+                idx->lngv[p->first]->lng[len - 1] == name[len - 1])
+                break;
+        }
+
+        /* The rest of name has to agree with the only option left. */
+        if (p->count == 1) {
+            const struct cli_option * const option = idx->lngv[p->first];
+
+            return strncmp(option->lng + len, name + len, name_len - len) == 0 ? option : NULL;
+        }
+
+        first = p->first;
+        count = p->count;
+    }
+
+    if (ambiguous)
+        *ambiguous = true;
+
+    return NULL;
+}
+#endif
+
+static merr_t
+index_options(
+    struct cli_index * const idx,
+    const struct cli * const cli,
+    struct cli_arena * const arena,
+    const char ** const keyv)
+{
+    merr_t err;
+    const struct cli_option *o;
+    const struct cli_constraint *c;
+    const size_t words = cli_result_words(idx->optionc);
+
+    SLIST_FOREACH(o, &cli->options, entry) {
+        /* Bitsets over ordinals trust them, which lists built by hand might
+         * not have.
+         */
+        if (o->ordinal >= idx->optionc)
+            return merr(EINVAL);
+
+        if (o->shrt) {
+            if (idx->shrt[(unsigned char)o->shrt])
+                return merr(ENOTUNIQ);
+
+            idx->shrtv[idx->shrtc++] = o;
+            idx->shrt[(unsigned char)o->shrt] = (uint8_t)idx->shrtc;
+        }
+
+#ifndef CLI_NO_GETOPT_LONG
+        if (o->lng)
+            idx->lngv[idx->lngc++] = o;
+#endif
+
+        if (o->type == CLI_TYPE_CHOICE && (idx->tables & CLI_INDEX_CHOICES)) {
+            size_t n = 0;
+
+            while (o->choices[n])
+                n++;
+
+            err = cli_phash_build(&idx->choiceh[idx->choicec], arena, n, o->choices);
+            if (err)
+                return err;
+
+            idx->choicev[idx->choicec++] = o;
+            idx->choicei[o->ordinal] = (uint16_t)idx->choicec;
+        }
+    }
+
+    SLIST_FOREACH(c, &cli->constraints, entry) {
+        uint64_t * const mask = idx->constraintm + idx->constraintc * words;
+
+        for (size_t j = 0; c->options[j]; j++) {
+            const uint16_t ordinal = c->options[j]->ordinal;
+
+            mask[ordinal / CLI_RESULT_WORD_BITS] |= UINT64_C(1) << (ordinal % CLI_RESULT_WORD_BITS);
+        }
+
+        idx->constraintv[idx->constraintc++] = c;
+    }
+
+#ifndef CLI_NO_GETOPT_LONG
+    /* The hash refers to positions, so sort before building it. */
+    if (idx->tables & CLI_INDEX_PREFIX) {
+        qsort(idx->lngv, idx->lngc, sizeof(*idx->lngv), long_cmp);
+
+        err = index_prefixes(idx, arena);
+        if (err)
+            return err;
+    }
+
+    for (size_t i = 0; i < idx->lngc; i++)
+        keyv[i] = idx->lngv[i]->lng;
+
+    err = cli_phash_build(&idx->lng, arena, idx->lngc, keyv);
+    if (err)
+        return err;
+
+    return 0;
+#else
+    (void)keyv;
+
+    return 0;
+#endif
+}
+
+static merr_t
+index_subcommands(
+    struct cli_index * const idx,
+    const struct cli * const cli,
+    struct cli_arena * const arena,
+    const char ** const keyv)
+{
+    const struct cli *c;
+    bool sorted = true;
+
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        if (idx->subc > 0 && strcmp(idx->subv[idx->subc - 1]->name, c->name) >= 0)
+            sorted = false;
+
+        idx->subv[idx->subc++] = c;
+    }
+
+    /* Registration keeps subcommands sorted, but be defensive about lists
+     * built by hand.
+     */
+    if (!sorted)
+        qsort(idx->subv, idx->subc, sizeof(*idx->subv), subcommand_cmp);
+
+    for (size_t i = 0; i < idx->subc; i++)
+        keyv[i] = idx->subv[i]->name;
+
+    return cli_phash_build(&idx->sub, arena, idx->subc, keyv);
+}
+
+static merr_t
+index_create(
+    const struct cli * const cli,
+    const unsigned int tables,
+    struct cli_arena * const arena,
+    struct cli_index ** const idx)
+{
+    merr_t err;
+    struct cli_index *i;
+    size_t subc = 0;
+    size_t shrtc = 0;
+    size_t words = 0;
+    size_t choicec = 0;
+    size_t optionc = 0;
+    size_t constraintc = 0;
+    size_t fixed;
+    size_t keyc;
+#ifndef CLI_NO_GETOPT_LONG
+    size_t lngc = 0;
+#endif
+    const char **keyv = NULL;
+
+    if (!cli || !idx)
+        return merr(EINVAL);
+
+    if (tables & CLI_INDEX_SUBCOMMANDS) {
+        const struct cli *c;
+
+        SLIST_FOREACH(c, &cli->subcommands, entry)
+            subc++;
+    }
+
+    if (tables & CLI_INDEX_OPTIONS) {
+        const struct cli_option *o;
+        const struct cli_constraint *c;
+
+        SLIST_FOREACH(c, &cli->constraints, entry)
+            constraintc++;
+
+        SLIST_FOREACH(o, &cli->options, entry) {
+            optionc++;
+            if (o->shrt)
+                shrtc++;
+            if (o->type == CLI_TYPE_CHOICE && (tables & CLI_INDEX_CHOICES))
+                choicec++;
+#ifndef CLI_NO_GETOPT_LONG
+            if (o->lng)
+                lngc++;
+#endif
+        }
+
+        words = cli_result_words(optionc);
+    }
+
+    /* The masks go first, for their alignment. */
+    fixed = sizeof(*i) + constraintc * (words * sizeof(*i->constraintm) + sizeof(*i->constraintv)) +
+        choicec * (sizeof(*i->choiceh) + sizeof(*i->choicev));
+
+#ifndef CLI_NO_GETOPT_LONG
+    /* Keys are only needed while the hashes are built, so the subcommands
+     * reuse those of the options.
+     */
+    keyc = lngc > subc ? lngc : subc;
+    fixed += lngc * sizeof(*i->lngv);
+#else
+    keyc = subc;
+#endif
+
+    /* The narrowest entries go last. */
+    i = cli_arena_calloc(
+        arena, 1,
+        fixed + subc * sizeof(*i->subv) + shrtc * sizeof(*i->shrtv) + keyc * sizeof(*keyv) +
+            (choicec ? optionc * sizeof(*i->choicei) : 0));
+    if (!i)
+        return merr(ENOMEM);
+
+    i->tables = tables;
+    i->optionc = optionc;
+    i->constraintm = (uint64_t *)(i + 1);
+    i->choiceh = (struct cli_phash *)(i->constraintm + constraintc * words);
+    i->choicev = (const struct cli_option **)(i->choiceh + choicec);
+    i->constraintv = (const struct cli_constraint **)(i->choicev + choicec);
+    i->subv = (const struct cli **)(i->constraintv + constraintc);
+    i->shrtv = (const struct cli_option **)(i->subv + subc);
+#ifndef CLI_NO_GETOPT_LONG
+    i->lngv = i->shrtv + shrtc;
+    keyv = (const char **)(i->lngv + lngc);
+#else
+    keyv = (const char **)(i->shrtv + shrtc);
+#endif
+    if (choicec)
+        i->choicei = (uint16_t *)(keyv + keyc);
+
+    if (tables & CLI_INDEX_OPTIONS) {
+        err = index_options(i, cli, arena, keyv);
+        if (err) {
+            cli_index_destroy(i, arena);
+            return err;
+        }
+    }
+
+    if (tables & CLI_INDEX_SUBCOMMANDS) {
+        err = index_subcommands(i, cli, arena, keyv);
+        if (err) {
+            cli_index_destroy(i, arena);
+            return err;
+        }
+    }
+
+    if (tables & CLI_INDEX_HELP) {
+        i->help_sz = cli_help_render(cli, NULL, 0);
+        i->help = cli_arena_alloc(arena, i->help_sz);
+        if (!i->help) {
+            cli_index_destroy(i, arena);
+            return merr(ENOMEM);
+        }
+        cli_help_render(cli, i->help, i->help_sz);
+    }
+
+    *idx = i;
+
+    return 0;
+}
+
+merr_t
+cli_index_create(
+    const struct cli * const cli,
+    const unsigned int tables,
+    struct cli_arena * const arena,
+    struct cli_index ** const idx)
+{
+    merr_t err;
+    const uint64_t start = cli_stats_start();
+
+    err = index_create(cli, tables, arena, idx);
+    cli_stats_stop(CLI_STATS_INDEX, start);
+
+    return err;
+}
+
+void
+cli_index_destroy(struct cli_index * const idx, struct cli_arena * const arena)
+{
+    if (!idx)
+        return;
+
+    cli_arena_free(arena, idx->help);
+    for (size_t i = 0; i < idx->choicec; i++)
+        cli_phash_destroy(&idx->choiceh[i], arena);
+    cli_phash_destroy(&idx->sub, arena);
+#ifndef CLI_NO_GETOPT_LONG
+    cli_phash_destroy(&idx->lng, arena);
+    cli_arena_free(arena, idx->prefixes);
+#endif
+    cli_arena_free(arena, idx);
+}
+
+int
+cli_index_find_choice(
+    const struct cli_index * const idx,
+    const struct cli_option * const option,
+    const char * const value)
+{
+    assert(option);
+    assert(option->choices);
+    assert(value);
+
+    /* Ordinals only count within a command, so check the option is this
+     * one's.
+     */
+    if (idx && idx->choicei && option->ordinal < idx->optionc) {
+        const uint16_t i = idx->choicei[option->ordinal];
+
+        if (i && idx->choicev[i - 1] == option) {
+            const size_t j = cli_phash_find(&idx->choiceh[i - 1], value, strlen(value));
+
+            return j != CLI_PHASH_NONE && strcmp(option->choices[j], value) == 0 ? (int)j : -1;
+        }
+    }
+
+    for (int i = 0; option->choices[i]; i++) {
+        if (strcmp(option->choices[i], value) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+const struct cli *
+cli_index_find_subcommand(
+    const struct cli_index * const idx,
+    const struct cli * const cli,
+    const char * const name)
+{
+    size_t i;
+
+    assert(cli);
+    assert(name);
+
+    if (!idx || !(idx->tables & CLI_INDEX_SUBCOMMANDS)) {
+        const struct cli *c;
+
+        /* The list is sorted, so stop as soon as we have gone past name. */
+        SLIST_FOREACH(c, &cli->subcommands, entry) {
+            const int rc = strcmp(c->name, name);
+
+            if (rc == 0)
+                return c;
+            if (rc > 0)
+                break;
+        }
+
+        return NULL;
+    }
+
+    i = cli_phash_find(&idx->sub, name, strlen(name));
+
+    return i != CLI_PHASH_NONE && strcmp(idx->subv[i]->name, name) == 0 ? idx->subv[i] : NULL;
+}
+
+size_t
+cli_index_prefix_subcommands(
+    const struct cli_index * const idx,
+    const char * const prefix,
+    size_t * const count)
+{
+    size_t lo = 0;
+    size_t end;
+    size_t hi;
+    const size_t prefix_len = strlen(prefix);
+
+    assert(idx);
+    assert(idx->tables & CLI_INDEX_SUBCOMMANDS);
+    assert(count);
+
+    hi = idx->subc;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (strcmp(idx->subv[mid]->name, prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (end = lo; end < idx->subc && strncmp(idx->subv[end]->name, prefix, prefix_len) == 0; end++)
+        ;
+
+    *count = end - lo;
+
+    return lo;
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+size_t
+cli_index_prefix_long(
+    const struct cli_index * const idx,
+    const char * const prefix,
+    const size_t prefix_len,
+    size_t * const count)
+{
+    size_t lo = 0;
+    size_t end;
+    size_t hi;
+
+    assert(idx);
+    assert(idx->tables & CLI_INDEX_PREFIX);
+    assert(count);
+
+    hi = idx->lngc;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (strncmp(idx->lngv[mid]->lng, prefix, prefix_len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (end = lo; end < idx->lngc && strncmp(idx->lngv[end]->lng, prefix, prefix_len) == 0; end++)
+        ;
+
+    *count = end - lo;
+
+    return lo;
+}
+
+const struct cli_option *
+cli_index_find_long_exact(
+    const struct cli_index * const idx,
+    const char * const name,
+    const size_t name_len)
+{
+    const char *lng;
+    const size_t i = cli_phash_find(&idx->lng, name, name_len);
+
+    if (i == CLI_PHASH_NONE)
+        return NULL;
+
+    lng = idx->lngv[i]->lng;
+
+    return strncmp(lng, name, name_len) == 0 && lng[name_len] == '\0' ? idx->lngv[i] : NULL;
+}
+
+const struct cli_option *
+cli_index_find_long(
+    const struct cli_index * const idx,
+    const char * const name,
+    const size_t name_len,
+    bool * const ambiguous)
+{
+    const struct cli_option *option;
+
+    assert(idx);
+    assert(name);
+
+    if (ambiguous)
+        *ambiguous = false;
+
+    option = cli_index_find_long_exact(idx, name, name_len);
+    if (option)
+        return option;
+
+    if ((idx->tables & CLI_INDEX_PREFIX) && name_len > 0)
+        return find_prefix(idx, name, name_len, ambiguous);
+
+    /* Like getopt_long(3), accept any unambiguous abbreviation. */
+    for (size_t i = 0; i < idx->lngc; i++) {
+        if (strncmp(idx->lngv[i]->lng, name, name_len) != 0)
+            continue;
+
+        if (option) {
+            if (ambiguous)
+                *ambiguous = true;
+            return NULL;
+        }
+
+        option = idx->lngv[i];
+    }
+
+    return option;
+}
+#endif
@@ -0,0 +1,162 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_INDEX_H
+#define LIBCLI_INDEX_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "mem.h"
+#include "phash.h"
+
+/* Which tables to build. Transient indexes made for a single parse of an
+ * uncompiled tree only build what pays for itself within one lookup.
+ */
+enum cli_index_tables {
+    CLI_INDEX_OPTIONS = 1 << 0,
+    CLI_INDEX_SUBCOMMANDS = 1 << 1,
+    CLI_INDEX_HELP = 1 << 2,
+    /* Sort long options by name for prefix searches. */
+    CLI_INDEX_PREFIX = 1 << 3,
+    /* Hash the values of choice options. Requires CLI_INDEX_OPTIONS. */
+    CLI_INDEX_CHOICES = 1 << 4,
+    CLI_INDEX_ALL = CLI_INDEX_OPTIONS | CLI_INDEX_SUBCOMMANDS | CLI_INDEX_HELP | CLI_INDEX_PREFIX |
+        CLI_INDEX_CHOICES,
+};
+
+#ifndef CLI_NO_GETOPT_LONG
+/* A prefix of some long option names, which are a range of the sorted lngv.
+ * Only prefixes shared by several names have one, along with the shortest
+ * prefix of each name which no other name shares.
+ */
+struct cli_index_prefix {
+    /* High bits of the hash of the prefix. */
+    uint32_t check;
+    /* Length of the prefix, or 0 for an empty slot. */
+    uint32_t len;
+    uint32_t first;
+    uint32_t count;
+};
+#endif
+
+/* Flat lookup tables for a single node of a command tree. Every table refers
+ * to options and subcommands by position in a single array of pointers, and
+ * names are never copied, which keeps large trees small.
+ */
+struct cli_index {
+    unsigned int tables;
+    /* Registered options, which their ordinals count. */
+    size_t optionc;
+    /* Each constraint as a bitset of ordinals, cli_result_words(optionc)
+     * words long, following the position of its first option.
+     */
+    size_t constraintc;
+    const struct cli_constraint **constraintv;
+    uint64_t *constraintm;
+    /* Position in shrtv plus one, or 0. A node has at most UCHAR_MAX short
+     * options, since they must be distinct.
+     */
+    uint8_t shrt[UCHAR_MAX + 1];
+    size_t shrtc;
+    const struct cli_option **shrtv;
+#ifndef CLI_NO_GETOPT_LONG
+    size_t lngc;
+    const struct cli_option **lngv;
+    struct cli_phash lng;
+    /* Open addressing over the prefixes, with CLI_INDEX_PREFIX. */
+    uint32_t prefix_mask;
+    struct cli_index_prefix *prefixes;
+#endif
+    /* Choice options and the hashes of their values. */
+    size_t choicec;
+    const struct cli_option **choicev;
+    struct cli_phash *choiceh;
+    /* Position in choicev plus one by ordinal, or 0, when there are any. */
+    uint16_t *choicei;
+    size_t subc;
+    /* Sorted by name for prefix searches. */
+    const struct cli **subv;
+    struct cli_phash sub;
+    /* Rendered by cli_help_render(). */
+    char *help;
+    size_t help_sz;
+};
+
+merr_t
+cli_index_create(
+    const struct cli *cli,
+    unsigned int tables,
+    struct cli_arena *arena,
+    struct cli_index **idx);
+
+void
+cli_index_destroy(struct cli_index *idx, struct cli_arena *arena);
+
+static inline const struct cli_option *
+cli_index_find_short(const struct cli_index * const idx, const int c)
+{
+    const uint8_t i = idx->shrt[(unsigned char)c];
+
+    return i ? idx->shrtv[i - 1] : NULL;
+}
+
+/* Position of value among the choices of option, or -1. Falls back to
+ * comparing every choice if idx is NULL or was built without
+ * CLI_INDEX_CHOICES.
+ */
+int
+cli_index_find_choice(
+    const struct cli_index *idx,
+    const struct cli_option *option,
+    const char *value);
+
+/* Falls back to walking the subcommand list if idx is NULL or was built
+ * without CLI_INDEX_SUBCOMMANDS.
+ */
+const struct cli *
+cli_index_find_subcommand(const struct cli_index *idx, const struct cli *cli, const char *name);
+
+/* Subcommands whose names start with the prefix, as a range of idx->subv.
+ * Requires CLI_INDEX_SUBCOMMANDS.
+ */
+size_t
+cli_index_prefix_subcommands(const struct cli_index *idx, const char *prefix, size_t *count);
+
+#ifndef CLI_NO_GETOPT_LONG
+/* Long options whose names start with the prefix, as a range of idx->lngv.
+ * Requires CLI_INDEX_PREFIX.
+ */
+size_t
+cli_index_prefix_long(
+    const struct cli_index *idx,
+    const char *prefix,
+    size_t prefix_len,
+    size_t *count);
+
+/* Only an exact match of name. */
+const struct cli_option *
+cli_index_find_long_exact(const struct cli_index *idx, const char *name, size_t name_len);
+
+/* An exact match of name, or else the only option which name abbreviates.
+ * When several do, *ambiguous is set. With CLI_INDEX_PREFIX this takes one
+ * probe per character of name, however many options there are, and
+ * otherwise compares name with every option.
+ */
+const struct cli_option *
+cli_index_find_long(
+    const struct cli_index *idx,
+    const char *name,
+    size_t name_len,
+    bool *ambiguous);
+#endif
+
+#endif
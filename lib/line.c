@@ -0,0 +1,471 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <merr.h>
+
+#include <libcli/line.h>
+#include <libcli/parser.h>
+#include <libcli/program.h>
+
+#include "line.h"
+#include "mem.h"
+#include "util.h"
+
+/* Bytes classified at once, one bit each. */
+#define BLOCK 64
+
+/* Arguments of cli_parse_line() which fit here are not allocated. */
+#define STACK_ARGS 32
+
+enum {
+    /* Ends a run outside of quotes. */
+    STOP_PLAIN = 1 << 0,
+    /* Ends a run inside double quotes. */
+    STOP_QUOTED = 1 << 1,
+};
+
+static const unsigned char stops[UCHAR_MAX + 1] = {
+    [' '] = STOP_PLAIN,
+    ['\t'] = STOP_PLAIN,
+    ['\r'] = STOP_PLAIN,
+    ['\n'] = STOP_PLAIN,
+    ['\''] = STOP_PLAIN,
+    ['"'] = STOP_PLAIN | STOP_QUOTED,
+    ['\\'] = STOP_PLAIN | STOP_QUOTED,
+    ['\0'] = STOP_PLAIN | STOP_QUOTED,
+};
+
+struct splitter {
+    char **argv;
+    size_t capacity;
+    /* Whether argv came from the heap. */
+    bool owned;
+    size_t argc;
+};
+
+static bool
+is_blank(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static unsigned int
+lowest(const uint64_t m)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_ctzll(m);
+#else
+    unsigned int i = 0;
+
+    while (!(m & (UINT64_C(1) << i)))
+        i++;
+
+    return i;
+#endif
+}
+
+#ifdef __SSE2__
+static uint64_t
+match(const __m128i x, const char c)
+{
+    return (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8(c)));
+}
+#else
+#define ONES UINT64_C(0x0101010101010101)
+#define LOWS UINT64_C(0x7f7f7f7f7f7f7f7f)
+
+/* Bytes of p in memory order, the first one lowest. */
+static uint64_t
+load(const char * const p)
+{
+    uint64_t x;
+
+    memcpy(&x, p, sizeof(x));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+
+    return x;
+}
+
+/* Bit i is set when byte i of x equals c. The comparison does not carry
+ * between bytes, and the multiplication gathers their high bits.
+ */
+static uint64_t
+match(const uint64_t x, const char c)
+{
+    const uint64_t y = x ^ (ONES * (unsigned char)c);
+    const uint64_t m = ~(((y & LOWS) + LOWS) | y | LOWS);
+
+    return ((m >> 7) * UINT64_C(0x0102040810204080)) >> 56;
+}
+#endif
+
+/* Bit i of *blanks and *quotes is set when byte i of p is a blank, and a
+ * quote or backslash respectively. With SSE2 sixteen bytes are compared at
+ * once, and otherwise the eight bytes of a word.
+ */
+static void
+classify(const char * const p, uint64_t * const blanks, uint64_t * const quotes)
+{
+#ifdef __SSE2__
+    const unsigned int step = 16;
+#else
+    const unsigned int step = 8;
+#endif
+
+    *blanks = 0;
+    *quotes = 0;
+
+    for (unsigned int i = 0; i < BLOCK; i += step) {
+#ifdef __SSE2__
+        const __m128i x = _mm_loadu_si128((const void *)(p + i));
+#else
+        const uint64_t x = load(p + i);
+#endif
+
+        *blanks |= (match(x, ' ') | match(x, '\t') | match(x, '\r') | match(x, '\n')) << i;
+        *quotes |= (match(x, '\'') | match(x, '"') | match(x, '\\')) << i;
+    }
+}
+
+static merr_t
+push(struct splitter * const sp, char * const arg)
+{
+    /* Leave room for the terminating NULL. */
+    if (sp->argc + 1 >= sp->capacity) {
+        char **argv;
+        const size_t capacity = sp->capacity ? sp->capacity * 2 : 16;
+
+        if (sp->owned) {
+            argv = cli_realloc(sp->argv, capacity * sizeof(*argv));
+        } else {
+            argv = cli_malloc(capacity * sizeof(*argv));
+            if (argv && sp->argc)
+                memcpy(argv, sp->argv, sp->argc * sizeof(*argv));
+        }
+        if (!argv)
+            return merr(ENOMEM);
+
+        sp->argv = argv;
+        sp->capacity = capacity;
+        sp->owned = true;
+    }
+
+    sp->argv[sp->argc++] = arg;
+
+    return 0;
+}
+
+/* Move the bytes from i up to the first one which stops the run down to *w.
+ * Runs are short, as the blocks have been through the long ones.
+ */
+static size_t
+run(char * const s, size_t * const w, size_t i, const unsigned char stop)
+{
+    if (*w == i) {
+        while (!(stops[(unsigned char)s[i]] & stop))
+            i++;
+        *w = i;
+    } else {
+        while (!(stops[(unsigned char)s[i]] & stop))
+            s[(*w)++] = s[i++];
+    }
+
+    return i;
+}
+
+/* Split the argument starting at *r, of which the bytes before i are plain,
+ * and set *r past its end. Every argument is written from its own start, so
+ * removing quotes only ever moves bytes within it.
+ */
+static merr_t
+split_word(char * const s, size_t * const r, size_t i, const size_t len)
+{
+    size_t w = i;
+
+    for (;;) {
+        char c;
+
+        i = run(s, &w, i, STOP_PLAIN);
+        if (i == len)
+            break;
+
+        c = s[i];
+        if (is_blank(c))
+            break;
+
+        if (c == '\'') {
+            const char * const q = memchr(s + i + 1, '\'', len - i - 1);
+            size_t n;
+
+            if (!q)
+                return merr(EINVAL);
+
+            n = (size_t)(q - (s + i + 1));
+            memmove(s + w, s + i + 1, n);
+            w += n;
+            i += n + 2;
+        } else if (c == '"') {
+            i++;
+            for (;;) {
+                i = run(s, &w, i, STOP_QUOTED);
+                if (i == len)
+                    return merr(EINVAL);
+
+                if (s[i] == '"') {
+                    i++;
+                    break;
+                }
+
+                /* Only a few bytes lose their meaning to a backslash here. */
+                if (i + 1 == len)
+                    return merr(EINVAL);
+
+                switch (s[i + 1]) {
+                case '\n':
+                    i += 2;
+                    break;
+                case '"':
+                case '\\':
+                case '$':
+                case '`':
+                    s[w++] = s[i + 1];
+                    i += 2;
+                    break;
+                default:
+                    s[w++] = s[i++];
+                    break;
+                }
+            }
+        } else {
+            if (i + 1 == len)
+                return merr(EINVAL);
+
+            if (s[i + 1] != '\n')
+                s[w++] = s[i + 1];
+            i += 2;
+        }
+    }
+
+    /* A blank, or the terminator when the argument ends the line. */
+    s[w] = '\0';
+    *r = i < len ? i + 1 : len;
+
+    return 0;
+}
+
+/* Split whatever is left after the last full block of the line. */
+static merr_t
+split_tail(struct splitter * const sp, char * const s, size_t r, const size_t len)
+{
+    merr_t err;
+
+    for (;;) {
+        while (r < len) {
+            if (is_blank(s[r])) {
+                r++;
+            } else if (s[r] == '\\' && r + 1 < len && s[r + 1] == '\n') {
+                r += 2;
+            } else {
+                break;
+            }
+        }
+
+        if (r == len)
+            return 0;
+
+        err = push(sp, s + r);
+        if (err)
+            return err;
+
+        err = split_word(s, &r, r, len);
+        if (err)
+            return err;
+    }
+}
+
+/* Lines are classified a block at a time. A byte which is not a blank but
+ * follows one starts an argument, and a blank which follows anything else
+ * ends one. The first quote or backslash hands the argument it is in over to
+ * split_word(), after which the rest of the block carries on.
+ */
+static merr_t
+split(struct splitter * const sp, char * const s)
+{
+    merr_t err;
+    size_t r = 0;
+    /* Whether the byte before r is a blank, as the start of the line is. */
+    uint64_t after_blank = 1;
+    const size_t len = strlen(s);
+
+    while (r + BLOCK <= len) {
+        const size_t base = r;
+        uint64_t blanks, quotes;
+
+        classify(s + base, &blanks, &quotes);
+
+        /* split_word() only writes before where it stops, so the rest of the
+         * block is as it was classified.
+         */
+        while (r < base + BLOCK) {
+            const unsigned int done = (unsigned int)(r - base);
+            const uint64_t live = ~UINT64_C(0) << done;
+            const uint64_t q = quotes & live;
+            const uint64_t before = q ? (q & (~q + 1)) - 1 : ~UINT64_C(0);
+            const uint64_t prev = (blanks << 1) | (after_blank << done);
+            uint64_t starts = ~blanks & prev & live & before;
+            uint64_t ends = blanks & ~prev & live & before;
+            unsigned int k;
+
+            for (; starts; starts &= starts - 1) {
+                err = push(sp, s + base + lowest(starts));
+                if (err)
+                    return err;
+            }
+
+            for (; ends; ends &= ends - 1)
+                s[base + lowest(ends)] = '\0';
+
+            if (!q) {
+                after_blank = blanks >> (BLOCK - 1);
+                r = base + BLOCK;
+                break;
+            }
+
+            k = lowest(q);
+            if (!((prev >> k) & 1)) {
+                size_t word = (size_t)(sp->argv[sp->argc - 1] - s);
+
+                err = split_word(s, &word, base + k, len);
+                if (err)
+                    return err;
+
+                r = word;
+            } else if (s[base + k] == '\\' && base + k + 1 < len && s[base + k + 1] == '\n') {
+                /* Joined lines between arguments. */
+                r = base + k + 2;
+            } else {
+                r = base + k;
+                err = push(sp, s + r);
+                if (err)
+                    return err;
+
+                err = split_word(s, &r, r, len);
+                if (err)
+                    return err;
+            }
+
+            after_blank = 1;
+        }
+    }
+
+    if (!after_blank) {
+        size_t word = (size_t)(sp->argv[sp->argc - 1] - s);
+
+        err = split_word(s, &word, r, len);
+        if (err)
+            return err;
+
+        r = word;
+    }
+
+    err = split_tail(sp, s, r, len);
+    if (err)
+        return err;
+
+    if (sp->argc > INT_MAX)
+        return merr(E2BIG);
+
+    /* Nothing was pushed to make room for the terminator. */
+    if (sp->argc >= sp->capacity) {
+        err = push(sp, NULL);
+        if (err)
+            return err;
+        sp->argc--;
+    }
+
+    sp->argv[sp->argc] = NULL;
+
+    return 0;
+}
+
+merr_t
+cli_line_split(struct cli_line * const line, char * const s)
+{
+    return cli_line_split_after(line, s, 0);
+}
+
+merr_t
+cli_line_split_after(struct cli_line * const line, char * const s, const int skip)
+{
+    merr_t err;
+    struct splitter sp;
+
+    if (!line || !s || skip < 0)
+        return merr(EINVAL);
+
+    sp.argv = line->argv;
+    sp.capacity = line->capacity;
+    sp.owned = true;
+    sp.argc = (size_t)skip;
+
+    err = split(&sp, s);
+
+    line->argv = sp.argv;
+    line->capacity = sp.capacity;
+    line->argc = err ? 0 : (int)sp.argc;
+
+    return err;
+}
+
+void
+cli_line_fini(struct cli_line * const line)
+{
+    if (!line)
+        return;
+
+    cli_free(line->argv);
+    memset(line, 0, sizeof(*line));
+}
+
+merr_t
+cli_parse_line(
+    const struct cli * const cli,
+    char * const line,
+    int * const exit_code,
+    struct cli_parser * const parser)
+{
+    merr_t err;
+    char *stack[STACK_ARGS];
+    struct splitter sp = { .argv = stack, .capacity = NELEM(stack), .argc = 1 };
+
+    if (!cli || !line || !exit_code || !parser)
+        return merr(EINVAL);
+
+    stack[0] = (char *)(parser->program_name ? parser->program_name :
+                        cli_program_name     ? cli_program_name :
+                                               cli->name);
+
+    err = split(&sp, line);
+    if (!err)
+        err = cli_parse_r(cli, (int)sp.argc, sp.argv, exit_code, parser);
+
+    if (sp.owned)
+        cli_free(sp.argv);
+
+    return err;
+}
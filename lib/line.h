@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_LINE_PRIVATE_H
+#define LIBCLI_LINE_PRIVATE_H
+
+#include <merr.h>
+
+#include <libcli/line.h>
+
+/* Like cli_line_split(), but the arguments start at argv[skip], leaving the
+ * entries before it for the caller to fill in. line->argc counts them.
+ */
+merr_t
+cli_line_split_after(struct cli_line *line, char *s, int skip);
+
+#endif
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "list.h"
+#include "mem.h"
+
+#define ONES  UINT64_C(0x0101010101010101)
+#define HIGHS UINT64_C(0x8080808080808080)
+#define LOWS  UINT64_C(0x7f7f7f7f7f7f7f7f)
+
+struct string {
+    struct string *next;
+    char s[];
+};
+
+merr_t
+cli_list_reserve(struct cli_list * const list, const size_t n, const size_t size)
+{
+    void *items;
+    size_t capacity;
+
+    if (n <= list->capacity - list->count)
+        return 0;
+
+    if (n > SIZE_MAX / size - list->count)
+        return merr(ENOMEM);
+
+    capacity = list->capacity ? list->capacity : 8;
+    while (capacity < list->count + n)
+        capacity = capacity > SIZE_MAX / 2 / size ? list->count + n : capacity * 2;
+
+    items = cli_realloc(list->items, capacity * size);
+    if (!items)
+        return merr(ENOMEM);
+
+    list->items = items;
+    list->capacity = capacity;
+
+    return 0;
+}
+
+char *
+cli_list_strdup(struct cli_list * const list, const char * const s, const size_t len)
+{
+    struct string *str;
+
+    str = cli_malloc(sizeof(*str) + len + 1);
+    if (!str)
+        return NULL;
+
+    memcpy(str->s, s, len);
+    str->s[len] = '\0';
+    str->next = list->strings;
+    list->strings = str;
+
+    return str->s;
+}
+
+void
+cli_list_truncate(struct cli_list * const list, const size_t count, void * const strings)
+{
+    struct string *str = list->strings;
+
+    while (str != strings) {
+        struct string *next = str->next;
+
+        cli_free(str);
+        str = next;
+    }
+
+    list->strings = strings;
+    if (count < list->count)
+        list->count = count;
+}
+
+void
+cli_list_fini(struct cli_list * const list)
+{
+    if (!list)
+        return;
+
+    cli_list_truncate(list, 0, NULL);
+    cli_free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+size_t
+cli_split(char * const s, const size_t len, const char delim)
+{
+    size_t i = 0;
+    size_t fields = 1;
+    const uint64_t pattern = ONES * (unsigned char)delim;
+
+    /* Eight bytes at a time: a byte of x is zero exactly where the delimiter
+     * is, and the mask gets its high bit set there without carries between
+     * bytes, so it is independent of byte order.
+     */
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t w, x, m;
+
+        memcpy(&w, s + i, sizeof(w));
+        x = w ^ pattern;
+        m = ~(((x & LOWS) + LOWS) | x | LOWS);
+        if (!m)
+            continue;
+
+        fields += (size_t)((((m >> 7) * ONES) >> 56) & 0xff);
+        w &= ~((m >> 7) * 0xff);
+        memcpy(s + i, &w, sizeof(w));
+    }
+
+    for (; i < len; i++) {
+        if (s[i] == delim) {
+            s[i] = '\0';
+            fields++;
+        }
+    }
+
+    return fields;
+}
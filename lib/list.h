@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_LIST_H
+#define LIBCLI_LIST_H
+
+#include <stddef.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+/* Grow list to hold at least n more items of the given size. */
+merr_t
+cli_list_reserve(struct cli_list *list, size_t n, size_t size);
+
+/* Copy of the len bytes at s, NUL-terminated, which lives as long as list. */
+char *
+cli_list_strdup(struct cli_list *list, const char *s, size_t len);
+
+/* Drop items past count and string copies made since strings was the head. */
+void
+cli_list_truncate(struct cli_list *list, size_t count, void *strings);
+
+/* Terminate every field of s in place by overwriting each delim with a NUL,
+ * returning the number of fields. Fields then follow each other, one strlen()
+ * plus one apart.
+ */
+size_t
+cli_split(char *s, size_t len, char delim);
+
+#endif
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/plugin.h>
+
+#include "loader.h"
+#include "stats.h"
+
+/* Loads are rare, so one lock for every stub is enough. */
+static pthread_mutex_t load_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local cli_load_hook *watch_hook;
+static _Thread_local void *watch_ctx;
+
+merr_t
+cli_load(const struct cli * const cli)
+{
+    merr_t err = 0;
+    bool loaded = false;
+
+    if (!cli->loader)
+        return 0;
+
+    /* cli_compile() publishes the index after everything the loader
+     * registered, so once it is seen nothing else needs the lock.
+     */
+    if (__atomic_load_n(&cli->index, __ATOMIC_ACQUIRE))
+        return 0;
+
+    pthread_mutex_lock(&load_lock);
+
+    /* Loaded stubs are always compiled. */
+    if (!cli->index) {
+        const uint64_t start = cli_stats_start();
+        /* Stubs are filled in place, so they are never really const. */
+        struct cli * const stub = (struct cli *)cli;
+
+        err = stub->loader(stub, stub->loader_ctx);
+        if (!err)
+            err = cli_compile(stub);
+        if (err)
+            cli_fini(stub);
+        loaded = !err;
+
+        cli_stats_stop(CLI_STATS_LOAD, start);
+    }
+
+    pthread_mutex_unlock(&load_lock);
+
+    if (loaded && watch_hook)
+        watch_hook(cli, watch_ctx);
+
+    return err;
+}
+
+void
+cli_load_watch(cli_load_hook * const hook, void * const ctx)
+{
+    watch_hook = hook;
+    watch_ctx = ctx;
+}
+
+merr_t
+cli_plugin_loader(struct cli * const cli, void * const ctx)
+{
+    cli_loader *entry;
+    struct cli_plugin * const plugin = ctx;
+
+    if (!cli || !plugin || !plugin->path || !plugin->symbol)
+        return merr(EINVAL);
+
+    if (!plugin->handle) {
+        plugin->handle = dlopen(plugin->path, RTLD_NOW | RTLD_LOCAL);
+        if (!plugin->handle)
+            return merr(ENOENT);
+    }
+
+    /* The conversion dlsym(3) recommends, since ISO C has no direct one. */
+    *(void **)&entry = dlsym(plugin->handle, plugin->symbol);
+    if (!entry)
+        return merr(ENOENT);
+
+    return entry(cli, plugin->ctx);
+}
+
+void
+cli_plugin_fini(struct cli_plugin * const plugin)
+{
+    if (!plugin || !plugin->handle)
+        return;
+
+    dlclose(plugin->handle);
+    plugin->handle = NULL;
+}
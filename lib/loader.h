@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_LOADER_H
+#define LIBCLI_LOADER_H
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+/* Fill in cli if it is a stub which has not been loaded yet. Any number of
+ * parses may race to load the same stub; the loader runs once.
+ */
+merr_t
+cli_load(const struct cli *cli);
+
+typedef void
+cli_load_hook(const struct cli *cli, void *ctx);
+
+/* Call hook whenever the calling thread loads a stub, before anything is
+ * parsed into it. A NULL hook stops watching.
+ */
+void
+cli_load_watch(cli_load_hook *hook, void *ctx);
+
+#endif
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcli/alloc.h>
+
+#include "mem.h"
+#include "stats.h"
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+static struct cli_allocator allocator;
+
+void
+cli_set_allocator(const struct cli_allocator * const a)
+{
+    if (a) {
+        allocator = *a;
+    } else {
+        memset(&allocator, 0, sizeof(allocator));
+    }
+}
+
+void *
+cli_malloc(const size_t size)
+{
+    cli_stats_alloc(size);
+
+    if (allocator.reallocate)
+        return allocator.reallocate(NULL, size, allocator.ctx);
+
+    return malloc(size);
+}
+
+void *
+cli_calloc(const size_t nmemb, const size_t size)
+{
+    void *ptr;
+
+    if (size && nmemb > SIZE_MAX / size)
+        return NULL;
+
+    cli_stats_alloc(nmemb * size);
+
+    if (!allocator.reallocate)
+        return calloc(nmemb, size);
+
+    ptr = allocator.reallocate(NULL, nmemb * size, allocator.ctx);
+    if (ptr)
+        memset(ptr, 0, nmemb * size);
+
+    return ptr;
+}
+
+void *
+cli_realloc(void * const ptr, const size_t size)
+{
+    cli_stats_alloc(size);
+
+    if (allocator.reallocate)
+        return allocator.reallocate(ptr, size, allocator.ctx);
+
+    return realloc(ptr, size);
+}
+
+void
+cli_free(void * const ptr)
+{
+    if (!ptr)
+        return;
+
+    if (allocator.deallocate) {
+        allocator.deallocate(ptr, allocator.ctx);
+    } else {
+        free(ptr);
+    }
+}
+
+void *
+cli_arena_alloc(struct cli_arena * const arena, const size_t size)
+{
+    size_t offset;
+
+    if (!arena || !arena->buf)
+        return cli_malloc(size);
+
+    /* Align the address rather than the offset, as buf may be any memory. */
+    offset = arena->used +
+        ((ARENA_ALIGN - ((uintptr_t)(arena->buf + arena->used) & (ARENA_ALIGN - 1))) &
+         (ARENA_ALIGN - 1));
+    if (offset > arena->size || size > arena->size - offset)
+        return cli_malloc(size);
+
+    arena->used = offset + size;
+
+    return arena->buf + offset;
+}
+
+void *
+cli_arena_calloc(struct cli_arena * const arena, const size_t nmemb, const size_t size)
+{
+    void *ptr;
+
+    if (size && nmemb > SIZE_MAX / size)
+        return NULL;
+
+    if (!arena || !arena->buf)
+        return cli_calloc(nmemb, size);
+
+    ptr = cli_arena_alloc(arena, nmemb * size);
+    if (ptr)
+        memset(ptr, 0, nmemb * size);
+
+    return ptr;
+}
+
+bool
+cli_arena_owns(const struct cli_arena * const arena, const void * const ptr)
+{
+    const uintptr_t p = (uintptr_t)ptr;
+
+    return arena && arena->buf && p >= (uintptr_t)arena->buf &&
+        p < (uintptr_t)arena->buf + arena->size;
+}
+
+void
+cli_arena_free(struct cli_arena * const arena, void * const ptr)
+{
+    if (cli_arena_owns(arena, ptr))
+        return;
+
+    cli_free(ptr);
+}
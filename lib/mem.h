@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_MEM_H
+#define LIBCLI_MEM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Bump allocator over caller-provided memory. Individual allocations are
+ * never freed; callers roll back to a previously saved value of used instead.
+ * Requests which do not fit fall back to the heap.
+ */
+struct cli_arena {
+    char *buf;
+    size_t size;
+    size_t used;
+};
+
+void *
+cli_malloc(size_t size);
+
+void *
+cli_calloc(size_t nmemb, size_t size);
+
+void *
+cli_realloc(void *ptr, size_t size);
+
+void
+cli_free(void *ptr);
+
+void *
+cli_arena_alloc(struct cli_arena *arena, size_t size);
+
+void *
+cli_arena_calloc(struct cli_arena *arena, size_t nmemb, size_t size);
+
+/* Whether ptr came from the arena rather than the heap. */
+bool
+cli_arena_owns(const struct cli_arena *arena, const void *ptr);
+
+void
+cli_arena_free(struct cli_arena *arena, void *ptr);
+
+#endif
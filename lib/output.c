@@ -13,6 +13,8 @@
 #include <libcli/output.h>
 #include <libcli/program.h>
 
+#include "mem.h"
+
 #define COLUMN_SEP "  "
 
 int
@@ -56,7 +58,7 @@ cli_print_table(
     if (!ncol || !headers || !values)
         return -1;
 
-    longest = malloc(ncol * sizeof(*longest));
+    longest = cli_malloc(ncol * sizeof(*longest));
     if (!longest)
         return 0;
 
@@ -132,7 +134,7 @@ cli_print_table(
             printed++;
     }
 
-    free(longest);
+    cli_free(longest);
 
     return printed;
 }
@@ -7,7 +7,6 @@
 
 #include <assert.h>
 #include <errno.h>
-#include <getopt.h>
 #include <limits.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -26,371 +25,841 @@
 #include <libcli/parser.h>
 #include <libcli/program.h>
 
-#define TAB "  "
+#include "complete.h"
+#include "config.h"
+#include "convert.h"
+#include "help.h"
+#include "index.h"
+#include "list.h"
+#include "loader.h"
+#include "mem.h"
+#include "parser.h"
+#include "response.h"
+#include "result.h"
+#include "stats.h"
+#include "suggest.h"
+#include "type.h"
+
+/* Everything a parse needs beyond the tree itself. Nothing in here is shared
+ * between concurrent parses.
+ */
+struct parse_state {
+    struct cli_parser *parser;
+    struct cli_arena arena;
+    const char *program;
+    const char *program_short;
+    FILE *out;
+    FILE *err;
+    /* Subcommand path of the command being parsed, for config lookups. */
+    const struct cli_config_path *path;
+    /* Position of the command being parsed in the arguments of the root. */
+    int offset;
+};
+
+/* Config value for an option of the command being parsed. */
+struct parse_default {
+    const struct cli_option *option;
+    const char *value;
+};
 
-merr_t
-cli_add_argument(struct cli * const cli, struct cli_argument * const argument)
+static void
+parse_error(const struct parse_state * const ps, const char * const fmt, ...)
 {
-    struct cli_argument *a;
-    struct cli_argument *prev;
+    va_list ap;
+
+    assert(ps);
+    assert(fmt);
+
+    va_start(ap, fmt);
+    flockfile(ps->err);
+    fprintf(ps->err, "%s: ", ps->program_short);
+    vfprintf(ps->err, fmt, ap);
+    fputc('\n', ps->err);
+    funlockfile(ps->err);
+    va_end(ap);
+}
 
-    if (!cli || !argument)
-        return merr(EINVAL);
+static void
+parse_suggest(
+    const struct parse_state * const ps,
+    const struct cli_suggestions * const sg,
+    const char * const prefix)
+{
+    if (sg->count == 0)
+        return;
 
-    if (SLIST_EMPTY(&cli->arguments)) {
-        SLIST_INSERT_HEAD(&cli->arguments, argument, entry);
+    flockfile(ps->err);
+    fprintf(ps->err, "%s: Did you mean ", ps->program_short);
+    for (size_t i = 0; i < sg->count; i++) {
+        const char *sep = i == 0 ? "" : i + 1 == sg->count ? " or " : ", ";
 
-        return 0;
+        fprintf(ps->err, "%s'%s%s'", sep, prefix, sg->names[i]);
     }
+    fputs("?\n", ps->err);
+    funlockfile(ps->err);
+}
 
-    prev = SLIST_FIRST(&cli->arguments);
-    SLIST_FOREACH(a, &cli->arguments, entry) {
-        if (a == argument)
-            return merr(ENOTUNIQ);
-
-        if (strcmp(a->name, argument->name) > 0)
-            break;
+#ifndef CLI_NO_GETOPT_LONG
+/* Every long option which name abbreviates, rather than the closest few. */
+static void
+parse_candidates(
+    const struct parse_state * const ps,
+    const struct cli_index * const idx,
+    const char * const name,
+    const size_t name_len)
+{
+    size_t n = 0;
+    size_t total = 0;
 
-        /* We want to continue looping through the rest of the options to verify
-         * other preconditions.
-         */
-        if (!prev)
-            prev = a;
+    for (size_t i = 0; i < idx->lngc; i++) {
+        if (strncmp(idx->lngv[i]->lng, name, name_len) == 0)
+            total++;
     }
 
-    SLIST_INSERT_AFTER(prev, argument, entry);
-
-    return 0;
-}
-
-merr_t
-cli_add_arguments(struct cli *cli, const size_t argumentc, struct cli_argument * const argumentv)
-{
-    if (!cli || !argumentv)
-        return merr(EINVAL);
+    flockfile(ps->err);
+    fprintf(ps->err, "%s: Could be ", ps->program_short);
+    for (size_t i = 0; i < idx->lngc; i++) {
+        const char *sep;
 
-    for (size_t i = 0; i < argumentc; i++) {
-        merr_t err;
+        if (strncmp(idx->lngv[i]->lng, name, name_len) != 0)
+            continue;
 
-        err = cli_add_argument(cli, argumentv + i);
-        if (err)
-            return err;
+        sep = n == 0 ? "" : n + 1 == total ? " or " : ", ";
+        fprintf(ps->err, "%s'--%s'", sep, idx->lngv[i]->lng);
+        n++;
     }
+    fputc('\n', ps->err);
+    funlockfile(ps->err);
+}
+#endif
 
-    return 0;
+static bool
+argument_is_valid(const struct cli_argument * const argument)
+{
+    return argument->name && argument->type != CLI_TYPE_CHOICE &&
+        (!argument->variadic || argument->type == CLI_TYPE_STRING);
 }
 
-merr_t
-cli_add_option(struct cli * const cli, struct cli_option * const option)
+static merr_t
+add_argument(struct cli * const cli, struct cli_argument * const argument)
 {
-    struct cli_option *o;
-    struct cli_option *prev;
+    struct cli_argument *a;
+    struct cli_argument *last = NULL;
 
-    if (!cli || !option)
+    if (!cli || !argument || !argument_is_valid(argument))
         return merr(EINVAL);
 
-    if (SLIST_EMPTY(&cli->options)) {
-        SLIST_INSERT_HEAD(&cli->options, option, entry);
-
-        return 0;
-    }
+    if (cli->index)
+        return merr(EBUSY);
 
-    prev = SLIST_FIRST(&cli->options);
-    SLIST_FOREACH(o, &cli->options, entry) {
-        if (o == option || o->shrt == option->shrt)
+    SLIST_FOREACH(a, &cli->arguments, entry) {
+        if (a == argument)
             return merr(ENOTUNIQ);
 
-        if (o->shrt > option->shrt)
-            break;
-
-        /* We want to continue looping through the rest of the options to verify
-         * other preconditions.
-         */
-        if (!prev)
-            prev = o;
+        last = a;
     }
 
-    SLIST_INSERT_AFTER(prev, option, entry);
+    /* Nothing can follow an argument which takes the rest of argv. */
+    if (last && last->variadic)
+        return merr(EINVAL);
+
+    if (last) {
+        SLIST_INSERT_AFTER(last, argument, entry);
+    } else {
+        SLIST_INSERT_HEAD(&cli->arguments, argument, entry);
+    }
 
     return 0;
 }
 
 merr_t
-cli_add_options(struct cli *cli, const size_t optionc, struct cli_option * const optionv)
+cli_add_argument(struct cli * const cli, struct cli_argument * const argument)
 {
-    if (!cli || !optionv)
-        return merr(EINVAL);
+    merr_t err;
+    const uint64_t start = cli_stats_start();
 
-    for (size_t i = 0; i < optionc; i++) {
-        merr_t err;
-
-        err = cli_add_option(cli, optionv + i);
-        if (err)
-            return err;
-    }
+    err = add_argument(cli, argument);
+    cli_stats_stop(CLI_STATS_REGISTER, start);
 
-    return 0;
+    return err;
 }
 
-merr_t
-cli_add_subcommand(struct cli *cli, struct cli * const subcommand)
+static merr_t
+add_arguments(struct cli *cli, const size_t argumentc, struct cli_argument * const argumentv)
 {
-    struct cli *c;
-    struct cli *prev;
-
-    if (!cli || !subcommand)
-        return merr(EINVAL);
+    struct cli_argument *a;
+    struct cli_argument *last = NULL;
 
-    if (cli == subcommand)
+    if (!cli || !argumentv)
         return merr(EINVAL);
 
-    if (SLIST_EMPTY(&cli->subcommands)) {
-        SLIST_INSERT_HEAD(&cli->subcommands, subcommand, entry);
+    if (cli->index)
+        return merr(EBUSY);
 
+    if (argumentc == 0)
         return 0;
-    }
 
-    prev = SLIST_FIRST(&cli->subcommands);
-    SLIST_FOREACH(c, &cli->subcommands, entry) {
-        int rc;
-
-        rc = strcmp(c->name, subcommand->name);
-        if (c == subcommand || rc == 0)
+    /* An argument can only already be registered if it is one of ours. */
+    SLIST_FOREACH(a, &cli->arguments, entry) {
+        if ((uintptr_t)a >= (uintptr_t)argumentv &&
+            (uintptr_t)a < (uintptr_t)(argumentv + argumentc))
             return merr(ENOTUNIQ);
 
-        if (rc > 0)
-            break;
+        last = a;
+    }
 
-        /* We want to continue looping through the rest of the options to
-         * verify other preconditions.
-         */
-        if (!prev)
-            prev = c;
+    if (last && last->variadic)
+        return merr(EINVAL);
+
+    for (size_t i = 0; i < argumentc; i++) {
+        if (!argument_is_valid(argumentv + i) || (argumentv[i].variadic && i != argumentc - 1))
+            return merr(EINVAL);
     }
 
-    SLIST_INSERT_AFTER(prev, subcommand, entry);
+    for (size_t i = 0; i < argumentc; i++) {
+        if (last) {
+            SLIST_INSERT_AFTER(last, argumentv + i, entry);
+        } else {
+            SLIST_INSERT_HEAD(&cli->arguments, argumentv + i, entry);
+        }
+
+        last = argumentv + i;
+    }
 
     return 0;
 }
 
 merr_t
-cli_add_subcommands(struct cli *cli, size_t subcommandc, struct cli * const subcommandv)
+cli_add_arguments(struct cli *cli, const size_t argumentc, struct cli_argument * const argumentv)
 {
-    if (!cli || !subcommandv)
-        return merr(EINVAL);
-
-    for (size_t i = 0; i < subcommandc; i++) {
-        merr_t err;
+    merr_t err;
+    const uint64_t start = cli_stats_start();
 
-        err = cli_add_subcommand(cli, subcommandv + i);
-        if (err)
-            return err;
-    }
+    err = add_arguments(cli, argumentc, argumentv);
+    cli_stats_stop(CLI_STATS_REGISTER, start);
 
-    return 0;
+    return err;
 }
 
-void
-cli_init(struct cli * const cli)
+/* Options are ordered by short name, with long-only options first and
+ * ordered by long name.
+ */
+static int
+option_order(const struct cli_option * const x, const struct cli_option * const y)
 {
-    if (!cli)
-        return;
+    if (x->shrt != y->shrt)
+        return (unsigned char)x->shrt < (unsigned char)y->shrt ? -1 : 1;
 
-    SLIST_INIT(&cli->options);
+#ifndef CLI_NO_GETOPT_LONG
+    if (!x->lng || !y->lng)
+        return (x->lng != NULL) - (y->lng != NULL);
+
+    return strcmp(x->lng, y->lng);
+#else
+    return 0;
+#endif
 }
 
-static size_t
-cli_get_num_options(const struct cli * const cli)
+static int
+option_cmp(const void * const a, const void * const b)
 {
-    size_t i = 0;
-    const struct cli_option *o;
+    const struct cli_option * const *x = a;
+    const struct cli_option * const *y = b;
 
-    assert(cli);
+    return option_order(*x, *y);
+}
 
-    SLIST_FOREACH(o, &cli->options, entry)
-        i++;
+static bool
+option_is_valid(const struct cli_option * const option)
+{
+    if (option->type == CLI_TYPE_CHOICE && (!option->choices || !option->choices[0]))
+        return false;
 
-    return i;
+#ifndef CLI_NO_GETOPT_LONG
+    return option->shrt || option->lng;
+#else
+    return option->shrt;
+#endif
 }
 
-static const struct cli_option *
-cli_get_option(const struct cli * const cli, const int c)
+static merr_t
+add_option(struct cli * const cli, struct cli_option * const option)
 {
-    const struct cli_option *o;
+    struct cli_option *o;
+    size_t count = 0;
+    struct cli_option *prev = NULL;
 
-    assert(cli);
+    if (!cli || !option)
+        return merr(EINVAL);
+
+    if (!option_is_valid(option))
+        return merr(EINVAL);
+
+    if (cli->index)
+        return merr(EBUSY);
 
     SLIST_FOREACH(o, &cli->options, entry) {
-        if (c == o->shrt)
-            return o;
+        count++;
+
+        if (o == option || (option->shrt && o->shrt == option->shrt))
+            return merr(ENOTUNIQ);
+
+#ifndef CLI_NO_GETOPT_LONG
+        if (option->lng && o->lng && strcmp(o->lng, option->lng) == 0)
+            return merr(ENOTUNIQ);
+#endif
+
+        /* We want to continue looping through the rest of the options to verify
+         * other preconditions.
+         */
+        if (option_order(o, option) < 0)
+            prev = o;
+    }
+
+    if (count > UINT16_MAX)
+        return merr(E2BIG);
+
+    option->ordinal = (uint16_t)count;
+
+    if (prev) {
+        SLIST_INSERT_AFTER(prev, option, entry);
+    } else {
+        SLIST_INSERT_HEAD(&cli->options, option, entry);
     }
 
-    return NULL;
+    return 0;
 }
 
-static void
-cli_action_help(const struct cli * const cli, int * const exit_code, FILE * const output)
+merr_t
+cli_add_option(struct cli * const cli, struct cli_option * const option)
 {
-    assert(cli);
-    assert(output);
+    merr_t err;
+    const uint64_t start = cli_stats_start();
 
-    fprintf(output, "Usage: %s", cli_program_name);
-    if (!SLIST_EMPTY(&cli->options))
-        fputs(" [OPTIONS]...", output);
-    if (!SLIST_EMPTY(&cli->arguments)) {
-        const struct cli_argument *a;
+    err = add_option(cli, option);
+    cli_stats_stop(CLI_STATS_REGISTER, start);
 
-        SLIST_FOREACH(a, &cli->arguments, entry)
-            fprintf(output, " %s", a->name);
-    }
-    fputc('\n', output);
+    return err;
+}
 
-    if (cli->description)
-        fprintf(output, "\n%s\n", cli->description);
+/* Duplicate detection over the union of the registered and new options:
+ * short names in a bitmap, long names in an open addressing hash set.
+ */
+struct option_set {
+    unsigned long shrt[(UCHAR_MAX + 1) / (sizeof(unsigned long) * CHAR_BIT)];
+#ifndef CLI_NO_GETOPT_LONG
+    size_t mask;
+    const char **lng;
+#endif
+};
 
-    if (!SLIST_EMPTY(&cli->arguments)) {
-        size_t max_width = 0;
-        const struct cli_argument *a;
+static bool
+option_set_insert(struct option_set * const set, const struct cli_option * const option)
+{
+    if (option->shrt) {
+        const unsigned char c = (unsigned char)option->shrt;
+        const size_t bits = sizeof(set->shrt[0]) * CHAR_BIT;
+        const unsigned long bit = 1UL << (c % bits);
 
-        fputs("\nArguments:\n", output);
+        if (set->shrt[c / bits] & bit)
+            return false;
 
-        SLIST_FOREACH(a, &cli->arguments, entry) {
-            size_t width = strlen(a->name);
+        set->shrt[c / bits] |= bit;
+    }
 
-            if (width > max_width)
-                max_width = width;
-        }
+#ifndef CLI_NO_GETOPT_LONG
+    if (option->lng) {
+        size_t slot;
 
-        SLIST_FOREACH(a, &cli->arguments, entry) {
-            fprintf(output, TAB "%-*s", (int)max_width, a->name);
-            if (a->description)
-                fprintf(output, TAB "%s", a->description);
-            fputc('\n', output);
-        }
-    }
+        slot = (size_t)cli_hash(option->lng, strlen(option->lng)) & set->mask;
+        while (set->lng[slot]) {
+            if (strcmp(set->lng[slot], option->lng) == 0)
+                return false;
 
-    if (!SLIST_EMPTY(&cli->options)) {
-        size_t max_width = 0;
-        const struct cli_option *o;
+            slot = (slot + 1) & set->mask;
+        }
 
-        fputs("\nOptions:\n", output);
+        set->lng[slot] = option->lng;
+    }
+#endif
 
-        SLIST_FOREACH(o, &cli->options, entry) {
-            size_t width = 0;
+    return true;
+}
 
+static merr_t
+add_options(struct cli *cli, const size_t optionc, struct cli_option * const optionv)
+{
+    size_t i;
+    merr_t err = 0;
+    size_t count = 0;
+    struct cli_option *o;
+    struct cli_option *prev;
+    struct cli_option **sorted;
+    struct option_set set = { 0 };
 #ifndef CLI_NO_GETOPT_LONG
-            if (o->lng)
-                width += strlen(o->lng);
+    size_t lngc = 0;
 #endif
 
-            switch (o->argument) {
-            case CLI_HAS_ARG_NONE:
-                break;
-            case CLI_HAS_ARG_REQUIRED:
-                width += 3;
-                break;
-#ifndef CLI_NO_OPTIONAL_ARGUMENT
-            case CLI_HAS_ARG_OPTIONAL:
-                width += 5;
-                break;
-#endif
-            }
+    if (!cli || !optionv)
+        return merr(EINVAL);
 
-            if (width > max_width)
-                max_width = width;
-        }
+    if (cli->index)
+        return merr(EBUSY);
 
-        SLIST_FOREACH(o, &cli->options, entry) {
-#ifndef CLI_NO_GETOPT_LONG
-            const char *arg_str = "";
+    if (optionc == 0)
+        return 0;
 
-            switch (o->argument) {
-            case CLI_HAS_ARG_NONE:
-                break;
-            case CLI_HAS_ARG_REQUIRED:
-                arg_str = " arg";
-                break;
-#ifndef CLI_NO_OPTIONAL_ARGUMENT
-            case CLI_HAS_ARG_OPTIONAL:
-                arg_str = " (arg)";
-#endif
-            }
-#endif
+    if (optionc == 1)
+        return add_option(cli, optionv);
 
-            fprintf(output, TAB " -%c", o->shrt);
+    for (i = 0; i < optionc; i++) {
+        if (!option_is_valid(optionv + i))
+            return merr(EINVAL);
 #ifndef CLI_NO_GETOPT_LONG
-            if (o->lng)
-                fprintf(output, ", --%s%*s", o->lng, (int)(max_width - strlen(o->lng)), arg_str);
+        if (optionv[i].lng)
+            lngc++;
 #endif
-            if (o->description)
-                fprintf(output, TAB "%s", o->description);
-            fputc('\n', output);
-        }
     }
 
-    if (!SLIST_EMPTY(&cli->subcommands)) {
-        const struct cli *c;
-        size_t max_width = 0;
+#ifndef CLI_NO_GETOPT_LONG
+    SLIST_FOREACH(o, &cli->options, entry) {
+        if (o->lng)
+            lngc++;
+    }
 
-        fputs("\nSubcommands:\n", output);
+    for (set.mask = 1; set.mask < 2 * lngc; set.mask <<= 1)
+        ;
 
-        SLIST_FOREACH(c, &cli->subcommands, entry) {
-            size_t width;
+    sorted = cli_malloc(optionc * sizeof(*sorted) + set.mask * sizeof(*set.lng));
+    if (!sorted)
+        return merr(ENOMEM);
 
-            width = strlen(c->name);
-            if (width > max_width)
-                max_width = width;
-        }
+    set.lng = (const char **)(sorted + optionc);
+    memset(set.lng, 0, set.mask * sizeof(*set.lng));
+    set.mask--;
+#else
+    sorted = cli_malloc(optionc * sizeof(*sorted));
+    if (!sorted)
+        return merr(ENOMEM);
+#endif
 
-        SLIST_FOREACH(c, &cli->subcommands, entry) {
-            fprintf(output, TAB "%-*s", (int)max_width, c->name);
-            if (c->description)
-                fprintf(output, TAB "%s", c->description);
-            fputc('\n', output);
-        }
+    /* An option which is already registered collides with itself. */
+    SLIST_FOREACH(o, &cli->options, entry) {
+        option_set_insert(&set, o);
+        count++;
     }
 
-    if (output == stderr && exit_code)
-        *exit_code = EX_USAGE;
-}
+    if (optionc > (size_t)UINT16_MAX + 1 - count) {
+        err = merr(E2BIG);
+        goto out;
+    }
 
-static bool
-parse_bool(const char * const arg, int * const exit_code, bool * const value)
-{
-    assert(arg);
-    assert(value);
+    for (i = 0; i < optionc; i++) {
+        if (!option_set_insert(&set, optionv + i)) {
+            err = merr(ENOTUNIQ);
+            goto out;
+        }
 
-    if (strcmp(arg, "true") == 0) {
-        *value = true;
-    } else if (strcmp(arg, "false") == 0) {
-        *value = false;
-    } else {
-        if (exit_code)
-            *exit_code = EX_USAGE;
-        return false;
+        sorted[i] = optionv + i;
     }
 
-    return true;
-}
-
-static int
-parse_base(const char * const arg)
-{
-    int base;
+    for (i = 0; i < optionc; i++)
+        optionv[i].ordinal = (uint16_t)(count + i);
 
-    assert(arg);
+    /* Sort the new options once, then merge them into the already sorted list
+     * in a single pass.
+     */
+    qsort(sorted, optionc, sizeof(*sorted), option_cmp);
 
-    if (strstr(arg, "0x") == arg) {
-        base = 16;
-    } else if (strstr(arg, "0o") == arg) {
-        base = 8;
-    } else if (strstr(arg, "0b") == arg) {
-        base = 2;
-    } else {
-        base = 10;
-    }
+    prev = NULL;
+    o = SLIST_FIRST(&cli->options);
+    for (i = 0; i < optionc; i++) {
+        while (o && option_order(o, sorted[i]) < 0) {
+            prev = o;
+            o = SLIST_NEXT(o, entry);
+        }
 
-    return base;
+        if (prev) {
+            SLIST_INSERT_AFTER(prev, sorted[i], entry);
+        } else {
+            SLIST_INSERT_HEAD(&cli->options, sorted[i], entry);
+        }
+
+        prev = sorted[i];
+    }
+
+out:
+    cli_free(sorted);
+
+    return err;
+}
+
+merr_t
+cli_add_options(struct cli *cli, const size_t optionc, struct cli_option * const optionv)
+{
+    merr_t err;
+    const uint64_t start = cli_stats_start();
+
+    err = add_options(cli, optionc, optionv);
+    cli_stats_stop(CLI_STATS_REGISTER, start);
+
+    return err;
+}
+
+static merr_t
+add_constraint(struct cli * const cli, struct cli_constraint * const constraint)
+{
+    size_t n;
+    struct cli_constraint *c;
+    struct cli_constraint *last = NULL;
+
+    if (!cli || !constraint || !constraint->options)
+        return merr(EINVAL);
+
+    if (cli->index)
+        return merr(EBUSY);
+
+    for (n = 0; constraint->options[n]; n++) {
+        const struct cli_option *o;
+
+        SLIST_FOREACH(o, &cli->options, entry) {
+            if (o == constraint->options[n])
+                break;
+        }
+
+        if (!o)
+            return merr(EINVAL);
+    }
+
+    switch (constraint->type) {
+    case CLI_CONSTRAINT_EXCLUSIVE:
+    case CLI_CONSTRAINT_REQUIRES:
+        if (n < 2)
+            return merr(EINVAL);
+        break;
+    case CLI_CONSTRAINT_ONE_OF:
+        if (n < 1)
+            return merr(EINVAL);
+        break;
+    default:
+        return merr(EINVAL);
+    }
+
+    SLIST_FOREACH(c, &cli->constraints, entry) {
+        if (c == constraint)
+            return merr(ENOTUNIQ);
+
+        last = c;
+    }
+
+    /* Keep the order of registration, which is the order of checking. */
+    if (last) {
+        SLIST_INSERT_AFTER(last, constraint, entry);
+    } else {
+        SLIST_INSERT_HEAD(&cli->constraints, constraint, entry);
+    }
+
+    return 0;
+}
+
+merr_t
+cli_add_constraint(struct cli * const cli, struct cli_constraint * const constraint)
+{
+    merr_t err;
+    const uint64_t start = cli_stats_start();
+
+    err = add_constraint(cli, constraint);
+    cli_stats_stop(CLI_STATS_REGISTER, start);
+
+    return err;
+}
+
+static merr_t
+add_subcommand(struct cli *cli, struct cli * const subcommand)
+{
+    struct cli *c;
+    struct cli *prev = NULL;
+
+    if (!cli || !subcommand)
+        return merr(EINVAL);
+
+    if (cli == subcommand)
+        return merr(EINVAL);
+
+    if (cli->index)
+        return merr(EBUSY);
+
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        int rc;
+
+        rc = strcmp(c->name, subcommand->name);
+        if (c == subcommand || rc == 0)
+            return merr(ENOTUNIQ);
+
+        if (rc > 0)
+            break;
+
+        prev = c;
+    }
+
+    if (prev) {
+        SLIST_INSERT_AFTER(prev, subcommand, entry);
+    } else {
+        SLIST_INSERT_HEAD(&cli->subcommands, subcommand, entry);
+    }
+
+    return 0;
+}
+
+merr_t
+cli_add_subcommand(struct cli *cli, struct cli * const subcommand)
+{
+    merr_t err;
+    const uint64_t start = cli_stats_start();
+
+    err = add_subcommand(cli, subcommand);
+    cli_stats_stop(CLI_STATS_REGISTER, start);
+
+    return err;
+}
+
+static int
+subcommand_cmp(const void * const a, const void * const b)
+{
+    const struct cli * const *x = a;
+    const struct cli * const *y = b;
+
+    return strcmp((*x)->name, (*y)->name);
+}
+
+static merr_t
+add_subcommands(struct cli *cli, size_t subcommandc, struct cli * const subcommandv)
+{
+    struct cli *c;
+    size_t i;
+    merr_t err = 0;
+    struct cli *prev;
+    struct cli **sorted;
+
+    if (!cli || !subcommandv)
+        return merr(EINVAL);
+
+    if (cli->index)
+        return merr(EBUSY);
+
+    if (subcommandc == 0)
+        return 0;
+
+    if (subcommandc == 1)
+        return add_subcommand(cli, subcommandv);
+
+    /* Sort the new subcommands once, then merge them into the already sorted
+     * list in a single pass rather than walking the list for each of them.
+     */
+    sorted = cli_malloc(subcommandc * sizeof(*sorted));
+    if (!sorted)
+        return merr(ENOMEM);
+
+    for (i = 0; i < subcommandc; i++) {
+        if (subcommandv + i == cli || !subcommandv[i].name) {
+            err = merr(EINVAL);
+            goto out;
+        }
+
+        sorted[i] = subcommandv + i;
+    }
+
+    qsort(sorted, subcommandc, sizeof(*sorted), subcommand_cmp);
+
+    for (i = 1; i < subcommandc; i++) {
+        if (strcmp(sorted[i - 1]->name, sorted[i]->name) == 0) {
+            err = merr(ENOTUNIQ);
+            goto out;
+        }
+    }
+
+    /* Check for conflicts with the existing subcommands before touching the
+     * list, so that a failure leaves it unchanged.
+     */
+    i = 0;
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        int rc = -1;
+
+        while (i < subcommandc && (rc = strcmp(c->name, sorted[i]->name)) > 0)
+            i++;
+
+        if (i == subcommandc)
+            break;
+
+        if (rc == 0) {
+            err = merr(ENOTUNIQ);
+            goto out;
+        }
+    }
+
+    prev = NULL;
+    c = SLIST_FIRST(&cli->subcommands);
+    for (i = 0; i < subcommandc; i++) {
+        while (c && strcmp(c->name, sorted[i]->name) < 0) {
+            prev = c;
+            c = SLIST_NEXT(c, entry);
+        }
+
+        if (prev) {
+            SLIST_INSERT_AFTER(prev, sorted[i], entry);
+        } else {
+            SLIST_INSERT_HEAD(&cli->subcommands, sorted[i], entry);
+        }
+
+        prev = sorted[i];
+    }
+
+out:
+    cli_free(sorted);
+
+    return err;
+}
+
+merr_t
+cli_add_subcommands(struct cli *cli, size_t subcommandc, struct cli * const subcommandv)
+{
+    merr_t err;
+    const uint64_t start = cli_stats_start();
+
+    err = add_subcommands(cli, subcommandc, subcommandv);
+    cli_stats_stop(CLI_STATS_REGISTER, start);
+
+    return err;
+}
+
+merr_t
+cli_compile(struct cli * const cli)
+{
+    struct cli *c;
+
+    if (!cli)
+        return merr(EINVAL);
+
+    SLIST_FOREACH(c, &cli->subcommands, entry) {
+        merr_t err;
+
+        /* Stubs are compiled once they are loaded. */
+        if (c->loader)
+            continue;
+
+        err = cli_compile(c);
+        if (err) {
+            cli_fini(cli);
+            return err;
+        }
+    }
+
+    if (!cli->index) {
+        merr_t err;
+        struct cli_index *idx;
+
+        err = cli_index_create(cli, CLI_INDEX_ALL, NULL, &idx);
+        if (err)
+            return err;
+
+        /* Publish the index last, as cli_load() takes it to mean that the
+         * whole command is ready.
+         */
+        __atomic_store_n(&cli->index, idx, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
+
+void
+cli_fini(struct cli * const cli)
+{
+    struct cli *c;
+
+    if (!cli)
+        return;
+
+    cli_index_destroy(cli->index, NULL);
+    cli->index = NULL;
+
+    SLIST_FOREACH(c, &cli->subcommands, entry)
+        cli_fini(c);
+
+    /* Forget whatever the loader registered, which may not outlive it. */
+    if (cli->loader) {
+        SLIST_INIT(&cli->options);
+        SLIST_INIT(&cli->subcommands);
+        SLIST_INIT(&cli->arguments);
+        SLIST_INIT(&cli->constraints);
+    }
+}
+
+void
+cli_init(struct cli * const cli)
+{
+    if (!cli)
+        return;
+
+    SLIST_INIT(&cli->options);
+}
+
+static void
+cli_action_help(
+    const struct parse_state * const ps,
+    const struct cli * const cli,
+    int * const exit_code,
+    const bool usage)
+{
+    FILE *output;
+    const uint64_t start = cli_stats_start();
+
+    assert(ps);
+    assert(cli);
+
+    output = usage ? ps->err : ps->out;
+
+    /* Compiled trees render their help once, ahead of time. */
+    if (cli->index && cli->index->help) {
+        cli_help_emit(output, ps->program, cli->index->help, cli->index->help_sz);
+    } else {
+        char *text;
+        char stack[4096];
+        size_t len;
+
+        len = cli_help_render(cli, stack, sizeof(stack));
+        text = len > sizeof(stack) ? cli_malloc(len) : stack;
+        if (text) {
+            if (text != stack)
+                cli_help_render(cli, text, len);
+            cli_help_emit(output, ps->program, text, len);
+            if (text != stack)
+                cli_free(text);
+        }
+    }
+
+    cli_stats_stop(CLI_STATS_HELP, start);
+
+    if (usage && exit_code)
+        *exit_code = EX_USAGE;
+}
+
+static bool
+parse_bool(const char * const arg, int * const exit_code, bool * const value)
+{
+    assert(arg);
+    assert(value);
+
+    if (strcmp(arg, "true") == 0) {
+        *value = true;
+    } else if (strcmp(arg, "false") == 0) {
+        *value = false;
+    } else {
+        if (exit_code)
+            *exit_code = EX_USAGE;
+        return false;
+    }
+
+    return true;
 }
 
 static bool
@@ -400,16 +869,10 @@ parse_uint(
     const unsigned long long max,
     unsigned long long * const value)
 {
-    int base;
-
     assert(arg);
     assert(value);
 
-    base = parse_base(arg);
-
-    errno = 0;
-    *value = strtoull(arg + (base == 10 ? 0 : 2), NULL, base);
-    if (errno == ERANGE || *value > max) {
+    if (cli_convert_uint(arg, max, value)) {
         if (exit_code)
             *exit_code = EX_USAGE;
         return false;
@@ -426,16 +889,40 @@ parse_int(
     const long long max,
     long long * const value)
 {
-    int base;
+    assert(arg);
+    assert(value);
+
+    if (cli_convert_int(arg, min, max, value)) {
+        if (exit_code)
+            *exit_code = EX_USAGE;
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+parse_float(
+    const char * const arg,
+    int * const exit_code,
+    const enum cli_type type,
+    void * const value)
+{
+    merr_t err;
 
     assert(arg);
     assert(value);
 
-    base = parse_base(arg);
+    if (type == CLI_TYPE_FLOAT) {
+        err = cli_convert_float(arg, value);
+    } else if (type == CLI_TYPE_DOUBLE) {
+        err = cli_convert_double(arg, value);
+    } else {
+        assert(type == CLI_TYPE_LONGDOUBLE);
+        err = cli_convert_long_double(arg, value);
+    }
 
-    errno = 0;
-    *value = strtoll(arg + (base == 10 ? 0 : 2), NULL, base);
-    if (errno == ERANGE || *value < min || *value > max) {
+    if (err) {
         if (exit_code)
             *exit_code = EX_USAGE;
         return false;
@@ -444,11 +931,11 @@ parse_int(
     return true;
 }
 
-static void
+bool
 cli_action_store(
-    const struct cli * const cli,
     int * const exit_code,
-    const struct cli_option * const option,
+    const enum cli_type type,
+    void * const data,
     const char *arg)
 {
     union {
@@ -459,148 +946,154 @@ cli_action_store(
         long double ld;
     } value;
 
-    (void)cli;
-
-    assert(cli);
-    assert(option);
+    assert(data);
 
-    switch (option->type) {
+    switch (type) {
     case CLI_TYPE_BOOL:
         if (arg) {
-            if (!parse_bool(arg, exit_code, option->data))
-                return;
+            if (!parse_bool(arg, exit_code, data))
+                return false;
         } else {
-            *(bool *)option->data = true;
+            *(bool *)data = true;
         }
         break;
     case CLI_TYPE_UCHAR:
         if (!parse_uint(arg, exit_code, UCHAR_MAX, &value.u))
-            return;
-        *(unsigned char *)option->data = (unsigned char)value.u;
+            return false;
+        *(unsigned char *)data = (unsigned char)value.u;
         break;
     case CLI_TYPE_USHORT:
         if (!parse_uint(arg, exit_code, USHRT_MAX, &value.u))
-            return;
-        *(unsigned short *)option->data = (unsigned short)value.u;
+            return false;
+        *(unsigned short *)data = (unsigned short)value.u;
         break;
     case CLI_TYPE_UINT:
         if (!parse_uint(arg, exit_code, UINT_MAX, &value.u))
-            return;
-        *(unsigned int *)option->data = (unsigned int)value.u;
+            return false;
+        *(unsigned int *)data = (unsigned int)value.u;
         break;
     case CLI_TYPE_ULONG:
         if (!parse_uint(arg, exit_code, ULONG_MAX, &value.u))
-            return;
-        *(unsigned long *)option->data = value.u;
+            return false;
+        *(unsigned long *)data = value.u;
         break;
     case CLI_TYPE_ULONGLONG:
         if (!parse_uint(arg, exit_code, ULLONG_MAX, &value.u))
-            return;
-        *(unsigned long long *)option->data = value.u;
+            return false;
+        *(unsigned long long *)data = value.u;
         break;
     case CLI_TYPE_U8:
         if (!parse_uint(arg, exit_code, UINT8_MAX, &value.u))
-            return;
-        *(uint8_t *)option->data = (uint8_t)value.u;
+            return false;
+        *(uint8_t *)data = (uint8_t)value.u;
         break;
     case CLI_TYPE_U16:
         if (!parse_uint(arg, exit_code, UINT16_MAX, &value.u))
-            return;
-        *(uint16_t *)option->data = (uint16_t)value.u;
+            return false;
+        *(uint16_t *)data = (uint16_t)value.u;
         break;
     case CLI_TYPE_U32:
         if (!parse_uint(arg, exit_code, UINT32_MAX, &value.u))
-            return;
-        *(uint32_t *)option->data = (uint32_t)value.u;
+            return false;
+        *(uint32_t *)data = (uint32_t)value.u;
         break;
     case CLI_TYPE_U64:
         if (!parse_uint(arg, exit_code, UINT64_MAX, &value.u))
-            return;
-        *(uint64_t *)option->data = value.u;
+            return false;
+        *(uint64_t *)data = value.u;
         break;
     case CLI_TYPE_CHAR:
         if (!parse_int(arg, exit_code, CHAR_MIN, CHAR_MAX, &value.s))
-            return;
-        *(char *)option->data = (char)value.s;
+            return false;
+        *(char *)data = (char)value.s;
         break;
     case CLI_TYPE_SHORT:
         if (!parse_int(arg, exit_code, SHRT_MIN, SHRT_MAX, &value.s))
-            return;
-        *(short *)option->data = (short)value.s;
+            return false;
+        *(short *)data = (short)value.s;
         break;
     case CLI_TYPE_INT:
         if (!parse_int(arg, exit_code, INT_MIN, INT_MAX, &value.s))
-            return;
-        *(int *)option->data = (int)value.s;
+            return false;
+        *(int *)data = (int)value.s;
         break;
     case CLI_TYPE_LONG:
         if (!parse_int(arg, exit_code, LONG_MIN, LONG_MAX, &value.s))
-            return;
-        *(long *)option->data = value.s;
+            return false;
+        *(long *)data = value.s;
         break;
     case CLI_TYPE_LONGLONG:
         if (!parse_int(arg, exit_code, LLONG_MIN, LLONG_MAX, &value.s))
-            return;
-        *(long long *)option->data = value.s;
+            return false;
+        *(long long *)data = value.s;
         break;
     case CLI_TYPE_I8:
         if (!parse_int(arg, exit_code, INT8_MIN, INT8_MAX, &value.s))
-            return;
-        *(int8_t *)option->data = (int8_t)value.s;
+            return false;
+        *(int8_t *)data = (int8_t)value.s;
         break;
     case CLI_TYPE_I16:
         if (!parse_int(arg, exit_code, INT16_MIN, INT16_MAX, &value.s))
-            return;
-        *(int16_t *)option->data = (int16_t)value.s;
+            return false;
+        *(int16_t *)data = (int16_t)value.s;
         break;
     case CLI_TYPE_I32:
         if (!parse_int(arg, exit_code, INT32_MIN, INT32_MAX, &value.s))
-            return;
-        *(int32_t *)option->data = (int32_t)value.s;
+            return false;
+        *(int32_t *)data = (int32_t)value.s;
         break;
     case CLI_TYPE_I64:
         if (!parse_int(arg, exit_code, INT64_MIN, INT64_MAX, &value.s))
-            return;
-        *(int64_t *)option->data = (int64_t)value.s;
+            return false;
+        *(int64_t *)data = (int64_t)value.s;
         break;
     case CLI_TYPE_FLOAT:
-        value.f = strtof(arg, NULL);
-        if (errno == ERANGE) {
-            if (exit_code)
-                *exit_code = EX_USAGE;
-            return;
-        }
-        *(float *)option->data = value.f;
-        break;
     case CLI_TYPE_DOUBLE:
-        value.d = strtod(arg, NULL);
-        if (errno == ERANGE) {
-            if (exit_code)
-                *exit_code = EX_USAGE;
-            return;
-        }
-        *(double *)option->data = value.d;
-        break;
     case CLI_TYPE_LONGDOUBLE:
-        value.ld = strtold(arg, NULL);
-        if (errno == ERANGE) {
-            if (exit_code)
-                *exit_code = EX_USAGE;
-            return;
-        }
-        *(long double *)option->data = value.ld;
+        if (!parse_float(arg, exit_code, type, data))
+            return false;
         break;
     case CLI_TYPE_STRING:
-        *(const char **)option->data = arg;
+        *(const char **)data = arg;
         break;
+    case CLI_TYPE_CHOICE:
+        /* Resolved by cli_action_store_option(). */
+        return false;
     }
+
+    return true;
 }
 
-static merr_t
-cli_action_accumulate(
-    const struct cli * const cli,
+bool
+cli_action_store_option(
+    const struct cli_index * const idx,
     int * const exit_code,
     const struct cli_option * const option,
+    void * const data,
+    const char * const arg)
+{
+    int choice;
+
+    if (option->type != CLI_TYPE_CHOICE)
+        return cli_action_store(exit_code, option->type, data, arg);
+
+    choice = cli_index_find_choice(idx, option, arg);
+    if (choice < 0) {
+        if (exit_code)
+            *exit_code = EX_USAGE;
+        return false;
+    }
+
+    *(int *)data = choice;
+
+    return true;
+}
+
+static bool
+cli_action_accumulate(
+    int * const exit_code,
+    const enum cli_type type,
+    void * const data,
     const char * const arg)
 {
     union {
@@ -611,326 +1104,1060 @@ cli_action_accumulate(
         long double ld;
     } value = { 1 };
 
-    (void)cli;
-
-    assert(cli);
-    assert(option);
+    assert(data);
 
-    switch (option->type) {
+    switch (type) {
     case CLI_TYPE_BOOL:
-        *(bool *)option->data ^= true;
+        *(bool *)data ^= true;
         break;
     case CLI_TYPE_UCHAR:
         if (arg) {
             if (!parse_uint(arg, exit_code, UCHAR_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(unsigned char *)option->data += (unsigned char)value.u;
+        *(unsigned char *)data += (unsigned char)value.u;
         break;
     case CLI_TYPE_USHORT:
         if (arg) {
             if (!parse_uint(arg, exit_code, USHRT_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(unsigned short *)option->data += (unsigned short)value.u;
+        *(unsigned short *)data += (unsigned short)value.u;
         break;
     case CLI_TYPE_UINT:
         if (arg) {
             if (!parse_uint(arg, exit_code, UINT_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(unsigned int *)option->data += (unsigned int)value.u;
+        *(unsigned int *)data += (unsigned int)value.u;
         break;
     case CLI_TYPE_ULONG:
         if (arg) {
             if (!parse_uint(arg, exit_code, ULONG_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(unsigned long *)option->data += value.u;
+        *(unsigned long *)data += value.u;
         break;
     case CLI_TYPE_ULONGLONG:
         if (arg) {
             if (!parse_uint(arg, exit_code, ULLONG_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(unsigned long long *)option->data += value.u;
+        *(unsigned long long *)data += value.u;
         break;
     case CLI_TYPE_U8:
         if (arg) {
             if (!parse_uint(arg, exit_code, UINT8_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(uint8_t *)option->data += (uint8_t)value.u;
+        *(uint8_t *)data += (uint8_t)value.u;
         break;
     case CLI_TYPE_U16:
         if (arg) {
             if (!parse_uint(arg, exit_code, UINT16_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(uint16_t *)option->data += (uint16_t)value.u;
+        *(uint16_t *)data += (uint16_t)value.u;
         break;
     case CLI_TYPE_U32:
         if (arg) {
             if (!parse_uint(arg, exit_code, UINT32_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(uint32_t *)option->data += (uint32_t)value.u;
+        *(uint32_t *)data += (uint32_t)value.u;
         break;
     case CLI_TYPE_U64:
         if (arg) {
             if (!parse_uint(arg, exit_code, UINT64_MAX, &value.u))
-                return 0;
+                return false;
         }
-        *(uint64_t *)option->data += (uint64_t)value.u;
+        *(uint64_t *)data += (uint64_t)value.u;
         break;
     case CLI_TYPE_CHAR:
         if (arg) {
             if (!parse_int(arg, exit_code, CHAR_MIN, CHAR_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(char *)option->data += (char)value.s;
+        *(char *)data += (char)value.s;
         break;
     case CLI_TYPE_SHORT:
         if (arg) {
             if (!parse_int(arg, exit_code, SHRT_MIN, SHRT_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(short *)option->data += (short)value.s;
+        *(short *)data += (short)value.s;
         break;
     case CLI_TYPE_INT:
         if (arg) {
             if (!parse_int(arg, exit_code, INT_MIN, INT_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(int *)option->data += (int)value.s;
+        *(int *)data += (int)value.s;
         break;
     case CLI_TYPE_LONG:
         if (arg) {
             if (!parse_int(arg, exit_code, LONG_MIN, LONG_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(long *)option->data += value.s;
+        *(long *)data += value.s;
         break;
     case CLI_TYPE_LONGLONG:
         if (arg) {
             if (!parse_int(arg, exit_code, LLONG_MIN, LLONG_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(long long *)option->data += value.s;
+        *(long long *)data += value.s;
         break;
     case CLI_TYPE_I8:
         if (arg) {
             if (!parse_int(arg, exit_code, INT8_MIN, INT8_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(int8_t *)option->data += (int8_t)value.s;
+        *(int8_t *)data += (int8_t)value.s;
         break;
     case CLI_TYPE_I16:
         if (arg) {
             if (!parse_int(arg, exit_code, INT16_MIN, INT16_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(int16_t *)option->data += (int16_t)value.s;
+        *(int16_t *)data += (int16_t)value.s;
         break;
     case CLI_TYPE_I32:
         if (arg) {
             if (!parse_int(arg, exit_code, INT32_MIN, INT32_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(int32_t *)option->data += (int32_t)value.s;
+        *(int32_t *)data += (int32_t)value.s;
         break;
     case CLI_TYPE_I64:
         if (arg) {
             if (!parse_int(arg, exit_code, INT64_MIN, INT64_MAX, &value.s))
-                return 0;
+                return false;
         }
-        *(int64_t *)option->data += (int64_t)value.s;
+        *(int64_t *)data += (int64_t)value.s;
         break;
     case CLI_TYPE_FLOAT:
+        value.f = 1;
         if (arg) {
-            value.f = strtof(arg, NULL);
-            if (errno == ERANGE) {
-                if (exit_code)
-                    *exit_code = EX_USAGE;
-                return 0;
-            }
+            if (!parse_float(arg, exit_code, type, &value.f))
+                return false;
         }
-        *(float *)option->data += 1;
+        *(float *)data += value.f;
         break;
     case CLI_TYPE_DOUBLE:
+        value.d = 1;
         if (arg) {
-            value.d = strtod(arg, NULL);
-            if (errno == ERANGE) {
-                if (exit_code)
-                    *exit_code = EX_USAGE;
+            if (!parse_float(arg, exit_code, type, &value.d))
+                return false;
+        }
+        *(double *)data += value.d;
+        break;
+    case CLI_TYPE_LONGDOUBLE:
+        value.ld = 1;
+        if (arg) {
+            if (!parse_float(arg, exit_code, type, &value.ld))
+                return false;
+        }
+        *(long double *)data += value.ld;
+        break;
+    case CLI_TYPE_STRING:
+    case CLI_TYPE_CHOICE:
+        /* Rejected by cli_dispatch(). */
+        return false;
+    }
+
+    return true;
+}
+
+static merr_t
+cli_action_append(
+    const struct cli_index * const idx,
+    int * const exit_code,
+    const struct cli_option * const option,
+    struct cli_list * const list,
+    const char * const arg,
+    bool * const valid)
+{
+    merr_t err;
+    size_t len, n;
+    char *fields;
+    char stack[256];
+    const size_t count = list->count;
+    void * const strings = list->strings;
+    const size_t size = cli_type_size(option->type);
+
+    assert(option);
+    assert(list);
+    assert(arg);
+    assert(valid);
+
+    if (!option->delimiter) {
+        err = cli_list_reserve(list, 1, size);
+        if (err)
+            return err;
+
+        *valid = cli_action_store_option(
+            idx, exit_code, option, (char *)list->items + count * size, arg);
+        if (*valid)
+            list->count++;
+
+        return 0;
+    }
+
+    /* Split a copy, since argv may not be writable. Strings keep theirs. */
+    len = strlen(arg);
+    if (option->type == CLI_TYPE_STRING) {
+        fields = cli_list_strdup(list, arg, len);
+    } else if (len < sizeof(stack)) {
+        fields = stack;
+        memcpy(fields, arg, len + 1);
+    } else {
+        fields = cli_malloc(len + 1);
+        if (fields)
+            memcpy(fields, arg, len + 1);
+    }
+    if (!fields)
+        return merr(ENOMEM);
+
+    n = cli_split(fields, len, option->delimiter);
+
+    err = cli_list_reserve(list, n, size);
+    if (err)
+        goto out;
+
+    for (const char *f = fields; n > 0; n--) {
+        *valid = cli_action_store_option(
+            idx, exit_code, option, (char *)list->items + list->count * size, f);
+        if (!*valid) {
+            cli_list_truncate(list, count, strings);
+            break;
+        }
+
+        list->count++;
+        f += strlen(f) + 1;
+    }
+
+out:
+    if (err && option->type == CLI_TYPE_STRING)
+        cli_list_truncate(list, count, strings);
+    if (option->type != CLI_TYPE_STRING && fields != stack)
+        cli_free(fields);
+
+    return err;
+}
+
+static merr_t
+cli_dispatch(
+    const struct parse_state * const ps,
+    const struct cli * const cli,
+    int * const exit_code,
+    const struct cli_option * const option,
+    const char * const arg,
+    bool * const stop)
+{
+    merr_t err;
+    void *data;
+    uint64_t start;
+    bool valid = true;
+
+    assert(ps);
+    assert(cli);
+    assert(option);
+    assert(stop);
+
+    /* Relative option data lets each parse store into its own structure. */
+    data = cli_resolve_data(option->data, ps->parser->data);
+
+    switch (option->action) {
+    case CLI_ACTION_HELP:
+        cli_action_help(ps, cli, exit_code, false);
+        break;
+    case CLI_ACTION_STORE:
+        switch (option->argument) {
+        case CLI_HAS_ARG_NONE:
+            *stop = true;
+            return merr(EINVAL);
+#ifndef CLI_NO_OPTIONAL_ARGUMENT
+        case CLI_HAS_ARG_OPTIONAL:
+#endif
+        case CLI_HAS_ARG_REQUIRED:
+            if (!arg) {
+                cli_action_help(ps, cli, exit_code, true);
+                *stop = true;
                 return 0;
             }
+            start = cli_stats_start();
+            valid = cli_action_store_option(cli->index, exit_code, option, data, arg);
+            cli_stats_stop(CLI_STATS_CONVERT, start);
         }
-        *(double *)option->data += 1;
         break;
-    case CLI_TYPE_LONGDOUBLE:
-        if (arg) {
-            value.ld = strtold(arg, NULL);
-            if (errno == ERANGE) {
-                if (exit_code)
-                    *exit_code = EX_USAGE;
+    case CLI_ACTION_ACCUMULATE:
+        if (option->type == CLI_TYPE_STRING || option->type == CLI_TYPE_CHOICE) {
+            *stop = true;
+            return merr(EINVAL);
+        }
+        start = cli_stats_start();
+        valid = cli_action_accumulate(exit_code, option->type, data, arg);
+        cli_stats_stop(CLI_STATS_CONVERT, start);
+        break;
+    case CLI_ACTION_APPEND:
+        switch (option->argument) {
+        case CLI_HAS_ARG_NONE:
+            *stop = true;
+            return merr(EINVAL);
+#ifndef CLI_NO_OPTIONAL_ARGUMENT
+        case CLI_HAS_ARG_OPTIONAL:
+#endif
+        case CLI_HAS_ARG_REQUIRED:
+            if (!arg) {
+                cli_action_help(ps, cli, exit_code, true);
+                *stop = true;
                 return 0;
             }
+            start = cli_stats_start();
+            err = cli_action_append(cli->index, exit_code, option, data, arg, &valid);
+            cli_stats_stop(CLI_STATS_CONVERT, start);
+            if (err) {
+                *stop = true;
+                return err;
+            }
         }
-        *(long double *)option->data += 1;
         break;
-    case CLI_TYPE_STRING:
-        return merr(EINVAL);
+    }
+
+    if (!valid) {
+        if (option->shrt) {
+            parse_error(ps, "Invalid value for option '-%c': '%s'", option->shrt, arg);
+        } else {
+#ifndef CLI_NO_GETOPT_LONG
+            parse_error(ps, "Invalid value for option '--%s': '%s'", option->lng, arg);
+#endif
+        }
+
+        if (option->type == CLI_TYPE_CHOICE && !option->delimiter) {
+            struct cli_suggestions sg;
+
+            cli_suggestions_init(&sg, arg, strlen(arg));
+            for (size_t i = 0; option->choices[i]; i++)
+                cli_suggestions_add(&sg, option->choices[i]);
+            parse_suggest(ps, &sg, "");
+        }
+
+        cli_action_help(ps, cli, exit_code, true);
+        *stop = true;
     }
 
     return 0;
 }
 
-merr_t
-cli_parse(const struct cli * const cli, const int argc, char * const * const argv, int *exit_code)
+/* Pick out the config values which name options of this command. Nothing is
+ * converted until the command line has had its say.
+ */
+static merr_t
+parse_defaults(
+    struct parse_state * const ps,
+    const struct cli_index * const idx,
+    struct parse_default ** const defaults,
+    size_t * const count)
 {
-    int c;
-    void *buf;
-    size_t buf_sz;
-    merr_t err = 0;
-    size_t optionc;
-    char *shortopts, *ptr;
-    const struct cli_option *option;
 #ifndef CLI_NO_GETOPT_LONG
-    struct option *longopts;
+    size_t sectionc;
+    const struct cli_config_section *section;
 #endif
 
-    if (!cli)
-        return merr(EINVAL);
+    assert(ps);
+    assert(idx);
+    assert(defaults);
+    assert(count);
 
-    if (!cli_program_name)
-        cli_set_program_name(argv[0]);
+    *defaults = NULL;
+    *count = 0;
 
-    optionc = cli_get_num_options(cli);
-    buf_sz = (3 * optionc + 3) * sizeof(*shortopts);
 #ifndef CLI_NO_GETOPT_LONG
-    buf_sz += (optionc + 1) * sizeof(*longopts);
-#endif
-    buf = calloc(1, buf_sz);
-    if (!buf)
+    if (!ps->parser->config || idx->lngc == 0)
+        return 0;
+
+    section = cli_config_find_section(ps->parser->config, ps->path, &sectionc);
+    if (!section)
+        return 0;
+
+    /* Each option has at most one default, which bounds the allocation no
+     * matter how large the section is.
+     */
+    *defaults = cli_arena_alloc(&ps->arena, idx->lngc * sizeof(**defaults));
+    if (!*defaults)
         return merr(ENOMEM);
 
-    shortopts = ptr = buf;
-#ifndef CLI_NO_GETOPT_LONG
-    longopts = (void *)(shortopts + (3 * optionc + 3));
+    for (const struct cli_config_section *s = section; s < section + sectionc; s++) {
+        for (size_t j = 0; j < s->count; j++) {
+            const struct cli_config_entry * const entry = &ps->parser->config->entryv[s->first + j];
+            const struct cli_option *option;
+            size_t k;
+
+            option = cli_index_find_long_exact(idx, entry->key, entry->key_len);
+            if (!option || option->action == CLI_ACTION_HELP)
+                continue;
+
+            /* Like a repeated assignment, the last one wins. */
+            for (k = 0; k < *count && (*defaults)[k].option != option; k++)
+                ;
+            (*defaults)[k].option = option;
+            (*defaults)[k].value = entry->value;
+            if (k == *count)
+                (*count)++;
+        }
+    }
 #endif
-    *(ptr++) = '+';
-    *(ptr++) = ':';
 
-    option = SLIST_FIRST(&cli->options);
-    for (size_t i = 0; i < optionc; i++, option = SLIST_NEXT(option, entry)) {
-#ifndef CLI_NO_GETOPT_LONG
-        struct option *longopt;
+    return 0;
+}
+
+static void
+parse_defaults_drop(
+    struct parse_default * const defaults,
+    const size_t count,
+    const struct cli_option * const option)
+{
+    for (size_t j = 0; j < count; j++) {
+        if (defaults[j].option == option)
+            defaults[j].option = NULL;
+    }
+}
 
-        longopt = longopts + i;
+static merr_t
+parse_defaults_apply(
+    const struct parse_state * const ps,
+    const struct cli * const cli,
+    int * const exit_code,
+    const struct parse_default * const defaults,
+    const size_t count,
+    bool * const stop)
+{
+    for (size_t j = 0; j < count; j++) {
+        merr_t err;
+        const struct cli_option *option = defaults[j].option;
+        struct cli_option store;
 
-        longopt->val = option->shrt;
-        longopt->name = option->lng;
-        longopt->flag = NULL;
-#endif
+        if (!option)
+            continue;
 
-        *(ptr++) = option->shrt;
+        /* A count or toggle in a config file is its final value rather than
+         * a step, so "verbose = 2" means the same as -vv.
+         */
+        if (option->action == CLI_ACTION_ACCUMULATE) {
+            store = *option;
+            store.action = CLI_ACTION_STORE;
+            store.argument = CLI_HAS_ARG_REQUIRED;
+            option = &store;
+        }
 
-        switch (option->argument) {
-        case CLI_HAS_ARG_NONE:
-            break;
-        case CLI_HAS_ARG_REQUIRED:
-            *(ptr++) = ':';
+        err = cli_dispatch(ps, cli, exit_code, option, defaults[j].value, stop);
+        if (err || *stop)
+            return err;
+    }
+
+    return 0;
+}
+
+static void
+print_option(FILE * const stream, const struct cli_option * const option)
+{
 #ifndef CLI_NO_GETOPT_LONG
-            longopt->has_arg = required_argument;
+    if (!option->shrt) {
+        fprintf(stream, "'--%s'", option->lng);
+        return;
+    }
 #endif
+
+    fprintf(stream, "'-%c'", option->shrt);
+}
+
+/* Checks every constraint of the command against the options it was given,
+ * a few words of bitset at a time.
+ */
+static bool
+parse_constraints(
+    const struct parse_state * const ps,
+    const struct cli_index * const idx,
+    const struct cli_result_node * const node)
+{
+    const size_t words = cli_result_words(idx->optionc);
+
+    for (size_t c = 0; c < idx->constraintc; c++) {
+        const struct cli_constraint * const constraint = idx->constraintv[c];
+        const struct cli_option * const * const options = constraint->options;
+        const uint64_t * const mask = idx->constraintm + c * words;
+        const struct cli_option *first = NULL;
+        size_t given = 0;
+        size_t total = 0;
+
+        for (size_t w = 0; w < words; w++) {
+            given += cli_result_popcount(node->seen[w] & mask[w]);
+            total += cli_result_popcount(mask[w]);
+        }
+
+        switch (constraint->type) {
+        case CLI_CONSTRAINT_EXCLUSIVE:
+            if (given <= 1)
+                continue;
+
+            flockfile(ps->err);
+            fprintf(ps->err, "%s: Options ", ps->program_short);
+            for (size_t j = 0; options[j]; j++) {
+                if (!cli_result_test(node, options[j]))
+                    continue;
+
+                if (first) {
+                    print_option(ps->err, first);
+                    fputs(" and ", ps->err);
+                    print_option(ps->err, options[j]);
+                    break;
+                }
+
+                first = options[j];
+            }
+            fputs(" are mutually exclusive\n", ps->err);
+            funlockfile(ps->err);
             break;
-        case CLI_HAS_ARG_OPTIONAL:
-            *(ptr++) = ':';
-            *(ptr++) = ':';
-#ifndef CLI_NO_GETOPT_LONG
-            longopt->has_arg = optional_argument;
-#endif
+        case CLI_CONSTRAINT_REQUIRES:
+            if (given == total || !cli_result_test(node, options[0]))
+                continue;
+
+            flockfile(ps->err);
+            fprintf(ps->err, "%s: Option ", ps->program_short);
+            print_option(ps->err, options[0]);
+            fputs(" requires ", ps->err);
+            for (size_t j = 1; options[j]; j++) {
+                if (!cli_result_test(node, options[j])) {
+                    print_option(ps->err, options[j]);
+                    break;
+                }
+            }
+            fputc('\n', ps->err);
+            funlockfile(ps->err);
+            break;
+        case CLI_CONSTRAINT_ONE_OF:
+            if (given > 0)
+                continue;
+
+            flockfile(ps->err);
+            fprintf(ps->err, "%s: One of these options is required: ", ps->program_short);
+            for (size_t j = 0; options[j]; j++) {
+                fputs(j == 0 ? "" : options[j + 1] ? ", " : " or ", ps->err);
+                print_option(ps->err, options[j]);
+            }
+            fputc('\n', ps->err);
+            funlockfile(ps->err);
             break;
         }
+
+        return false;
+    }
+
+    return true;
+}
+
+/* Where this level of the parse records the options it sees. Without a
+ * result to fill, only constraints need a bitset, which fits on the stack for
+ * all but the largest commands.
+ */
+static merr_t
+parse_track(
+    struct parse_state * const ps,
+    const struct cli * const cli,
+    const struct cli_index * const idx,
+    struct cli_result_node * const local,
+    uint64_t * const stack,
+    const size_t stackc,
+    struct cli_result_node ** const node)
+{
+    const size_t words = cli_result_words(idx->optionc);
+
+    *node = NULL;
+
+    if (ps->parser->result)
+        return cli_result_push(ps->parser->result, cli, idx->optionc, node);
+
+    if (idx->constraintc == 0)
+        return 0;
+
+    memset(local, 0, sizeof(*local));
+    local->cli = cli;
+    local->optionc = idx->optionc;
+    if (words <= stackc) {
+        memset(stack, 0, words * sizeof(*stack));
+        local->seen = stack;
+    } else {
+        local->seen = cli_arena_calloc(&ps->arena, words, sizeof(*local->seen));
+        if (!local->seen)
+            return merr(ENOMEM);
+    }
+
+    *node = local;
+
+    return 0;
+}
+
+static merr_t
+parse(
+    struct parse_state * const ps,
+    const struct cli * const cli,
+    const int argc,
+    char * const * const argv,
+    int * const exit_code)
+{
+    int i;
+    merr_t err = 0;
+    bool stop = false;
+    const struct cli_index *idx;
+    const struct cli *subcommand;
+    const struct cli_argument *argument;
+    struct cli_index *transient = NULL;
+    struct parse_default *defaults = NULL;
+    size_t defaultc = 0;
+    uint64_t seen[4];
+    struct cli_result_node local;
+    struct cli_result_node *node = NULL;
+    const size_t arena_mark = ps->arena.used;
+
+    assert(ps);
+    assert(cli);
+
+    err = cli_load(cli);
+    if (err)
+        return err;
+
+    /* Trees which were not compiled ahead of time get a throwaway index for
+     * the duration of this level of the parse.
+     */
+    idx = cli->index;
+    if (!idx) {
+        err = cli_index_create(cli, CLI_INDEX_OPTIONS, &ps->arena, &transient);
+        if (err)
+            return err;
+
+        idx = transient;
     }
 
+    err = parse_defaults(ps, idx, &defaults, &defaultc);
+    if (err)
+        goto out;
+
+    err = parse_track(ps, cli, idx, &local, seen, NELEM(seen), &node);
+    if (err)
+        goto out;
+
+    for (i = 1; i < argc;) {
+        const char *arg = argv[i];
+        const int position = ps->offset + i;
+        const struct cli_option *option;
+
+        /* Like getopt(3) with a leading '+', stop at the first non-option. */
+        if (arg[0] != '-' || arg[1] == '\0')
+            break;
+
+        i++;
+
+        if (arg[1] == '-') {
 #ifndef CLI_NO_GETOPT_LONG
-    while ((c = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1) {
-#else
-    while ((c = getopt(argc, argv, shortopts)) != -1) {
+            size_t name_len;
+            const char *eq;
+            bool ambiguous = false;
+            const char *value = NULL;
+            const char *name = arg + 2;
 #endif
-        switch (c) {
-        case ':':
-            cli_error("Missing argument for option: '-%c'", optopt);
-            cli_action_help(cli, exit_code, stderr);
-            goto out;
-        case '?':
-            cli_error("Invalid option: '-%c'", optopt);
-            cli_action_help(cli, exit_code, stderr);
-            goto out;
-        default:
-            option = cli_get_option(cli, c);
 
-            switch (option->action) {
-            case CLI_ACTION_HELP:
-                cli_action_help(cli, exit_code, stdout);
+            if (arg[2] == '\0')
                 break;
-            case CLI_ACTION_STORE:
-                switch (option->argument) {
-                case CLI_HAS_ARG_NONE:
-                    err = merr(EINVAL);
+
+#ifndef CLI_NO_GETOPT_LONG
+            eq = strchr(name, '=');
+            name_len = eq ? (size_t)(eq - name) : strlen(name);
+
+            option = name_len > 0 ? cli_index_find_long(idx, name, name_len, &ambiguous) : NULL;
+            if (!option) {
+                if (ambiguous) {
+                    parse_error(ps, "Ambiguous option: '--%.*s'", (int)name_len, name);
+                    parse_candidates(ps, idx, name, name_len);
+                } else {
+                    struct cli_suggestions sg;
+
+                    parse_error(ps, "Invalid option: '--%.*s'", (int)name_len, name);
+
+                    cli_suggestions_init(&sg, name, name_len);
+                    for (size_t j = 0; j < idx->lngc; j++)
+                        cli_suggestions_add(&sg, idx->lngv[j]->lng);
+                    parse_suggest(ps, &sg, "--");
+                }
+                cli_action_help(ps, cli, exit_code, true);
+                goto out;
+            }
+
+            if (eq) {
+                if (option->argument == CLI_HAS_ARG_NONE) {
+                    parse_error(ps, "Option does not take an argument: '--%s'", option->lng);
+                    cli_action_help(ps, cli, exit_code, true);
+                    goto out;
+                }
+
+                value = eq + 1;
+            } else if (option->argument == CLI_HAS_ARG_REQUIRED) {
+                if (i == argc) {
+                    parse_error(ps, "Missing argument for option: '--%s'", option->lng);
+                    cli_action_help(ps, cli, exit_code, true);
                     goto out;
-                case CLI_HAS_ARG_OPTIONAL:
-                case CLI_HAS_ARG_REQUIRED:
-                    if (!optarg) {
-                        cli_action_help(cli, exit_code, stderr);
+                }
+
+                value = argv[i++];
+            }
+
+            if (node)
+                cli_result_mark(node, option, position);
+            parse_defaults_drop(defaults, defaultc, option);
+
+            err = cli_dispatch(ps, cli, exit_code, option, value, &stop);
+            if (err || stop)
+                goto out;
+
+            continue;
+#else
+            parse_error(ps, "Invalid option: '%s'", arg);
+            cli_action_help(ps, cli, exit_code, true);
+            goto out;
+#endif
+        }
+
+        for (const char *p = arg + 1; *p != '\0'; p++) {
+            const char *value = NULL;
+
+            option = cli_index_find_short(idx, *p);
+            if (!option) {
+                parse_error(ps, "Invalid option: '-%c'", *p);
+                cli_action_help(ps, cli, exit_code, true);
+                goto out;
+            }
+
+            if (option->argument != CLI_HAS_ARG_NONE) {
+                if (p[1] != '\0') {
+                    value = p + 1;
+                } else if (option->argument == CLI_HAS_ARG_REQUIRED) {
+                    if (i == argc) {
+                        parse_error(ps, "Missing argument for option: '-%c'", *p);
+                        cli_action_help(ps, cli, exit_code, true);
                         goto out;
                     }
-                    cli_action_store(cli, exit_code, option, optarg);
+
+                    value = argv[i++];
                 }
-                break;
-            case CLI_ACTION_ACCUMULATE:
-                cli_action_accumulate(cli, exit_code, option, optarg);
-                break;
             }
+
+            if (node)
+                cli_result_mark(node, option, position);
+            parse_defaults_drop(defaults, defaultc, option);
+
+            err = cli_dispatch(ps, cli, exit_code, option, value, &stop);
+            if (err || stop)
+                goto out;
+
+            /* The rest of the cluster, if any, was the option's argument. */
+            if (option->argument != CLI_HAS_ARG_NONE)
+                break;
         }
     }
 
-    // Free memory as early as possible
-    free(buf);
-    buf = NULL;
+    if (idx->constraintc > 0 && !parse_constraints(ps, idx, node)) {
+        cli_action_help(ps, cli, exit_code, true);
+        goto out;
+    }
 
-    if (optind != argc) {
-        const struct cli *subcommand;
-        const char *arg = argv[optind];
+    err = parse_defaults_apply(ps, cli, exit_code, defaults, defaultc, &stop);
+    if (err || stop)
+        goto out;
 
-        SLIST_FOREACH(subcommand, &cli->subcommands, entry) {
-            int diff;
+    SLIST_FOREACH(argument, &cli->arguments, entry) {
+        /* Presence-only arguments have no offset to resolve. */
+        void * const data =
+            argument->data ? cli_resolve_data(argument->data, ps->parser->data) : NULL;
+        uint64_t start;
+        bool valid;
 
-            diff = strcmp(subcommand->name, arg);
-            if (diff == 0)
-                break;
+        if (argument->variadic) {
+            if (data) {
+                struct cli_slice *slice = data;
+
+                slice->argv = argv + i;
+                slice->argc = (size_t)(argc - i);
+            }
+
+            i = argc;
+            break;
+        }
+
+        if (i == argc) {
+            parse_error(ps, "Missing argument: %s", argument->name);
+            cli_action_help(ps, cli, exit_code, true);
+            goto out;
         }
 
+        start = cli_stats_start();
+        valid = !data || cli_action_store(exit_code, argument->type, data, argv[i]);
+        cli_stats_stop(CLI_STATS_CONVERT, start);
+        if (!valid) {
+            parse_error(ps, "Invalid value for %s: '%s'", argument->name, argv[i]);
+            cli_action_help(ps, cli, exit_code, true);
+            goto out;
+        }
+
+        i++;
+    }
+
+    subcommand = i != argc ? cli_index_find_subcommand(idx, cli, argv[i]) : NULL;
+
+    // Free memory as early as possible
+    if (node == &local && local.seen != seen)
+        cli_arena_free(&ps->arena, local.seen);
+    node = NULL;
+    cli_arena_free(&ps->arena, defaults);
+    defaults = NULL;
+    cli_index_destroy(transient, &ps->arena);
+    transient = NULL;
+    ps->arena.used = arena_mark;
+
+    if (i != argc) {
         if (subcommand) {
-            err = cli_parse(subcommand, argc - optind, argv + optind, exit_code);
+            const struct cli_config_path * const parent = ps->path;
+            struct cli_config_path path;
+
+            if (ps->parser->config) {
+                cli_config_path_init(&path, parent, subcommand->name);
+                ps->path = &path;
+            }
+
+            ps->offset += i;
+            err = parse(ps, subcommand, argc - i, argv + i, exit_code);
+            ps->offset -= i;
+            ps->path = parent;
+        } else if (SLIST_EMPTY(&cli->subcommands)) {
+            parse_error(ps, "Unexpected argument: %s", argv[i]);
+            cli_action_help(ps, cli, exit_code, true);
+            goto out;
         } else {
-            cli_error("Unknown subcommand: %s", arg);
-            cli_action_help(cli, exit_code, stderr);
+            const struct cli *c;
+            struct cli_suggestions sg;
+
+            parse_error(ps, "Unknown subcommand: %s", argv[i]);
+
+            cli_suggestions_init(&sg, argv[i], strlen(argv[i]));
+            SLIST_FOREACH(c, &cli->subcommands, entry)
+                cli_suggestions_add(&sg, c->name);
+            parse_suggest(ps, &sg, "");
+
+            cli_action_help(ps, cli, exit_code, true);
             goto out;
         }
     }
 
     if (cli->callback) {
-        cli->callback(cli, exit_code, cli->ctx);
-    } else {
-        if (exit_code)
-            *exit_code = 0;
+        const uint64_t start = cli_stats_start();
+
+        cli->callback(cli, exit_code, ps->parser->ctx ? ps->parser->ctx : cli->ctx);
+        cli_stats_stop(CLI_STATS_CALLBACK, start);
+    } else if (exit_code && !subcommand) {
+        /* Keep the exit code the subcommand settled on. */
+        *exit_code = 0;
     }
 
 out:
-    free(buf);
+    if (node == &local && local.seen != seen)
+        cli_arena_free(&ps->arena, local.seen);
+    cli_arena_free(&ps->arena, defaults);
+    cli_index_destroy(transient, &ps->arena);
+    ps->arena.used = arena_mark;
+
+    return err;
+}
+
+/* Parse from cli, which is the root unless a multi-call binary picked one of
+ * its subcommands. Flags always come from the root.
+ */
+static merr_t
+parse_root(
+    const struct cli * const root,
+    const struct cli * const cli,
+    const int argc,
+    char * const * const argv,
+    int * const exit_code,
+    struct cli_parser * const parser,
+    const char * const program)
+{
+    const char *slash;
+    struct parse_state ps;
+    struct cli_config_path path;
+
+    ps.parser = parser;
+    ps.arena.buf = parser->arena;
+    ps.arena.size = parser->arena ? parser->arena_sz : 0;
+    ps.arena.used = 0;
+    ps.out = parser->out ? parser->out : stdout;
+    ps.err = parser->err ? parser->err : stderr;
+    ps.program = program;
+    ps.path = NULL;
+    ps.offset = 0;
+
+    if (parser->result)
+        parser->result->depth = 0;
+
+    slash = strrchr(ps.program, PATH_SEP);
+    ps.program_short = slash ? slash + 1 : ps.program;
+
+    if (cli != root && parser->config) {
+        cli_config_path_init(&path, NULL, cli->name);
+        ps.path = &path;
+    }
+
+    if ((root->flags & CLI_FLAG_COMPLETION) && argc > 1 && strcmp(argv[1], CLI_COMPLETE_ARG) == 0) {
+        merr_t err;
+
+        err = cli_complete(cli, argc - 2, argv + 2, ps.out, &ps.arena);
+        if (exit_code)
+            *exit_code = err ? EX_SOFTWARE : 0;
+
+        return err;
+    }
+
+    if (root->flags & CLI_FLAG_RESPONSE_FILES) {
+        merr_t err;
+        struct cli_expansion exp;
+
+        err = cli_expansion_init(&exp, argc, argv, &ps.arena);
+
+        /* Keep whatever was mapped, since parsed values may point into it. */
+        if (exp.responses) {
+            struct cli_response *last = exp.responses;
+
+            while (last->next)
+                last = last->next;
+            last->next = parser->responses;
+            parser->responses = exp.responses;
+        }
+
+        if (err) {
+            if (exp.failed) {
+                char buf[128];
+
+                if (strerror_r((int)merr_errno(err), buf, sizeof(buf)) != 0)
+                    buf[0] = '\0';
+
+                parse_error(&ps, "Failed to read response file: %s: %s", exp.failed, buf);
+                if (exit_code)
+                    *exit_code = EX_NOINPUT;
+                err = 0;
+            }
+        } else if (exp.responses) {
+            /* Variadic arguments slice into the expanded vector, so it lives
+             * as long as the files it was expanded from.
+             */
+            err = cli_expansion_keep(&exp);
+            if (!err)
+                err = parse(&ps, cli, exp.argc, exp.responses->argv, exit_code);
+        } else {
+            err = parse(&ps, cli, argc, argv, exit_code);
+        }
+
+        cli_expansion_fini(&exp);
+
+        return err;
+    }
+
+    return parse(&ps, cli, argc, argv, exit_code);
+}
+
+merr_t
+cli_parse_r(
+    const struct cli * const cli,
+    const int argc,
+    char * const * const argv,
+    int * const exit_code,
+    struct cli_parser * const parser)
+{
+    merr_t err;
+    uint64_t start;
+    const char *program;
+    int stats_argc = 0;
+    struct cli_stats before;
+    const struct cli *applet = NULL;
+
+    if (!cli || argc < 1 || !argv || !parser)
+        return merr(EINVAL);
+
+    program = parser->program_name ? parser->program_name : argv[0];
+
+    /* Run the subcommand the binary was invoked as, which skips the root
+     * entirely. Compiled trees find it through a hash.
+     */
+    if (cli->flags & CLI_FLAG_MULTI_CALL) {
+        const char * const slash = strrchr(argv[0], PATH_SEP);
+
+        applet = cli_index_find_subcommand(cli->index, cli, slash ? slash + 1 : argv[0]);
+    }
+
+    /* The hidden argument takes the place of argv[0], which is only ever
+     * used for the program name.
+     */
+    if ((cli->flags & CLI_FLAG_STATS) && argc > 1 && strcmp(argv[1], CLI_STATS_ARG) == 0) {
+        cli_stats_hold();
+        cli_stats_get(&before);
+        stats_argc = 1;
+    }
+
+    start = cli_stats_start();
+    err = parse_root(
+        cli,
+        applet ? applet : cli,
+        argc - stats_argc,
+        argv + stats_argc,
+        exit_code,
+        parser,
+        program);
+    cli_stats_stop(CLI_STATS_PARSE, start);
+
+    if (stats_argc) {
+        struct cli_stats stats;
+
+        cli_stats_get(&stats);
+        cli_stats_since(&stats, &before);
+        cli_stats_release();
+        cli_stats_print(&stats, parser->err ? parser->err : stderr);
+    }
 
     return err;
 }
+
+void
+cli_parser_fini(struct cli_parser * const parser)
+{
+    if (!parser)
+        return;
+
+    cli_response_release(parser->responses, NULL);
+    parser->responses = NULL;
+}
+
+merr_t
+cli_parse(const struct cli * const cli, const int argc, char * const * const argv, int *exit_code)
+{
+    struct cli_parser parser = { 0 };
+
+    if (!cli || argc < 1 || !argv)
+        return merr(EINVAL);
+
+    if (!cli_program_name)
+        cli_set_program_name(argv[0]);
+
+    parser.program_name = cli_program_name;
+
+    /* cli_parser_fini() is deliberately not called: like argv itself,
+     * response files stay mapped for the life of the process.
+     */
+    return cli_parse_r(cli, argc, argv, exit_code, &parser);
+}
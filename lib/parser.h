@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_PARSER_PRIVATE_H
+#define LIBCLI_PARSER_PRIVATE_H
+
+#include <stdbool.h>
+
+#include <libcli/parser.h>
+
+#include "index.h"
+
+/* Convert arg to type and store it in data. On failure, data is untouched and
+ * exit_code, if non-NULL, is set to EX_USAGE.
+ */
+bool
+cli_action_store(int *exit_code, enum cli_type type, void *data, const char *arg);
+
+/* Like cli_action_store(), but choices are resolved against the option. */
+bool
+cli_action_store_option(
+    const struct cli_index *idx,
+    int *exit_code,
+    const struct cli_option *option,
+    void *data,
+    const char *arg);
+
+#endif
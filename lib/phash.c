@@ -0,0 +1,285 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include "mem.h"
+#include "phash.h"
+
+#define GOLDEN_RATIO 0x9e3779b97f4a7c15ULL
+
+/* Number of seeds to try for a single bucket before growing the table. Seeds
+ * must fit in the uint16_t which stores them.
+ */
+#define MAX_SEED (1U << 16)
+
+uint64_t
+cli_hash(const char * const key, const size_t key_len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < key_len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 0x100000001b3ULL;
+    }
+
+    return h;
+}
+
+static uint64_t
+mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static uint32_t
+hash_bucket(const uint64_t h, const uint32_t mask)
+{
+    return (uint32_t)(mix(h) >> 32) & mask;
+}
+
+static uint32_t
+hash_slot(const uint64_t h, const uint32_t seed, const uint32_t mask)
+{
+    return (uint32_t)mix(h + (seed + 1ULL) * GOLDEN_RATIO) & mask;
+}
+
+static uint32_t
+next_pow2(const size_t n)
+{
+    uint32_t p = 1;
+
+    while (p < n)
+        p <<= 1;
+
+    return p;
+}
+
+/* Try to place every bucket with the current number of slots. Returns false
+ * if some bucket could not be placed, in which case the caller should retry
+ * with a larger table.
+ */
+static bool
+place(
+    struct cli_phash * const phash,
+    const uint64_t * const hashes,
+    const uint32_t * const order,
+    const uint32_t * const starts,
+    const uint32_t * const buckets,
+    const uint32_t nbuckets,
+    uint32_t * const slots)
+{
+    for (uint32_t i = 0; i < nbuckets; i++) {
+        uint32_t seed;
+        const uint32_t b = buckets[i];
+        const uint32_t start = starts[b];
+        const uint32_t size = starts[b + 1] - start;
+
+        if (size == 0)
+            break;
+
+        for (seed = 0; seed < MAX_SEED; seed++) {
+            uint32_t j;
+
+            for (j = 0; j < size; j++) {
+                uint32_t k;
+                const uint32_t s = hash_slot(hashes[order[start + j]], seed, phash->slot_mask);
+
+                if (phash->slots[s])
+                    break;
+
+                for (k = 0; k < j; k++) {
+                    if (slots[k] == s)
+                        break;
+                }
+                if (k != j)
+                    break;
+
+                slots[j] = s;
+            }
+
+            if (j == size)
+                break;
+        }
+
+        if (seed == MAX_SEED)
+            return false;
+
+        phash->seeds[b] = (uint16_t)seed;
+        for (uint32_t j = 0; j < size; j++)
+            phash->slots[slots[j]] = order[start + j] + 1;
+    }
+
+    return true;
+}
+
+merr_t
+cli_phash_build(
+    struct cli_phash * const phash,
+    struct cli_arena * const arena,
+    const size_t keyc,
+    const char * const * const keyv)
+{
+    void *tmp;
+    merr_t err = 0;
+    uint64_t *hashes;
+    uint32_t nbuckets, nslots, max_size;
+    uint32_t *order, *starts, *buckets, *counts, *slots;
+
+    if (!phash || (keyc > 0 && !keyv))
+        return merr(EINVAL);
+
+    memset(phash, 0, sizeof(*phash));
+
+    if (keyc == 0)
+        return 0;
+
+    if (keyc > UINT32_MAX / 4)
+        return merr(E2BIG);
+
+    nbuckets = next_pow2((keyc + 1) / 2);
+    nslots = next_pow2(keyc);
+
+    tmp = cli_arena_alloc(
+        arena,
+        keyc * sizeof(*hashes) + keyc * sizeof(*order) + (nbuckets + 1) * sizeof(*starts) +
+        nbuckets * sizeof(*buckets) + (keyc + 2) * sizeof(*counts) + keyc * sizeof(*slots));
+    if (!tmp)
+        return merr(ENOMEM);
+
+    hashes = tmp;
+    order = (uint32_t *)(hashes + keyc);
+    starts = order + keyc;
+    buckets = starts + nbuckets + 1;
+    counts = buckets + nbuckets;
+    slots = counts + keyc + 2;
+
+    for (size_t i = 0; i < keyc; i++) {
+        if (!keyv[i]) {
+            err = merr(EINVAL);
+            goto out;
+        }
+
+        hashes[i] = cli_hash(keyv[i], strlen(keyv[i]));
+    }
+
+    /* Group the keys by bucket with a counting sort. */
+    memset(starts, 0, (nbuckets + 1) * sizeof(*starts));
+    for (size_t i = 0; i < keyc; i++)
+        starts[hash_bucket(hashes[i], nbuckets - 1) + 1]++;
+    for (uint32_t b = 0; b < nbuckets; b++)
+        starts[b + 1] += starts[b];
+    memcpy(buckets, starts, nbuckets * sizeof(*buckets));
+    for (uint32_t i = 0; i < keyc; i++)
+        order[buckets[hash_bucket(hashes[i], nbuckets - 1)]++] = i;
+
+    /* Identical keys always land in the same bucket, so duplicates can be
+     * found by comparing keys pairwise within each bucket.
+     */
+    max_size = 0;
+    for (uint32_t b = 0; b < nbuckets; b++) {
+        const uint32_t size = starts[b + 1] - starts[b];
+
+        for (uint32_t i = starts[b]; i < starts[b + 1]; i++) {
+            for (uint32_t j = i + 1; j < starts[b + 1]; j++) {
+                if (hashes[order[i]] == hashes[order[j]] &&
+                    strcmp(keyv[order[i]], keyv[order[j]]) == 0)
+                {
+                    err = merr(ENOTUNIQ);
+                    goto out;
+                }
+            }
+        }
+
+        if (size > max_size)
+            max_size = size;
+    }
+
+    /* Place the largest buckets first while the table is mostly empty. */
+    memset(counts, 0, (max_size + 2) * sizeof(*counts));
+    for (uint32_t b = 0; b < nbuckets; b++)
+        counts[max_size - (starts[b + 1] - starts[b]) + 1]++;
+    for (uint32_t s = 0; s < max_size; s++)
+        counts[s + 1] += counts[s];
+    for (uint32_t b = 0; b < nbuckets; b++)
+        buckets[counts[max_size - (starts[b + 1] - starts[b])]++] = b;
+
+    for (;;) {
+        void *mem;
+
+        mem = cli_arena_calloc(
+            arena, 1, nslots * sizeof(*phash->slots) + nbuckets * sizeof(*phash->seeds));
+        if (!mem) {
+            err = merr(ENOMEM);
+            goto out;
+        }
+
+        phash->slots = mem;
+        phash->seeds = (uint16_t *)(phash->slots + nslots);
+        phash->bucket_mask = nbuckets - 1;
+        phash->slot_mask = nslots - 1;
+
+        if (place(phash, hashes, order, starts, buckets, nbuckets, slots))
+            break;
+
+        cli_arena_free(arena, mem);
+        memset(phash, 0, sizeof(*phash));
+
+        if (nslots > UINT32_MAX / 2) {
+            err = merr(E2BIG);
+            goto out;
+        }
+
+        nslots <<= 1;
+    }
+
+out:
+    cli_arena_free(arena, tmp);
+
+    return err;
+}
+
+void
+cli_phash_destroy(struct cli_phash * const phash, struct cli_arena * const arena)
+{
+    if (!phash)
+        return;
+
+    /* The seeds share the allocation made for the slots. */
+    cli_arena_free(arena, phash->slots);
+    memset(phash, 0, sizeof(*phash));
+}
+
+size_t
+cli_phash_find(const struct cli_phash * const phash, const char * const key, const size_t key_len)
+{
+    uint64_t h;
+    uint32_t slot;
+
+    assert(phash);
+    assert(key);
+
+    if (!phash->slots)
+        return CLI_PHASH_NONE;
+
+    h = cli_hash(key, key_len);
+    slot = hash_slot(h, phash->seeds[hash_bucket(h, phash->bucket_mask)], phash->slot_mask);
+
+    return phash->slots[slot] ? phash->slots[slot] - 1 : CLI_PHASH_NONE;
+}
@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_PHASH_H
+#define LIBCLI_PHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <merr.h>
+
+#include "mem.h"
+
+/* Perfect hash over a fixed set of NUL-terminated strings using the
+ * hash-and-displace scheme: keys are grouped into buckets, and each bucket
+ * gets a seed which places all of its keys into distinct slots.
+ *
+ * Slots hold the position of their key in the array the hash was built from
+ * rather than the key itself, so the table costs a few bytes per key and the
+ * caller's own array serves both for comparing keys and as the values.
+ */
+struct cli_phash {
+    uint32_t bucket_mask;
+    uint32_t slot_mask;
+    uint16_t *seeds;
+    /* Position of the key plus one, or 0 for an empty slot. */
+    uint32_t *slots;
+};
+
+#define CLI_PHASH_NONE SIZE_MAX
+
+/* 64-bit FNV-1a. */
+uint64_t
+cli_hash(const char *key, size_t key_len);
+
+merr_t
+cli_phash_build(
+    struct cli_phash *phash,
+    struct cli_arena *arena,
+    size_t keyc,
+    const char * const *keyv);
+
+void
+cli_phash_destroy(struct cli_phash *phash, struct cli_arena *arena);
+
+/* The only position which may hold key, or CLI_PHASH_NONE. Callers compare
+ * the key at that position themselves.
+ */
+size_t
+cli_phash_find(const struct cli_phash *phash, const char *key, size_t key_len);
+
+#endif
@@ -0,0 +1,289 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include "mem.h"
+#include "response.h"
+
+/* Bounds the recursion, which also catches files which include themselves. */
+#define MAX_DEPTH 32
+
+static merr_t
+expand_arg(struct cli_expansion *exp, char *arg, unsigned int depth);
+
+static merr_t
+push(struct cli_expansion * const exp, char * const arg)
+{
+    /* Leave room for the terminating NULL. */
+    if ((size_t)exp->argc + 1 >= exp->argv_sz) {
+        char **argv;
+
+        if (exp->argc == INT_MAX - 1)
+            return merr(E2BIG);
+
+        argv = cli_arena_alloc(exp->arena, exp->argv_sz * 2 * sizeof(*argv));
+        if (!argv)
+            return merr(ENOMEM);
+
+        memcpy(argv, exp->argv, (size_t)exp->argc * sizeof(*argv));
+        cli_arena_free(exp->arena, exp->argv);
+        exp->argv = argv;
+        exp->argv_sz *= 2;
+    }
+
+    exp->argv[exp->argc++] = arg;
+    exp->argv[exp->argc] = NULL;
+
+    return 0;
+}
+
+static merr_t
+map_file(struct cli_expansion * const exp, const char * const path, struct cli_response ** const r)
+{
+    int fd;
+    void *map;
+    struct stat st;
+    struct cli_response *response;
+
+    *r = NULL;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        goto err;
+
+    if (fstat(fd, &st) == -1) {
+        const int saved = errno;
+
+        close(fd);
+        errno = saved;
+        goto err;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        const int saved = errno;
+
+        close(fd);
+        errno = saved;
+        goto err;
+    }
+
+    close(fd);
+
+    response = cli_calloc(1, sizeof(*response));
+    if (!response) {
+        munmap(map, (size_t)st.st_size);
+        return merr(ENOMEM);
+    }
+
+    response->map = map;
+    response->map_sz = (size_t)st.st_size;
+    response->next = exp->responses;
+    exp->responses = response;
+    *r = response;
+
+    return 0;
+
+err:
+    exp->failed = path;
+
+    return merr(errno);
+}
+
+static merr_t
+expand_file(struct cli_expansion * const exp, const char * const path, const unsigned int depth)
+{
+    merr_t err;
+    int sep;
+    char *p, *end;
+    size_t page_sz;
+    struct cli_response *r;
+
+    if (depth == MAX_DEPTH) {
+        exp->failed = path;
+        return merr(ELOOP);
+    }
+
+    err = map_file(exp, path, &r);
+    if (err || !r)
+        return err;
+
+    p = r->map;
+    end = p + r->map_sz;
+    page_sz = (size_t)sysconf(_SC_PAGESIZE);
+
+    /* Files with any NUL in them are NUL-separated, which allows entries to
+     * contain newlines.
+     */
+    sep = memchr(p, '\0', r->map_sz) ? '\0' : '\n';
+
+    while (p < end) {
+        char *entry = p;
+        char *q;
+
+        q = memchr(p, sep, (size_t)(end - p));
+        if (!q)
+            q = end;
+
+        p = q + 1;
+
+        if (sep == '\n' && q > entry && q[-1] == '\r')
+            q--;
+
+        if (q == entry)
+            continue;
+
+        if (q < end) {
+            /* Writing even an identical byte would copy the page. */
+            if (*q != '\0')
+                *q = '\0';
+        } else if (r->map_sz % page_sz == 0) {
+            /* The remainder of the last page is zero-filled unless the file
+             * ends exactly on a page boundary.
+             */
+            r->tail = cli_malloc((size_t)(q - entry) + 1);
+            if (!r->tail)
+                return merr(ENOMEM);
+
+            memcpy(r->tail, entry, (size_t)(q - entry));
+            r->tail[q - entry] = '\0';
+            entry = r->tail;
+        }
+
+        err = expand_arg(exp, entry, depth + 1);
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+static merr_t
+expand_arg(struct cli_expansion * const exp, char * const arg, const unsigned int depth)
+{
+    if (exp->terminated)
+        return push(exp, arg);
+
+    if (arg[0] == '@' && arg[1] != '\0')
+        return expand_file(exp, arg + 1, depth);
+
+    if (strcmp(arg, "--") == 0)
+        exp->terminated = true;
+
+    return push(exp, arg);
+}
+
+merr_t
+cli_expansion_init(
+    struct cli_expansion * const exp,
+    const int argc,
+    char * const * const argv,
+    struct cli_arena * const arena)
+{
+    int i;
+    merr_t err;
+
+    if (!exp)
+        return merr(EINVAL);
+
+    memset(exp, 0, sizeof(*exp));
+
+    if (argc < 1 || !argv)
+        return merr(EINVAL);
+
+    for (i = 1; i < argc && strcmp(argv[i], "--") != 0; i++) {
+        if (argv[i][0] == '@' && argv[i][1] != '\0')
+            break;
+    }
+
+    if (i == argc || strcmp(argv[i], "--") == 0)
+        return 0;
+
+    exp->arena = arena;
+    exp->argv_sz = (size_t)argc + 1;
+    exp->argv = cli_arena_alloc(arena, exp->argv_sz * sizeof(*exp->argv));
+    if (!exp->argv)
+        return merr(ENOMEM);
+
+    err = push(exp, argv[0]);
+    if (err)
+        return err;
+
+    for (i = 1; i < argc; i++) {
+        err = expand_arg(exp, argv[i], 0);
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
+merr_t
+cli_expansion_keep(struct cli_expansion * const exp)
+{
+    char **argv;
+
+    if (!exp || !exp->argv || !exp->responses)
+        return merr(EINVAL);
+
+    if (!cli_arena_owns(exp->arena, exp->argv)) {
+        exp->responses->argv = exp->argv;
+        exp->argv = NULL;
+        return 0;
+    }
+
+    argv = cli_malloc(((size_t)exp->argc + 1) * sizeof(*argv));
+    if (!argv)
+        return merr(ENOMEM);
+
+    memcpy(argv, exp->argv, ((size_t)exp->argc + 1) * sizeof(*argv));
+    exp->responses->argv = argv;
+
+    return 0;
+}
+
+void
+cli_expansion_fini(struct cli_expansion * const exp)
+{
+    if (!exp)
+        return;
+
+    cli_arena_free(exp->arena, exp->argv);
+    exp->argv = NULL;
+    exp->argc = 0;
+    exp->argv_sz = 0;
+}
+
+void
+cli_response_release(struct cli_response *head, const struct cli_response * const stop)
+{
+    while (head && head != stop) {
+        struct cli_response *next = head->next;
+
+        munmap(head->map, head->map_sz);
+        cli_free(head->tail);
+        cli_free(head->argv);
+        cli_free(head);
+
+        head = next;
+    }
+}
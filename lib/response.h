@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_RESPONSE_H
+#define LIBCLI_RESPONSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <merr.h>
+
+#include "mem.h"
+
+/* A mapped response file. Entries are terminated in place, so the mapping is
+ * private and writable.
+ */
+struct cli_response {
+    struct cli_response *next;
+    void *map;
+    size_t map_sz;
+    /* Copy of the final entry when it runs up to a page boundary and there is
+     * no room to terminate it in the mapping.
+     */
+    char *tail;
+    /* Expanded argument vector, which variadic arguments slice into. */
+    char **argv;
+};
+
+struct cli_expansion {
+    int argc;
+    char **argv;
+    struct cli_arena *arena;
+    size_t argv_sz;
+    /* Set once -- has been seen. */
+    bool terminated;
+    /* Newly mapped files, most recent first. */
+    struct cli_response *responses;
+    /* Response file which could not be read when expansion fails. */
+    const char *failed;
+};
+
+/* Expand argv into exp->argv, which is NULL-terminated and allocated from
+ * arena. exp->argv stays NULL when no argument names a response file. On
+ * failure, anything mapped so far is still in exp->responses.
+ */
+merr_t
+cli_expansion_init(
+    struct cli_expansion *exp,
+    int argc,
+    char * const *argv,
+    struct cli_arena *arena);
+
+/* Hand the expanded vector to the most recent response, copying it out of
+ * the arena so that it outlives the parse.
+ */
+merr_t
+cli_expansion_keep(struct cli_expansion *exp);
+
+/* Free the argument vector, but not the responses. */
+void
+cli_expansion_fini(struct cli_expansion *exp);
+
+/* Release responses from head up to, but not including, stop. */
+void
+cli_response_release(struct cli_response *head, const struct cli_response *stop);
+
+#endif
@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/result.h>
+
+#include "mem.h"
+#include "result.h"
+
+merr_t
+cli_result_push(
+    struct cli_result * const result,
+    const struct cli * const cli,
+    const size_t optionc,
+    struct cli_result_node ** const node)
+{
+    struct cli_result_node *n;
+    const size_t words = cli_result_words(optionc);
+    const size_t size =
+        words * sizeof(*n->seen) + optionc * (sizeof(*n->counts) + sizeof(*n->positions));
+
+    assert(result);
+    assert(cli);
+    assert(node);
+
+    if (result->depth == result->capacity) {
+        const size_t capacity = result->capacity ? 2 * result->capacity : 4;
+
+        n = cli_realloc(result->nodes, capacity * sizeof(*n));
+        if (!n)
+            return merr(ENOMEM);
+
+        memset(n + result->capacity, 0, (capacity - result->capacity) * sizeof(*n));
+        result->nodes = n;
+        result->capacity = capacity;
+    }
+
+    n = &result->nodes[result->depth];
+    if (n->size < size) {
+        void * const mem = cli_realloc(n->seen, size);
+
+        if (!mem)
+            return merr(ENOMEM);
+
+        n->seen = mem;
+        n->size = size;
+    }
+
+    memset(n->seen, 0, size);
+    n->cli = cli;
+    n->optionc = optionc;
+    n->counts = (unsigned int *)(n->seen + words);
+    n->positions = (int *)(n->counts + optionc);
+
+    result->depth++;
+    *node = n;
+
+    return 0;
+}
+
+static const struct cli_result_node *
+find(
+    const struct cli_result * const result,
+    const struct cli * const cli,
+    const struct cli_option * const option)
+{
+    if (!result || !cli || !option)
+        return NULL;
+
+    for (size_t i = 0; i < result->depth; i++) {
+        const struct cli_result_node * const n = &result->nodes[i];
+
+        if (n->cli == cli)
+            return option->ordinal < n->optionc ? n : NULL;
+    }
+
+    return NULL;
+}
+
+bool
+cli_result_seen(
+    const struct cli_result * const result,
+    const struct cli * const cli,
+    const struct cli_option * const option)
+{
+    const struct cli_result_node * const n = find(result, cli, option);
+
+    return n && cli_result_test(n, option);
+}
+
+unsigned int
+cli_result_count(
+    const struct cli_result * const result,
+    const struct cli * const cli,
+    const struct cli_option * const option)
+{
+    const struct cli_result_node * const n = find(result, cli, option);
+
+    return n ? n->counts[option->ordinal] : 0;
+}
+
+int
+cli_result_position(
+    const struct cli_result * const result,
+    const struct cli * const cli,
+    const struct cli_option * const option)
+{
+    const struct cli_result_node * const n = find(result, cli, option);
+
+    return n && n->positions[option->ordinal] > 0 ? n->positions[option->ordinal] : -1;
+}
+
+void
+cli_result_fini(struct cli_result * const result)
+{
+    if (!result)
+        return;
+
+    for (size_t i = 0; i < result->capacity; i++)
+        cli_free(result->nodes[i].seen);
+    cli_free(result->nodes);
+    memset(result, 0, sizeof(*result));
+}
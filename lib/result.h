@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_RESULT_PRIVATE_H
+#define LIBCLI_RESULT_PRIVATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/result.h>
+
+#define CLI_RESULT_WORD_BITS 64
+
+/* Options seen at one level of a parse, indexed by ordinal. Only seen is
+ * required; a parse which just checks constraints leaves the rest NULL.
+ */
+struct cli_result_node {
+    const struct cli *cli;
+    size_t optionc;
+    uint64_t *seen;
+    unsigned int *counts;
+    /* Zero, which is always the command's own name, if never seen. */
+    int *positions;
+    /* Bytes behind seen, which counts and positions share. */
+    size_t size;
+};
+
+static inline size_t
+cli_result_words(const size_t optionc)
+{
+    return (optionc + CLI_RESULT_WORD_BITS - 1) / CLI_RESULT_WORD_BITS;
+}
+
+static inline unsigned int
+cli_result_popcount(const uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_popcountll(word);
+#else
+    uint64_t x = word - ((word >> 1) & UINT64_C(0x5555555555555555));
+
+    x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+    x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+
+    return (unsigned int)((x * UINT64_C(0x0101010101010101)) >> 56);
+#endif
+}
+
+static inline bool
+cli_result_test(const struct cli_result_node * const node, const struct cli_option * const option)
+{
+    return node->seen[option->ordinal / CLI_RESULT_WORD_BITS] &
+        (UINT64_C(1) << (option->ordinal % CLI_RESULT_WORD_BITS));
+}
+
+static inline void
+cli_result_mark(
+    struct cli_result_node * const node,
+    const struct cli_option * const option,
+    const int position)
+{
+    node->seen[option->ordinal / CLI_RESULT_WORD_BITS] |= UINT64_C(1)
+        << (option->ordinal % CLI_RESULT_WORD_BITS);
+    if (node->counts) {
+        node->counts[option->ordinal]++;
+        node->positions[option->ordinal] = position;
+    }
+}
+
+/* Start the next level of the parsed path, cleared for optionc options. */
+merr_t
+cli_result_push(
+    struct cli_result *result,
+    const struct cli *cli,
+    size_t optionc,
+    struct cli_result_node **node);
+
+#endif
@@ -0,0 +1,961 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/server.h>
+
+#include "mem.h"
+
+#define MAGIC 0x6c69636cu
+
+/* Bytes of arguments in a single request. */
+#define MAX_REQUEST (1u << 20)
+
+#define ARENA_SZ (16 * 1024)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
+
+enum {
+    PASS_OUT = 1 << 0,
+    PASS_ERR = 1 << 1,
+};
+
+/* Followed by size bytes of NUL-terminated arguments. The descriptors which
+ * pass says were sent come with the header, out before err.
+ */
+struct request {
+    uint32_t magic;
+    uint32_t argc;
+    uint32_t size;
+    uint32_t pass;
+};
+
+struct response {
+    int32_t exit_code;
+};
+
+/* Connections between requests. Workers take turns polling them along with
+ * the socket, so an idle client holds no worker, and the one which polls
+ * hands a readable connection to itself and leaves the polling to the next.
+ */
+struct cli_server_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    /* Whether a worker is polling, and whether the server is stopping. */
+    bool polling;
+    bool stopping;
+    /* Written to make the polling worker start over with the current set. */
+    int rearm[2];
+    size_t idlec;
+    size_t idle_sz;
+    int *idlev;
+};
+
+struct cli_server_worker {
+    struct cli_server *server;
+    pthread_t thread;
+    struct pollfd *pfds;
+    size_t pfds_sz;
+    char *args;
+    size_t args_sz;
+    char **argv;
+    size_t argv_sz;
+    void *data;
+    char *arena;
+};
+
+static _Thread_local FILE *request_out;
+static _Thread_local FILE *request_err;
+
+FILE *
+cli_server_out(void)
+{
+    return request_out ? request_out : stdout;
+}
+
+FILE *
+cli_server_err(void)
+{
+    return request_err ? request_err : stderr;
+}
+
+static merr_t
+write_all(const int fd, const void * const buf, const size_t len)
+{
+    const char *p = buf;
+    size_t left = len;
+
+    while (left > 0) {
+        const ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            return merr(errno);
+        }
+
+        p += n;
+        left -= (size_t)n;
+    }
+
+    return 0;
+}
+
+/* An end of file before all of len is a reset connection. Waits are given
+ * up on as soon as wake becomes readable, unless it is -1.
+ */
+static merr_t
+read_all(const int fd, const int wake, void * const buf, const size_t len)
+{
+    char *p = buf;
+    size_t left = len;
+
+    while (left > 0) {
+        ssize_t n;
+        struct pollfd pfds[] = {
+            { .fd = fd, .events = POLLIN },
+            { .fd = wake, .events = POLLIN },
+        };
+
+        if (poll(pfds, 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            return merr(errno);
+        }
+
+        if (pfds[1].revents)
+            return merr(ECANCELED);
+
+        n = read(fd, p, left);
+
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            return merr(errno);
+        }
+
+        if (n == 0)
+            return merr(ECONNRESET);
+
+        p += n;
+        left -= (size_t)n;
+    }
+
+    return 0;
+}
+
+/* Receive a request header with whatever descriptors came along. Sets *eof
+ * if the client hung up instead.
+ */
+static merr_t
+read_request(
+    const int fd,
+    const int wake,
+    struct request * const req,
+    int * const fds,
+    size_t * const fdc,
+    bool * const eof)
+{
+    ssize_t n;
+    struct msghdr msg = { 0 };
+    struct iovec iov = { .iov_base = req, .iov_len = sizeof(*req) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct cmsghdr *cmsg;
+
+    *fdc = 0;
+    *eof = false;
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    do {
+        n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (n == -1 && errno == EINTR);
+
+    if (n == -1)
+        return merr(errno);
+
+    if (n == 0) {
+        *eof = true;
+        return 0;
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+            for (size_t i = 0; i < count; i++) {
+                int received;
+
+                memcpy(&received, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(received));
+                if (*fdc < 2) {
+                    fds[(*fdc)++] = received;
+                } else {
+                    close(received);
+                }
+            }
+        }
+    }
+
+    if (msg.msg_flags & MSG_CTRUNC)
+        return merr(EPROTO);
+
+    if ((size_t)n < sizeof(*req))
+        return read_all(fd, wake, (char *)req + n, sizeof(*req) - (size_t)n);
+
+    return 0;
+}
+
+static FILE *
+open_stream(const int fd, FILE * const fallback)
+{
+    FILE *stream;
+
+    if (fd < 0)
+        return fallback;
+
+    stream = fdopen(fd, "w");
+    if (!stream) {
+        close(fd);
+        return fallback;
+    }
+
+    return stream;
+}
+
+/* Split the arguments of a request into argv, checking that there are as
+ * many as the client said.
+ */
+static merr_t
+split_args(struct cli_server_worker * const w, const struct request * const req)
+{
+    size_t n = 0;
+    char *p = w->args;
+    char * const end = w->args + req->size;
+
+    if (req->argc + 1 > w->argv_sz) {
+        char **argv;
+        size_t argv_sz = w->argv_sz ? w->argv_sz : 16;
+
+        while (argv_sz < req->argc + 1)
+            argv_sz *= 2;
+
+        argv = cli_realloc(w->argv, argv_sz * sizeof(*argv));
+        if (!argv)
+            return merr(ENOMEM);
+
+        w->argv = argv;
+        w->argv_sz = argv_sz;
+    }
+
+    while (p < end) {
+        char * const nul = memchr(p, '\0', (size_t)(end - p));
+
+        if (!nul || n == req->argc)
+            return merr(EPROTO);
+
+        w->argv[n++] = p;
+        p = nul + 1;
+    }
+
+    if (n != req->argc)
+        return merr(EPROTO);
+
+    w->argv[n] = NULL;
+
+    return 0;
+}
+
+/* Serve one request of a connection. Sets *eof once the client hangs up. */
+static merr_t
+serve_request(struct cli_server_worker * const w, const int conn, bool * const eof)
+{
+    merr_t err;
+    size_t fdc;
+    int fds[2] = { -1, -1 };
+    int exit_code = EX_SOFTWARE;
+    struct request req;
+    struct response res;
+    struct cli_server * const server = w->server;
+    struct cli_parser parser = server->parser;
+
+    err = read_request(conn, server->wake[0], &req, fds, &fdc, eof);
+    if (err || *eof)
+        goto out;
+
+    /* Every argument takes at least its NUL, which bounds argv by size. */
+    if (req.magic != MAGIC || req.argc < 1 || req.size > MAX_REQUEST || req.argc > req.size ||
+        fdc != (size_t)((req.pass & PASS_OUT ? 1 : 0) + (req.pass & PASS_ERR ? 1 : 0))) {
+        err = merr(EPROTO);
+        goto out;
+    }
+
+    if (req.size > w->args_sz) {
+        char * const args = cli_realloc(w->args, req.size);
+
+        if (!args) {
+            err = merr(ENOMEM);
+            goto out;
+        }
+
+        w->args = args;
+        w->args_sz = req.size;
+    }
+
+    /* A client which stalls halfway must not keep stop waiting. */
+    err = read_all(conn, server->wake[0], w->args, req.size);
+    if (err)
+        goto out;
+
+    err = split_args(w, &req);
+    if (err)
+        goto out;
+
+    if (!(req.pass & PASS_OUT)) {
+        fds[1] = fds[0];
+        fds[0] = -1;
+    } else if (!(req.pass & PASS_ERR)) {
+        fds[1] = -1;
+    }
+
+    parser.out = open_stream(fds[0], parser.out ? parser.out : stdout);
+    parser.err = open_stream(fds[1], parser.err ? parser.err : stderr);
+    fds[0] = fds[1] = -1;
+    parser.arena = w->arena;
+    parser.arena_sz = ARENA_SZ;
+    parser.responses = NULL;
+    if (server->data_sz) {
+        memcpy(w->data, server->parser.data, server->data_sz);
+        parser.data = w->data;
+        if (!parser.ctx)
+            parser.ctx = w->data;
+    }
+
+    request_out = parser.out;
+    request_err = parser.err;
+
+    err = cli_parse_r(server->cli, (int)req.argc, w->argv, &exit_code, &parser);
+    if (err)
+        exit_code = EX_SOFTWARE;
+
+    request_out = NULL;
+    request_err = NULL;
+
+    cli_parser_fini(&parser);
+
+    /* Everything the client is owed is written before it hears back. */
+    if (parser.out != server->parser.out && parser.out != stdout) {
+        fclose(parser.out);
+    } else {
+        fflush(parser.out);
+    }
+    if (parser.err != server->parser.err && parser.err != stderr) {
+        fclose(parser.err);
+    } else {
+        fflush(parser.err);
+    }
+
+    /* Writing to a client's stream whose reader is gone raised SIGPIPE at
+     * this thread, which blocks it. Discard it rather than let it pile up.
+     */
+    {
+        sigset_t pipe_set;
+        const struct timespec now = { 0 };
+
+        sigemptyset(&pipe_set);
+        sigaddset(&pipe_set, SIGPIPE);
+        while (sigtimedwait(&pipe_set, NULL, &now) == SIGPIPE)
+            ;
+    }
+
+    res.exit_code = exit_code;
+    err = write_all(conn, &res, sizeof(res));
+
+out:
+    for (size_t i = 0; i < 2; i++) {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+
+    return err;
+}
+
+static merr_t
+pool_add(struct cli_server_pool * const pool, const int conn)
+{
+    if (pool->idlec == pool->idle_sz) {
+        const size_t idle_sz = pool->idle_sz ? pool->idle_sz * 2 : 16;
+        int * const idlev = cli_realloc(pool->idlev, idle_sz * sizeof(*idlev));
+
+        if (!idlev)
+            return merr(ENOMEM);
+
+        pool->idlev = idlev;
+        pool->idle_sz = idle_sz;
+    }
+
+    pool->idlev[pool->idlec++] = conn;
+
+    return 0;
+}
+
+/* Give a connection back once its request is served, or close it. Whoever is
+ * polling has to start over to see it.
+ */
+static void
+pool_return(struct cli_server_pool * const pool, const int conn)
+{
+    const char byte = 0;
+    bool wake = false;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->stopping || pool_add(pool, conn)) {
+        close(conn);
+    } else {
+        wake = pool->polling;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (wake) {
+        while (write(pool->rearm[1], &byte, 1) == -1 && errno == EINTR)
+            ;
+    }
+}
+
+/* Accept every pending client into the idle set. */
+static void
+pool_accept(struct cli_server * const server)
+{
+    struct cli_server_pool * const pool = server->pool;
+
+    for (;;) {
+        const int conn = accept(server->fd, NULL, NULL);
+
+        if (conn == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        fcntl(conn, F_SETFD, FD_CLOEXEC);
+        if (pool_add(pool, conn))
+            close(conn);
+    }
+}
+
+/* Poll the socket and the idle connections until one has a request, which
+ * is taken out of the set. Returns -1 once the server stops.
+ */
+static int
+pool_take(struct cli_server_worker * const w)
+{
+    struct cli_server * const server = w->server;
+    struct cli_server_pool * const pool = server->pool;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;) {
+        int rc;
+        size_t n;
+        int conn = -1;
+
+        while (pool->polling && !pool->stopping)
+            pthread_cond_wait(&pool->turn, &pool->lock);
+
+        if (pool->stopping)
+            break;
+
+        n = pool->idlec + 3;
+        if (n > w->pfds_sz) {
+            struct pollfd * const pfds = cli_realloc(w->pfds, n * sizeof(*pfds));
+
+            if (!pfds) {
+                /* Leave the polling to workers which can. */
+                pthread_mutex_unlock(&pool->lock);
+                return -1;
+            }
+
+            w->pfds = pfds;
+            w->pfds_sz = n;
+        }
+
+        w->pfds[0] = (struct pollfd){ .fd = server->wake[0], .events = POLLIN };
+        w->pfds[1] = (struct pollfd){ .fd = pool->rearm[0], .events = POLLIN };
+        w->pfds[2] = (struct pollfd){ .fd = server->fd, .events = POLLIN };
+        for (size_t i = 0; i < pool->idlec; i++)
+            w->pfds[i + 3] = (struct pollfd){ .fd = pool->idlev[i], .events = POLLIN };
+
+        pool->polling = true;
+        pthread_mutex_unlock(&pool->lock);
+
+        rc = poll(w->pfds, n, -1);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->polling = false;
+        pthread_cond_signal(&pool->turn);
+
+        if (rc == -1)
+            continue;
+
+        if (w->pfds[0].revents) {
+            pool->stopping = true;
+            pthread_cond_broadcast(&pool->turn);
+            break;
+        }
+
+        if (w->pfds[1].revents) {
+            char buf[64];
+
+            while (read(pool->rearm[0], buf, sizeof(buf)) == (ssize_t)sizeof(buf))
+                ;
+        }
+
+        /* Anything else which was readable is found again by the next poll,
+         * so take the first and leave the rest.
+         */
+        for (size_t i = 3; i < n && conn == -1; i++) {
+            if (!w->pfds[i].revents)
+                continue;
+
+            conn = w->pfds[i].fd;
+            for (size_t j = 0; j < pool->idlec; j++) {
+                if (pool->idlev[j] == conn) {
+                    pool->idlev[j] = pool->idlev[--pool->idlec];
+                    break;
+                }
+            }
+        }
+
+        if (w->pfds[2].revents)
+            pool_accept(server);
+
+        if (conn != -1) {
+            pthread_mutex_unlock(&pool->lock);
+            return conn;
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return -1;
+}
+
+static void *
+worker(void * const arg)
+{
+    struct cli_server_worker * const w = arg;
+
+    for (;;) {
+        bool eof;
+        merr_t err;
+        const int conn = pool_take(w);
+
+        if (conn == -1)
+            break;
+
+        err = serve_request(w, conn, &eof);
+        if (err || eof) {
+            close(conn);
+        } else {
+            pool_return(w->server->pool, conn);
+        }
+    }
+
+    return NULL;
+}
+
+static long
+online_processors(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? n : 1;
+#else
+    return 1;
+#endif
+}
+
+static merr_t
+listen_on(struct cli_server * const server)
+{
+    struct stat st;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (strlen(server->path) >= sizeof(addr.sun_path))
+        return merr(ENAMETOOLONG);
+
+    strcpy(addr.sun_path, server->path);
+
+    /* Only ever replace a socket, never a file which happens to be there. */
+    if (lstat(server->path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode))
+            return merr(EEXIST);
+        unlink(server->path);
+    }
+
+    server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->fd == -1)
+        return merr(errno);
+
+    if (fcntl(server->fd, F_SETFD, FD_CLOEXEC) == -1 ||
+        fcntl(server->fd, F_SETFL, O_NONBLOCK) == -1 ||
+        bind(server->fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        listen(server->fd, SOMAXCONN) == -1) {
+        const merr_t err = merr(errno);
+
+        close(server->fd);
+        server->fd = -1;
+
+        return err;
+    }
+
+    return 0;
+}
+
+static merr_t
+pool_create(struct cli_server * const server)
+{
+    struct cli_server_pool * const pool = cli_calloc(1, sizeof(*pool));
+
+    if (!pool)
+        return merr(ENOMEM);
+
+    if (pipe(pool->rearm) == -1) {
+        const merr_t err = merr(errno);
+
+        cli_free(pool);
+        return err;
+    }
+
+    /* Wakeups only need to be pending, not counted. */
+    for (int i = 0; i < 2; i++) {
+        fcntl(pool->rearm[i], F_SETFD, FD_CLOEXEC);
+        fcntl(pool->rearm[i], F_SETFL, O_NONBLOCK);
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->turn, NULL);
+    server->pool = pool;
+
+    return 0;
+}
+
+static void
+pool_destroy(struct cli_server * const server)
+{
+    struct cli_server_pool * const pool = server->pool;
+
+    if (!pool)
+        return;
+
+    for (size_t i = 0; i < pool->idlec; i++)
+        close(pool->idlev[i]);
+
+    close(pool->rearm[0]);
+    close(pool->rearm[1]);
+    pthread_cond_destroy(&pool->turn);
+    pthread_mutex_destroy(&pool->lock);
+    cli_free(pool->idlev);
+    cli_free(pool);
+    server->pool = NULL;
+}
+
+static void
+server_release(struct cli_server * const server)
+{
+    for (unsigned int i = 0; i < server->workerc; i++) {
+        struct cli_server_worker * const w = &server->workerv[i];
+
+        cli_free(w->args);
+        cli_free(w->argv);
+        cli_free(w->pfds);
+        cli_free(w->arena);
+    }
+
+    pool_destroy(server);
+
+    cli_free(server->workerv);
+    server->workerv = NULL;
+    server->workerc = 0;
+
+    if (server->fd >= 0) {
+        close(server->fd);
+        unlink(server->path);
+    }
+    if (server->wake[0] >= 0)
+        close(server->wake[0]);
+    if (server->wake[1] >= 0)
+        close(server->wake[1]);
+
+    server->fd = server->wake[0] = server->wake[1] = -1;
+}
+
+merr_t
+cli_server_start(struct cli_server * const server, const struct cli * const cli)
+{
+    merr_t err;
+    unsigned int workers;
+    sigset_t pipe_set, saved;
+
+    if (!server || !cli || !server->path || (server->data_sz && !server->parser.data))
+        return merr(EINVAL);
+
+    workers = server->workers ? server->workers : (unsigned int)online_processors();
+
+    server->cli = cli;
+    server->fd = server->wake[0] = server->wake[1] = -1;
+    server->pool = NULL;
+    server->workerc = 0;
+
+    /* Workers hold on to their share of memory for as long as they run. */
+    server->workerv = cli_calloc(workers, sizeof(*server->workerv));
+    if (!server->workerv)
+        return merr(ENOMEM);
+
+    if (pipe(server->wake) == -1) {
+        err = merr(errno);
+        server->wake[0] = server->wake[1] = -1;
+        server_release(server);
+        return err;
+    }
+
+    err = pool_create(server);
+    if (!err)
+        err = listen_on(server);
+    if (err) {
+        server_release(server);
+        return err;
+    }
+
+    /* Workers write to streams clients pass, whose readers may be gone, and
+     * inherit this mask, so SIGPIPE never takes the process down.
+     */
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &saved);
+
+    for (unsigned int i = 0; i < workers; i++) {
+        int rc;
+        struct cli_server_worker * const w = &server->workerv[i];
+
+        w->server = server;
+        w->arena = cli_malloc(ARENA_SZ + server->data_sz);
+        if (!w->arena) {
+            err = merr(ENOMEM);
+            break;
+        }
+        w->data = w->arena + ARENA_SZ;
+
+        rc = pthread_create(&w->thread, NULL, worker, w);
+        if (rc) {
+            cli_free(w->arena);
+            w->arena = NULL;
+            err = merr(rc);
+            break;
+        }
+
+        server->workerc++;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (err) {
+        cli_server_stop(server);
+        return err;
+    }
+
+    return 0;
+}
+
+void
+cli_server_stop(struct cli_server * const server)
+{
+    const char byte = 0;
+
+    if (!server || !server->workerv)
+        return;
+
+    /* Never read, so workers reading a request see it too. */
+    while (write(server->wake[1], &byte, 1) == -1 && errno == EINTR)
+        ;
+
+    for (unsigned int i = 0; i < server->workerc; i++)
+        pthread_join(server->workerv[i].thread, NULL);
+
+    server_release(server);
+}
+
+merr_t
+cli_client_connect(struct cli_client * const client, const char * const path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (!client || !path)
+        return merr(EINVAL);
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return merr(ENAMETOOLONG);
+
+    strcpy(addr.sun_path, path);
+
+    client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client->fd == -1)
+        return merr(errno);
+
+    if (connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        const merr_t err = merr(errno);
+
+        close(client->fd);
+        client->fd = -1;
+
+        return err;
+    }
+
+    return 0;
+}
+
+merr_t
+cli_client_call(
+    struct cli_client * const client,
+    const int argc,
+    char * const * const argv,
+    const int out_fd,
+    const int err_fd,
+    int * const exit_code)
+{
+    merr_t err;
+    ssize_t n;
+    char *p;
+    char *args;
+    char stack[4096];
+    size_t size = 0;
+    size_t fdc = 0;
+    int fds[2];
+    struct request req = { .magic = MAGIC };
+    struct response res;
+    struct msghdr msg = { 0 };
+    struct iovec iov = { .iov_base = &req, .iov_len = sizeof(req) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+
+    if (!client || client->fd < 0 || argc < 1 || !argv || !exit_code)
+        return merr(EINVAL);
+
+    for (int i = 0; i < argc; i++) {
+        size += strlen(argv[i]) + 1;
+        if (size > MAX_REQUEST)
+            return merr(E2BIG);
+    }
+
+    args = size <= sizeof(stack) ? stack : cli_malloc(size);
+    if (!args)
+        return merr(ENOMEM);
+
+    p = args;
+    for (int i = 0; i < argc; i++) {
+        const size_t len = strlen(argv[i]) + 1;
+
+        memcpy(p, argv[i], len);
+        p += len;
+    }
+
+    if (out_fd >= 0) {
+        fds[fdc++] = out_fd;
+        req.pass |= PASS_OUT;
+    }
+    if (err_fd >= 0) {
+        fds[fdc++] = err_fd;
+        req.pass |= PASS_ERR;
+    }
+
+    req.argc = (uint32_t)argc;
+    req.size = (uint32_t)size;
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fdc > 0) {
+        struct cmsghdr *cmsg;
+
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = CMSG_SPACE(fdc * sizeof(int));
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fdc * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, fdc * sizeof(int));
+    }
+
+    do {
+        n = sendmsg(client->fd, &msg, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+
+    if (n == -1) {
+        err = merr(errno);
+    } else {
+        /* The descriptors went with the first byte, the rest is plain data. */
+        err = write_all(client->fd, (char *)&req + n, sizeof(req) - (size_t)n);
+        if (!err)
+            err = write_all(client->fd, args, size);
+    }
+
+    if (args != stack)
+        cli_free(args);
+
+    if (err)
+        return err;
+
+    err = read_all(client->fd, -1, &res, sizeof(res));
+    if (err)
+        return err;
+
+    *exit_code = res.exit_code;
+
+    return 0;
+}
+
+void
+cli_client_close(struct cli_client * const client)
+{
+    if (!client || client->fd < 0)
+        return;
+
+    close(client->fd);
+    client->fd = -1;
+}
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcli/stats.h>
+
+#include "stats.h"
+
+atomic_int cli_stats_state = CLI_STATS_UNKNOWN;
+struct cli_stats_counters cli_stats_counters;
+
+static const char * const phase_names[CLI_STATS_PHASES] = {
+    [CLI_STATS_REGISTER] = "register",
+    [CLI_STATS_INDEX] = "index",
+    [CLI_STATS_CONFIG] = "config",
+    [CLI_STATS_PARSE] = "parse",
+    [CLI_STATS_CONVERT] = "convert",
+    [CLI_STATS_HELP] = "help",
+    [CLI_STATS_CALLBACK] = "callback",
+    [CLI_STATS_LOAD] = "load",
+};
+
+/* Parses with CLI_STATS_ARG in flight, and the state from before the first
+ * of them.
+ */
+static pthread_mutex_t hold_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int holds;
+static int held_state;
+
+static void
+print_at_exit(void)
+{
+    struct cli_stats stats;
+
+    cli_stats_get(&stats);
+    cli_stats_print(&stats, stderr);
+}
+
+enum cli_stats_state
+cli_stats_init(void)
+{
+    int expected = CLI_STATS_UNKNOWN;
+    const char *env = getenv("LIBCLI_STATS");
+    const int state = env && *env != '\0' && strcmp(env, "0") != 0 ? CLI_STATS_ON : CLI_STATS_OFF;
+
+    /* Whoever gets here first decides, and only once. */
+    if (!atomic_compare_exchange_strong(&cli_stats_state, &expected, state))
+        return (enum cli_stats_state)expected;
+
+    if (state == CLI_STATS_ON)
+        atexit(print_at_exit);
+
+    return (enum cli_stats_state)state;
+}
+
+void
+cli_stats_enable(const bool enable)
+{
+    atomic_store(&cli_stats_state, enable ? CLI_STATS_ON : CLI_STATS_OFF);
+}
+
+void
+cli_stats_hold(void)
+{
+    pthread_mutex_lock(&hold_lock);
+    if (holds++ == 0) {
+        held_state = cli_stats_enabled() ? CLI_STATS_ON : CLI_STATS_OFF;
+        atomic_store(&cli_stats_state, CLI_STATS_ON);
+    }
+    pthread_mutex_unlock(&hold_lock);
+}
+
+void
+cli_stats_release(void)
+{
+    pthread_mutex_lock(&hold_lock);
+    assert(holds > 0);
+    if (--holds == 0)
+        atomic_store(&cli_stats_state, held_state);
+    pthread_mutex_unlock(&hold_lock);
+}
+
+void
+cli_stats_since(struct cli_stats * const stats, const struct cli_stats * const before)
+{
+    for (int i = 0; i < CLI_STATS_PHASES; i++) {
+        stats->phases[i].calls -= before->phases[i].calls;
+        stats->phases[i].ns -= before->phases[i].ns;
+    }
+
+    stats->allocs -= before->allocs;
+    stats->alloc_bytes -= before->alloc_bytes;
+}
+
+void
+cli_stats_get(struct cli_stats * const stats)
+{
+    if (!stats)
+        return;
+
+    for (int i = 0; i < CLI_STATS_PHASES; i++) {
+        stats->phases[i].calls =
+            atomic_load_explicit(&cli_stats_counters.calls[i], memory_order_relaxed);
+        stats->phases[i].ns = atomic_load_explicit(&cli_stats_counters.ns[i], memory_order_relaxed);
+    }
+
+    stats->allocs = atomic_load_explicit(&cli_stats_counters.allocs, memory_order_relaxed);
+    stats->alloc_bytes =
+        atomic_load_explicit(&cli_stats_counters.alloc_bytes, memory_order_relaxed);
+}
+
+void
+cli_stats_reset(void)
+{
+    for (int i = 0; i < CLI_STATS_PHASES; i++) {
+        atomic_store_explicit(&cli_stats_counters.calls[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&cli_stats_counters.ns[i], 0, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&cli_stats_counters.allocs, 0, memory_order_relaxed);
+    atomic_store_explicit(&cli_stats_counters.alloc_bytes, 0, memory_order_relaxed);
+}
+
+void
+cli_stats_print(const struct cli_stats * const stats, FILE * const stream)
+{
+    if (!stats || !stream)
+        return;
+
+    flockfile(stream);
+    fprintf(stream, "%-10s %10s %14s\n", "phase", "calls", "time (us)");
+    for (int i = 0; i < CLI_STATS_PHASES; i++) {
+        fprintf(
+            stream,
+            "%-10s %10llu %14.3f\n",
+            phase_names[i],
+            (unsigned long long)stats->phases[i].calls,
+            (double)stats->phases[i].ns / 1000.0);
+    }
+    fprintf(stream, "%-10s %10llu\n", "allocs", (unsigned long long)stats->allocs);
+    fprintf(stream, "%-10s %10llu\n", "bytes", (unsigned long long)stats->alloc_bytes);
+    funlockfile(stream);
+}
@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_STATS_PRIVATE_H
+#define LIBCLI_STATS_PRIVATE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <libcli/stats.h>
+
+/* Name of the hidden argument which prints statistics after a parse. */
+#define CLI_STATS_ARG "--cli-stats"
+
+enum cli_stats_state {
+    CLI_STATS_UNKNOWN,
+    CLI_STATS_OFF,
+    CLI_STATS_ON,
+};
+
+struct cli_stats_counters {
+    atomic_uint_fast64_t calls[CLI_STATS_PHASES];
+    atomic_uint_fast64_t ns[CLI_STATS_PHASES];
+    atomic_uint_fast64_t allocs;
+    atomic_uint_fast64_t alloc_bytes;
+};
+
+extern atomic_int cli_stats_state;
+extern struct cli_stats_counters cli_stats_counters;
+
+/* Decide from the environment on first use. */
+enum cli_stats_state
+cli_stats_init(void);
+
+/* Keep statistics enabled while a parse with CLI_STATS_ARG runs. Once the
+ * last of any concurrent ones releases them, they go back to the state from
+ * before the first.
+ */
+void
+cli_stats_hold(void);
+
+void
+cli_stats_release(void);
+
+/* Turn stats into what was counted since before. */
+void
+cli_stats_since(struct cli_stats *stats, const struct cli_stats *before);
+
+static inline bool
+cli_stats_enabled(void)
+{
+    int state = atomic_load_explicit(&cli_stats_state, memory_order_relaxed);
+
+    if (state == CLI_STATS_UNKNOWN)
+        state = (int)cli_stats_init();
+
+    return state == CLI_STATS_ON;
+}
+
+static inline uint64_t
+cli_stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* Returns 0 when disabled, which cli_stats_stop() then ignores. */
+static inline uint64_t
+cli_stats_start(void)
+{
+    return cli_stats_enabled() ? cli_stats_now() : 0;
+}
+
+static inline void
+cli_stats_stop(const enum cli_stats_phase phase, const uint64_t start)
+{
+    if (!start)
+        return;
+
+    atomic_fetch_add_explicit(&cli_stats_counters.calls[phase], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(
+        &cli_stats_counters.ns[phase], cli_stats_now() - start, memory_order_relaxed);
+}
+
+static inline void
+cli_stats_alloc(const size_t size)
+{
+    if (!cli_stats_enabled())
+        return;
+
+    atomic_fetch_add_explicit(&cli_stats_counters.allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cli_stats_counters.alloc_bytes, size, memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "suggest.h"
+
+#define WORD_MAX 64
+
+void
+cli_suggestions_init(struct cli_suggestions * const sg, const char * const word, const size_t len)
+{
+    memset(sg, 0, sizeof(*sg));
+
+    if (len == 0 || len > WORD_MAX)
+        return;
+
+    sg->len = len;
+    for (size_t i = 0; i < len; i++)
+        sg->peq[(unsigned char)word[i]] |= UINT64_C(1) << i;
+
+    /* Roughly a third of the word may be wrong, but never more than three
+     * edits, past which suggestions stop looking related.
+     */
+    sg->max = (unsigned int)((len + 2) / 3);
+    if (sg->max > 3)
+        sg->max = 3;
+}
+
+unsigned int
+cli_suggestions_distance(
+    const struct cli_suggestions * const sg,
+    const char * const text,
+    const size_t len,
+    const unsigned int max)
+{
+    uint64_t pv = ~UINT64_C(0);
+    uint64_t mv = 0;
+    size_t score = sg->len;
+    const uint64_t high = UINT64_C(1) << (sg->len - 1);
+
+    /* Each character of difference in length costs an insertion or a
+     * deletion.
+     */
+    if ((len > sg->len ? len - sg->len : sg->len - len) > max)
+        return max + 1;
+
+    for (size_t j = 0; j < len; j++) {
+        const uint64_t eq = sg->peq[(unsigned char)text[j]];
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & high) {
+            score++;
+        } else if (mh & high) {
+            score--;
+        }
+
+        /* The first row of the matrix grows by one per character. */
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        /* The rest of the text can take at most one off per character. */
+        if (score > max + (len - j - 1))
+            return max + 1;
+    }
+
+    return (unsigned int)score;
+}
+
+void
+cli_suggestions_add(struct cli_suggestions * const sg, const char * const name)
+{
+    unsigned int d;
+
+    if (sg->len == 0)
+        return;
+
+    d = cli_suggestions_distance(sg, name, strlen(name), sg->max);
+    if (d > sg->max)
+        return;
+
+    /* A closer name replaces everything found so far. */
+    if (d < sg->max && sg->count > 0)
+        sg->count = 0;
+    sg->max = d;
+
+    if (sg->count < CLI_SUGGESTIONS_MAX)
+        sg->names[sg->count++] = name;
+}
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_SUGGEST_H
+#define LIBCLI_SUGGEST_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CLI_SUGGESTIONS_MAX 4
+
+/* Names closest to a mistyped word by edit distance. The word is encoded
+ * once, then each candidate costs one pass over its characters with the
+ * bit-parallel algorithm of Myers, as formulated by Hyyrö.
+ */
+struct cli_suggestions {
+    /* Bit i of peq[c] is set if the i-th character of the word is c. */
+    uint64_t peq[UCHAR_MAX + 1];
+    size_t len;
+    /* Largest distance still worth suggesting, which shrinks to the best one
+     * found so far.
+     */
+    unsigned int max;
+    size_t count;
+    const char *names[CLI_SUGGESTIONS_MAX];
+};
+
+/* Words longer than 64 characters are not matched against anything. */
+void
+cli_suggestions_init(struct cli_suggestions *sg, const char *word, size_t len);
+
+void
+cli_suggestions_add(struct cli_suggestions *sg, const char *name);
+
+/* Levenshtein distance between the word and the len characters of text, or
+ * some value greater than max once it is known to exceed it.
+ */
+unsigned int
+cli_suggestions_distance(
+    const struct cli_suggestions *sg,
+    const char *text,
+    size_t len,
+    unsigned int max);
+
+#endif
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#ifndef LIBCLI_TYPE_H
+#define LIBCLI_TYPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libcli/parser.h>
+
+static inline size_t
+cli_type_size(const enum cli_type type)
+{
+    switch (type) {
+    case CLI_TYPE_BOOL:
+        return sizeof(bool);
+    case CLI_TYPE_UCHAR:
+        return sizeof(unsigned char);
+    case CLI_TYPE_USHORT:
+        return sizeof(unsigned short);
+    case CLI_TYPE_UINT:
+        return sizeof(unsigned int);
+    case CLI_TYPE_ULONG:
+        return sizeof(unsigned long);
+    case CLI_TYPE_ULONGLONG:
+        return sizeof(unsigned long long);
+    case CLI_TYPE_U8:
+        return sizeof(uint8_t);
+    case CLI_TYPE_U16:
+        return sizeof(uint16_t);
+    case CLI_TYPE_U32:
+        return sizeof(uint32_t);
+    case CLI_TYPE_U64:
+        return sizeof(uint64_t);
+    case CLI_TYPE_CHAR:
+        return sizeof(char);
+    case CLI_TYPE_SHORT:
+        return sizeof(short);
+    case CLI_TYPE_INT:
+        return sizeof(int);
+    case CLI_TYPE_LONG:
+        return sizeof(long);
+    case CLI_TYPE_LONGLONG:
+        return sizeof(long long);
+    case CLI_TYPE_I8:
+        return sizeof(int8_t);
+    case CLI_TYPE_I16:
+        return sizeof(int16_t);
+    case CLI_TYPE_I32:
+        return sizeof(int32_t);
+    case CLI_TYPE_I64:
+        return sizeof(int64_t);
+    case CLI_TYPE_FLOAT:
+        return sizeof(float);
+    case CLI_TYPE_DOUBLE:
+        return sizeof(double);
+    case CLI_TYPE_LONGDOUBLE:
+        return sizeof(long double);
+    case CLI_TYPE_STRING:
+        return sizeof(const char *);
+    case CLI_TYPE_CHOICE:
+        return sizeof(int);
+    }
+
+    return 0;
+}
+
+/* Option and argument data is relative to base when the parse provides one. */
+static inline void *
+cli_resolve_data(void * const data, void * const base)
+{
+    return base ? (char *)base + (uintptr_t)data : data;
+}
+
+#endif
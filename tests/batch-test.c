@@ -0,0 +1,411 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/batch.h>
+#include <libcli/parser.h>
+
+struct results {
+    size_t count;
+    size_t lines[8];
+    int exit_codes[8];
+};
+
+struct state {
+    int verbose;
+    int level;
+    int runs;
+    int last_level;
+    int last_verbose;
+    struct cli_list tags;
+    size_t last_tags;
+};
+
+static void
+report(const size_t line, const int exit_code, void * const ctx)
+{
+    struct results *res = ctx;
+
+    g_assert_cmpuint(res->count, <, NELEM(res->lines));
+
+    res->lines[res->count] = line;
+    res->exit_codes[res->count] = exit_code;
+    res->count++;
+}
+
+static void
+run_cb(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    struct state *s = ctx;
+
+    (void)cli;
+    (void)exit_code;
+
+    s->runs++;
+    s->last_level = s->level;
+    s->last_verbose = s->verbose;
+    s->last_tags = s->tags.count;
+}
+
+static struct cli_option run_options[] = {
+    {
+        .shrt = 'l',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "level",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct state, level),
+    },
+    {
+        .shrt = 't',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_APPEND,
+        .delimiter = ',',
+        .data = (void *)offsetof(struct state, tags),
+    },
+};
+
+static struct cli_option root_options[] = {
+    {
+        .shrt = 'v',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = (void *)offsetof(struct state, verbose),
+    },
+};
+
+static void
+tree_init(struct cli * const root, struct cli * const run)
+{
+    merr_t err;
+
+    memset(root, 0, sizeof(*root));
+    memset(run, 0, sizeof(*run));
+    root->name = "batch";
+    run->name = "run";
+    run->callback = run_cb;
+
+    err = cli_add_options(run, NELEM(run_options), run_options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_options(root, NELEM(root_options), root_options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommand(root, run);
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+test_parse_batch_lines(void)
+{
+    merr_t err;
+    FILE *input, *err_stream;
+    char *err_buf = NULL;
+    size_t err_sz = 0;
+    struct cli root, run;
+    struct results res = { 0 };
+    struct state s = { .level = 7 };
+    struct cli_batch batch = { .delim = '\n', .report = report, .ctx = &res };
+    struct cli_parser parser = { .program_name = "batch", .data = &s, .ctx = &s };
+    static char lines[] = "-vv run -l 3\n"
+                          "\n"
+                          "run\n"
+                          "  run\t-x\n"
+                          "-v run -l9";
+
+    tree_init(&root, &run);
+
+    input = fmemopen(lines, sizeof(lines) - 1, "r");
+    g_assert_nonnull(input);
+    err_stream = open_memstream(&err_buf, &err_sz);
+    g_assert_nonnull(err_stream);
+    parser.err = err_stream;
+
+    err = cli_parse_batch(&root, input, &batch, &parser);
+    g_assert_no_errno(merr_errno(err));
+    fclose(err_stream);
+
+    g_assert_cmpuint(res.count, ==, 4);
+    g_assert_cmpuint(res.lines[0], ==, 1);
+    g_assert_cmpint(res.exit_codes[0], ==, 0);
+    g_assert_cmpuint(res.lines[1], ==, 3);
+    g_assert_cmpint(res.exit_codes[1], ==, 0);
+    g_assert_cmpuint(res.lines[2], ==, 4);
+    g_assert_cmpint(res.exit_codes[2], ==, EX_USAGE);
+    g_assert_cmpuint(res.lines[3], ==, 5);
+    g_assert_cmpint(res.exit_codes[3], ==, 0);
+
+    /* Line 3 must not see the storage written by line 1. */
+    g_assert_cmpint(s.runs, ==, 3);
+    g_assert_cmpint(s.last_level, ==, 9);
+    g_assert_cmpint(s.last_verbose, ==, 1);
+    g_assert_nonnull(strstr(err_buf, "batch: "));
+
+    fclose(input);
+    free(err_buf);
+    cli_fini(&root);
+}
+
+static void
+test_parse_batch_reset(void)
+{
+    merr_t err;
+    FILE *input;
+    struct cli root, run;
+    struct results res = { 0 };
+    struct state s = { .level = 7 };
+    struct cli_batch batch = { .delim = '\n', .report = report, .ctx = &res };
+    struct cli_parser parser = { .data = &s, .ctx = &s };
+    static char lines[] = "run -l 3 -t a,b -t c\nrun -t d\nrun\n";
+
+    tree_init(&root, &run);
+
+    input = fmemopen(lines, sizeof(lines) - 1, "r");
+    g_assert_nonnull(input);
+
+    err = cli_parse_batch(&root, input, &batch, &parser);
+    g_assert_no_errno(merr_errno(err));
+
+    g_assert_cmpuint(res.count, ==, 3);
+    g_assert_cmpint(s.runs, ==, 3);
+    g_assert_cmpint(s.last_level, ==, 7);
+
+    /* Lists are emptied again between lines. */
+    g_assert_cmpuint(s.last_tags, ==, 0);
+    g_assert_cmpuint(s.tags.count, ==, 0);
+    g_assert_null(s.tags.strings);
+
+    fclose(input);
+    cli_list_fini(&s.tags);
+    cli_fini(&root);
+}
+
+static void
+test_parse_batch_fd(void)
+{
+    merr_t err;
+    int fds[2];
+    ssize_t rc;
+    struct cli root, run;
+    struct results res = { 0 };
+    struct state s = { 0 };
+    struct cli_batch batch = { .delim = '\0', .report = report, .ctx = &res };
+    struct cli_parser parser = { .data = &s, .ctx = &s };
+    static const char lines[] = "run -l 1\0-v\nrun -l\t2\0";
+
+    tree_init(&root, &run);
+
+    g_assert_cmpint(pipe(fds), ==, 0);
+    rc = write(fds[1], lines, sizeof(lines) - 1);
+    g_assert_cmpint(rc, ==, (ssize_t)sizeof(lines) - 1);
+    close(fds[1]);
+
+    err = cli_parse_batch_fd(&root, fds[0], &batch, &parser);
+    g_assert_no_errno(merr_errno(err));
+
+    /* Newlines are just blanks when lines are NUL-delimited. */
+    g_assert_cmpuint(res.count, ==, 2);
+    g_assert_cmpint(s.runs, ==, 2);
+    g_assert_cmpint(s.last_level, ==, 2);
+    g_assert_cmpint(s.last_verbose, ==, 1);
+
+    close(fds[0]);
+    cli_fini(&root);
+}
+
+struct quoted_state {
+    const char *name;
+    size_t count;
+    char names[4][16];
+};
+
+static void
+quoted_cb(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    struct quoted_state *s = ctx;
+
+    (void)cli;
+    (void)exit_code;
+
+    /* Values only live as long as their line. */
+    g_assert_cmpuint(s->count, <, NELEM(s->names));
+    snprintf(s->names[s->count++], sizeof(s->names[0]), "%s", s->name);
+}
+
+/* Lines are split with shell quoting, and one which does not split only
+ * fails itself.
+ */
+static void
+test_parse_batch_quoted(void)
+{
+    merr_t err;
+    FILE *input, *err_stream;
+    char *err_buf = NULL;
+    size_t err_sz = 0;
+    struct results res = { 0 };
+    struct quoted_state s = { 0 };
+    struct cli cli = { .name = "batch", .callback = quoted_cb };
+    struct cli_batch batch = { .delim = '\n', .report = report, .ctx = &res };
+    struct cli_parser parser = { .program_name = "/usr/bin/batch", .data = &s, .ctx = &s };
+    struct cli_option option = {
+        .shrt = 'n',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct quoted_state, name),
+    };
+    static char lines[] = "-n 'a b'\n-n \"unterminated\n-n c\\ d\n";
+
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+
+    input = fmemopen(lines, sizeof(lines) - 1, "r");
+    g_assert_nonnull(input);
+    err_stream = open_memstream(&err_buf, &err_sz);
+    g_assert_nonnull(err_stream);
+    parser.err = err_stream;
+
+    err = cli_parse_batch(&cli, input, &batch, &parser);
+    g_assert_no_errno(merr_errno(err));
+    fclose(err_stream);
+
+    g_assert_cmpuint(res.count, ==, 3);
+    g_assert_cmpint(res.exit_codes[0], ==, 0);
+    g_assert_cmpint(res.exit_codes[1], ==, EX_USAGE);
+    g_assert_cmpint(res.exit_codes[2], ==, 0);
+    g_assert_cmpstr(err_buf, ==, "batch: line 2: Unterminated quote or trailing backslash\n");
+    g_assert_cmpuint(s.count, ==, 2);
+    g_assert_cmpstr(s.names[0], ==, "a b");
+    g_assert_cmpstr(s.names[1], ==, "c d");
+
+    fclose(input);
+    free(err_buf);
+    cli_fini(&cli);
+}
+
+struct stub_state {
+    int jobs;
+    int last_jobs;
+};
+
+static void
+stub_cb(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    struct stub_state *s = ctx;
+
+    (void)cli;
+    (void)exit_code;
+
+    s->last_jobs = s->jobs;
+}
+
+static struct cli_option stub_options[] = {
+    {
+        .shrt = 'j',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct stub_state, jobs),
+    },
+};
+
+static merr_t
+stub_loader(struct cli * const cli, void * const ctx)
+{
+    unsigned int * const loads = ctx;
+
+    (*loads)++;
+    cli->callback = stub_cb;
+
+    return cli_add_options(cli, NELEM(stub_options), stub_options);
+}
+
+/* Options registered by a loader are reset like any other, and stubs which
+ * no line reaches are never loaded.
+ */
+static void
+test_parse_batch_stub(void)
+{
+    merr_t err;
+    FILE *input;
+    unsigned int loads[2] = { 0 };
+    struct cli root = { .name = "batch" };
+    struct cli stubs[] = {
+        { .name = "build", .loader = stub_loader, .loader_ctx = &loads[0] },
+        { .name = "clean", .loader = stub_loader, .loader_ctx = &loads[1] },
+    };
+    struct results res = { 0 };
+    struct stub_state s = { .jobs = 1 };
+    struct cli_batch batch = { .delim = '\n', .report = report, .ctx = &res };
+    struct cli_parser parser = { .data = &s, .ctx = &s };
+    static char lines[] = "build -j 8\nbuild\n";
+
+    err = cli_add_subcommands(&root, NELEM(stubs), stubs);
+    g_assert_no_errno(merr_errno(err));
+
+    input = fmemopen(lines, sizeof(lines) - 1, "r");
+    g_assert_nonnull(input);
+
+    err = cli_parse_batch(&root, input, &batch, &parser);
+    g_assert_no_errno(merr_errno(err));
+
+    g_assert_cmpuint(res.count, ==, 2);
+    g_assert_cmpint(res.exit_codes[0], ==, 0);
+    g_assert_cmpint(res.exit_codes[1], ==, 0);
+    g_assert_cmpint(s.last_jobs, ==, 1);
+    g_assert_cmpuint(loads[0], ==, 1);
+    g_assert_cmpuint(loads[1], ==, 0);
+
+    fclose(input);
+    cli_fini(&root);
+}
+
+static void
+test_parse_batch_invalid_args(void)
+{
+    merr_t err;
+    struct cli cli = { .name = "test" };
+    struct cli_parser parser = { 0 };
+    struct cli_batch batch = { .delim = ';' };
+
+    err = cli_parse_batch(&cli, stdin, &batch, &parser);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    batch.delim = '\n';
+    err = cli_parse_batch(&cli, NULL, &batch, &parser);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    err = cli_parse_batch_fd(&cli, -1, &batch, &parser);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/batch/lines", test_parse_batch_lines);
+    g_test_add_func("/batch/reset", test_parse_batch_reset);
+    g_test_add_func("/batch/fd", test_parse_batch_fd);
+    g_test_add_func("/batch/stub", test_parse_batch_stub);
+    g_test_add_func("/batch/quoted", test_parse_batch_quoted);
+    g_test_add_func("/batch/invalid-args", test_parse_batch_invalid_args);
+
+    return g_test_run();
+}
@@ -0,0 +1,268 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+static const char * const formats[] = { "json", "csv", "table", NULL };
+
+static int format;
+
+static struct cli_option format_option = {
+    .shrt = 'f',
+#ifndef CLI_NO_GETOPT_LONG
+    .lng = "format",
+#endif
+    .description = "Output format",
+    .argument = CLI_HAS_ARG_REQUIRED,
+    .type = CLI_TYPE_CHOICE,
+    .action = CLI_ACTION_STORE,
+    .data = &format,
+    .choices = formats,
+};
+
+static void
+run_store(const bool compile)
+{
+    merr_t err;
+    int exit_code;
+    FILE *err_stream;
+    char *buf = NULL;
+    size_t sz = 0;
+    struct cli cli = { .name = "test" };
+
+    err = cli_add_option(&cli, &format_option);
+    g_assert_no_errno(merr_errno(err));
+    if (compile) {
+        err = cli_compile(&cli);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    {
+        char *args[] = { "test", "-f", "csv" };
+
+        format = -1;
+        err = cli_parse(&cli, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(format, ==, 1);
+    }
+
+#ifndef CLI_NO_GETOPT_LONG
+    {
+        char *args[] = { "test", "--format=table" };
+
+        err = cli_parse(&cli, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(format, ==, 2);
+    }
+#endif
+
+    /* Values are matched exactly, and close ones are suggested. */
+    err_stream = open_memstream(&buf, &sz);
+    g_assert_nonnull(err_stream);
+
+    {
+        char *args[] = { "test", "-f", "jsno" };
+        struct cli_parser parser = { .err = err_stream };
+
+        format = -1;
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, !=, 0);
+        g_assert_cmpint(format, ==, -1);
+    }
+
+    fclose(err_stream);
+    g_assert_nonnull(strstr(buf, "Invalid value for option '-f': 'jsno'"));
+    g_assert_nonnull(strstr(buf, "Did you mean 'json'?"));
+    free(buf);
+
+    cli_fini(&cli);
+}
+
+static void
+test_choice_store(void)
+{
+    run_store(false);
+    run_store(true);
+}
+
+static void
+test_choice_append(void)
+{
+    merr_t err;
+    int exit_code;
+    struct cli_list list = { 0 };
+    struct cli cli = { .name = "test" };
+    struct cli_option option = {
+        .shrt = 'f',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_CHOICE,
+        .action = CLI_ACTION_APPEND,
+        .delimiter = ',',
+        .data = &list,
+        .choices = formats,
+    };
+    char *args[] = { "test", "-f", "table,json", "-f", "csv" };
+
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_compile(&cli);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_parse(&cli, NELEM(args), args, &exit_code);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+    g_assert_cmpuint(list.count, ==, 3);
+    g_assert_cmpint(((int *)list.items)[0], ==, 2);
+    g_assert_cmpint(((int *)list.items)[1], ==, 0);
+    g_assert_cmpint(((int *)list.items)[2], ==, 1);
+
+    cli_list_fini(&list);
+    cli_fini(&cli);
+}
+
+static void
+test_choice_many(void)
+{
+    merr_t err;
+    int exit_code;
+    int zone = -1;
+    enum { ZONES = 5000 };
+    char (*names)[32];
+    const char **zones;
+    struct cli cli = { .name = "test" };
+    struct cli_option option = {
+        .shrt = 'z',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_CHOICE,
+        .action = CLI_ACTION_STORE,
+        .data = &zone,
+    };
+
+    names = g_malloc(ZONES * sizeof(*names));
+    zones = g_malloc((ZONES + 1) * sizeof(*zones));
+    for (int i = 0; i < ZONES; i++) {
+        snprintf(names[i], sizeof(names[i]), "region-%d-zone-%c", i / 3, 'a' + i % 3);
+        zones[i] = names[i];
+    }
+    zones[ZONES] = NULL;
+    option.choices = zones;
+
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_compile(&cli);
+    g_assert_no_errno(merr_errno(err));
+
+    for (int i = 0; i < ZONES; i += 7) {
+        char *args[] = { "test", "-z", names[i] };
+
+        err = cli_parse(&cli, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(zone, ==, i);
+    }
+
+    cli_fini(&cli);
+    g_free(zones);
+    g_free(names);
+}
+
+static void
+test_choice_help(void)
+{
+    merr_t err;
+    int exit_code;
+    FILE *out;
+    char *buf = NULL;
+    size_t sz = 0;
+    struct cli cli = { .name = "test" };
+    struct cli_option help = { .shrt = 'h', .action = CLI_ACTION_HELP };
+    char *args[] = { "test", "-h" };
+    struct cli_parser parser = { 0 };
+
+    err = cli_add_option(&cli, &format_option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_option(&cli, &help);
+    g_assert_no_errno(merr_errno(err));
+
+    out = open_memstream(&buf, &sz);
+    g_assert_nonnull(out);
+    parser.out = out;
+
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    fclose(out);
+
+    g_assert_nonnull(strstr(buf, "One of: json, csv, table\n"));
+    free(buf);
+
+    cli_fini(&cli);
+}
+
+static void
+test_choice_invalid(void)
+{
+    merr_t err;
+    int value;
+    static const char * const none[] = { NULL };
+    static const char * const twice[] = { "a", "b", "a", NULL };
+    struct cli cli = { .name = "test" };
+    struct cli_option option = {
+        .shrt = 'c',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_CHOICE,
+        .action = CLI_ACTION_STORE,
+        .data = &value,
+    };
+    struct cli_argument argument = {
+        .name = "arg",
+        .type = CLI_TYPE_CHOICE,
+        .data = &value,
+    };
+
+    err = cli_add_option(&cli, &option);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+    option.choices = none;
+    err = cli_add_option(&cli, &option);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    err = cli_add_argument(&cli, &argument);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    option.choices = twice;
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_compile(&cli);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+
+    cli_fini(&cli);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/choice/store", test_choice_store);
+    g_test_add_func("/choice/append", test_choice_append);
+    g_test_add_func("/choice/many", test_choice_many);
+    g_test_add_func("/choice/help", test_choice_help);
+    g_test_add_func("/choice/invalid", test_choice_invalid);
+
+    return g_test_run();
+}
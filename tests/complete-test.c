@@ -0,0 +1,241 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+static int called;
+
+static void
+callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    called++;
+    *exit_code = 0;
+}
+
+static struct cli_option root_options[] = {
+    {
+        .shrt = 'v',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "verbose",
+#endif
+        .description = "More output",
+        .action = CLI_ACTION_HELP,
+    },
+    {
+        .shrt = 'C',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "directory",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .action = CLI_ACTION_HELP,
+    },
+#ifndef CLI_NO_GETOPT_LONG
+    {
+        .lng = "version",
+        .action = CLI_ACTION_HELP,
+    },
+#endif
+};
+
+static struct cli_argument run_arguments[] = {
+    { .name = "target", .description = "What to run", .type = CLI_TYPE_STRING },
+    { .name = "args", .type = CLI_TYPE_STRING, .variadic = true },
+};
+
+static struct cli root;
+
+static struct cli subcommands[] = {
+    { .name = "build", .description = "Build things" },
+    { .name = "bench" },
+    { .name = "run", .description = "Run things" },
+};
+
+static void
+tree_init(struct cli * const cli)
+{
+    merr_t err;
+
+    cli->name = "prog";
+    cli->flags = CLI_FLAG_COMPLETION;
+    cli->callback = callback;
+
+    err = cli_add_options(cli, NELEM(root_options), root_options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommands(cli, NELEM(subcommands), subcommands);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_arguments(&subcommands[2], NELEM(run_arguments), run_arguments);
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+check(const struct cli * const cli, const int argc, char ** const argv, const char * const expected)
+{
+    merr_t err;
+    char *buf;
+    size_t buf_sz;
+    FILE *stream;
+    int exit_code = -1;
+    struct cli_parser parser = { 0 };
+
+    stream = open_memstream(&buf, &buf_sz);
+    g_assert_nonnull(stream);
+    parser.out = stream;
+
+    err = cli_parse_r(cli, argc, argv, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+
+    fclose(stream);
+    g_assert_cmpstr(buf, ==, expected);
+    free(buf);
+}
+
+#define CHECK(cli, expected, ...)                                                                  \
+    do {                                                                                           \
+        char *argv[] = { "prog", "__complete", __VA_ARGS__ };                                      \
+        check((cli), NELEM(argv), argv, (expected));                                               \
+    } while (0)
+
+static void
+test_complete(void)
+{
+    for (int compiled = 0; compiled < 2; compiled++) {
+        CHECK(&root, "bench\nbuild\tBuild things\nrun\tRun things\n", "");
+        CHECK(&root, "bench\nbuild\tBuild things\n", "b");
+        CHECK(&root, "build\tBuild things\n", "bu");
+        CHECK(&root, "", "x");
+        CHECK(&root, "<target>\tWhat to run\n", "run", "");
+        CHECK(&root, "<args>\n", "run", "a", "b", "");
+
+        /* Option values are skipped over, and left to the shell. */
+        CHECK(&root, "-C\n", "-C");
+        CHECK(&root, "", "-C", "");
+        CHECK(&root, "bench\n", "-C", "dir", "-v", "be");
+        CHECK(&root, "bench\n", "-Cdir", "be");
+        CHECK(&root, "-v\tMore output\n", "-v");
+
+#ifndef CLI_NO_GETOPT_LONG
+        CHECK(&root, "-C\n-v\tMore output\n--directory\n--verbose\tMore output\n--version\n", "-");
+        CHECK(&root, "--verbose\tMore output\n--version\n", "--ver");
+        CHECK(&root, "", "--directory=");
+        CHECK(&root, "run\tRun things\n", "--directory", "x", "r");
+        CHECK(&root, "run\tRun things\n", "--directory=x", "r");
+#endif
+
+        /* Nothing after -- is an option. */
+        CHECK(&root, "", "--", "-");
+
+        g_assert_no_errno(merr_errno(cli_compile(&root)));
+    }
+
+    /* Without the word, there is nothing to complete but subcommands. */
+    {
+        char *argv[] = { "prog", "__complete" };
+
+        check(&root, NELEM(argv), argv, "bench\nbuild\tBuild things\nrun\tRun things\n");
+    }
+
+    g_assert_cmpint(called, ==, 0);
+
+    cli_fini(&root);
+}
+
+static void
+test_complete_disabled(void)
+{
+    merr_t err;
+    int exit_code = -1;
+    struct cli_parser parser = { 0 };
+    char *argv[] = { "prog", "__complete", "b" };
+
+    /* Without the flag, __complete is just an unknown subcommand. */
+    root.flags = 0;
+    parser.err = fopen("/dev/null", "w");
+    g_assert_nonnull(parser.err);
+    err = cli_parse_r(&root, NELEM(argv), argv, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, !=, 0);
+    fclose(parser.err);
+    root.flags = CLI_FLAG_COMPLETION;
+}
+
+/* Bytes of a scratch buffer which completing argv wrote to. */
+static size_t
+arena_touched(const struct cli * const cli, const int argc, char ** const argv)
+{
+    merr_t err;
+    size_t used;
+    int exit_code = -1;
+    static char arena[65536];
+    struct cli_parser parser = { .arena = arena, .arena_sz = sizeof(arena) };
+
+    memset(arena, 0x5a, sizeof(arena));
+    parser.out = fopen("/dev/null", "w");
+    g_assert_nonnull(parser.out);
+
+    err = cli_parse_r(cli, argc, argv, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+    fclose(parser.out);
+
+    for (used = sizeof(arena); used > 0 && arena[used - 1] == 0x5a; used--)
+        ;
+
+    return used;
+}
+
+/* Each level of an uncompiled tree reuses the scratch memory of the one
+ * before it.
+ */
+static void
+test_complete_arena(void)
+{
+    merr_t err;
+    size_t shallow, deep;
+    struct cli top = { .name = "prog", .flags = CLI_FLAG_COMPLETION };
+    struct cli chain[8];
+    char *one[] = { "prog", "__complete", "a", "" };
+    char *seven[] = { "prog", "__complete", "a", "a", "a", "a", "a", "a", "a", "" };
+
+    memset(chain, 0, sizeof(chain));
+    for (size_t i = 0; i < NELEM(chain); i++) {
+        chain[i].name = "a";
+        err = cli_add_subcommand(i == 0 ? &top : &chain[i - 1], &chain[i]);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    shallow = arena_touched(&top, NELEM(one), one);
+    deep = arena_touched(&top, NELEM(seven), seven);
+    g_assert_cmpuint(shallow, >, 0);
+    g_assert_cmpuint(deep, ==, shallow);
+
+    cli_fini(&top);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    tree_init(&root);
+
+    g_test_add_func("/complete", test_complete);
+    g_test_add_func("/complete/disabled", test_complete_disabled);
+    g_test_add_func("/complete/arena", test_complete_arena);
+
+    return g_test_run();
+}
@@ -0,0 +1,335 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/config.h>
+#include <libcli/parser.h>
+
+static char *
+write_file(const char * const contents)
+{
+    int fd;
+    char *path;
+    const size_t len = strlen(contents);
+    const char *dir = getenv("TMPDIR");
+
+    path = g_strdup_printf("%s/libcli-config-XXXXXX", dir ? dir : "/tmp");
+    fd = mkstemp(path);
+    g_assert_cmpint(fd, !=, -1);
+    g_assert_cmpint(write(fd, contents, len), ==, (ssize_t)len);
+    close(fd);
+
+    return path;
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+struct state {
+    const char *name;
+    int count;
+    int verbose;
+    int jobs;
+    struct cli_list targets;
+    int level;
+};
+
+static struct cli_option root_options[] = {
+    {
+        .lng = "name",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct state, name),
+    },
+    {
+        .shrt = 'c',
+        .lng = "count",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct state, count),
+    },
+    {
+        .shrt = 'v',
+        .lng = "verbose",
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = (void *)offsetof(struct state, verbose),
+    },
+};
+
+static struct cli_option build_options[] = {
+    {
+        .shrt = 'j',
+        .lng = "jobs",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct state, jobs),
+    },
+    {
+        .lng = "targets",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_APPEND,
+        .delimiter = ',',
+        .data = (void *)offsetof(struct state, targets),
+    },
+};
+
+static struct cli_option fast_options[] = {
+    {
+        .lng = "level",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct state, level),
+    },
+};
+
+static const char contents[] = "# Shared with other tools\n"
+                               "name = \"from config\"\n"
+                               "count = 3\n"
+                               "verbose = 2\n"
+                               "jobs = 99\n"
+                               "other-tool = ignored\n"
+                               "\n"
+                               "[build]\n"
+                               "jobs = 4\n"
+                               "targets = a,b\n"
+                               "[lint]\n"
+                               "jobs = 1\n"
+                               "[ build   fast ]\n"
+                               "\tlevel=9\r\n"
+                               "[build]\n"
+                               "jobs = 8";
+
+static struct cli root;
+static struct cli build;
+static struct cli fast;
+
+static void
+tree_init(void)
+{
+    merr_t err;
+
+    cli_init(&root);
+    root.name = "test";
+    cli_init(&build);
+    build.name = "build";
+    cli_init(&fast);
+    fast.name = "fast";
+
+    err = cli_add_options(&root, NELEM(root_options), root_options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_options(&build, NELEM(build_options), build_options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_options(&fast, NELEM(fast_options), fast_options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommand(&build, &fast);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommand(&root, &build);
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+test_config_defaults(void)
+{
+    merr_t err;
+    char *path;
+    int exit_code;
+    struct state s;
+    struct cli_config *config;
+    struct cli_parser parser = { .data = &s };
+
+    path = write_file(contents);
+    err = cli_config_open(path, &config, NULL);
+    g_assert_no_errno(merr_errno(err));
+    parser.config = config;
+
+    memset(&s, 0, sizeof(s));
+    {
+        char *args[] = { "test", "build" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    /* Sections only apply to their own command, and later keys win. */
+    g_assert_cmpstr(s.name, ==, "from config");
+    g_assert_cmpint(s.count, ==, 3);
+    g_assert_cmpint(s.verbose, ==, 2);
+    g_assert_cmpint(s.jobs, ==, 8);
+    g_assert_cmpuint(s.targets.count, ==, 2);
+    g_assert_cmpstr(((char **)s.targets.items)[0], ==, "a");
+    g_assert_cmpstr(((char **)s.targets.items)[1], ==, "b");
+    g_assert_cmpint(s.level, ==, 0);
+    cli_list_fini(&s.targets);
+
+    /* The command line takes priority, including over list defaults. */
+    memset(&s, 0, sizeof(s));
+    {
+        char *args[] = { "test", "-c5", "-v", "build", "--jobs=1", "--targets", "x" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    g_assert_cmpstr(s.name, ==, "from config");
+    g_assert_cmpint(s.count, ==, 5);
+    g_assert_cmpint(s.verbose, ==, 1);
+    g_assert_cmpint(s.jobs, ==, 1);
+    g_assert_cmpuint(s.targets.count, ==, 1);
+    g_assert_cmpstr(((char **)s.targets.items)[0], ==, "x");
+    cli_list_fini(&s.targets);
+
+    memset(&s, 0, sizeof(s));
+    {
+        char *args[] = { "test", "build", "fast" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    g_assert_cmpint(s.jobs, ==, 8);
+    g_assert_cmpint(s.level, ==, 9);
+    cli_list_fini(&s.targets);
+
+    /* Compiled trees look keys up through the same index. */
+    err = cli_compile(&root);
+    g_assert_no_errno(merr_errno(err));
+
+    memset(&s, 0, sizeof(s));
+    {
+        char *args[] = { "test", "build", "-j", "2", "fast" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    g_assert_cmpint(s.count, ==, 3);
+    g_assert_cmpint(s.jobs, ==, 2);
+    g_assert_cmpint(s.level, ==, 9);
+    cli_list_fini(&s.targets);
+
+    cli_config_close(config);
+    unlink(path);
+    g_free(path);
+}
+
+static void
+test_config_invalid_value(void)
+{
+    merr_t err;
+    char *path;
+    int exit_code;
+    FILE *err_stream;
+    char *err_buf = NULL;
+    size_t err_sz = 0;
+    struct state s = { 0 };
+    struct cli_config *config;
+    struct cli_parser parser = { .program_name = "test", .data = &s };
+
+    /* Values are only converted for options of the parsed path. */
+    path = write_file("count = many\n[lint]\njobs = lots\n");
+    err = cli_config_open(path, &config, NULL);
+    g_assert_no_errno(merr_errno(err));
+    parser.config = config;
+
+    err_stream = open_memstream(&err_buf, &err_sz);
+    g_assert_nonnull(err_stream);
+    parser.err = err_stream;
+    parser.out = err_stream;
+
+    {
+        char *args[] = { "test", "-c", "1", "build" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    {
+        char *args[] = { "test", "build" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+    }
+
+    fclose(err_stream);
+    g_assert_nonnull(strstr(err_buf, "'-c': 'many'"));
+
+    free(err_buf);
+    cli_config_close(config);
+    unlink(path);
+    g_free(path);
+}
+#endif
+
+static void
+test_config_errors(void)
+{
+    merr_t err;
+    char *path;
+    size_t line = 0;
+    struct cli_config *config;
+
+    err = cli_config_open("/nonexistent/config/file", &config, &line);
+    g_assert_cmpint(merr_errno(err), ==, ENOENT);
+    g_assert_null(config);
+
+    path = write_file("a = 1\n\n[sub\nb = 2\n");
+    err = cli_config_open(path, &config, &line);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+    g_assert_cmpuint(line, ==, 3);
+    unlink(path);
+    g_free(path);
+
+    path = write_file("a = 1\njust a word\n");
+    err = cli_config_open(path, &config, &line);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+    g_assert_cmpuint(line, ==, 2);
+    unlink(path);
+    g_free(path);
+
+    path = write_file("");
+    err = cli_config_open(path, &config, &line);
+    g_assert_no_errno(merr_errno(err));
+    cli_config_close(config);
+    unlink(path);
+    g_free(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+#ifndef CLI_NO_GETOPT_LONG
+    tree_init();
+
+    g_test_add_func("/config/defaults", test_config_defaults);
+    g_test_add_func("/config/invalid-value", test_config_invalid_value);
+#endif
+    g_test_add_func("/config/errors", test_config_errors);
+
+    return g_test_run();
+}
@@ -0,0 +1,254 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include "convert.h"
+
+static void
+test_convert_uint(void)
+{
+    static const struct {
+        const char *str;
+        unsigned long long max;
+        int err;
+        unsigned long long value;
+    } cases[] = {
+        { "0", UINT8_MAX, 0, 0 },
+        { "+42", UINT8_MAX, 0, 42 },
+        { "255", UINT8_MAX, 0, 255 },
+        { "256", UINT8_MAX, ERANGE, 0 },
+        { "0xff", UINT8_MAX, 0, 255 },
+        { "0XFF", UINT8_MAX, 0, 255 },
+        { "0o17", UINT8_MAX, 0, 15 },
+        { "0b1010_1010", UINT8_MAX, 0, 170 },
+        { "1_000_000", ULLONG_MAX, 0, 1000000 },
+        { "18446744073709551615", ULLONG_MAX, 0, ULLONG_MAX },
+        { "18446744073709551616", ULLONG_MAX, ERANGE, 0 },
+        { "0xffffffffffffffff", ULLONG_MAX, 0, ULLONG_MAX },
+        { "0x1_0000_0000_0000_0000", ULLONG_MAX, ERANGE, 0 },
+        { "99999999999999999999z", ULLONG_MAX, EINVAL, 0 },
+        { "12abc", ULLONG_MAX, EINVAL, 0 },
+        { "", ULLONG_MAX, EINVAL, 0 },
+        { "0x", ULLONG_MAX, EINVAL, 0 },
+        { "0b2", ULLONG_MAX, EINVAL, 0 },
+        { "-1", ULLONG_MAX, EINVAL, 0 },
+        { " 1", ULLONG_MAX, EINVAL, 0 },
+        { "1 ", ULLONG_MAX, EINVAL, 0 },
+        { "_1", ULLONG_MAX, EINVAL, 0 },
+        { "1_", ULLONG_MAX, EINVAL, 0 },
+        { "1__0", ULLONG_MAX, EINVAL, 0 },
+        { "0x_1", ULLONG_MAX, EINVAL, 0 },
+    };
+
+    for (size_t i = 0; i < NELEM(cases); i++) {
+        merr_t err;
+        unsigned long long value = 0;
+
+        err = cli_convert_uint(cases[i].str, cases[i].max, &value);
+        g_assert_cmpint(merr_errno(err), ==, cases[i].err);
+        if (!err)
+            g_assert_cmpuint(value, ==, cases[i].value);
+    }
+}
+
+static void
+test_convert_int(void)
+{
+    static const struct {
+        const char *str;
+        long long min;
+        long long max;
+        int err;
+        long long value;
+    } cases[] = {
+        { "-128", INT8_MIN, INT8_MAX, 0, -128 },
+        { "-129", INT8_MIN, INT8_MAX, ERANGE, 0 },
+        { "127", INT8_MIN, INT8_MAX, 0, 127 },
+        { "128", INT8_MIN, INT8_MAX, ERANGE, 0 },
+        { "-0x80", INT8_MIN, INT8_MAX, 0, -128 },
+        { "-0", INT8_MIN, INT8_MAX, 0, 0 },
+        { "-9223372036854775808", LLONG_MIN, LLONG_MAX, 0, LLONG_MIN },
+        { "-9223372036854775809", LLONG_MIN, LLONG_MAX, ERANGE, 0 },
+        { "9223372036854775807", LLONG_MIN, LLONG_MAX, 0, LLONG_MAX },
+        { "9223372036854775808", LLONG_MIN, LLONG_MAX, ERANGE, 0 },
+        { "-1_000", LLONG_MIN, LLONG_MAX, 0, -1000 },
+        { "--1", LLONG_MIN, LLONG_MAX, EINVAL, 0 },
+        { "+-1", LLONG_MIN, LLONG_MAX, EINVAL, 0 },
+        { "-", LLONG_MIN, LLONG_MAX, EINVAL, 0 },
+        { "1.0", LLONG_MIN, LLONG_MAX, EINVAL, 0 },
+    };
+
+    for (size_t i = 0; i < NELEM(cases); i++) {
+        merr_t err;
+        long long value = 0;
+
+        err = cli_convert_int(cases[i].str, cases[i].min, cases[i].max, &value);
+        g_assert_cmpint(merr_errno(err), ==, cases[i].err);
+        if (!err)
+            g_assert_cmpint(value, ==, cases[i].value);
+    }
+}
+
+static void
+test_convert_double(void)
+{
+    static const struct {
+        const char *str;
+        int err;
+        double value;
+    } cases[] = {
+        { "0", 0, 0.0 },
+        { "-0.0", 0, -0.0 },
+        { "1", 0, 1.0 },
+        { ".5", 0, 0.5 },
+        { "5.", 0, 5.0 },
+        { "1_000.000_1", 0, 1000.0001 },
+        { "0.1", 0, 0.1 },
+        { "1e23", 0, 1e23 },
+        { "-1.5E-3", 0, -1.5e-3 },
+        { "1e+300", 0, 1e300 },
+        { "9007199254740993", 0, 9007199254740992.0 },
+        { "9007199254740995", 0, 9007199254740996.0 },
+        { "2.2250738585072011e-308", 0, 2.2250738585072011e-308 },
+        { "2.2250738585072012e-308", 0, 2.2250738585072012e-308 },
+        { "4.9406564584124654e-324", 0, 4.9406564584124654e-324 },
+        { "1.7976931348623157e308", 0, DBL_MAX },
+        { "0.000000000000000000000000000000000000000000001e300", 0, 1e255 },
+        { "1e309", ERANGE, 0 },
+        { "1e-400", ERANGE, 0 },
+        { "0e-400", 0, 0 },
+        { "1.5abc", EINVAL, 0 },
+        { "1,5", EINVAL, 0 },
+        { "", EINVAL, 0 },
+        { ".", EINVAL, 0 },
+        { "e5", EINVAL, 0 },
+        { "1e", EINVAL, 0 },
+        { "1e+", EINVAL, 0 },
+        { "1..2", EINVAL, 0 },
+        { "1_.2", EINVAL, 0 },
+        { "1._2", EINVAL, 0 },
+        { "0x10", EINVAL, 0 },
+    };
+
+    for (size_t i = 0; i < NELEM(cases); i++) {
+        merr_t err;
+        double value = -1;
+
+        err = cli_convert_double(cases[i].str, &value);
+        g_assert_cmpint(merr_errno(err), ==, cases[i].err);
+        if (!err) {
+            g_assert_cmpmem(&value, sizeof(value), &cases[i].value, sizeof(cases[i].value));
+        }
+    }
+}
+
+static void
+test_convert_special(void)
+{
+    merr_t err;
+    float f;
+    double d;
+    long double ld;
+
+    err = cli_convert_double("-Infinity", &d);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_true(isinf(d) && d < 0);
+
+    err = cli_convert_float("INF", &f);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_true(isinf(f) && f > 0);
+
+    err = cli_convert_long_double("nan", &ld);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_true(isnan(ld));
+
+    err = cli_convert_double("infinite", &d);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+}
+
+static uint64_t
+xorshift(uint64_t * const state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+/* glibc's strtod(3) and strtof(3) are correctly rounded, so they serve as the
+ * reference for values written with every number of significant digits.
+ */
+static void
+test_convert_random(void)
+{
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+    for (int i = 0; i < 200000; i++) {
+        merr_t err;
+        char buf[64];
+        uint64_t bits;
+        uint32_t fbits;
+        double d, expected, got;
+        float f, fexpected, fgot;
+
+        bits = xorshift(&state) & ~(UINT64_C(1) << 63);
+        memcpy(&d, &bits, sizeof(d));
+        if (!isfinite(d))
+            continue;
+
+        snprintf(buf, sizeof(buf), "%.*g", 1 + i % 20, d);
+        expected = strtod(buf, NULL);
+        err = cli_convert_double(buf, &got);
+        if (isinf(expected) || (expected == 0 && d != 0)) {
+            g_assert_cmpint(merr_errno(err), ==, ERANGE);
+        } else {
+            g_assert_no_errno(merr_errno(err));
+            g_assert_cmpmem(&got, sizeof(got), &expected, sizeof(expected));
+        }
+
+        fbits = (uint32_t)xorshift(&state) & ~(UINT32_C(1) << 31);
+        memcpy(&f, &fbits, sizeof(f));
+        if (!isfinite(f))
+            continue;
+
+        snprintf(buf, sizeof(buf), "%.*g", 1 + i % 12, (double)f);
+        fexpected = strtof(buf, NULL);
+        err = cli_convert_float(buf, &fgot);
+        if (isinf(fexpected) || (fexpected == 0 && f != 0)) {
+            g_assert_cmpint(merr_errno(err), ==, ERANGE);
+        } else {
+            g_assert_no_errno(merr_errno(err));
+            g_assert_cmpmem(&fgot, sizeof(fgot), &fexpected, sizeof(fexpected));
+        }
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/convert/uint", test_convert_uint);
+    g_test_add_func("/convert/int", test_convert_int);
+    g_test_add_func("/convert/double", test_convert_double);
+    g_test_add_func("/convert/special", test_convert_special);
+    g_test_add_func("/convert/random", test_convert_random);
+
+    return g_test_run();
+}
@@ -0,0 +1,403 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/incremental.h>
+#include <libcli/parser.h>
+
+static const char * const formats[] = { "json", "csv", NULL };
+
+static int verbose;
+static int jobs;
+static int format;
+static int level;
+static const char *target;
+
+static struct cli_option root_options[] = {
+    {
+        .shrt = 'v',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = &verbose,
+    },
+    {
+        .shrt = 'j',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "jobs",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &jobs,
+    },
+    {
+        .shrt = 'f',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "format",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_CHOICE,
+        .action = CLI_ACTION_STORE,
+        .data = &format,
+        .choices = formats,
+    },
+};
+
+static struct cli_option build_option = {
+    .shrt = 'O',
+    .argument = CLI_HAS_ARG_REQUIRED,
+    .type = CLI_TYPE_INT,
+    .action = CLI_ACTION_STORE,
+    .data = &level,
+};
+
+static struct cli_argument build_argument = {
+    .name = "target",
+    .type = CLI_TYPE_STRING,
+    .data = &target,
+};
+
+static void
+setup(struct cli * const root, struct cli * const build)
+{
+    merr_t err;
+
+    err = cli_add_options(root, NELEM(root_options), root_options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_option(build, &build_option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_argument(build, &build_argument);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommand(root, build);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_compile(root);
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+update(struct cli_incremental * const inc, const char * const line)
+{
+    merr_t err;
+
+    err = cli_incremental_update(inc, line, strlen(line));
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+test_incremental_tokens(void)
+{
+    merr_t err;
+    int value;
+    struct cli_incremental inc;
+    struct cli root = { .name = "test" };
+    struct cli build = { .name = "build" };
+
+    setup(&root, &build);
+
+    err = cli_incremental_init(&inc, &root);
+    g_assert_no_errno(merr_errno(err));
+
+    update(&inc, "-v -j 4  -fcsv build -O2 x86");
+    g_assert_cmpuint(inc.tokenc, ==, 7);
+    g_assert_cmpuint(inc.errors, ==, 0);
+    g_assert_true(inc.command == &build);
+    g_assert_null(inc.pending);
+    g_assert_null(inc.missing);
+
+    g_assert_cmpint(inc.tokens[0].kind, ==, CLI_TOKEN_OPTION);
+    g_assert_true(inc.tokens[0].option == &root_options[0]);
+    g_assert_cmpint(inc.tokens[2].kind, ==, CLI_TOKEN_VALUE);
+    g_assert_cmpuint(inc.tokens[2].start, ==, 6);
+    g_assert_cmpuint(inc.tokens[2].len, ==, 1);
+    memcpy(&value, inc.tokens[2].value.bytes, sizeof(value));
+    g_assert_cmpint(value, ==, 4);
+    memcpy(&value, inc.tokens[3].value.bytes, sizeof(value));
+    g_assert_cmpint(value, ==, 1);
+    g_assert_cmpint(inc.tokens[4].kind, ==, CLI_TOKEN_SUBCOMMAND);
+    g_assert_true(inc.tokens[4].cli == &root);
+    g_assert_true(inc.tokens[5].cli == &build);
+    g_assert_cmpint(inc.tokens[6].kind, ==, CLI_TOKEN_ARGUMENT);
+    g_assert_true(inc.tokens[6].argument == &build_argument);
+
+    /* Nothing is stored. */
+    g_assert_cmpint(jobs, ==, 0);
+    g_assert_null(target);
+
+    cli_incremental_fini(&inc);
+    cli_fini(&root);
+}
+
+static void
+test_incremental_errors(void)
+{
+    merr_t err;
+    struct cli_incremental inc;
+    struct cli root = { .name = "test" };
+    struct cli build = { .name = "build" };
+
+    setup(&root, &build);
+
+    err = cli_incremental_init(&inc, &root);
+    g_assert_no_errno(merr_errno(err));
+
+    update(&inc, "-x -j four -fxml");
+    g_assert_cmpuint(inc.errors, ==, 3);
+    g_assert_cmpint(inc.tokens[0].status, ==, CLI_TOKEN_UNKNOWN);
+    g_assert_cmpint(inc.tokens[2].status, ==, CLI_TOKEN_INVALID);
+    g_assert_cmpint(inc.tokens[3].status, ==, CLI_TOKEN_INVALID);
+
+    update(&inc, "-j");
+    g_assert_cmpuint(inc.errors, ==, 0);
+    g_assert_true(inc.pending == &root_options[1]);
+
+    update(&inc, "build");
+    g_assert_true(inc.missing == &build_argument);
+
+    update(&inc, "build x86 arm");
+    g_assert_cmpint(inc.tokens[2].status, ==, CLI_TOKEN_UNEXPECTED);
+
+    update(&inc, "bulid");
+    g_assert_cmpint(inc.tokens[0].status, ==, CLI_TOKEN_UNKNOWN);
+
+#ifndef CLI_NO_GETOPT_LONG
+    update(&inc, "--jobs=2 --format");
+    g_assert_cmpuint(inc.errors, ==, 0);
+    g_assert_true(inc.pending == &root_options[2]);
+
+    update(&inc, "--jo 2 --zzz");
+    g_assert_cmpint(inc.tokens[0].status, ==, CLI_TOKEN_OK);
+    g_assert_cmpint(inc.tokens[2].status, ==, CLI_TOKEN_UNKNOWN);
+#endif
+
+    /* After --, and after the first operand, options are arguments. */
+    update(&inc, "build -- -v");
+    g_assert_cmpint(inc.tokens[1].kind, ==, CLI_TOKEN_TERMINATOR);
+    g_assert_cmpint(inc.tokens[2].kind, ==, CLI_TOKEN_ARGUMENT);
+    g_assert_cmpuint(inc.errors, ==, 0);
+
+    cli_incremental_fini(&inc);
+    cli_fini(&root);
+}
+
+static void
+assert_same(const struct cli_incremental * const a, const struct cli_incremental * const b)
+{
+    g_assert_cmpuint(a->tokenc, ==, b->tokenc);
+    g_assert_cmpuint(a->errors, ==, b->errors);
+    g_assert_true(a->command == b->command);
+    g_assert_true(a->pending == b->pending);
+    g_assert_true(a->missing == b->missing);
+
+    for (size_t i = 0; i < a->tokenc; i++) {
+        g_assert_cmpuint(a->tokens[i].start, ==, b->tokens[i].start);
+        g_assert_cmpuint(a->tokens[i].len, ==, b->tokens[i].len);
+        g_assert_cmpint(a->tokens[i].kind, ==, b->tokens[i].kind);
+        g_assert_cmpint(a->tokens[i].status, ==, b->tokens[i].status);
+        g_assert_true(a->tokens[i].cli == b->tokens[i].cli);
+        g_assert_true(a->tokens[i].option == b->tokens[i].option);
+        g_assert_true(a->tokens[i].argument == b->tokens[i].argument);
+        g_assert_cmpmem(
+            a->tokens[i].value.bytes, sizeof(a->tokens[i].value.bytes), b->tokens[i].value.bytes,
+            sizeof(b->tokens[i].value.bytes));
+    }
+}
+
+/* Every edit gives the same tokens as parsing the edited line afresh. */
+static void
+test_incremental_edits(void)
+{
+    merr_t err;
+    char line[128];
+    struct cli_incremental inc;
+    struct cli root = { .name = "test" };
+    struct cli build = { .name = "build" };
+    static const char typed[] = "-v -j 12 -fjson build -O3 x86_64";
+    static const char * const edits[] = {
+        "-v -j 12 -fjson build -O3 x86_64",
+        "-v -j 1 -fjson build -O3 x86_64",
+        "-v -j 1 -fjson build -O3",
+        "-v -j 1 -fjson build -O 3 x86_64",
+        "-v -j 1 -fcsv  build -O 3 x86_64",
+        "-v -j 1 -fcsv build -O 3 x86_64",
+        "-v -j -fcsv build -O 3 x86_64",
+        "",
+        "build",
+    };
+
+    setup(&root, &build);
+
+    err = cli_incremental_init(&inc, &root);
+    g_assert_no_errno(merr_errno(err));
+
+    for (size_t i = 0; i <= strlen(typed); i++) {
+        struct cli_incremental fresh;
+
+        memcpy(line, typed, i);
+        line[i] = '\0';
+
+        update(&inc, line);
+
+        /* Typing at the end only parses the last token again. */
+        g_assert_cmpuint(inc.first + 1, >=, inc.tokenc);
+
+        err = cli_incremental_init(&fresh, &root);
+        g_assert_no_errno(merr_errno(err));
+        update(&fresh, line);
+        assert_same(&inc, &fresh);
+        cli_incremental_fini(&fresh);
+    }
+
+    for (size_t i = 0; i < NELEM(edits); i++) {
+        struct cli_incremental fresh;
+
+        update(&inc, edits[i]);
+
+        err = cli_incremental_init(&fresh, &root);
+        g_assert_no_errno(merr_errno(err));
+        update(&fresh, edits[i]);
+        assert_same(&inc, &fresh);
+        cli_incremental_fini(&fresh);
+    }
+
+    cli_incremental_fini(&inc);
+    cli_fini(&root);
+}
+
+/* Edits at a position agree with handing over the whole line. */
+static void
+test_incremental_positions(void)
+{
+    merr_t err;
+    struct cli_incremental inc;
+    struct cli_incremental whole;
+    struct cli root = { .name = "test" };
+    struct cli build = { .name = "build" };
+    static const struct {
+        size_t pos;
+        size_t removed;
+        const char *text;
+        const char *line;
+    } edits[] = {
+        { 0, 0, "build x86", "build x86" },
+        { 0, 0, "-j 4 ", "-j 4 build x86" },
+        { 3, 1, "16", "-j 16 build x86" },
+        { 5, 0, " -v", "-j 16 -v build x86" },
+        { 18, 0, "_64", "-j 16 -v build x86_64" },
+        { 3, 2, "", "-j  -v build x86_64" },
+        { 0, 19, "-fcsv", "-fcsv" },
+    };
+
+    setup(&root, &build);
+
+    err = cli_incremental_init(&inc, &root);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_incremental_init(&whole, &root);
+    g_assert_no_errno(merr_errno(err));
+
+    for (size_t i = 0; i < NELEM(edits); i++) {
+        err = cli_incremental_edit(
+            &inc, edits[i].pos, edits[i].removed, edits[i].text, strlen(edits[i].text));
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpmem(inc.text, inc.len, edits[i].line, strlen(edits[i].line));
+
+        update(&whole, edits[i].line);
+        assert_same(&inc, &whole);
+    }
+
+    err = cli_incremental_edit(&inc, 3, 10, "", 0);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    cli_incremental_fini(&whole);
+    cli_incremental_fini(&inc);
+    cli_fini(&root);
+}
+
+/* Parsing again stops at the first token past the edit which is reached in
+ * the state it was before.
+ */
+static void
+test_incremental_resync(void)
+{
+    merr_t err;
+    struct cli_incremental inc;
+    struct cli root = { .name = "test" };
+    struct cli build = { .name = "build" };
+    static const struct {
+        size_t pos;
+        size_t removed;
+        const char *text;
+        size_t parsed;
+    } edits[] = {
+        { 7, 0, "6", 1 },
+        { 6, 2, "x", 1 },
+        { 6, 1, "4", 1 },
+        { 3, 0, "-v -v -v -v -v -v -v -v -v ", 9 },
+        { 3, 27, "", 0 },
+        { 6, 1, "", 3 },
+        { 6, 0, "4", 4 },
+        { 24, 0, " y", 2 },
+    };
+
+    setup(&root, &build);
+
+    err = cli_incremental_init(&inc, &root);
+    g_assert_no_errno(merr_errno(err));
+
+    update(&inc, "-v -j 1 build -O3 x86_64");
+
+    for (size_t i = 0; i < NELEM(edits); i++) {
+        struct cli_incremental fresh;
+
+        err = cli_incremental_edit(
+            &inc, edits[i].pos, edits[i].removed, edits[i].text, strlen(edits[i].text));
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpuint(inc.last - inc.first, ==, edits[i].parsed);
+
+        err = cli_incremental_init(&fresh, &root);
+        g_assert_no_errno(merr_errno(err));
+        err = cli_incremental_update(&fresh, inc.text, inc.len);
+        g_assert_no_errno(merr_errno(err));
+        assert_same(&inc, &fresh);
+        cli_incremental_fini(&fresh);
+    }
+
+    cli_incremental_fini(&inc);
+    cli_fini(&root);
+}
+
+static void
+test_incremental_invalid(void)
+{
+    merr_t err;
+    struct cli_incremental inc;
+    struct cli cli = { .name = "test" };
+
+    err = cli_incremental_init(&inc, &cli);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/incremental/tokens", test_incremental_tokens);
+    g_test_add_func("/incremental/errors", test_incremental_errors);
+    g_test_add_func("/incremental/edits", test_incremental_edits);
+    g_test_add_func("/incremental/positions", test_incremental_positions);
+    g_test_add_func("/incremental/resync", test_incremental_resync);
+    g_test_add_func("/incremental/invalid", test_incremental_invalid);
+
+    return g_test_run();
+}
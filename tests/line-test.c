@@ -0,0 +1,306 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/line.h>
+#include <libcli/parser.h>
+
+static void
+assert_split(
+    struct cli_line * const line,
+    const char * const input,
+    const char * const * const expected)
+{
+    merr_t err;
+    int argc = 0;
+    char *s = g_strdup(input);
+
+    while (expected[argc])
+        argc++;
+
+    err = cli_line_split(line, s);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(line->argc, ==, argc);
+    for (int i = 0; i < argc; i++) {
+        g_assert_cmpstr(line->argv[i], ==, expected[i]);
+        /* Nothing is copied. */
+        g_assert_true(line->argv[i] >= s && line->argv[i] <= s + strlen(input));
+    }
+    g_assert_null(line->argv[argc]);
+
+    g_free(s);
+}
+
+static void
+test_line_split(void)
+{
+    struct cli_line line = { 0 };
+    static const struct {
+        const char *input;
+        const char *expected[8];
+    } cases[] = {
+        { "", { NULL } },
+        { " \t\r\n ", { NULL } },
+        { "a", { "a", NULL } },
+        { "  build   -v\t--jobs=4\n", { "build", "-v", "--jobs=4", NULL } },
+        { "'a b' \"c d\"", { "a b", "c d", NULL } },
+        { "a'b c'd\"e f\"g", { "ab cde fg", NULL } },
+        { "'' \"\" x", { "", "", "x", NULL } },
+        { "it\\'s a\\ b \\\\", { "it's", "a b", "\\", NULL } },
+        { "'\\n' '\"'", { "\\n", "\"", NULL } },
+        { "\"\\\" \\\\ \\$ \\` \\n\"", { "\" \\ $ ` \\n", NULL } },
+        { "a\\\nb \\\n c", { "ab", "c", NULL } },
+        { "\"a\\\nb\"", { "ab", NULL } },
+        { "$HOME * ~ #x !y &z", { "$HOME", "*", "~", "#x", "!y", "&z", NULL } },
+        { "--name=\"hello world\" caf\xc3\xa9", { "--name=hello world", "caf\xc3\xa9", NULL } },
+        { "--a-long-option-name=a-long-value-which-spans-words \"and a quoted one at the end\"",
+          { "--a-long-option-name=a-long-value-which-spans-words", "and a quoted one at the end",
+            NULL } },
+        { "\"quoted\"followed-by-a-long-unquoted-tail-to-move another-long-word-after-it",
+          { "quotedfollowed-by-a-long-unquoted-tail-to-move", "another-long-word-after-it",
+            NULL } },
+    };
+
+    for (size_t i = 0; i < NELEM(cases); i++)
+        assert_split(&line, cases[i].input, cases[i].expected);
+
+    cli_line_fini(&line);
+}
+
+/* Quotes and escapes at every offset within and across words. */
+static void
+test_line_offsets(void)
+{
+    struct cli_line line = { 0 };
+
+    for (size_t i = 0; i < 40; i++) {
+        char input[128];
+        char first[64];
+        const char *expected[3] = { first, "0123456789abcdef0123", NULL };
+
+        memset(first, 'x', i);
+        first[i] = '\0';
+        strcat(first, "a b\"c");
+
+        memset(input, 'x', i);
+        input[i] = '\0';
+        strcat(input, "'a b'\\\"c 0123456789abcdef0123");
+
+        assert_split(&line, input, expected);
+    }
+
+    cli_line_fini(&line);
+}
+
+/* Byte at a time, the way the rules read. Returns the number of arguments,
+ * or -1 for an invalid line.
+ */
+static int
+reference(const char *p, char * const out, const char ** const argv)
+{
+    int argc = 0;
+    char *w = out;
+
+    for (;;) {
+        bool quoted = false;
+
+        while ((*p && strchr(" \t\r\n", *p)) || (p[0] == '\\' && p[1] == '\n'))
+            p += *p == '\\' ? 2 : 1;
+
+        if (!*p)
+            return argc;
+
+        argv[argc++] = w;
+
+        for (; *p; p++) {
+            if (!quoted && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+                break;
+
+            if (!quoted && *p == '\'') {
+                const char * const q = strchr(p + 1, '\'');
+
+                if (!q)
+                    return -1;
+                memcpy(w, p + 1, (size_t)(q - p - 1));
+                w += q - p - 1;
+                p = q;
+            } else if (*p == '"') {
+                quoted = !quoted;
+            } else if (*p == '\\') {
+                if (!p[1])
+                    return -1;
+                if (quoted && !strchr("\"\\$`\n", p[1])) {
+                    *w++ = *p;
+                } else if (p[1] != '\n') {
+                    *w++ = p[1];
+                    p++;
+                } else {
+                    p++;
+                }
+            } else {
+                *w++ = *p;
+            }
+        }
+
+        if (quoted)
+            return -1;
+
+        *w++ = '\0';
+    }
+}
+
+/* Random lines, long enough to cross blocks, split like the reference. */
+static void
+test_line_random(void)
+{
+    uint64_t state = 0x9e3779b97f4a7c15;
+    struct cli_line line = { 0 };
+    static const char alphabet[] = "abcdefgh    \t\n'\"\\$";
+
+    for (int i = 0; i < 5000; i++) {
+        merr_t err;
+        char input[400];
+        char copy[400];
+        char out[400];
+        const char *expected[400];
+        int expected_argc;
+        size_t len;
+
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        len = (size_t)(state % (sizeof(input) - 1));
+
+        for (size_t j = 0; j < len; j++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            /* Mostly plain bytes, so that some lines are valid. */
+            input[j] = state % 4 ? alphabet[state % 8] : alphabet[state % (sizeof(alphabet) - 1)];
+        }
+        input[len] = '\0';
+
+        expected_argc = reference(input, out, expected);
+
+        memcpy(copy, input, len + 1);
+        err = cli_line_split(&line, copy);
+        if (expected_argc < 0) {
+            g_assert_cmpint(merr_errno(err), ==, EINVAL);
+            continue;
+        }
+
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(line.argc, ==, expected_argc);
+        for (int j = 0; j < expected_argc; j++)
+            g_assert_cmpstr(line.argv[j], ==, expected[j]);
+    }
+
+    cli_line_fini(&line);
+}
+
+static void
+test_line_invalid(void)
+{
+    merr_t err;
+    struct cli_line line = { 0 };
+    static const char * const inputs[] = {
+        "'unterminated", "\"unterminated", "a \"b\\\"", "trailing\\", "ok 'bad",
+    };
+
+    for (size_t i = 0; i < NELEM(inputs); i++) {
+        char *s = g_strdup(inputs[i]);
+
+        err = cli_line_split(&line, s);
+        g_assert_cmpint(merr_errno(err), ==, EINVAL);
+        g_assert_cmpint(line.argc, ==, 0);
+
+        g_free(s);
+    }
+
+    err = cli_line_split(NULL, NULL);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    cli_line_fini(&line);
+}
+
+static void
+test_line_parse(void)
+{
+    merr_t err;
+    int exit_code;
+    int jobs = 0;
+    const char *name = NULL;
+    struct cli_parser parser = { .program_name = "test" };
+    struct cli cli = { .name = "test" };
+    struct cli_option option = {
+        .shrt = 'j',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &jobs,
+    };
+    struct cli_argument argument = {
+        .name = "name",
+        .type = CLI_TYPE_STRING,
+        .data = &name,
+    };
+    char line[] = "-j 4 'hello world'";
+    char many[512] = "-j 1";
+    char usage[] = "-j";
+
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_argument(&cli, &argument);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_parse_line(&cli, line, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+    g_assert_cmpint(jobs, ==, 4);
+    g_assert_cmpstr(name, ==, "hello world");
+
+    /* More arguments than fit on the stack. */
+    for (int i = 2; i < 60; i++)
+        snprintf(many + strlen(many), sizeof(many) - strlen(many), " -j %d", i);
+    strcat(many, " last");
+    err = cli_parse_line(&cli, many, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(jobs, ==, 59);
+    g_assert_cmpstr(name, ==, "last");
+
+    parser.err = fopen("/dev/null", "w");
+    err = cli_parse_line(&cli, usage, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+    fclose(parser.err);
+
+    cli_fini(&cli);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/line/split", test_line_split);
+    g_test_add_func("/line/offsets", test_line_offsets);
+    g_test_add_func("/line/random", test_line_random);
+    g_test_add_func("/line/invalid", test_line_invalid);
+    g_test_add_func("/line/parse", test_line_parse);
+
+    return g_test_run();
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+merr_t
+plugin_load(struct cli *cli, void *ctx);
+
+static struct cli_option option = {
+    .shrt = 'v',
+    .argument = CLI_HAS_ARG_REQUIRED,
+    .type = CLI_TYPE_INT,
+    .action = CLI_ACTION_STORE,
+};
+
+merr_t
+plugin_load(struct cli * const cli, void * const ctx)
+{
+    option.data = ctx;
+
+    return cli_add_option(cli, &option);
+}
@@ -0,0 +1,258 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/plugin.h>
+
+struct stub {
+    int loads;
+    int calls;
+    int value;
+    merr_t fail;
+    struct cli_option option;
+};
+
+static void
+callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    struct stub * const stub = ctx;
+
+    (void)cli;
+
+    stub->calls++;
+    *exit_code = 0;
+}
+
+static merr_t
+load(struct cli * const cli, void * const ctx)
+{
+    struct stub * const stub = ctx;
+
+    stub->loads++;
+    if (stub->fail)
+        return stub->fail;
+
+    cli->callback = callback;
+    cli->ctx = stub;
+
+    stub->option = (struct cli_option){
+        .shrt = 'n',
+        .description = "A number",
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &stub->value,
+    };
+
+    return cli_add_option(cli, &stub->option);
+}
+
+static void
+tree_init(struct cli * const root, struct cli * const stubs, struct stub * const ctxs)
+{
+    merr_t err;
+
+    memset(ctxs, 0, 2 * sizeof(*ctxs));
+    *root = (struct cli){ .name = "prog", .flags = CLI_FLAG_COMPLETION };
+    stubs[0] = (struct cli){
+        .name = "a",
+        .description = "First",
+        .loader = load,
+        .loader_ctx = &ctxs[0],
+    };
+    stubs[1] = (struct cli){
+        .name = "b",
+        .description = "Second",
+        .loader = load,
+        .loader_ctx = &ctxs[1],
+    };
+
+    err = cli_add_subcommands(root, 2, stubs);
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+run_lazy(const bool compile)
+{
+    merr_t err;
+    int exit_code;
+    struct cli root;
+    struct cli stubs[2];
+    struct stub ctxs[2];
+
+    tree_init(&root, stubs, ctxs);
+    if (compile) {
+        err = cli_compile(&root);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_null(stubs[0].index);
+    }
+
+    for (int i = 1; i <= 3; i++) {
+        char *args[] = { "prog", "a", "-n", "7" };
+
+        err = cli_parse(&root, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(ctxs[0].calls, ==, i);
+        g_assert_cmpint(ctxs[0].value, ==, 7);
+    }
+
+    /* Only the stub on the parsed path was loaded, and only once. */
+    g_assert_cmpint(ctxs[0].loads, ==, 1);
+    g_assert_cmpint(ctxs[1].loads, ==, 0);
+
+    /* Subcommands are listed from the stubs alone. */
+    {
+        FILE *err_stream;
+        char *buf = NULL;
+        size_t sz = 0;
+        char *args[] = { "prog", "c" };
+        struct cli_parser parser = { 0 };
+
+        err_stream = open_memstream(&buf, &sz);
+        g_assert_nonnull(err_stream);
+        parser.err = err_stream;
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, !=, 0);
+        fclose(err_stream);
+
+        g_assert_nonnull(strstr(buf, "Second"));
+        g_assert_cmpint(ctxs[1].loads, ==, 0);
+        free(buf);
+    }
+
+    /* Completing inside a stub loads it. */
+    {
+        FILE *out;
+        char *buf = NULL;
+        size_t sz = 0;
+        char *args[] = { "prog", "__complete", "b", "-" };
+        struct cli_parser parser = { 0 };
+
+        out = open_memstream(&buf, &sz);
+        g_assert_nonnull(out);
+        parser.out = out;
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        fclose(out);
+
+        g_assert_cmpstr(buf, ==, "-n\tA number\n");
+        g_assert_cmpint(ctxs[1].loads, ==, 1);
+        free(buf);
+    }
+
+    /* Finishing the tree turns loaded stubs back into stubs. */
+    cli_fini(&root);
+    g_assert_true(SLIST_EMPTY(&stubs[0].options));
+    g_assert_null(stubs[0].index);
+
+    {
+        char *args[] = { "prog", "a", "-n", "8" };
+
+        err = cli_parse(&root, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(ctxs[0].loads, ==, 2);
+        g_assert_cmpint(ctxs[0].value, ==, 8);
+    }
+
+    cli_fini(&root);
+}
+
+static void
+test_loader_lazy(void)
+{
+    run_lazy(false);
+    run_lazy(true);
+}
+
+static void
+test_loader_error(void)
+{
+    merr_t err;
+    int exit_code;
+    struct cli root;
+    struct cli stubs[2];
+    struct stub ctxs[2];
+    char *args[] = { "prog", "a", "-n", "1" };
+
+    tree_init(&root, stubs, ctxs);
+    ctxs[0].fail = merr(EIO);
+
+    err = cli_parse(&root, NELEM(args), args, &exit_code);
+    g_assert_cmpint(merr_errno(err), ==, EIO);
+    g_assert_true(SLIST_EMPTY(&stubs[0].options));
+
+    /* A failed load is tried again by the next parse. */
+    ctxs[0].fail = 0;
+    err = cli_parse(&root, NELEM(args), args, &exit_code);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(ctxs[0].loads, ==, 2);
+    g_assert_cmpint(ctxs[0].calls, ==, 1);
+
+    cli_fini(&root);
+}
+
+static void
+test_loader_plugin(void)
+{
+    merr_t err;
+    int exit_code;
+    int value = 0;
+    const char *path;
+    struct cli_plugin plugin = { .symbol = "plugin_load", .ctx = &value };
+    struct cli stub = { .name = "plugin", .loader = cli_plugin_loader, .loader_ctx = &plugin };
+    struct cli root = { .name = "prog" };
+    char *args[] = { "prog", "plugin", "-v", "42" };
+
+    err = cli_add_subcommand(&root, &stub);
+    g_assert_no_errno(merr_errno(err));
+
+    plugin.path = "/nonexistent/plugin.so";
+    err = cli_parse(&root, NELEM(args), args, &exit_code);
+    g_assert_cmpint(merr_errno(err), ==, ENOENT);
+
+    path = g_getenv("LIBCLI_TEST_PLUGIN");
+    if (!path) {
+        g_test_skip("LIBCLI_TEST_PLUGIN is not set");
+        cli_fini(&root);
+        return;
+    }
+
+    plugin.path = path;
+    err = cli_parse(&root, NELEM(args), args, &exit_code);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+    g_assert_cmpint(value, ==, 42);
+
+    cli_fini(&root);
+    cli_plugin_fini(&plugin);
+    g_assert_null(plugin.handle);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/loader/lazy", test_loader_lazy);
+    g_test_add_func("/loader/error", test_loader_error);
+    g_test_add_func("/loader/plugin", test_loader_plugin);
+
+    return g_test_run();
+}
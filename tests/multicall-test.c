@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+static int long_listing;
+static int root_calls;
+static int ls_calls;
+static int cat_calls;
+
+static void
+root_callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    root_calls++;
+    *exit_code = 0;
+}
+
+static void
+ls_callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    ls_calls++;
+    *exit_code = 0;
+}
+
+static void
+cat_callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    cat_calls++;
+    *exit_code = 0;
+}
+
+static void
+run(const bool compile)
+{
+    merr_t err;
+    int exit_code;
+    struct cli root = { .name = "box", .flags = CLI_FLAG_MULTI_CALL, .callback = root_callback };
+    struct cli applets[] = {
+        { .name = "cat", .callback = cat_callback },
+        { .name = "ls", .callback = ls_callback },
+    };
+    struct cli_option option = {
+        .shrt = 'l',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = &long_listing,
+    };
+
+    root_calls = ls_calls = cat_calls = 0;
+    long_listing = 0;
+
+    err = cli_add_subcommands(&root, NELEM(applets), applets);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_option(&applets[1], &option);
+    g_assert_no_errno(merr_errno(err));
+    if (compile) {
+        err = cli_compile(&root);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    /* Invoked through a link named after the applet. */
+    {
+        char *args[] = { "/usr/bin/ls", "-l" };
+
+        err = cli_parse(&root, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(ls_calls, ==, 1);
+        g_assert_cmpint(root_calls, ==, 0);
+        g_assert_cmpint(long_listing, ==, 1);
+    }
+
+    {
+        char *args[] = { "cat" };
+
+        err = cli_parse(&root, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(cat_calls, ==, 1);
+        g_assert_cmpint(root_calls, ==, 0);
+    }
+
+    /* Any other name is the root, which dispatches as usual. */
+    long_listing = 0;
+    {
+        char *args[] = { "/bin/box", "ls", "-l" };
+
+        err = cli_parse(&root, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(ls_calls, ==, 2);
+        g_assert_cmpint(root_calls, ==, 1);
+        g_assert_cmpint(long_listing, ==, 1);
+    }
+
+    {
+        char *args[] = { "box" };
+
+        err = cli_parse(&root, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(root_calls, ==, 2);
+    }
+
+    cli_fini(&root);
+}
+
+static void
+test_multicall_dispatch(void)
+{
+    run(false);
+    run(true);
+}
+
+static void
+test_multicall_disabled(void)
+{
+    merr_t err;
+    int exit_code;
+    struct cli ls = { .name = "ls", .callback = ls_callback };
+    struct cli cli = { .name = "box", .callback = root_callback };
+
+    root_calls = ls_calls = 0;
+
+    err = cli_add_subcommand(&cli, &ls);
+    g_assert_no_errno(merr_errno(err));
+
+    {
+        char *args[] = { "/usr/bin/ls" };
+
+        err = cli_parse(&cli, NELEM(args), args, &exit_code);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(root_calls, ==, 1);
+        g_assert_cmpint(ls_calls, ==, 0);
+    }
+
+    cli_fini(&cli);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/multicall/dispatch", test_multicall_dispatch);
+    g_test_add_func("/multicall/disabled", test_multicall_disabled);
+
+    return g_test_run();
+}
@@ -3,12 +3,23 @@
  * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
  */
 
+#include "util.h"
+
 #include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
 
 #include <glib.h>
 #include <merr.h>
 
+#include <libcli/alloc.h>
 #include <libcli/parser.h>
 
 static void
@@ -47,6 +58,1040 @@ test_add_option_invald_args(void)
     g_assert_cmpint(merr_errno(err), ==, EINVAL);
 }
 
+static void
+test_compile(void)
+{
+    merr_t err;
+    int exit_code;
+    int alpha = 0, beta = 0, gamma = 0;
+    struct cli cli = { .name = "test" };
+    struct cli_option options[] = {
+        {
+            .shrt = 'a',
+#ifndef CLI_NO_GETOPT_LONG
+            .lng = "alpha",
+#endif
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_INT,
+            .action = CLI_ACTION_STORE,
+            .data = &alpha,
+        },
+        {
+            .shrt = 'b',
+#ifndef CLI_NO_GETOPT_LONG
+            .lng = "beta",
+#endif
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_INT,
+            .action = CLI_ACTION_STORE,
+            .data = &beta,
+        },
+        {
+            .shrt = 'g',
+#ifndef CLI_NO_GETOPT_LONG
+            .lng = "gamma",
+#endif
+            .argument = CLI_HAS_ARG_NONE,
+            .type = CLI_TYPE_INT,
+            .action = CLI_ACTION_ACCUMULATE,
+            .data = &gamma,
+        },
+    };
+    struct cli_option extra = { .shrt = 'x', .action = CLI_ACTION_HELP };
+    char *args[] = {
+        "test", "-a", "1", "-b2", "-gg",
+#ifndef CLI_NO_GETOPT_LONG
+        "--alpha=3", "--gam",
+#endif
+    };
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_compile(&cli);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_option(&cli, &extra);
+    g_assert_cmpint(merr_errno(err), ==, EBUSY);
+
+    err = cli_parse(&cli, NELEM(args), args, &exit_code);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+#ifndef CLI_NO_GETOPT_LONG
+    g_assert_cmpint(alpha, ==, 3);
+    g_assert_cmpint(gamma, ==, 3);
+#else
+    g_assert_cmpint(alpha, ==, 1);
+    g_assert_cmpint(gamma, ==, 2);
+#endif
+    g_assert_cmpint(beta, ==, 2);
+
+    cli_fini(&cli);
+
+    err = cli_add_option(&cli, &extra);
+    g_assert_no_errno(merr_errno(err));
+}
+
+/* Every possible short option, which fills the compact table completely. */
+static void
+test_compile_shorts(void)
+{
+    merr_t err;
+    int exit_code;
+    int counts[UCHAR_MAX + 1] = { 0 };
+    char names[UCHAR_MAX + 1][3];
+    char *args[UCHAR_MAX + 1] = { "test" };
+    struct cli_option options[UCHAR_MAX];
+    struct cli cli = { .name = "test" };
+    int argc = 1;
+
+    for (int c = 1; c <= UCHAR_MAX; c++) {
+        options[c - 1] = (struct cli_option){
+            .shrt = (char)c,
+            .argument = CLI_HAS_ARG_NONE,
+            .type = CLI_TYPE_INT,
+            .action = CLI_ACTION_ACCUMULATE,
+            .data = &counts[c],
+        };
+
+        /* "--" ends the options. */
+        if (c != '-') {
+            names[c][0] = '-';
+            names[c][1] = (char)c;
+            names[c][2] = '\0';
+            args[argc++] = names[c];
+        }
+    }
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_compile(&cli);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_parse(&cli, argc, args, &exit_code);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+
+    for (int c = 1; c <= UCHAR_MAX; c++)
+        g_assert_cmpint(counts[c], ==, c != '-');
+
+    cli_fini(&cli);
+}
+
+static void
+test_add_options(void)
+{
+    merr_t err;
+    size_t i = 0;
+    const struct cli_option *o;
+    struct cli cli = { .name = "test" };
+    struct cli_option single = { .shrt = 'm', .action = CLI_ACTION_HELP };
+    struct cli_option bulk[] = {
+        { .shrt = 'z', .action = CLI_ACTION_HELP },
+        { .shrt = 'b', .action = CLI_ACTION_HELP },
+#ifndef CLI_NO_GETOPT_LONG
+        { .lng = "only-long", .action = CLI_ACTION_HELP },
+#endif
+        { .shrt = 'q', .action = CLI_ACTION_HELP },
+    };
+    struct cli_option dup_short[] = {
+        { .shrt = 'x', .action = CLI_ACTION_HELP },
+        { .shrt = 'x', .action = CLI_ACTION_HELP },
+    };
+    struct cli_option dup_existing[] = {
+        { .shrt = 'y', .action = CLI_ACTION_HELP },
+        { .shrt = 'm', .action = CLI_ACTION_HELP },
+    };
+    static const char expected[] = {
+#ifndef CLI_NO_GETOPT_LONG
+        '\0',
+#endif
+        'b', 'm', 'q', 'z',
+    };
+
+    err = cli_add_option(&cli, &single);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_options(&cli, NELEM(bulk), bulk);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_options(&cli, NELEM(dup_short), dup_short);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+
+    err = cli_add_options(&cli, NELEM(dup_existing), dup_existing);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+
+    err = cli_add_options(&cli, NELEM(bulk), bulk);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+
+    SLIST_FOREACH(o, &cli.options, entry) {
+        g_assert_cmpuint(i, <, NELEM(expected));
+        g_assert_cmpint(o->shrt, ==, expected[i]);
+        i++;
+    }
+    g_assert_cmpuint(i, ==, NELEM(expected));
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+static void
+test_add_options_duplicate_long(void)
+{
+    merr_t err;
+    struct cli cli = { .name = "test" };
+    struct cli_option options[] = {
+        { .shrt = 'a', .lng = "same", .action = CLI_ACTION_HELP },
+        { .shrt = 'b', .lng = "same", .action = CLI_ACTION_HELP },
+    };
+    struct cli_option other = { .shrt = 'c', .lng = "same", .action = CLI_ACTION_HELP };
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+    g_assert_true(SLIST_EMPTY(&cli.options));
+
+    err = cli_add_option(&cli, options);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_option(&cli, &other);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+}
+#endif
+
+static void
+record_callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    *(const char **)ctx = cli->name;
+    *exit_code = 0;
+}
+
+static void
+test_add_subcommands(void)
+{
+    merr_t err;
+    int exit_code;
+    size_t i = 0;
+    const char *called = NULL;
+    const struct cli *c;
+    struct cli root = { .name = "test" };
+    struct cli singles[] = { { .name = "m" }, { .name = "c" }, { .name = "x" } };
+    struct cli bulk[] = {
+        { .name = "q" }, { .name = "a" }, { .name = "z" }, { .name = "d" }, { .name = "n" },
+    };
+    struct cli dup_bulk[] = { { .name = "e" }, { .name = "e" } };
+    struct cli dup_existing[] = { { .name = "f" }, { .name = "m" } };
+    static const char * const expected[] = { "a", "c", "d", "m", "n", "q", "x", "z" };
+    char *args[] = { "test", "n" };
+
+    for (size_t j = 0; j < NELEM(singles); j++) {
+        err = cli_add_subcommand(&root, singles + j);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    err = cli_add_subcommands(&root, NELEM(bulk), bulk);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_subcommands(&root, NELEM(dup_bulk), dup_bulk);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+
+    err = cli_add_subcommands(&root, NELEM(dup_existing), dup_existing);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+
+    SLIST_FOREACH(c, &root.subcommands, entry) {
+        g_assert_cmpuint(i, <, NELEM(expected));
+        g_assert_cmpstr(c->name, ==, expected[i]);
+        i++;
+    }
+    g_assert_cmpuint(i, ==, NELEM(expected));
+
+    bulk[4].callback = record_callback;
+    bulk[4].ctx = &called;
+
+    err = cli_compile(&root);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_parse(&root, NELEM(args), args, &exit_code);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpstr(called, ==, "n");
+
+    cli_fini(&root);
+}
+
+struct thread_options {
+    int alpha;
+    unsigned long count;
+    const char *name;
+};
+
+static struct cli thread_cli = { .name = "test" };
+
+static struct cli_option thread_cli_options[] = {
+    {
+        .shrt = 'a',
+#ifndef CLI_NO_GETOPT_LONG
+        .lng = "alpha",
+#endif
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct thread_options, alpha),
+    },
+    {
+        .shrt = 'c',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_ULONG,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = (void *)offsetof(struct thread_options, count),
+    },
+    {
+        .shrt = 'n',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct thread_options, name),
+    },
+};
+
+static void
+test_add_arguments(void)
+{
+    merr_t err;
+    size_t i = 0;
+    const struct cli_argument *a;
+    struct cli cli = { .name = "test" };
+    struct cli_argument single = { .name = "b" };
+    struct cli_argument bulk[] = { { .name = "z" }, { .name = "a" } };
+    struct cli_argument rest = { .name = "rest", .type = CLI_TYPE_STRING, .variadic = true };
+    struct cli_argument after = { .name = "after" };
+    struct cli_argument typed_rest = { .name = "typed", .type = CLI_TYPE_INT, .variadic = true };
+    struct cli_argument early_rest[] = {
+        { .name = "x", .type = CLI_TYPE_STRING, .variadic = true },
+        { .name = "y" },
+    };
+    static const char * const expected[] = { "b", "z", "a", "rest" };
+
+    err = cli_add_argument(&cli, &typed_rest);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    err = cli_add_arguments(&cli, NELEM(early_rest), early_rest);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    err = cli_add_argument(&cli, &single);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_arguments(&cli, NELEM(bulk), bulk);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_argument(&cli, &rest);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_argument(&cli, &after);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    /* Arguments keep the order they were added in. */
+    SLIST_FOREACH(a, &cli.arguments, entry) {
+        g_assert_cmpuint(i, <, NELEM(expected));
+        g_assert_cmpstr(a->name, ==, expected[i]);
+        i++;
+    }
+    g_assert_cmpuint(i, ==, NELEM(expected));
+}
+
+static void
+test_parse_arguments(void)
+{
+    merr_t err;
+    int exit_code;
+    FILE *err_stream;
+    char *err_buf = NULL;
+    size_t err_sz = 0;
+    int count = 0;
+    bool verbose = false;
+    const char *name = NULL;
+    struct cli_slice files = { 0 };
+    struct cli cli = { .name = "test" };
+    struct cli_parser parser = { .program_name = "test" };
+    struct cli_option option = {
+        .shrt = 'v',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_BOOL,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = &verbose,
+    };
+    struct cli_argument arguments[] = {
+        { .name = "name", .type = CLI_TYPE_STRING, .data = &name },
+        { .name = "count", .type = CLI_TYPE_INT, .data = &count },
+        { .name = "files", .type = CLI_TYPE_STRING, .data = &files, .variadic = true },
+    };
+    char *args[] = { "test", "-v", "--", "-name", "42", "a.c", "-b.c" };
+    char *missing[] = { "test", "name" };
+    char *invalid[] = { "test", "name", "99999999999" };
+    char *none[] = { "test", "name", "7" };
+
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_arguments(&cli, NELEM(arguments), arguments);
+    g_assert_no_errno(merr_errno(err));
+
+    err_stream = open_memstream(&err_buf, &err_sz);
+    g_assert_nonnull(err_stream);
+    parser.err = err_stream;
+
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+    g_assert_true(verbose);
+    g_assert_true(name == args[3]);
+    g_assert_cmpint(count, ==, 42);
+
+    /* The variadic argument is a view of argv itself. */
+    g_assert_true(files.argv == args + 5);
+    g_assert_cmpuint(files.argc, ==, 2);
+
+    err = cli_parse_r(&cli, NELEM(none), none, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+    g_assert_cmpint(count, ==, 7);
+    g_assert_cmpuint(files.argc, ==, 0);
+
+    err = cli_parse_r(&cli, NELEM(missing), missing, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+
+    err = cli_parse_r(&cli, NELEM(invalid), invalid, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+
+    fclose(err_stream);
+    g_assert_nonnull(strstr(err_buf, "Missing argument: count"));
+    g_assert_nonnull(strstr(err_buf, "Invalid value for count: '99999999999'"));
+    g_assert_nonnull(strstr(err_buf, "Usage: test [OPTIONS]... name count [files]..."));
+
+    free(err_buf);
+}
+
+struct relative_options {
+    const char *first;
+    int count;
+};
+
+/* Arguments without data are only checked for, even when the others are
+ * offsets into the parser's data.
+ */
+static void
+test_parse_arguments_relative(void)
+{
+    merr_t err;
+    int exit_code;
+    struct relative_options options = { 0 };
+    struct cli cli = { .name = "test" };
+    struct cli_parser parser = { .program_name = "test", .data = &options };
+    struct cli_argument arguments[] = {
+        { .name = "command", .type = CLI_TYPE_STRING },
+        {
+            .name = "count",
+            .type = CLI_TYPE_INT,
+            .data = (void *)offsetof(struct relative_options, count),
+        },
+    };
+    char *args[] = { "test", "hello", "3" };
+
+    err = cli_add_arguments(&cli, NELEM(arguments), arguments);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+    g_assert_null(options.first);
+    g_assert_cmpint(options.count, ==, 3);
+}
+
+static void
+test_parse_append(void)
+{
+    merr_t err;
+    int exit_code;
+    FILE *err_stream;
+    char *err_buf = NULL;
+    size_t err_sz = 0;
+    GString *many;
+    struct cli_list dirs = { 0 };
+    struct cli_list ids = { 0 };
+    struct cli_list paths = { 0 };
+    struct cli cli = { .name = "test" };
+    struct cli_parser parser = { .program_name = "test" };
+    struct cli_option options[] = {
+        {
+            .shrt = 'I',
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_STRING,
+            .action = CLI_ACTION_APPEND,
+            .data = &dirs,
+        },
+        {
+            .shrt = 'i',
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_U32,
+            .action = CLI_ACTION_APPEND,
+            .delimiter = ',',
+            .data = &ids,
+        },
+        {
+            .shrt = 'p',
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_STRING,
+            .action = CLI_ACTION_APPEND,
+            .delimiter = ':',
+            .data = &paths,
+        },
+    };
+    char *args[] = {
+        "test", "-Iinclude", "-i", "1,2,3", "-p", "/bin::/usr/bin", "-I", "lib", "-i7",
+    };
+    char *invalid[] = { "test", "-i", "4,x,5" };
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+
+    /* Undelimited strings point into argv. */
+    g_assert_cmpuint(dirs.count, ==, 2);
+    g_assert_true(((const char **)dirs.items)[0] == args[1] + 2);
+    g_assert_true(((const char **)dirs.items)[1] == args[7]);
+
+    g_assert_cmpuint(ids.count, ==, 4);
+    g_assert_cmpuint(((uint32_t *)ids.items)[0], ==, 1);
+    g_assert_cmpuint(((uint32_t *)ids.items)[2], ==, 3);
+    g_assert_cmpuint(((uint32_t *)ids.items)[3], ==, 7);
+
+    g_assert_cmpuint(paths.count, ==, 3);
+    g_assert_cmpstr(((const char **)paths.items)[0], ==, "/bin");
+    g_assert_cmpstr(((const char **)paths.items)[1], ==, "");
+    g_assert_cmpstr(((const char **)paths.items)[2], ==, "/usr/bin");
+    g_assert_cmpstr(args[5], ==, "/bin::/usr/bin");
+
+    /* An invalid item leaves the list as it was. */
+    err_stream = open_memstream(&err_buf, &err_sz);
+    g_assert_nonnull(err_stream);
+    parser.err = err_stream;
+
+    err = cli_parse_r(&cli, NELEM(invalid), invalid, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+    g_assert_cmpuint(ids.count, ==, 4);
+
+    fclose(err_stream);
+    g_assert_nonnull(strstr(err_buf, "Invalid value for option '-i': '4,x,5'"));
+    free(err_buf);
+
+    /* Long enough to be split off the stack, with delimiters next to bytes
+     * which differ from them in a single bit.
+     */
+    cli_list_fini(&ids);
+    many = g_string_new(NULL);
+    for (unsigned int i = 0; i < 10000; i++)
+        g_string_append_printf(many, "%s%u", i ? "," : "", i * 7919);
+
+    {
+        char *list[] = { "test", "-i", many->str, "-p", ":-,:-" };
+
+        err = cli_parse_r(&cli, NELEM(list), list, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    g_assert_cmpuint(ids.count, ==, 10000);
+    for (unsigned int i = 0; i < 10000; i++)
+        g_assert_cmpuint(((uint32_t *)ids.items)[i], ==, i * 7919);
+
+    g_assert_cmpuint(paths.count, ==, 6);
+    g_assert_cmpstr(((const char **)paths.items)[3], ==, "");
+    g_assert_cmpstr(((const char **)paths.items)[4], ==, "-,");
+    g_assert_cmpstr(((const char **)paths.items)[5], ==, "-");
+
+    g_string_free(many, TRUE);
+    cli_list_fini(&dirs);
+    cli_list_fini(&ids);
+    cli_list_fini(&paths);
+    g_assert_null(paths.items);
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+static char *
+help_read(const struct cli * const cli, char ** const args, const int argc, const bool pipe_out)
+{
+    merr_t err;
+    char *buf;
+    FILE *stream;
+    size_t buf_sz;
+    int fds[2] = { -1, -1 };
+    int exit_code = -1;
+    struct cli_parser parser = { .program_name = "prog" };
+
+    if (pipe_out) {
+        g_assert_cmpint(pipe(fds), ==, 0);
+        stream = fdopen(fds[1], "w");
+    } else {
+        stream = open_memstream(&buf, &buf_sz);
+    }
+    g_assert_nonnull(stream);
+
+    /* Buffered output written before the help must come out first. */
+    fputs("before\n", stream);
+
+    parser.out = stream;
+    err = cli_parse_r(cli, argc, args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 0);
+
+    fclose(stream);
+    if (pipe_out) {
+        ssize_t n;
+
+        buf_sz = 0;
+        buf = g_malloc(4096);
+        while ((n = read(fds[0], buf + buf_sz, 4096 - 1 - buf_sz)) > 0)
+            buf_sz += (size_t)n;
+        buf[buf_sz] = '\0';
+        close(fds[0]);
+    }
+
+    return buf;
+}
+
+static void
+test_help(void)
+{
+    merr_t err;
+    char *out;
+    struct cli sub = { .name = "sub", .description = "A subcommand" };
+    struct cli longer = { .name = "longer-name" };
+    struct cli cli = { .name = "prog", .description = "Does things." };
+    struct cli_argument argument = {
+        .name = "file",
+        .description = "Input",
+        .type = CLI_TYPE_STRING,
+    };
+    struct cli_option options[] = {
+        { .shrt = 'h', .lng = "help", .description = "Show help", .action = CLI_ACTION_HELP },
+        { .shrt = 'n', .argument = CLI_HAS_ARG_REQUIRED, .action = CLI_ACTION_HELP },
+        {
+            .lng = "level",
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .description = "Level",
+            .action = CLI_ACTION_HELP,
+        },
+    };
+    char *args[] = { "prog", "--help", "x" };
+    static const char expected[] = "before\n"
+                                   "Usage: prog [OPTIONS]... file\n"
+                                   "\n"
+                                   "Does things.\n"
+                                   "\n"
+                                   "Arguments:\n"
+                                   "  file  Input\n"
+                                   "\n"
+                                   "Options:\n"
+                                   "       --level arg  Level\n"
+                                   "   -h, --help       Show help\n"
+                                   "   -n\n"
+                                   "\n"
+                                   "Subcommands:\n"
+                                   "  longer-name\n"
+                                   "  sub          A subcommand\n";
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_argument(&cli, &argument);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommand(&cli, &sub);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommand(&cli, &longer);
+    g_assert_no_errno(merr_errno(err));
+
+    for (int compiled = 0; compiled < 2; compiled++) {
+        for (int pipe_out = 0; pipe_out < 2; pipe_out++) {
+            out = help_read(&cli, args, NELEM(args), pipe_out);
+            g_assert_cmpstr(out, ==, expected);
+            free(out);
+        }
+
+        err = cli_compile(&cli);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    cli_fini(&cli);
+}
+#endif
+
+static void *
+parse_thread(void * const arg)
+{
+    char alpha[16];
+    const int id = (int)(intptr_t)arg;
+    char *args[] = { "test", "-a", alpha, "-ccc", "-n", alpha };
+
+    snprintf(alpha, sizeof(alpha), "%d", id);
+
+    for (int i = 0; i < 2000; i++) {
+        merr_t err;
+        int exit_code = -1;
+        struct thread_options options = { 0 };
+        struct cli_parser parser = { .data = &options };
+
+        err = cli_parse_r(&thread_cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(options.alpha, ==, id);
+        g_assert_cmpuint(options.count, ==, 3);
+        g_assert_true(options.name == alpha);
+    }
+
+    return NULL;
+}
+
+static void
+test_parse_r_threads(void)
+{
+    merr_t err;
+    GThread *threads[8];
+
+    err = cli_add_options(&thread_cli, NELEM(thread_cli_options), thread_cli_options);
+    g_assert_no_errno(merr_errno(err));
+
+    /* Half of the threads parse the uncompiled tree. */
+    for (size_t i = 0; i < NELEM(threads) / 2; i++)
+        threads[i] = g_thread_new("parse", parse_thread, (void *)(intptr_t)i);
+    for (size_t i = 0; i < NELEM(threads) / 2; i++)
+        g_thread_join(threads[i]);
+
+    err = cli_compile(&thread_cli);
+    g_assert_no_errno(merr_errno(err));
+
+    for (size_t i = 0; i < NELEM(threads); i++)
+        threads[i] = g_thread_new("parse", parse_thread, (void *)(intptr_t)i);
+    for (size_t i = 0; i < NELEM(threads); i++)
+        g_thread_join(threads[i]);
+
+    cli_fini(&thread_cli);
+}
+
+static void
+test_parse_r_streams(void)
+{
+    merr_t err;
+    char *buf;
+    FILE *stream;
+    size_t buf_sz;
+    int exit_code = 0;
+    struct cli_parser parser = { 0 };
+    struct cli cli = { .name = "test" };
+    struct cli_option option = { .shrt = 'h', .action = CLI_ACTION_HELP };
+    char *args[] = { "/usr/bin/test", "-z" };
+    static const char expected[] = "test: Invalid option: '-z'\nUsage: /usr/bin/test [OPTIONS]...\n";
+
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+
+    stream = open_memstream(&buf, &buf_sz);
+    g_assert_nonnull(stream);
+
+    parser.err = stream;
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+
+    fflush(stream);
+    g_assert_cmpuint(buf_sz, >=, sizeof(expected) - 1);
+    g_assert_cmpmem(buf, sizeof(expected) - 1, expected, sizeof(expected) - 1);
+
+    fclose(stream);
+    free(buf);
+}
+
+#ifndef CLI_NO_GETOPT_LONG
+static void
+test_parse_long_prefix(void)
+{
+    merr_t err;
+    unsigned int verb = 0;
+    unsigned int verbose = 0;
+    unsigned int version = 0;
+    const char *output = NULL;
+    struct cli cli = { .name = "test" };
+    struct cli_option options[] = {
+        {
+            .lng = "verb",
+            .type = CLI_TYPE_UINT,
+            .action = CLI_ACTION_ACCUMULATE,
+            .data = &verb,
+        },
+        {
+            .lng = "verbose",
+            .type = CLI_TYPE_UINT,
+            .action = CLI_ACTION_ACCUMULATE,
+            .data = &verbose,
+        },
+        {
+            .lng = "version",
+            .type = CLI_TYPE_UINT,
+            .action = CLI_ACTION_ACCUMULATE,
+            .data = &version,
+        },
+        {
+            .lng = "output",
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_STRING,
+            .action = CLI_ACTION_STORE,
+            .data = &output,
+        },
+    };
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+
+    /* Uncompiled, then through the prefix table. */
+    for (int pass = 0; pass < 2; pass++) {
+        char *buf;
+        FILE *stream;
+        size_t buf_sz;
+        int exit_code;
+        struct cli_parser parser = { 0 };
+        char *args[] = { "test", "--verb", "--verbo", "--vers", "--o=out" };
+        char *ambiguous[] = { "test", "--ver" };
+        char *invalid[] = { "test", "--verbosely" };
+
+        verb = verbose = version = 0;
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpuint(verb, ==, 1);
+        g_assert_cmpuint(verbose, ==, 1);
+        g_assert_cmpuint(version, ==, 1);
+        /* The value is not copied out of the argument. */
+        g_assert_true(output == args[4] + 4);
+
+        stream = open_memstream(&buf, &buf_sz);
+        g_assert_nonnull(stream);
+        parser.err = stream;
+
+        err = cli_parse_r(&cli, NELEM(ambiguous), ambiguous, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+
+        err = cli_parse_r(&cli, NELEM(invalid), invalid, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+
+        fclose(stream);
+        g_assert_nonnull(strstr(buf, "Ambiguous option: '--ver'\n"));
+        g_assert_nonnull(strstr(buf, "'--verb'"));
+        g_assert_nonnull(strstr(buf, "'--verbose'"));
+        g_assert_nonnull(strstr(buf, "'--version'"));
+        g_assert_null(strstr(buf, "'--output'"));
+        g_assert_nonnull(strstr(buf, "Invalid option: '--verbosely'\n"));
+        if (pass == 1)
+            g_assert_nonnull(strstr(buf, "Could be '--verb', '--verbose' or '--version'\n"));
+        free(buf);
+
+        err = cli_compile(&cli);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    cli_fini(&cli);
+}
+
+#define PREFIX_OPTIONS 300
+
+/* Whichever option each prefix of each name picks, through the prefix table
+ * and the linear scan of uncompiled trees alike.
+ */
+static void
+test_parse_long_prefix_random(void)
+{
+    merr_t err;
+    size_t optionc = 0;
+    uint64_t state = 0x2545f4914f6cdd1d;
+    unsigned int values[PREFIX_OPTIONS];
+    char names[PREFIX_OPTIONS][8];
+    struct cli_option options[PREFIX_OPTIONS];
+    struct cli cli = { .name = "test" };
+    struct cli_parser parser = { 0 };
+    int expected[PREFIX_OPTIONS][8];
+    static const char alphabet[] = "ab-";
+
+    memset(options, 0, sizeof(options));
+
+    while (optionc < PREFIX_OPTIONS) {
+        char *name = names[optionc];
+        size_t len;
+        bool unique = true;
+
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        len = 1 + state % (sizeof(names[0]) - 1);
+        for (size_t i = 0; i < len; i++)
+            name[i] = alphabet[(state >> (8 + 2 * i)) % 3];
+        name[len] = '\0';
+
+        for (size_t i = 0; i < optionc && unique; i++)
+            unique = strcmp(names[i], name) != 0;
+        if (!unique)
+            continue;
+
+        options[optionc].lng = name;
+        options[optionc].type = CLI_TYPE_UINT;
+        options[optionc].action = CLI_ACTION_ACCUMULATE;
+        options[optionc].data = &values[optionc];
+        optionc++;
+    }
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+
+    parser.err = fopen("/dev/null", "w");
+    g_assert_nonnull(parser.err);
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < optionc; i++) {
+            for (size_t len = 1; names[i][len - 1]; len++) {
+                int exit_code;
+                int found = -1;
+                char arg[16] = "--";
+                char *args[] = { "test", arg };
+
+                memcpy(arg + 2, names[i], len);
+                arg[2 + len] = '\0';
+
+                memset(values, 0, sizeof(values));
+                err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+                g_assert_no_errno(merr_errno(err));
+
+                for (size_t j = 0; j < optionc; j++) {
+                    if (values[j])
+                        found = (int)j;
+                }
+
+                if (exit_code != 0) {
+                    g_assert_cmpint(found, ==, -1);
+                    found = -2;
+                } else {
+                    g_assert_cmpint(found, >=, 0);
+                    g_assert_true(strncmp(names[found], names[i], len) == 0);
+                }
+
+                if (pass == 0) {
+                    expected[i][len - 1] = found;
+                } else {
+                    g_assert_cmpint(found, ==, expected[i][len - 1]);
+                }
+            }
+
+            /* A name always finds its own option. */
+            g_assert_cmpint(expected[i][strlen(names[i]) - 1], ==, (int)i);
+        }
+
+        err = cli_compile(&cli);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    fclose(parser.err);
+    cli_fini(&cli);
+}
+#endif
+
+static size_t allocations;
+
+static void *
+counting_reallocate(void * const ptr, const size_t size, void * const ctx)
+{
+    (void)ctx;
+
+    allocations++;
+
+    return realloc(ptr, size);
+}
+
+static void
+counting_deallocate(void * const ptr, void * const ctx)
+{
+    (void)ctx;
+
+    free(ptr);
+}
+
+static void
+test_parse_r_arena(void)
+{
+    merr_t err;
+    int exit_code;
+    char arena[16384];
+    struct thread_options options;
+    struct cli_parser parser = { 0 };
+    struct cli cli = { .name = "test" };
+    struct cli_option cli_options[NELEM(thread_cli_options)];
+    char *args[] = { "test", "-a", "1", "-cc", "-n", "name" };
+    static const struct cli_allocator counting = {
+        .reallocate = counting_reallocate,
+        .deallocate = counting_deallocate,
+    };
+
+    memcpy(cli_options, thread_cli_options, sizeof(cli_options));
+    err = cli_add_options(&cli, NELEM(cli_options), cli_options);
+    g_assert_no_errno(merr_errno(err));
+
+    cli_set_allocator(&counting);
+
+    parser.data = &options;
+
+    /* Uncompiled trees need scratch memory for their lookup tables. */
+    allocations = 0;
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpuint(allocations, >, 0);
+
+    /* Any memory will do, however it is aligned. */
+    parser.arena = arena + 1;
+    parser.arena_sz = sizeof(arena) - 1;
+
+    allocations = 0;
+    for (int i = 0; i < 100; i++) {
+        memset(&options, 0, sizeof(options));
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpint(options.alpha, ==, 1);
+        g_assert_cmpuint(options.count, ==, 2);
+    }
+    g_assert_cmpuint(allocations, ==, 0);
+
+    /* Compiled trees need no scratch memory at all. */
+    err = cli_compile(&cli);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpuint(allocations, >, 0);
+
+    parser.arena = NULL;
+    parser.arena_sz = 0;
+
+    allocations = 0;
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpuint(allocations, ==, 0);
+
+    /* Nor do response files, unless an argument names one. */
+    cli.flags |= CLI_FLAG_RESPONSE_FILES;
+
+    allocations = 0;
+    err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpuint(allocations, ==, 0);
+
+    cli_fini(&cli);
+    cli_set_allocator(NULL);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -54,6 +1099,27 @@ main(int argc, char *argv[])
 
     g_test_add_func("/parser/add_option/duplicates", test_add_option_duplicates);
     g_test_add_func("/parser/add_option/invalid-args", test_add_option_invald_args);
+    g_test_add_func("/parser/add_options", test_add_options);
+#ifndef CLI_NO_GETOPT_LONG
+    g_test_add_func("/parser/add_options/duplicate-long", test_add_options_duplicate_long);
+#endif
+    g_test_add_func("/parser/add_subcommands", test_add_subcommands);
+    g_test_add_func("/parser/add_arguments", test_add_arguments);
+    g_test_add_func("/parser/parse/arguments", test_parse_arguments);
+    g_test_add_func("/parser/parse/arguments/relative", test_parse_arguments_relative);
+    g_test_add_func("/parser/parse/append", test_parse_append);
+#ifndef CLI_NO_GETOPT_LONG
+    g_test_add_func("/parser/help", test_help);
+#endif
+    g_test_add_func("/parser/compile", test_compile);
+    g_test_add_func("/parser/compile/shorts", test_compile_shorts);
+    g_test_add_func("/parser/parse_r/threads", test_parse_r_threads);
+    g_test_add_func("/parser/parse_r/streams", test_parse_r_streams);
+    g_test_add_func("/parser/parse_r/arena", test_parse_r_arena);
+#ifndef CLI_NO_GETOPT_LONG
+    g_test_add_func("/parser/parse/long-prefix", test_parse_long_prefix);
+    g_test_add_func("/parser/parse/long-prefix-random", test_parse_long_prefix_random);
+#endif
 
     return g_test_run();
 }
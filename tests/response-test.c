@@ -0,0 +1,328 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+struct state {
+    int count;
+    const char *last;
+    int verbose;
+};
+
+static struct cli_option options[] = {
+    {
+        .shrt = 'f',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_STRING,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct state, last),
+    },
+    {
+        .shrt = 'v',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = (void *)offsetof(struct state, verbose),
+    },
+};
+
+static void
+callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    struct state *s = ctx;
+
+    (void)cli;
+
+    s->count++;
+    *exit_code = 0;
+}
+
+static char *
+write_file(const void * const contents, const size_t len)
+{
+    int fd;
+    char *path;
+    const char *dir = getenv("TMPDIR");
+
+    path = g_strdup_printf("%s/libcli-response-XXXXXX", dir ? dir : "/tmp");
+    fd = mkstemp(path);
+    g_assert_cmpint(fd, !=, -1);
+    g_assert_cmpint(write(fd, contents, len), ==, (ssize_t)len);
+    close(fd);
+
+    return path;
+}
+
+static void
+tree_init(struct cli * const cli)
+{
+    merr_t err;
+
+    memset(cli, 0, sizeof(*cli));
+    cli->name = "test";
+    cli->flags = CLI_FLAG_RESPONSE_FILES;
+    cli->callback = callback;
+
+    err = cli_add_options(cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+test_response_nested(void)
+{
+    merr_t err;
+    int exit_code;
+    struct cli cli;
+    struct state s = { 0 };
+    char *inner, *outer, *arg;
+    char outer_contents[256];
+    struct cli_parser parser = { .data = &s, .ctx = &s };
+    static const char inner_contents[] = "-f\r\nfrom-inner\n\n-v\n";
+
+    tree_init(&cli);
+
+    inner = write_file(inner_contents, sizeof(inner_contents) - 1);
+    snprintf(outer_contents, sizeof(outer_contents), "-v\n@%s\n-f\nfrom-outer", inner);
+    outer = write_file(outer_contents, strlen(outer_contents));
+    arg = g_strdup_printf("@%s", outer);
+
+    {
+        char *args[] = { "test", arg, "-v" };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    g_assert_cmpint(s.verbose, ==, 3);
+    g_assert_cmpstr(s.last, ==, "from-outer");
+    g_assert_nonnull(parser.responses);
+
+    cli_parser_fini(&parser);
+    g_assert_null(parser.responses);
+
+    unlink(inner);
+    unlink(outer);
+    g_free(arg);
+    g_free(outer);
+    g_free(inner);
+    cli_fini(&cli);
+}
+
+static void
+test_response_nul(void)
+{
+    merr_t err;
+    int exit_code;
+    struct cli cli;
+    char *path, *arg;
+    struct state s = { 0 };
+    struct cli_parser parser = { .data = &s, .ctx = &s };
+    static const char contents[] = "-f\0with\nnewline\0-v";
+
+    tree_init(&cli);
+
+    path = write_file(contents, sizeof(contents) - 1);
+    arg = g_strdup_printf("@%s", path);
+
+    {
+        char *args[] = { "test", arg };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    g_assert_cmpstr(s.last, ==, "with\nnewline");
+    g_assert_cmpint(s.verbose, ==, 1);
+
+    cli_parser_fini(&parser);
+    unlink(path);
+    g_free(arg);
+    g_free(path);
+    cli_fini(&cli);
+}
+
+static void
+test_response_page_boundary(void)
+{
+    merr_t err;
+    int exit_code;
+    struct cli cli;
+    char *path, *arg, *contents;
+    struct state s = { 0 };
+    struct cli_parser parser = { .data = &s, .ctx = &s };
+    const size_t page_sz = (size_t)sysconf(_SC_PAGESIZE);
+
+    tree_init(&cli);
+
+    /* An unterminated final entry which ends right on a page boundary. */
+    contents = g_malloc(page_sz);
+    memset(contents, 'x', page_sz);
+    memcpy(contents, "-f\n", 3);
+    path = write_file(contents, page_sz);
+    arg = g_strdup_printf("@%s", path);
+
+    {
+        char *args[] = { "test", arg };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    g_assert_nonnull(s.last);
+    g_assert_cmpuint(strlen(s.last), ==, page_sz - 3);
+
+    cli_parser_fini(&parser);
+    unlink(path);
+    g_free(arg);
+    g_free(path);
+    g_free(contents);
+    cli_fini(&cli);
+}
+
+static void
+test_response_arguments(void)
+{
+    merr_t err;
+    int exit_code;
+    char *path, *arg;
+    char arena[4096];
+    struct cli_slice files = { 0 };
+    struct cli_parser parser = { .arena = arena, .arena_sz = sizeof(arena) };
+    struct cli cli = { .name = "test", .flags = CLI_FLAG_RESPONSE_FILES };
+    struct cli_argument argument = {
+        .name = "files",
+        .type = CLI_TYPE_STRING,
+        .data = &files,
+        .variadic = true,
+    };
+    static const char contents[] = "a.c\nb.c\n";
+
+    err = cli_add_argument(&cli, &argument);
+    g_assert_no_errno(merr_errno(err));
+
+    path = write_file(contents, sizeof(contents) - 1);
+    arg = g_strdup_printf("@%s", path);
+
+    {
+        char *args[] = { "test", "first.c", arg, "last.c" };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    /* The slice outlives the parse along with the mapping, but not in the
+     * scratch memory the expansion started out in.
+     */
+    memset(arena, 0, sizeof(arena));
+    g_assert_cmpuint(files.argc, ==, 4);
+    g_assert_cmpstr(files.argv[0], ==, "first.c");
+    g_assert_cmpstr(files.argv[1], ==, "a.c");
+    g_assert_cmpstr(files.argv[2], ==, "b.c");
+    g_assert_cmpstr(files.argv[3], ==, "last.c");
+
+    cli_parser_fini(&parser);
+    unlink(path);
+    g_free(arg);
+    g_free(path);
+}
+
+static void
+test_response_errors(void)
+{
+    merr_t err;
+    int exit_code;
+    struct cli cli;
+    FILE *err_stream;
+    char *err_buf = NULL;
+    size_t err_sz = 0;
+    char *path, *arg;
+    char contents[256];
+    struct state s = { 0 };
+    struct cli_parser parser = { .program_name = "test", .data = &s, .ctx = &s };
+
+    tree_init(&cli);
+
+    err_stream = open_memstream(&err_buf, &err_sz);
+    g_assert_nonnull(err_stream);
+    parser.err = err_stream;
+
+    {
+        char *args[] = { "test", "@/nonexistent/response/file" };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, EX_NOINPUT);
+    }
+
+    /* A file which includes itself. */
+    path = write_file("", 0);
+    snprintf(contents, sizeof(contents), "@%s\n", path);
+    {
+        FILE *f = fopen(path, "w");
+
+        g_assert_nonnull(f);
+        fputs(contents, f);
+        fclose(f);
+    }
+    arg = g_strdup_printf("@%s", path);
+
+    {
+        char *args[] = { "test", arg };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, EX_NOINPUT);
+    }
+
+    fclose(err_stream);
+    g_assert_nonnull(strstr(err_buf, "/nonexistent/response/file"));
+    g_assert_cmpint(s.count, ==, 0);
+
+    /* Neither a lone @ nor anything after -- is expanded. */
+    {
+        char *args[] = { "test", "-f", "@", "--", arg };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpstr(s.last, ==, "@");
+    }
+
+    cli_parser_fini(&parser);
+    unlink(path);
+    free(err_buf);
+    g_free(arg);
+    g_free(path);
+    cli_fini(&cli);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/response/nested", test_response_nested);
+    g_test_add_func("/response/nul", test_response_nul);
+    g_test_add_func("/response/page-boundary", test_response_page_boundary);
+    g_test_add_func("/response/arguments", test_response_arguments);
+    g_test_add_func("/response/errors", test_response_errors);
+
+    return g_test_run();
+}
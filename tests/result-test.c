@@ -0,0 +1,384 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/result.h>
+
+static int verbose;
+static int jobs;
+static int yes;
+
+static void
+run_seen(const bool compile)
+{
+    merr_t err;
+    int exit_code;
+    struct cli_result result = { 0 };
+    struct cli_parser parser = { .result = &result };
+    struct cli root = { .name = "test" };
+    struct cli sub = { .name = "sub" };
+    struct cli_option options[] = {
+        {
+            .shrt = 'v',
+            .argument = CLI_HAS_ARG_NONE,
+            .type = CLI_TYPE_INT,
+            .action = CLI_ACTION_ACCUMULATE,
+            .data = &verbose,
+        },
+        {
+            .shrt = 'j',
+#ifndef CLI_NO_GETOPT_LONG
+            .lng = "jobs",
+#endif
+            .argument = CLI_HAS_ARG_REQUIRED,
+            .type = CLI_TYPE_INT,
+            .action = CLI_ACTION_STORE,
+            .data = &jobs,
+        },
+    };
+    struct cli_option sub_option = {
+        .shrt = 'y',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = &yes,
+    };
+
+    err = cli_add_options(&root, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_option(&sub, &sub_option);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_subcommand(&root, &sub);
+    g_assert_no_errno(merr_errno(err));
+    if (compile) {
+        err = cli_compile(&root);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    {
+        char *args[] = { "test", "-v", "-j", "4", "-vv", "sub", "-y" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+
+        g_assert_cmpuint(result.depth, ==, 2);
+        g_assert_true(cli_result_seen(&result, &root, &options[0]));
+        g_assert_cmpuint(cli_result_count(&result, &root, &options[0]), ==, 3);
+        g_assert_cmpint(cli_result_position(&result, &root, &options[0]), ==, 4);
+        g_assert_true(cli_result_seen(&result, &root, &options[1]));
+        g_assert_cmpuint(cli_result_count(&result, &root, &options[1]), ==, 1);
+        g_assert_cmpint(cli_result_position(&result, &root, &options[1]), ==, 2);
+        g_assert_true(cli_result_seen(&result, &sub, &sub_option));
+        g_assert_cmpint(cli_result_position(&result, &sub, &sub_option), ==, 6);
+    }
+
+    /* Parsing again forgets the previous parse. */
+    {
+        char *args[] = { "test", "-j2" };
+
+        err = cli_parse_r(&root, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+
+        g_assert_cmpuint(result.depth, ==, 1);
+        g_assert_false(cli_result_seen(&result, &root, &options[0]));
+        g_assert_cmpuint(cli_result_count(&result, &root, &options[0]), ==, 0);
+        g_assert_cmpint(cli_result_position(&result, &root, &options[0]), ==, -1);
+        g_assert_cmpint(cli_result_position(&result, &root, &options[1]), ==, 1);
+        g_assert_false(cli_result_seen(&result, &sub, &sub_option));
+    }
+
+    cli_result_fini(&result);
+    cli_fini(&root);
+}
+
+static void
+test_result_seen(void)
+{
+    run_seen(false);
+    run_seen(true);
+}
+
+/* Parses args and returns what was printed to stderr. */
+static char *
+parse_err(const struct cli * const cli, const int argc, char ** const argv, int * const exit_code)
+{
+    merr_t err;
+    FILE *stream;
+    char *buf = NULL;
+    size_t sz = 0;
+    struct cli_parser parser = { 0 };
+
+    stream = open_memstream(&buf, &sz);
+    g_assert_nonnull(stream);
+    parser.err = stream;
+
+    err = cli_parse_r(cli, argc, argv, exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    fclose(stream);
+
+    return buf;
+}
+
+static void
+run_constraints(const bool compile)
+{
+    merr_t err;
+    int exit_code;
+    char *buf;
+    int flags[5];
+    struct cli cli = { .name = "test" };
+    struct cli_option options[5];
+    struct cli_constraint exclusive = {
+        .type = CLI_CONSTRAINT_EXCLUSIVE,
+        .options = (const struct cli_option *[]){ &options[0], &options[1], &options[2], NULL },
+    };
+    struct cli_constraint requires = {
+        .type = CLI_CONSTRAINT_REQUIRES,
+        .options = (const struct cli_option *[]){ &options[3], &options[0], NULL },
+    };
+    struct cli_constraint one_of = {
+        .type = CLI_CONSTRAINT_ONE_OF,
+        .options = (const struct cli_option *[]){ &options[0], &options[1], &options[4], NULL },
+    };
+
+    for (size_t i = 0; i < NELEM(options); i++) {
+        options[i] = (struct cli_option){
+            .shrt = "abcde"[i],
+            .argument = CLI_HAS_ARG_NONE,
+            .type = CLI_TYPE_INT,
+            .action = CLI_ACTION_ACCUMULATE,
+            .data = &flags[i],
+        };
+    }
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_constraint(&cli, &exclusive);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_constraint(&cli, &requires);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_constraint(&cli, &one_of);
+    g_assert_no_errno(merr_errno(err));
+    if (compile) {
+        err = cli_compile(&cli);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    {
+        char *args[] = { "test", "-a", "-d", "-a" };
+
+        buf = parse_err(&cli, NELEM(args), args, &exit_code);
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_cmpstr(buf, ==, "");
+        free(buf);
+    }
+
+    {
+        char *args[] = { "test", "-e", "-c", "-a" };
+
+        buf = parse_err(&cli, NELEM(args), args, &exit_code);
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+        g_assert_nonnull(strstr(buf, "test: Options '-a' and '-c' are mutually exclusive\n"));
+        free(buf);
+    }
+
+    {
+        char *args[] = { "test", "-de" };
+
+        buf = parse_err(&cli, NELEM(args), args, &exit_code);
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+        g_assert_nonnull(strstr(buf, "test: Option '-d' requires '-a'\n"));
+        free(buf);
+    }
+
+    {
+        char *args[] = { "test", "-c" };
+
+        buf = parse_err(&cli, NELEM(args), args, &exit_code);
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+        g_assert_nonnull(
+            strstr(buf, "test: One of these options is required: '-a', '-b' or '-e'\n"));
+        free(buf);
+    }
+
+    cli_fini(&cli);
+}
+
+static void
+test_result_constraints(void)
+{
+    run_constraints(false);
+    run_constraints(true);
+}
+
+/* Constraints over options whose ordinals span several words of bitset. */
+static void
+test_result_many(void)
+{
+    merr_t err;
+    int exit_code;
+    char *buf;
+    enum { OPTIONS = 200 };
+    int flags[OPTIONS];
+    char (*names)[16];
+    struct cli_option *options;
+    struct cli cli = { .name = "test" };
+    struct cli_result result = { 0 };
+    struct cli_constraint exclusive = {
+        .type = CLI_CONSTRAINT_EXCLUSIVE,
+    };
+    const struct cli_option *exclusive_options[3];
+
+    names = g_malloc(OPTIONS * sizeof(*names));
+    options = g_malloc0(OPTIONS * sizeof(*options));
+    for (int i = 0; i < OPTIONS; i++) {
+        snprintf(names[i], sizeof(names[i]), "opt-%d", i);
+#ifndef CLI_NO_GETOPT_LONG
+        options[i].lng = names[i];
+#else
+        options[i].shrt = (char)(i + 1);
+#endif
+        options[i].argument = CLI_HAS_ARG_NONE;
+        options[i].type = CLI_TYPE_INT;
+        options[i].action = CLI_ACTION_ACCUMULATE;
+        options[i].data = &flags[i];
+    }
+
+    /* Registered in two batches, so ordinals continue across calls. */
+    err = cli_add_options(&cli, OPTIONS / 2, options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_options(&cli, OPTIONS - OPTIONS / 2, options + OPTIONS / 2);
+    g_assert_no_errno(merr_errno(err));
+
+    exclusive_options[0] = &options[3];
+    exclusive_options[1] = &options[190];
+    exclusive_options[2] = NULL;
+    exclusive.options = exclusive_options;
+    err = cli_add_constraint(&cli, &exclusive);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_compile(&cli);
+    g_assert_no_errno(merr_errno(err));
+
+#ifndef CLI_NO_GETOPT_LONG
+    {
+        char *args[] = { "test", "--opt-190", "--opt-100" };
+        struct cli_parser parser = { .result = &result };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+        g_assert_true(cli_result_seen(&result, &cli, &options[190]));
+        g_assert_true(cli_result_seen(&result, &cli, &options[100]));
+        g_assert_false(cli_result_seen(&result, &cli, &options[3]));
+    }
+
+    {
+        char *args[] = { "test", "--opt-190", "--opt-3" };
+
+        buf = parse_err(&cli, NELEM(args), args, &exit_code);
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+        g_assert_nonnull(strstr(buf, "Options '--opt-3' and '--opt-190' are mutually exclusive"));
+        free(buf);
+    }
+#else
+    {
+        char *args[] = { "test", "-\x04\xbf" };
+
+        buf = parse_err(&cli, NELEM(args), args, &exit_code);
+        g_assert_cmpint(exit_code, ==, EX_USAGE);
+        free(buf);
+    }
+#endif
+
+    cli_result_fini(&result);
+    cli_fini(&cli);
+    g_free(options);
+    g_free(names);
+}
+
+static void
+test_result_invalid(void)
+{
+    merr_t err;
+    int value;
+    struct cli cli = { .name = "test" };
+    struct cli other = { .name = "other" };
+    struct cli_option a = {
+        .shrt = 'a',
+        .argument = CLI_HAS_ARG_NONE,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_ACCUMULATE,
+        .data = &value,
+    };
+    struct cli_option b = a;
+    struct cli_option c = a;
+    struct cli_constraint single = {
+        .type = CLI_CONSTRAINT_EXCLUSIVE,
+        .options = (const struct cli_option *[]){ &a, NULL },
+    };
+    struct cli_constraint foreign = {
+        .type = CLI_CONSTRAINT_REQUIRES,
+        .options = (const struct cli_option *[]){ &a, &c, NULL },
+    };
+    struct cli_constraint valid = {
+        .type = CLI_CONSTRAINT_EXCLUSIVE,
+        .options = (const struct cli_option *[]){ &a, &b, NULL },
+    };
+
+    b.shrt = 'b';
+    c.shrt = 'c';
+
+    err = cli_add_option(&cli, &a);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_option(&cli, &b);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_option(&other, &c);
+    g_assert_no_errno(merr_errno(err));
+
+    err = cli_add_constraint(&cli, &single);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+    err = cli_add_constraint(&cli, &foreign);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    err = cli_add_constraint(&cli, &valid);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_constraint(&cli, &valid);
+    g_assert_cmpint(merr_errno(err), ==, ENOTUNIQ);
+
+    err = cli_compile(&cli);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_constraint(&cli, &single);
+    g_assert_cmpint(merr_errno(err), ==, EBUSY);
+
+    cli_fini(&cli);
+    cli_fini(&other);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/result/seen", test_result_seen);
+    g_test_add_func("/result/constraints", test_result_constraints);
+    g_test_add_func("/result/many", test_result_many);
+    g_test_add_func("/result/invalid", test_result_invalid);
+
+    return g_test_run();
+}
@@ -0,0 +1,439 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/server.h>
+
+#define CLIENTS 8
+#define CALLS 50
+
+struct request_options {
+    int value;
+    const char *name;
+};
+
+static struct cli_option options[] = {
+    {
+        .shrt = 'n',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = (void *)offsetof(struct request_options, value),
+    },
+};
+
+static struct cli_argument arguments[] = {
+    {
+        .name = "name",
+        .type = CLI_TYPE_STRING,
+        .data = (void *)offsetof(struct request_options, name),
+    },
+};
+
+static void
+callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    const struct request_options * const opts = ctx;
+
+    (void)cli;
+
+    fprintf(cli_server_out(), "%s=%d\n", opts->name, opts->value);
+    *exit_code = opts->value;
+}
+
+struct fixture {
+    char dir[64];
+    char path[80];
+    struct request_options defaults;
+    struct cli cli;
+    struct cli_server server;
+};
+
+static void
+fixture_start(struct fixture * const f, const unsigned int workers)
+{
+    merr_t err;
+
+    memset(f, 0, sizeof(*f));
+    strcpy(f->dir, "/tmp/libcli-server-XXXXXX");
+    g_assert_nonnull(mkdtemp(f->dir));
+    snprintf(f->path, sizeof(f->path), "%s/sock", f->dir);
+
+    f->cli.name = "test";
+    f->cli.callback = callback;
+    err = cli_add_options(&f->cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+    err = cli_add_arguments(&f->cli, NELEM(arguments), arguments);
+    g_assert_no_errno(merr_errno(err));
+
+    f->server.path = f->path;
+    f->server.workers = workers;
+    f->server.parser.data = &f->defaults;
+    f->server.data_sz = sizeof(f->defaults);
+
+    err = cli_server_start(&f->server, &f->cli);
+    g_assert_no_errno(merr_errno(err));
+}
+
+static void
+fixture_stop(struct fixture * const f)
+{
+    cli_server_stop(&f->server);
+    g_assert_cmpint(access(f->path, F_OK), ==, -1);
+    rmdir(f->dir);
+    cli_fini(&f->cli);
+}
+
+static void
+call(
+    struct cli_client * const client,
+    char * const argv[],
+    const int argc,
+    char * const out,
+    const size_t out_sz,
+    char * const err_out,
+    const size_t err_sz,
+    int * const exit_code)
+{
+    merr_t err;
+    ssize_t n;
+    int out_pipe[2];
+    int err_pipe[2];
+
+    g_assert_cmpint(pipe(out_pipe), ==, 0);
+    g_assert_cmpint(pipe(err_pipe), ==, 0);
+
+    err = cli_client_call(client, argc, argv, out_pipe[1], err_pipe[1], exit_code);
+    g_assert_no_errno(merr_errno(err));
+
+    /* The server closed its copies before answering. */
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+
+    n = read(out_pipe[0], out, out_sz - 1);
+    g_assert_cmpint(n, >=, 0);
+    out[n] = '\0';
+    n = read(err_pipe[0], err_out, err_sz - 1);
+    g_assert_cmpint(n, >=, 0);
+    err_out[n] = '\0';
+
+    close(out_pipe[0]);
+    close(err_pipe[0]);
+}
+
+static void
+test_server_call(void)
+{
+    merr_t err;
+    int exit_code;
+    char out[128];
+    char err_out[512];
+    struct fixture f;
+    struct cli_client client;
+    char *argv[] = { "test", "-n", "7", "first" };
+    char *again[] = { "test", "second" };
+
+    fixture_start(&f, 1);
+
+    err = cli_client_connect(&client, f.path);
+    g_assert_no_errno(merr_errno(err));
+
+    call(&client, argv, NELEM(argv), out, sizeof(out), err_out, sizeof(err_out), &exit_code);
+    g_assert_cmpint(exit_code, ==, 7);
+    g_assert_cmpstr(out, ==, "first=7\n");
+    g_assert_cmpstr(err_out, ==, "");
+
+    /* Every request starts from the server's data, not the last request's. */
+    call(&client, again, NELEM(again), out, sizeof(out), err_out, sizeof(err_out), &exit_code);
+    g_assert_cmpint(exit_code, ==, 0);
+    g_assert_cmpstr(out, ==, "second=0\n");
+    g_assert_null(f.defaults.name);
+
+    cli_client_close(&client);
+    fixture_stop(&f);
+}
+
+/* Output to a pipe nobody reads fails that request alone. */
+static void
+test_server_closed_reader(void)
+{
+    merr_t err;
+    int exit_code;
+    int pipefd[2];
+    char out[128];
+    char err_out[512];
+    struct fixture f;
+    struct cli_client client;
+    char *argv[] = { "test", "-n", "3", "gone" };
+    char *again[] = { "test", "-n", "4", "back" };
+
+    fixture_start(&f, 1);
+
+    err = cli_client_connect(&client, f.path);
+    g_assert_no_errno(merr_errno(err));
+
+    g_assert_cmpint(pipe(pipefd), ==, 0);
+    close(pipefd[0]);
+
+    err = cli_client_call(&client, NELEM(argv), argv, pipefd[1], -1, &exit_code);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, 3);
+    close(pipefd[1]);
+
+    call(&client, again, NELEM(again), out, sizeof(out), err_out, sizeof(err_out), &exit_code);
+    g_assert_cmpint(exit_code, ==, 4);
+    g_assert_cmpstr(out, ==, "back=4\n");
+
+    cli_client_close(&client);
+    fixture_stop(&f);
+}
+
+struct client_arg {
+    const char *path;
+    int id;
+};
+
+static void *
+client_thread(void * const arg)
+{
+    merr_t err;
+    struct cli_client client;
+    const struct client_arg * const c = arg;
+
+    err = cli_client_connect(&client, c->path);
+    g_assert_no_errno(merr_errno(err));
+
+    for (int i = 0; i < CALLS; i++) {
+        int exit_code;
+        char value[16];
+        char name[16];
+        char expected[48];
+        char out[64];
+        char err_out[64];
+        char *argv[] = { "test", "-n", value, name };
+
+        snprintf(value, sizeof(value), "%d", c->id * 2 + i % 2);
+        snprintf(name, sizeof(name), "c%d-%d", c->id, i);
+        snprintf(expected, sizeof(expected), "%s=%s\n", name, value);
+
+        call(&client, argv, NELEM(argv), out, sizeof(out), err_out, sizeof(err_out), &exit_code);
+        g_assert_cmpint(exit_code, ==, c->id * 2 + i % 2);
+        g_assert_cmpstr(out, ==, expected);
+    }
+
+    cli_client_close(&client);
+
+    return NULL;
+}
+
+static void
+test_server_concurrent(void)
+{
+    struct fixture f;
+    pthread_t threads[CLIENTS];
+    struct client_arg args[CLIENTS];
+
+    fixture_start(&f, 4);
+
+    for (int i = 0; i < CLIENTS; i++) {
+        args[i].path = f.path;
+        args[i].id = i + 1;
+        g_assert_cmpint(pthread_create(&threads[i], NULL, client_thread, &args[i]), ==, 0);
+    }
+
+    for (int i = 0; i < CLIENTS; i++)
+        pthread_join(threads[i], NULL);
+
+    fixture_stop(&f);
+}
+
+static void
+test_server_usage(void)
+{
+    merr_t err;
+    int exit_code;
+    char out[128];
+    char err_out[512];
+    struct fixture f;
+    struct cli_client client;
+    char *argv[] = { "prog", "-x", "name" };
+
+    fixture_start(&f, 2);
+
+    err = cli_client_connect(&client, f.path);
+    g_assert_no_errno(merr_errno(err));
+
+    call(&client, argv, NELEM(argv), out, sizeof(out), err_out, sizeof(err_out), &exit_code);
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+    g_assert_cmpstr(out, ==, "");
+    g_assert_nonnull(strstr(err_out, "prog"));
+    g_assert_nonnull(strstr(err_out, "-x"));
+
+    cli_client_close(&client);
+    fixture_stop(&f);
+}
+
+static void
+test_server_invalid(void)
+{
+    merr_t err;
+    FILE *file;
+    struct fixture f;
+    struct cli_client client;
+    struct cli_server server = { 0 };
+    struct cli cli = { .name = "test" };
+
+    err = cli_server_start(&server, &cli);
+    g_assert_cmpint(merr_errno(err), ==, EINVAL);
+
+    err = cli_client_connect(&client, "/nonexistent/libcli.sock");
+    g_assert_cmpint(merr_errno(err), ==, ENOENT);
+
+    /* Anything but a socket at the path is left alone. */
+    fixture_start(&f, 1);
+    cli_server_stop(&f.server);
+    file = fopen(f.path, "w");
+    g_assert_nonnull(file);
+    fclose(file);
+    err = cli_server_start(&f.server, &f.cli);
+    g_assert_cmpint(merr_errno(err), ==, EEXIST);
+    unlink(f.path);
+    rmdir(f.dir);
+    cli_fini(&f.cli);
+}
+
+/* A connection which speaks the protocol by hand, header first. */
+static int
+raw_connect(const char * const path, const uint32_t argc, const uint32_t size)
+{
+    int fd;
+    ssize_t n;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    const uint32_t header[] = { 0x6c69636c, argc, size, 0 };
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    g_assert_cmpint(fd, >=, 0);
+    strcpy(addr.sun_path, path);
+    g_assert_cmpint(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+
+    n = write(fd, header, sizeof(header));
+    g_assert_cmpint(n, ==, (ssize_t)sizeof(header));
+
+    return fd;
+}
+
+/* More arguments than bytes to hold them is refused before anything is
+ * sized by it.
+ */
+static void
+test_server_malformed(void)
+{
+    int fd;
+    char buf[8];
+    ssize_t n;
+    struct fixture f;
+
+    fixture_start(&f, 1);
+
+    fd = raw_connect(f.path, UINT32_MAX, 4);
+    n = write(fd, "abc", 4);
+    g_assert_cmpint(n, ==, 4);
+    /* Hung up on, possibly with the arguments still unread. */
+    n = read(fd, buf, sizeof(buf));
+    g_assert_cmpint(n, <=, 0);
+    close(fd);
+
+    fixture_stop(&f);
+}
+
+/* Stopping abandons a request whose arguments never arrive. */
+static void
+test_server_stalled(void)
+{
+    int fd;
+    struct fixture f;
+
+    fixture_start(&f, 1);
+
+    fd = raw_connect(f.path, 1, 16);
+    /* Give the worker time to start waiting for the rest. */
+    nanosleep(&(struct timespec){ .tv_nsec = 10000000 }, NULL);
+
+    fixture_stop(&f);
+    close(fd);
+}
+
+/* Connected clients which send nothing hold no worker. */
+static void
+test_server_idle(void)
+{
+    merr_t err;
+    int exit_code;
+    char out[128];
+    char err_out[512];
+    struct fixture f;
+    struct cli_client idle[2];
+    struct cli_client client;
+    char *argv[] = { "test", "-n", "3", "busy" };
+
+    fixture_start(&f, NELEM(idle));
+
+    for (size_t i = 0; i < NELEM(idle); i++) {
+        err = cli_client_connect(&idle[i], f.path);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    err = cli_client_connect(&client, f.path);
+    g_assert_no_errno(merr_errno(err));
+
+    call(&client, argv, NELEM(argv), out, sizeof(out), err_out, sizeof(err_out), &exit_code);
+    g_assert_cmpint(exit_code, ==, 3);
+    g_assert_cmpstr(out, ==, "busy=3\n");
+
+    /* Nor do the idle clients lose their place. */
+    call(&idle[0], argv, NELEM(argv), out, sizeof(out), err_out, sizeof(err_out), &exit_code);
+    g_assert_cmpint(exit_code, ==, 3);
+
+    cli_client_close(&client);
+    for (size_t i = 0; i < NELEM(idle); i++)
+        cli_client_close(&idle[i]);
+    fixture_stop(&f);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/server/call", test_server_call);
+    g_test_add_func("/server/closed-reader", test_server_closed_reader);
+    g_test_add_func("/server/concurrent", test_server_concurrent);
+    g_test_add_func("/server/usage", test_server_usage);
+    g_test_add_func("/server/invalid", test_server_invalid);
+    g_test_add_func("/server/malformed", test_server_malformed);
+    g_test_add_func("/server/stalled", test_server_stalled);
+    g_test_add_func("/server/idle", test_server_idle);
+
+    return g_test_run();
+}
@@ -0,0 +1,207 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+#include <libcli/stats.h>
+
+static int count;
+static int calls;
+
+static struct cli_option options[] = {
+    {
+        .shrt = 'n',
+        .argument = CLI_HAS_ARG_REQUIRED,
+        .type = CLI_TYPE_INT,
+        .action = CLI_ACTION_STORE,
+        .data = &count,
+    },
+    {
+        .shrt = 'h',
+        .argument = CLI_HAS_ARG_NONE,
+        .action = CLI_ACTION_HELP,
+    },
+};
+
+static void
+callback(const struct cli * const cli, int * const exit_code, void * const ctx)
+{
+    (void)cli;
+    (void)ctx;
+
+    calls++;
+    *exit_code = 0;
+}
+
+static void
+test_stats_phases(void)
+{
+    merr_t err;
+    int exit_code;
+    FILE *out;
+    char *buf = NULL;
+    size_t sz = 0;
+    struct cli_stats stats;
+    struct cli cli = { .name = "test", .callback = callback };
+
+    cli_stats_enable(true);
+    cli_stats_reset();
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+
+    out = open_memstream(&buf, &sz);
+    g_assert_nonnull(out);
+
+    {
+        char *args[] = { "test", "-n", "3", "-h" };
+        struct cli_parser parser = { .out = out };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+    }
+
+    fclose(out);
+    free(buf);
+
+    cli_stats_get(&stats);
+    g_assert_cmpuint(stats.phases[CLI_STATS_REGISTER].calls, ==, 1);
+    g_assert_cmpuint(stats.phases[CLI_STATS_INDEX].calls, ==, 1);
+    g_assert_cmpuint(stats.phases[CLI_STATS_PARSE].calls, ==, 1);
+    g_assert_cmpuint(stats.phases[CLI_STATS_CONVERT].calls, ==, 1);
+    g_assert_cmpuint(stats.phases[CLI_STATS_HELP].calls, ==, 1);
+    g_assert_cmpuint(stats.phases[CLI_STATS_CALLBACK].calls, ==, 1);
+    g_assert_cmpuint(stats.phases[CLI_STATS_CONFIG].calls, ==, 0);
+    g_assert_cmpuint(stats.phases[CLI_STATS_PARSE].ns, >, 0);
+    g_assert_cmpuint(
+        stats.phases[CLI_STATS_PARSE].ns, >=, stats.phases[CLI_STATS_CONVERT].ns);
+    g_assert_cmpuint(stats.allocs, >, 0);
+    g_assert_cmpuint(stats.alloc_bytes, >, 0);
+
+    /* Nothing is collected while disabled. */
+    cli_stats_enable(false);
+    cli_stats_reset();
+
+    {
+        char *args[] = { "test", "-n", "4" };
+        struct cli_parser parser = { 0 };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(count, ==, 4);
+    }
+
+    cli_stats_get(&stats);
+    for (int i = 0; i < CLI_STATS_PHASES; i++)
+        g_assert_cmpuint(stats.phases[i].calls, ==, 0);
+    g_assert_cmpuint(stats.allocs, ==, 0);
+
+    cli_fini(&cli);
+}
+
+static void
+test_stats_argument(void)
+{
+    merr_t err;
+    int exit_code;
+    FILE *err_stream;
+    char *buf = NULL;
+    size_t sz = 0;
+    struct cli cli = { .name = "test", .flags = CLI_FLAG_STATS, .callback = callback };
+
+    cli_stats_enable(false);
+    cli_stats_reset();
+    calls = 0;
+
+    err = cli_add_options(&cli, NELEM(options), options);
+    g_assert_no_errno(merr_errno(err));
+
+    err_stream = open_memstream(&buf, &sz);
+    g_assert_nonnull(err_stream);
+
+    {
+        char *args[] = { "test", "--cli-stats", "-n", "5" };
+        struct cli_parser parser = { .err = err_stream };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, ==, 0);
+    }
+
+    fclose(err_stream);
+
+    /* The rest of the command line is parsed as usual. */
+    g_assert_cmpint(count, ==, 5);
+    g_assert_cmpint(calls, ==, 1);
+    g_assert_nonnull(strstr(buf, "callback"));
+    g_assert_nonnull(strstr(buf, "convert"));
+    free(buf);
+
+    /* Statistics are off again, and each parse only prints its own. */
+    {
+        struct cli_stats stats;
+        char *args[] = { "test", "-n", "6" };
+        char *again[] = { "test", "--cli-stats", "-n", "7" };
+        struct cli_parser parser = { 0 };
+
+        cli_stats_get(&stats);
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpuint(stats.phases[CLI_STATS_PARSE].calls, ==, 1);
+        cli_stats_get(&stats);
+        g_assert_cmpuint(stats.phases[CLI_STATS_PARSE].calls, ==, 1);
+
+        err_stream = open_memstream(&buf, &sz);
+        g_assert_nonnull(err_stream);
+        parser.err = err_stream;
+
+        err = cli_parse_r(&cli, NELEM(again), again, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(count, ==, 7);
+
+        fclose(err_stream);
+        g_assert_nonnull(strstr(buf, "\nparse               1 "));
+        free(buf);
+    }
+
+    /* Without the flag, the argument is an ordinary unknown option. */
+    cli.flags = 0;
+    err_stream = open_memstream(&buf, &sz);
+    g_assert_nonnull(err_stream);
+
+    {
+        char *args[] = { "test", "--cli-stats" };
+        struct cli_parser parser = { .err = err_stream, .out = err_stream };
+
+        err = cli_parse_r(&cli, NELEM(args), args, &exit_code, &parser);
+        g_assert_no_errno(merr_errno(err));
+        g_assert_cmpint(exit_code, !=, 0);
+    }
+
+    fclose(err_stream);
+    free(buf);
+
+    cli_stats_enable(false);
+    cli_fini(&cli);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/stats/phases", test_stats_phases);
+    g_test_add_func("/stats/argument", test_stats_argument);
+
+    return g_test_run();
+}
@@ -0,0 +1,183 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * SPDX-FileCopyrightText: 2023 Tristan Partin <tristan@partin.io>
+ */
+
+#include "util.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include <glib.h>
+#include <merr.h>
+
+#include <libcli/parser.h>
+
+#include "suggest.h"
+
+/* The textbook dynamic program, to check the bit-parallel one against. */
+static unsigned int
+levenshtein(const char * const a, const size_t m, const char * const b, const size_t n)
+{
+    unsigned int row[128];
+
+    g_assert_cmpuint(n, <, NELEM(row));
+
+    for (size_t j = 0; j <= n; j++)
+        row[j] = (unsigned int)j;
+
+    for (size_t i = 1; i <= m; i++) {
+        unsigned int diag = row[0];
+
+        row[0] = (unsigned int)i;
+        for (size_t j = 1; j <= n; j++) {
+            const unsigned int up = row[j];
+            unsigned int best = diag + (a[i - 1] != b[j - 1]);
+
+            if (up + 1 < best)
+                best = up + 1;
+            if (row[j - 1] + 1 < best)
+                best = row[j - 1] + 1;
+
+            diag = up;
+            row[j] = best;
+        }
+    }
+
+    return row[n];
+}
+
+static void
+test_suggest_distance(void)
+{
+    uint64_t state = 0x853c49e6748fea9bULL;
+
+    for (int i = 0; i < 100000; i++) {
+        char a[65], b[80];
+        size_t m, n;
+        unsigned int expected, got;
+        struct cli_suggestions sg;
+
+        /* A small alphabet makes for plenty of partial matches. */
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        m = 1 + state % 64;
+        n = (state >> 8) % 80;
+        for (size_t j = 0; j < m; j++)
+            a[j] = (char)('a' + (state >> (j % 48)) % 4);
+        for (size_t j = 0; j < n; j++)
+            b[j] = j < m && (state >> (j % 32)) % 5 ? a[j] : (char)('a' + (state >> (j % 40)) % 4);
+
+        cli_suggestions_init(&sg, a, m);
+        expected = levenshtein(a, m, b, n);
+
+        got = cli_suggestions_distance(&sg, b, n, 1000);
+        g_assert_cmpuint(got, ==, expected);
+
+        /* Bounded, anything past the bound only has to say so. */
+        got = cli_suggestions_distance(&sg, b, n, 3);
+        if (expected <= 3) {
+            g_assert_cmpuint(got, ==, expected);
+        } else {
+            g_assert_cmpuint(got, >, 3);
+        }
+    }
+}
+
+static void
+test_suggest_names(void)
+{
+    struct cli_suggestions sg;
+    static const char *names[] = { "build", "bench", "install", "init", "guild" };
+
+    /* Every name at the smallest distance is kept. */
+    cli_suggestions_init(&sg, "uild", 4);
+    for (size_t i = 0; i < NELEM(names); i++)
+        cli_suggestions_add(&sg, names[i]);
+    g_assert_cmpuint(sg.count, ==, 2);
+    g_assert_cmpstr(sg.names[0], ==, "build");
+    g_assert_cmpstr(sg.names[1], ==, "guild");
+
+    /* A transposition is two edits. */
+    cli_suggestions_init(&sg, "biuld", 5);
+    for (size_t i = 0; i < NELEM(names); i++)
+        cli_suggestions_add(&sg, names[i]);
+    g_assert_cmpuint(sg.count, ==, 1);
+    g_assert_cmpstr(sg.names[0], ==, "build");
+
+    cli_suggestions_init(&sg, "instal", 6);
+    for (size_t i = 0; i < NELEM(names); i++)
+        cli_suggestions_add(&sg, names[i]);
+    g_assert_cmpuint(sg.count, ==, 1);
+    g_assert_cmpstr(sg.names[0], ==, "install");
+
+    cli_suggestions_init(&sg, "zzzzzz", 6);
+    for (size_t i = 0; i < NELEM(names); i++)
+        cli_suggestions_add(&sg, names[i]);
+    g_assert_cmpuint(sg.count, ==, 0);
+}
+
+static void
+test_suggest_parse(void)
+{
+    merr_t err;
+    int exit_code;
+    FILE *stream;
+    char *buf = NULL;
+    size_t buf_sz = 0;
+    struct cli cli = { .name = "prog" };
+    struct cli_parser parser = { .program_name = "prog" };
+    struct cli subcommands[] = { { .name = "build" }, { .name = "bench" }, { .name = "run" } };
+    char *sub[] = { "prog", "bnech" };
+#ifndef CLI_NO_GETOPT_LONG
+    struct cli_option option = {
+        .lng = "verbose",
+        .action = CLI_ACTION_HELP,
+    };
+    char *opt[] = { "prog", "--verbsoe" };
+
+    err = cli_add_option(&cli, &option);
+    g_assert_no_errno(merr_errno(err));
+#endif
+
+    err = cli_add_subcommands(&cli, NELEM(subcommands), subcommands);
+    g_assert_no_errno(merr_errno(err));
+
+    stream = open_memstream(&buf, &buf_sz);
+    g_assert_nonnull(stream);
+    parser.err = stream;
+
+    err = cli_parse_r(&cli, NELEM(sub), sub, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+
+#ifndef CLI_NO_GETOPT_LONG
+    err = cli_parse_r(&cli, NELEM(opt), opt, &exit_code, &parser);
+    g_assert_no_errno(merr_errno(err));
+    g_assert_cmpint(exit_code, ==, EX_USAGE);
+#endif
+
+    fclose(stream);
+    g_assert_nonnull(strstr(buf, "prog: Unknown subcommand: bnech\nprog: Did you mean 'bench'?\n"));
+#ifndef CLI_NO_GETOPT_LONG
+    g_assert_nonnull(strstr(buf, "prog: Did you mean '--verbose'?\n"));
+#endif
+
+    free(buf);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/suggest/distance", test_suggest_distance);
+    g_test_add_func("/suggest/names", test_suggest_names);
+    g_test_add_func("/suggest/parse", test_suggest_parse);
+
+    return g_test_run();
+}